@@ -0,0 +1,1024 @@
+// clock_gettime and getaddrinfo are POSIX interfaces, request them explicitly
+// when building with -std=c99
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include "ipv6.h"
+#include "ipv6_gen.h"
+#include "ipv6_counters.h"
+#include "ipv6_clock.h"
+#include "ipv6_classify.h"
+#include "bench_inline.h"
+#include "ipv6_config.h"
+#include "ipv6_test_config.h"
+
+#ifdef HAVE_STDIO_H
+#include <stdio.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <stdlib.h>
+
+#ifdef HAVE_TIME_H
+#include <time.h>
+#endif
+
+#ifdef HAVE_WINSOCK_2_H
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <winsock2.h>
+#endif
+
+#ifdef HAVE_WS_2_TCPIP_H
+#include <ws2tcpip.h>
+#endif
+
+#ifdef HAVE_SYS_SOCKET_H
+#include <sys/socket.h>
+#endif
+
+#ifdef HAVE_NETINET_IN_H
+#include <netinet/in.h>
+#endif
+
+#ifdef HAVE_ARPA_INET_H
+#include <arpa/inet.h>
+#endif
+
+#ifdef HAVE_NETDB_H
+#include <netdb.h>
+#endif
+
+#if (defined(HAVE_ARPA_INET_H) && defined(HAVE_NETDB_H)) || defined(HAVE_WS_2_TCPIP_H)
+#define BENCH_HAVE_LIBC 1
+#endif
+
+#if defined(HAVE_X86INTRIN_H)
+#include <x86intrin.h>
+#define BENCH_HAVE_TSC 1
+#elif defined(HAVE_INTRIN_H) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define BENCH_HAVE_TSC 1
+#endif
+
+//
+// Address parsing micro-benchmark
+//
+// Each corpus is a set of address strings of a single form produced by the
+// corpus generator (ipv6_gen.h), so results are reproducible from the seed. The
+// operations under test are run over the corpus in batches of BATCH_SIZE
+// addresses, each batch yields one ns/address (and cycles/address) sample.
+// The median and p99 of those samples are reported to stdout and to a JSON
+// file for tracking results between builds.
+//
+// When the platform provides them the same corpora are also run through
+// inet_pton, inet_ntop and getaddrinfo(AI_NUMERICHOST), and every input where
+// libc and this library disagree on acceptance, value or formatting is
+// counted and optionally written to an agreement report (--agreement FILE).
+//
+// Results are only meaningful for optimized builds:
+//
+//     cmake -DCMAKE_BUILD_TYPE=Release ..
+//     bin/ipv6-bench --json bench.json
+//
+// A build with -DPARSE_COUNTERS=1 can dump the parser's transition, token and
+// zero-run counters of the timed ipv6_from_str rounds of each corpus
+// (--counters).
+//
+// The "/inline" operations run the same loops built against the header-only
+// parser (IPV6_PARSE_HEADER_ONLY, see bench_inline.c) to show the gain of
+// inlining the API into the caller over calling the library.
+//
+
+#define LENGTHOF(x) ((uint32_t)(sizeof(x)/sizeof(x[0])))
+
+// Number of addresses timed together for a single sample
+#define BATCH_SIZE 64
+
+// Maximum size of a generated address string including the nul byte
+#define BENCH_STRING_SIZE IPV6_GEN_STRING_SIZE
+
+// Size of an ip6.arpa name of every nibble including the nul byte
+#define BENCH_ARPA_SIZE (32 * 2 + sizeof "ip6.arpa")
+
+// Capture the command line options for the run
+typedef struct {
+    uint32_t                count;          // addresses per corpus
+    uint32_t                rounds;         // passes over each corpus
+    uint32_t                invalid_pct;    // percentage of invalid inputs in the mixed corpus
+    uint32_t                prefixes;       // distinct /48 prefixes in the corpora
+    double                  zipf;           // prefix skew
+    uint64_t                seed;           // seed for corpus generation
+    const char*             json_path;      // output file for JSON results, NULL to disable
+    const char*             agreement_path; // output file for libc disagreements, NULL to disable
+    const char*             only;           // run only the named corpus
+    bool                    libc;           // include the libc comparison
+    bool                    counters;       // print parser counters per corpus
+} bench_options_t;
+
+// Flat storage for a corpus of address strings
+typedef struct {
+    const char*             name;
+    char*                   strings;        // count * BENCH_STRING_SIZE bytes
+    size_t*                 lengths;
+    ipv6_address_full_t*    parsed;         // parse results, used as input for to_str / compare
+    bool*                   valid;
+    char*                   arpa;           // count * BENCH_ARPA_SIZE bytes of reverse names of parsed
+    size_t*                 arpa_lengths;
+    uint32_t                count;
+    uint32_t                valid_count;
+#if defined(BENCH_HAVE_LIBC)
+    uint8_t*                libc_bytes;     // count * 16 bytes of inet_pton output
+    int*                    libc_family;    // AF_INET, AF_INET6 or 0 when inet_pton rejected the input
+#endif
+} bench_corpus_t;
+
+// Classification of one input in the libc differential
+typedef enum {
+    VERDICT_AGREE_ACCEPT    = 0,    // both accept with identical value and formatting
+    VERDICT_AGREE_REJECT    = 1,    // both reject
+    VERDICT_IPV6_ONLY       = 2,    // only ipv6_from_str accepts (port, mask, brackets, ...)
+    VERDICT_LIBC_ONLY       = 3,    // only inet_pton accepts
+    VERDICT_VALUE_MISMATCH  = 4,    // both accept with different address bytes
+    VERDICT_FORMAT_MISMATCH = 5,    // same address, ipv6_to_str and inet_ntop differ
+    VERDICT_COUNT           = 6,
+} bench_verdict_t;
+
+static const char* verdict_names[VERDICT_COUNT] = {
+    "agree-accept",
+    "agree-reject",
+    "ipv6-only",
+    "libc-only",
+    "value-mismatch",
+    "format-mismatch",
+};
+
+// Differential summary for one corpus
+typedef struct {
+    const char*             corpus;
+    uint32_t                verdicts[VERDICT_COUNT];
+    uint32_t                gai_disagree;   // acceptance differs from getaddrinfo(AI_NUMERICHOST)
+} bench_agreement_t;
+
+// Summary of the samples for one operation over one corpus
+typedef struct {
+    const char*             corpus;
+    const char*             op;
+    uint32_t                samples;
+    uint32_t                accepted;
+    double                  ns_median;
+    double                  ns_p99;
+    double                  ns_mean;
+    double                  cycles_median;
+    double                  cycles_p99;
+} bench_result_t;
+
+// Generator settings for a corpus, applied on top of ipv6_gen_config_init
+typedef struct {
+    const char*             name;
+    uint32_t                form_weights[IPV6_GEN_FORM_COUNT];
+    double                  port_rate;
+    double                  mask_rate;
+    double                  zone_rate;
+    double                  embed_rate;
+    bool                    mixed;          // keep the default form mix and add invalid inputs
+} bench_corpus_desc_t;
+
+// Consumed by the timed loops to keep the optimizer from discarding work
+static volatile uint64_t bench_sink;
+
+//--------------------------------------------------------------------------------
+static uint64_t bench_cycles (void)
+{
+#if defined(BENCH_HAVE_TSC)
+    return (uint64_t)__rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static const bench_corpus_desc_t corpus_descs[] = {
+    // name                 compressed/expanded/mixed case/ipv4  port  mask  zone  embed  mixed
+    { "canonical-v6",       { 1, 0, 0, 0 },                      0.0,  0.0,  0.0,  0.0,   false },
+    { "expanded-v6",        { 0, 1, 0, 0 },                      0.0,  0.0,  0.0,  0.0,   false },
+    { "ipv4",               { 0, 0, 0, 1 },                      0.0,  0.0,  0.0,  0.0,   false },
+    { "embedded-v4",        { 1, 0, 0, 0 },                      0.0,  0.0,  0.0,  1.0,   false },
+    { "bracketed-port",     { 1, 0, 0, 0 },                      1.0,  0.0,  0.0,  0.0,   false },
+    { "cidr",               { 1, 0, 0, 0 },                      0.0,  1.0,  0.0,  0.0,   false },
+    { "zone",               { 1, 0, 0, 0 },                      0.0,  0.0,  1.0,  0.0,   false },
+    { "mixed",              { 0, 0, 0, 0 },                      0.0,  0.0,  0.0,  0.0,   true },
+};
+
+#if defined(BENCH_HAVE_LIBC)
+//--------------------------------------------------------------------------------
+// Accept either family the way ipv6_from_str does, returns the family or 0
+static int libc_pton (const char* str, uint8_t* out)
+{
+    if (inet_pton(AF_INET6, str, out) == 1) {
+        return AF_INET6;
+    }
+    if (inet_pton(AF_INET, str, out) == 1) {
+        return AF_INET;
+    }
+    return 0;
+}
+
+//--------------------------------------------------------------------------------
+static bool libc_getaddrinfo (const char* str)
+{
+    struct addrinfo hints;
+    struct addrinfo* result = NULL;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_flags = AI_NUMERICHOST;
+
+    if (getaddrinfo(str, NULL, &hints, &result) != 0) {
+        return false;
+    }
+    freeaddrinfo(result);
+    return true;
+}
+#endif // BENCH_HAVE_LIBC
+
+//--------------------------------------------------------------------------------
+static bool corpus_alloc (bench_corpus_t* corpus, const char* name, uint32_t count)
+{
+    memset(corpus, 0, sizeof(*corpus));
+    corpus->name = name;
+    corpus->count = count;
+    corpus->strings = (char*)malloc((size_t)count * BENCH_STRING_SIZE);
+    corpus->lengths = (size_t*)malloc(count * sizeof(size_t));
+    corpus->parsed = (ipv6_address_full_t*)malloc(count * sizeof(ipv6_address_full_t));
+    corpus->valid = (bool*)malloc(count * sizeof(bool));
+    corpus->arpa = (char*)malloc((size_t)count * BENCH_ARPA_SIZE);
+    corpus->arpa_lengths = (size_t*)malloc(count * sizeof(size_t));
+#if defined(BENCH_HAVE_LIBC)
+    corpus->libc_bytes = (uint8_t*)malloc((size_t)count * 16);
+    corpus->libc_family = (int*)malloc(count * sizeof(int));
+    if (!corpus->libc_bytes || !corpus->libc_family) {
+        return false;
+    }
+#endif
+    return corpus->strings && corpus->lengths && corpus->parsed && corpus->valid &&
+        corpus->arpa && corpus->arpa_lengths;
+}
+
+//--------------------------------------------------------------------------------
+static void corpus_free (bench_corpus_t* corpus)
+{
+    free(corpus->strings);
+    free(corpus->lengths);
+    free(corpus->parsed);
+    free(corpus->valid);
+    free(corpus->arpa);
+    free(corpus->arpa_lengths);
+#if defined(BENCH_HAVE_LIBC)
+    free(corpus->libc_bytes);
+    free(corpus->libc_family);
+#endif
+    memset(corpus, 0, sizeof(*corpus));
+}
+
+//--------------------------------------------------------------------------------
+// PTR query name of an address, in-addr.arpa for IPv4 compatible addresses
+static size_t corpus_arpa_name (const ipv6_address_full_t* addr, char* out)
+{
+    static const char hex[] = "0123456789abcdef";
+    const uint16_t* components = addr->address.components;
+
+    if (addr->flags & IPV6_FLAG_IPV4_COMPAT) {
+        return (size_t)snprintf(out, BENCH_ARPA_SIZE, "%u.%u.%u.%u.in-addr.arpa",
+            components[1] & 0xff, components[1] >> 8, components[0] & 0xff, components[0] >> 8);
+    }
+
+    char* wp = out;
+    for (int32_t nibble = 31; nibble >= 0; --nibble) {
+        *wp++ = hex[(components[nibble / 4] >> (12 - 4 * (nibble % 4))) & 0xf];
+        *wp++ = '.';
+    }
+    memcpy(wp, "ip6.arpa", sizeof "ip6.arpa");
+    return (size_t)(wp - out) + sizeof "ip6.arpa" - 1;
+}
+
+//--------------------------------------------------------------------------------
+// Parse every entry once so the format and compare passes have inputs
+static void corpus_finish (bench_corpus_t* corpus)
+{
+    corpus->valid_count = 0;
+    for (uint32_t i = 0; i < corpus->count; ++i) {
+        const char* str = corpus->strings + (size_t)i * BENCH_STRING_SIZE;
+        corpus->lengths[i] = strlen(str);
+        corpus->valid[i] = ipv6_from_str(str, corpus->lengths[i], &corpus->parsed[i]);
+        if (corpus->valid[i]) {
+            corpus->valid_count++;
+        } else {
+            memset(&corpus->parsed[i], 0, sizeof(ipv6_address_full_t));
+        }
+        corpus->arpa_lengths[i] = corpus_arpa_name(&corpus->parsed[i], corpus->arpa + (size_t)i * BENCH_ARPA_SIZE);
+#if defined(BENCH_HAVE_LIBC)
+        corpus->libc_family[i] = libc_pton(str, corpus->libc_bytes + (size_t)i * 16);
+        if (!corpus->libc_family[i]) {
+            memset(corpus->libc_bytes + (size_t)i * 16, 0, 16);
+            corpus->libc_family[i] = AF_INET6;
+        }
+#endif
+    }
+}
+
+//--------------------------------------------------------------------------------
+static bool corpus_generate (
+    bench_corpus_t* corpus,
+    const bench_corpus_desc_t* desc,
+    const bench_options_t* options,
+    uint32_t stream)
+{
+    ipv6_gen_config_t config;
+    ipv6_gen_t gen;
+
+    // Each corpus gets its own stream so filtering does not change the inputs
+    ipv6_gen_config_init(&config, options->seed * 0x9E3779B97F4A7C15ULL + stream);
+    config.prefix_count = options->prefixes;
+    config.zipf_exponent = options->zipf;
+
+    if (desc->mixed) {
+        ipv6_gen_set_invalid_rate(&config, options->invalid_pct / 100.0);
+    } else {
+        memcpy(config.form_weights, desc->form_weights, sizeof(config.form_weights));
+        config.port_rate = desc->port_rate;
+        config.mask_rate = desc->mask_rate;
+        config.zone_rate = desc->zone_rate;
+        config.embed_rate = desc->embed_rate;
+    }
+
+    if (!ipv6_gen_init(&gen, &config)) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < corpus->count; ++i) {
+        ipv6_gen_at(&gen, i, corpus->strings + (size_t)i * BENCH_STRING_SIZE, BENCH_STRING_SIZE, NULL);
+    }
+    corpus_finish(corpus);
+    return true;
+}
+
+//--------------------------------------------------------------------------------
+static void bench_diag_fn (
+    ipv6_diag_event_t event,
+    const ipv6_diag_info_t* info,
+    void* user_data)
+{
+    (void)info;
+    *(uint32_t*)user_data += (uint32_t)event + 1;
+}
+
+typedef enum {
+    OP_FROM_STR         = 0,
+    OP_FROM_STR_DIAG    = 1,
+    OP_FROM_STR_COMPACT = 2,
+    OP_TO_STR           = 3,
+    OP_COMPARE          = 4,
+    OP_FROM_STR_INLINE  = 5,
+    OP_TO_STR_INLINE    = 6,
+    OP_COMPARE_INLINE   = 7,
+    OP_CLASSIFY         = 8,
+    OP_FROM_ARPA        = 9,
+    OP_RANGE_FROM_STR   = 10,
+    OP_INET_PTON        = 11,
+    OP_INET_NTOP        = 12,
+    OP_GETADDRINFO      = 13,
+} bench_op_t;
+
+// The libc operations start at OP_INET_PTON
+static const char* op_names[] = {
+    "ipv6_from_str",
+    "ipv6_from_str_diag",
+    "ipv6_from_str_compact",
+    "ipv6_to_str",
+    "ipv6_compare",
+    "ipv6_from_str/inline",
+    "ipv6_to_str/inline",
+    "ipv6_compare/inline",
+    "ipv6_classify",
+    "ipv6_from_arpa",
+    "ipv6_range_from_str",
+#if defined(BENCH_HAVE_LIBC)
+    "inet_pton",
+    "inet_ntop",
+    "getaddrinfo",
+#endif
+};
+
+//--------------------------------------------------------------------------------
+// Run one operation over [begin, end) of the corpus, returns the accepted count
+static uint32_t run_batch (const bench_corpus_t* corpus, bench_op_t op, uint32_t begin, uint32_t end)
+{
+    ipv6_address_full_t addr;
+    char buffer[BENCH_STRING_SIZE] = "";
+    uint32_t accepted = 0;
+    uint32_t diag_calls = 0;
+    ipv6_diag_result_t diag;
+
+    switch (op) {
+        case OP_FROM_STR:
+            for (uint32_t i = begin; i < end; ++i) {
+                accepted += ipv6_from_str(
+                    corpus->strings + (size_t)i * BENCH_STRING_SIZE, corpus->lengths[i], &addr);
+            }
+            break;
+
+        case OP_FROM_STR_DIAG:
+            for (uint32_t i = begin; i < end; ++i) {
+                accepted += ipv6_from_str_diag(
+                    corpus->strings + (size_t)i * BENCH_STRING_SIZE, corpus->lengths[i], &addr,
+                    bench_diag_fn, &diag_calls);
+            }
+            break;
+
+        case OP_FROM_STR_COMPACT:
+            for (uint32_t i = begin; i < end; ++i) {
+                accepted += ipv6_from_str_compact(
+                    corpus->strings + (size_t)i * BENCH_STRING_SIZE, corpus->lengths[i], &addr, &diag);
+            }
+            break;
+
+        case OP_TO_STR:
+            for (uint32_t i = begin; i < end; ++i) {
+                accepted += ipv6_to_str(&corpus->parsed[i], buffer, sizeof(buffer)) > 0;
+            }
+            break;
+
+        case OP_COMPARE:
+            // Compare each entry to its neighbor, which mostly fails late in the
+            // component loop, and to itself which runs the full comparison
+            for (uint32_t i = begin; i < end; ++i) {
+                const uint32_t j = (i + 1 < corpus->count) ? i + 1 : 0;
+                accepted += ipv6_compare(&corpus->parsed[i], &corpus->parsed[i], 0) == IPV6_COMPARE_OK;
+                accepted += ipv6_compare(&corpus->parsed[i], &corpus->parsed[j], IPV6_FLAG_IPV4_EMBED) == IPV6_COMPARE_OK;
+            }
+            break;
+
+        case OP_FROM_STR_INLINE:
+            accepted = bench_inline_from_str(corpus->strings, BENCH_STRING_SIZE, corpus->lengths, begin, end);
+            break;
+
+        case OP_TO_STR_INLINE:
+            accepted = bench_inline_to_str(corpus->parsed, begin, end);
+            break;
+
+        case OP_COMPARE_INLINE:
+            accepted = bench_inline_compare(corpus->parsed, corpus->count, begin, end);
+            break;
+
+        case OP_CLASSIFY:
+            for (uint32_t i = begin; i < end; ++i) {
+                accepted += ipv6_classify(&corpus->parsed[i]) != 0;
+            }
+            break;
+
+        case OP_FROM_ARPA:
+            for (uint32_t i = begin; i < end; ++i) {
+                accepted += ipv6_from_arpa(
+                    corpus->arpa + (size_t)i * BENCH_ARPA_SIZE, corpus->arpa_lengths[i], &addr, &diag);
+            }
+            break;
+
+        case OP_RANGE_FROM_STR:
+            for (uint32_t i = begin; i < end; ++i) {
+                ipv6_range_t range;
+                accepted += ipv6_range_from_str(
+                    corpus->strings + (size_t)i * BENCH_STRING_SIZE, corpus->lengths[i], &range, &diag);
+            }
+            break;
+
+#if defined(BENCH_HAVE_LIBC)
+        case OP_INET_PTON:
+            for (uint32_t i = begin; i < end; ++i) {
+                uint8_t bytes[16];
+                accepted += libc_pton(corpus->strings + (size_t)i * BENCH_STRING_SIZE, bytes) != 0;
+                buffer[0] = (char)bytes[0];
+            }
+            break;
+
+        case OP_INET_NTOP:
+            for (uint32_t i = begin; i < end; ++i) {
+                accepted += inet_ntop(corpus->libc_family[i], corpus->libc_bytes + (size_t)i * 16,
+                    buffer, sizeof(buffer)) != NULL;
+            }
+            break;
+
+        case OP_GETADDRINFO:
+            for (uint32_t i = begin; i < end; ++i) {
+                accepted += libc_getaddrinfo(corpus->strings + (size_t)i * BENCH_STRING_SIZE);
+            }
+            break;
+#else
+        default:
+            break;
+#endif
+    }
+
+    bench_sink += diag_calls + addr.address.components[0] + (uint8_t)buffer[0];
+    return accepted;
+}
+
+#if defined(BENCH_HAVE_LIBC)
+//--------------------------------------------------------------------------------
+// Classify every input of the corpus against libc, appending disagreements to fp
+static void bench_differential (
+    const bench_corpus_t* corpus,
+    FILE* fp,
+    bench_agreement_t* agreement)
+{
+    memset(agreement, 0, sizeof(*agreement));
+    agreement->corpus = corpus->name;
+
+    for (uint32_t i = 0; i < corpus->count; ++i) {
+        const char* str = corpus->strings + (size_t)i * BENCH_STRING_SIZE;
+        const ipv6_address_full_t* parsed = &corpus->parsed[i];
+        const bool ipv6_ok = corpus->valid[i];
+        uint8_t bytes[16];
+        const int family = libc_pton(str, bytes);
+        const bool gai_ok = libc_getaddrinfo(str);
+        char ipv6_str[BENCH_STRING_SIZE] = "";
+        char libc_str[BENCH_STRING_SIZE] = "";
+        bench_verdict_t verdict;
+
+        if (ipv6_ok) {
+            ipv6_to_str(parsed, ipv6_str, sizeof(ipv6_str));
+        }
+        if (family) {
+            inet_ntop(family, bytes, libc_str, sizeof(libc_str));
+        }
+
+        if (!ipv6_ok && !family) {
+            verdict = VERDICT_AGREE_REJECT;
+        } else if (!family) {
+            verdict = VERDICT_IPV6_ONLY;
+        } else if (!ipv6_ok) {
+            verdict = VERDICT_LIBC_ONLY;
+        } else {
+            // Convert the host order components to network order bytes
+            uint8_t ours[16];
+            const bool v4 = (parsed->flags & IPV6_FLAG_IPV4_COMPAT) != 0;
+            const uint32_t n = v4 ? 4 : 16;
+            for (uint32_t b = 0; b < 16; b += 2) {
+                ours[b] = (uint8_t)(parsed->address.components[b / 2] >> 8);
+                ours[b + 1] = (uint8_t)parsed->address.components[b / 2];
+            }
+
+            if ((family == AF_INET) != v4 || memcmp(ours, bytes, n) != 0) {
+                verdict = VERDICT_VALUE_MISMATCH;
+            } else if (strcmp(ipv6_str, libc_str) != 0) {
+                verdict = VERDICT_FORMAT_MISMATCH;
+            } else {
+                verdict = VERDICT_AGREE_ACCEPT;
+            }
+        }
+
+        agreement->verdicts[verdict]++;
+        if (gai_ok != ipv6_ok) {
+            agreement->gai_disagree++;
+        }
+
+        if (fp && (verdict >= VERDICT_IPV6_ONLY || gai_ok != ipv6_ok)) {
+            fprintf(fp, "%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\n",
+                corpus->name,
+                verdict_names[verdict],
+                str,
+                ipv6_ok ? "accept" : "reject",
+                family ? "accept" : "reject",
+                gai_ok ? "accept" : "reject",
+                ipv6_str,
+                libc_str);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------
+static void print_agreement (const bench_agreement_t* agreement, uint32_t count)
+{
+    printf("%-16s agreement:", agreement->corpus);
+    for (uint32_t v = 0; v < VERDICT_COUNT; ++v) {
+        printf(" %s=%u", verdict_names[v], agreement->verdicts[v]);
+    }
+    printf(" getaddrinfo-disagree=%u/%u\n", agreement->gai_disagree, count);
+}
+#endif // BENCH_HAVE_LIBC
+
+// One (state, event class) transition count for sorting
+typedef struct {
+    uint32_t                state;
+    uint32_t                eventclass;
+    uint64_t                count;
+} bench_transition_t;
+
+//--------------------------------------------------------------------------------
+static int compare_double (const void* a, const void* b)
+{
+    const double da = *(const double*)a;
+    const double db = *(const double*)b;
+    return (da > db) - (da < db);
+}
+
+//--------------------------------------------------------------------------------
+// Nearest rank percentile over sorted samples
+static double percentile (const double* sorted, uint32_t count, uint32_t pct)
+{
+    if (count == 0) {
+        return 0.0;
+    }
+    uint32_t rank = (uint32_t)(((uint64_t)pct * count + 99) / 100);
+    if (rank > 0) {
+        rank--;
+    }
+    return sorted[rank < count ? rank : count - 1];
+}
+
+//--------------------------------------------------------------------------------
+static void bench_run_op (
+    const bench_corpus_t* corpus,
+    bench_op_t op,
+    const bench_options_t* options,
+    double* ns_samples,
+    double* cycle_samples,
+    bench_result_t* result,
+    ipv6_counters_t* counters)
+{
+    const uint32_t batches = (corpus->count + BATCH_SIZE - 1) / BATCH_SIZE;
+    uint32_t samples = 0;
+    double ns_total = 0.0;
+
+    memset(result, 0, sizeof(*result));
+    result->corpus = corpus->name;
+    result->op = op_names[op];
+
+    // Warm up caches and branch predictors with one untimed pass
+    for (uint32_t b = 0; b < batches; ++b) {
+        const uint32_t begin = b * BATCH_SIZE;
+        const uint32_t end = begin + BATCH_SIZE < corpus->count ? begin + BATCH_SIZE : corpus->count;
+        result->accepted += run_batch(corpus, op, begin, end);
+    }
+
+    // Counters cover the timed rounds only, not the warm-up
+    if (counters) {
+        ipv6_counters_reset();
+    }
+
+    for (uint32_t r = 0; r < options->rounds; ++r) {
+        for (uint32_t b = 0; b < batches; ++b) {
+            const uint32_t begin = b * BATCH_SIZE;
+            const uint32_t end = begin + BATCH_SIZE < corpus->count ? begin + BATCH_SIZE : corpus->count;
+
+            const uint64_t c0 = bench_cycles();
+            const uint64_t t0 = ipv6_clock_ns();
+            bench_sink += run_batch(corpus, op, begin, end);
+            const uint64_t t1 = ipv6_clock_ns();
+            const uint64_t c1 = bench_cycles();
+
+            const double n = (double)(end - begin);
+            ns_samples[samples] = (double)(t1 - t0) / n;
+            cycle_samples[samples] = (double)(c1 - c0) / n;
+            ns_total += ns_samples[samples];
+            samples++;
+        }
+    }
+
+    if (counters) {
+        ipv6_counters_snapshot(counters);
+    }
+
+    qsort(ns_samples, samples, sizeof(double), compare_double);
+    qsort(cycle_samples, samples, sizeof(double), compare_double);
+
+    result->samples = samples;
+    result->ns_median = percentile(ns_samples, samples, 50);
+    result->ns_p99 = percentile(ns_samples, samples, 99);
+    result->ns_mean = samples ? ns_total / samples : 0.0;
+    result->cycles_median = percentile(cycle_samples, samples, 50);
+    result->cycles_p99 = percentile(cycle_samples, samples, 99);
+}
+
+//--------------------------------------------------------------------------------
+static void print_result (const bench_result_t* result, uint32_t count)
+{
+    printf("%-16s %-22s %8.1f %8.1f %8.1f %10.1f %10.1f %8u/%u\n",
+        result->corpus,
+        result->op,
+        result->ns_median,
+        result->ns_p99,
+        result->ns_mean,
+        result->cycles_median,
+        result->cycles_p99,
+        result->accepted,
+        count);
+}
+
+//--------------------------------------------------------------------------------
+static int compare_transition (const void* a, const void* b)
+{
+    const uint64_t x = ((const bench_transition_t*)a)->count;
+    const uint64_t y = ((const bench_transition_t*)b)->count;
+    return (x < y) - (x > y);
+}
+
+//--------------------------------------------------------------------------------
+// Transitions in descending order of frequency, then token and zero-run counts
+static void print_counters (const char* corpus, const ipv6_counters_t* counters)
+{
+    bench_transition_t transitions[IPV6_COUNTERS_STATES * IPV6_COUNTERS_EVENTCLASSES];
+    uint32_t transition_count = 0;
+    uint64_t total = 0;
+
+    for (uint32_t s = 0; s < IPV6_COUNTERS_STATES; ++s) {
+        for (uint32_t e = 0; e < IPV6_COUNTERS_EVENTCLASSES; ++e) {
+            if (counters->transitions[s][e]) {
+                transitions[transition_count].state = s;
+                transitions[transition_count].eventclass = e;
+                transitions[transition_count].count = counters->transitions[s][e];
+                total += counters->transitions[s][e];
+                transition_count++;
+            }
+        }
+    }
+    qsort(transitions, transition_count, sizeof(transitions[0]), compare_transition);
+
+    printf("%-16s counters: parses=%llu transitions=%llu (%.1f/parse)\n",
+        corpus,
+        (unsigned long long)counters->parses,
+        (unsigned long long)total,
+        counters->parses ? (double)total / (double)counters->parses : 0.0);
+
+    for (uint32_t i = 0; i < transition_count; ++i) {
+        printf("%-16s   %-22s <- %-28s %12llu %6.2f%%\n",
+            "",
+            ipv6_counters_state_str(transitions[i].state),
+            ipv6_counters_eventclass_str(transitions[i].eventclass),
+            (unsigned long long)transitions[i].count,
+            100.0 * (double)transitions[i].count / (double)total);
+    }
+
+    for (uint32_t kind = 0; kind < IPV6_COUNTERS_TOKEN_KINDS; ++kind) {
+        printf("%-16s   %s token lengths:", "", kind == IPV6_COUNTERS_TOKEN_HEX ? "hex    " : "decimal");
+        for (uint32_t len = 0; len < IPV6_COUNTERS_TOKEN_LENGTHS; ++len) {
+            printf(" %u%s=%llu", len, (len == IPV6_COUNTERS_TOKEN_LENGTHS - 1) ? "+" : "",
+                (unsigned long long)counters->token_lengths[kind][len]);
+        }
+        printf("\n");
+    }
+
+    printf("%-16s   zero-run shuffles=%llu (%.1f%% of parses) empty=%llu components-moved=%llu\n",
+        "",
+        (unsigned long long)counters->zerorun_shuffles,
+        counters->parses ? 100.0 * (double)counters->zerorun_shuffles / (double)counters->parses : 0.0,
+        (unsigned long long)counters->zerorun_empty,
+        (unsigned long long)counters->zerorun_components);
+}
+
+//--------------------------------------------------------------------------------
+static bool write_json (
+    const char* path,
+    const bench_options_t* options,
+    const bench_result_t* results,
+    uint32_t result_count,
+    const bench_agreement_t* agreements,
+    uint32_t agreement_count)
+{
+    FILE* fp = fopen(path, "w");
+    if (!fp) {
+        return false;
+    }
+
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"seed\": %llu,\n", (unsigned long long)options->seed);
+    fprintf(fp, "  \"count\": %u,\n", options->count);
+    fprintf(fp, "  \"rounds\": %u,\n", options->rounds);
+    fprintf(fp, "  \"batch_size\": %u,\n", (uint32_t)BATCH_SIZE);
+    fprintf(fp, "  \"invalid_pct\": %u,\n", options->invalid_pct);
+#if defined(BENCH_HAVE_TSC)
+    fprintf(fp, "  \"cycles\": \"tsc\",\n");
+#else
+    fprintf(fp, "  \"cycles\": null,\n");
+#endif
+    fprintf(fp, "  \"results\": [\n");
+    for (uint32_t i = 0; i < result_count; ++i) {
+        const bench_result_t* r = &results[i];
+        fprintf(fp,
+            "    { \"corpus\": \"%s\", \"op\": \"%s\", \"samples\": %u, \"accepted\": %u, "
+            "\"ns_per_addr\": { \"median\": %.2f, \"p99\": %.2f, \"mean\": %.2f }, "
+            "\"cycles_per_addr\": { \"median\": %.2f, \"p99\": %.2f } }%s\n",
+            r->corpus, r->op, r->samples, r->accepted,
+            r->ns_median, r->ns_p99, r->ns_mean,
+            r->cycles_median, r->cycles_p99,
+            (i + 1 < result_count) ? "," : "");
+    }
+    fprintf(fp, "  ],\n");
+    fprintf(fp, "  \"agreement\": [\n");
+    for (uint32_t i = 0; i < agreement_count; ++i) {
+        const bench_agreement_t* a = &agreements[i];
+        fprintf(fp, "    { \"corpus\": \"%s\"", a->corpus);
+        for (uint32_t v = 0; v < VERDICT_COUNT; ++v) {
+            fprintf(fp, ", \"%s\": %u", verdict_names[v], a->verdicts[v]);
+        }
+        fprintf(fp, ", \"getaddrinfo-disagree\": %u }%s\n",
+            a->gai_disagree, (i + 1 < agreement_count) ? "," : "");
+    }
+    fprintf(fp, "  ]\n}\n");
+    fclose(fp);
+    return true;
+}
+
+//--------------------------------------------------------------------------------
+static void usage (const char* name)
+{
+    printf("usage: %s [options]\n", name);
+    printf("  --count N        addresses per corpus (default 100000)\n");
+    printf("  --rounds N       timed passes over each corpus (default 5)\n");
+    printf("  --invalid PCT    percentage of invalid inputs in the mixed corpus (default 10)\n");
+    printf("  --seed N         corpus generation seed (default 1)\n");
+    printf("  --prefixes N     distinct /48 prefixes in the corpora (default 65536)\n");
+    printf("  --zipf S         Zipf exponent of the prefix distribution (default 1)\n");
+    printf("  --corpus NAME    only run the named corpus\n");
+    printf("  --json FILE      write results as JSON to FILE\n");
+    printf("  --agreement FILE write every input where libc and ipv6_from_str disagree to FILE\n");
+    printf("  --no-libc        skip the inet_pton / inet_ntop / getaddrinfo comparison\n");
+    printf("  --counters       print parser counters of the timed ipv6_from_str rounds (-DPARSE_COUNTERS=1)\n");
+}
+
+//--------------------------------------------------------------------------------
+static bool parse_options (int argc, const char** argv, bench_options_t* options)
+{
+    options->count = 100000;
+    options->rounds = 5;
+    options->invalid_pct = 10;
+    options->seed = 1;
+    options->prefixes = 65536;
+    options->zipf = 1.0;
+    options->json_path = NULL;
+    options->agreement_path = NULL;
+    options->only = NULL;
+    options->libc = true;
+    options->counters = false;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if (!strcmp(arg, "--help") || !strcmp(arg, "-h")) {
+            return false;
+        }
+        if (!strcmp(arg, "--no-libc")) {
+            options->libc = false;
+            continue;
+        }
+        if (!strcmp(arg, "--counters")) {
+            options->counters = true;
+            continue;
+        }
+        if (!value) {
+            printf("missing value for %s\n", arg);
+            return false;
+        }
+
+        if (!strcmp(arg, "--count")) {
+            options->count = (uint32_t)strtoul(value, NULL, 10);
+        } else if (!strcmp(arg, "--rounds")) {
+            options->rounds = (uint32_t)strtoul(value, NULL, 10);
+        } else if (!strcmp(arg, "--invalid")) {
+            options->invalid_pct = (uint32_t)strtoul(value, NULL, 10);
+        } else if (!strcmp(arg, "--seed")) {
+            options->seed = strtoull(value, NULL, 10);
+        } else if (!strcmp(arg, "--prefixes")) {
+            options->prefixes = (uint32_t)strtoul(value, NULL, 10);
+        } else if (!strcmp(arg, "--zipf")) {
+            options->zipf = atof(value);
+        } else if (!strcmp(arg, "--corpus")) {
+            options->only = value;
+        } else if (!strcmp(arg, "--json")) {
+            options->json_path = value;
+        } else if (!strcmp(arg, "--agreement")) {
+            options->agreement_path = value;
+        } else {
+            printf("unknown option: %s\n", arg);
+            return false;
+        }
+        i++;
+    }
+
+    if (options->count == 0 || options->rounds == 0 || options->invalid_pct > 100) {
+        printf("invalid option value\n");
+        return false;
+    }
+
+    ipv6_counters_t counters;
+    if (options->counters && !ipv6_counters_snapshot(&counters)) {
+        printf("--counters requires a build with -DPARSE_COUNTERS=1\n");
+        return false;
+    }
+    return true;
+}
+
+int main (int argc, const char** argv) {
+    bench_options_t options;
+    if (!parse_options(argc, argv, &options)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+#if defined(_WIN32)
+    WSADATA wsa_data;
+    WSAStartup(MAKEWORD(2, 2), &wsa_data);
+#endif
+
+    const uint32_t corpus_count = LENGTHOF(corpus_descs);
+    const uint32_t op_count = options.libc ? LENGTHOF(op_names) : OP_INET_PTON;
+    const size_t max_samples = (size_t)options.rounds * ((options.count + BATCH_SIZE - 1) / BATCH_SIZE);
+
+    bench_result_t* results = (bench_result_t*)calloc(corpus_count * op_count, sizeof(bench_result_t));
+    bench_agreement_t* agreements = (bench_agreement_t*)calloc(corpus_count, sizeof(bench_agreement_t));
+    double* ns_samples = (double*)malloc(max_samples * sizeof(double));
+    double* cycle_samples = (double*)malloc(max_samples * sizeof(double));
+    if (!results || !agreements || !ns_samples || !cycle_samples) {
+        printf("out of memory\n");
+        return 2;
+    }
+
+    FILE* agreement_fp = NULL;
+    if (options.agreement_path) {
+        agreement_fp = fopen(options.agreement_path, "w");
+        if (!agreement_fp) {
+            printf("failed to open %s\n", options.agreement_path);
+            return 3;
+        }
+        fprintf(agreement_fp, "corpus\tverdict\tinput\tipv6_from_str\tinet_pton\tgetaddrinfo\tipv6_to_str\tinet_ntop\n");
+    }
+
+    printf("%-16s %-22s %8s %8s %8s %10s %10s %s\n",
+        "corpus", "op", "ns/med", "ns/p99", "ns/mean", "cyc/med", "cyc/p99", "accepted");
+
+    uint32_t result_count = 0;
+    uint32_t agreement_count = 0;
+    for (uint32_t c = 0; c < corpus_count; ++c) {
+        const char* name = corpus_descs[c].name;
+        if (options.only && strcmp(options.only, name)) {
+            continue;
+        }
+
+        bench_corpus_t corpus;
+        if (!corpus_alloc(&corpus, name, options.count)) {
+            printf("out of memory\n");
+            return 2;
+        }
+
+        if (!corpus_generate(&corpus, &corpus_descs[c], &options, c)) {
+            printf("invalid generator configuration\n");
+            return 1;
+        }
+
+        // Counters are taken over the timed rounds of ipv6_from_str
+        ipv6_counters_t counters;
+        for (uint32_t op = 0; op < op_count; ++op) {
+            bench_result_t* result = &results[result_count++];
+            bench_run_op(&corpus, (bench_op_t)op, &options, ns_samples, cycle_samples, result,
+                (options.counters && op == OP_FROM_STR) ? &counters : NULL);
+            print_result(result, (op == OP_COMPARE || op == OP_COMPARE_INLINE) ? corpus.count * 2 : corpus.count);
+        }
+
+        if (options.counters) {
+            print_counters(name, &counters);
+        }
+
+#if defined(BENCH_HAVE_LIBC)
+        if (options.libc) {
+            bench_agreement_t* agreement = &agreements[agreement_count++];
+            bench_differential(&corpus, agreement_fp, agreement);
+            print_agreement(agreement, corpus.count);
+        }
+#endif
+
+        corpus_free(&corpus);
+    }
+
+    if (agreement_fp) {
+        fclose(agreement_fp);
+        printf("wrote %s\n", options.agreement_path);
+    }
+
+    if (options.json_path) {
+        if (!write_json(options.json_path, &options, results, result_count, agreements, agreement_count)) {
+            printf("failed to write %s\n", options.json_path);
+            return 3;
+        }
+        printf("wrote %s\n", options.json_path);
+    }
+
+    free(results);
+    free(agreements);
+    free(ns_samples);
+    free(cycle_samples);
+    return 0;
+}
@@ -0,0 +1,69 @@
+#define IPV6_PARSE_HEADER_ONLY 1
+
+#include "bench_inline.h"
+#include "ipv6_gen.h"
+
+// Consumed by the loops to keep the optimizer from discarding work
+static volatile uint64_t bench_inline_sink;
+
+//--------------------------------------------------------------------------------
+uint32_t bench_inline_from_str (
+    const char* strings,
+    size_t stride,
+    const size_t* lengths,
+    uint32_t begin,
+    uint32_t end)
+{
+    ipv6_address_full_t addr;
+    uint32_t accepted = 0;
+    uint64_t sink = 0;
+
+    for (uint32_t i = begin; i < end; ++i) {
+        if (ipv6_from_str(strings + (size_t)i * stride, lengths[i], &addr)) {
+            accepted++;
+            sink += addr.address.components[0];
+        }
+    }
+
+    bench_inline_sink += sink;
+    return accepted;
+}
+
+//--------------------------------------------------------------------------------
+uint32_t bench_inline_to_str (
+    const ipv6_address_full_t* parsed,
+    uint32_t begin,
+    uint32_t end)
+{
+    char buffer[IPV6_GEN_STRING_SIZE];
+    uint32_t accepted = 0;
+    uint64_t sink = 0;
+
+    for (uint32_t i = begin; i < end; ++i) {
+        if (ipv6_to_str(&parsed[i], buffer, sizeof(buffer)) > 0) {
+            accepted++;
+            sink += (uint8_t)buffer[0];
+        }
+    }
+
+    bench_inline_sink += sink;
+    return accepted;
+}
+
+//--------------------------------------------------------------------------------
+uint32_t bench_inline_compare (
+    const ipv6_address_full_t* parsed,
+    uint32_t count,
+    uint32_t begin,
+    uint32_t end)
+{
+    uint32_t accepted = 0;
+
+    for (uint32_t i = begin; i < end; ++i) {
+        const uint32_t j = (i + 1 < count) ? i + 1 : 0;
+        accepted += ipv6_compare(&parsed[i], &parsed[i], 0) == IPV6_COMPARE_OK;
+        accepted += ipv6_compare(&parsed[i], &parsed[j], IPV6_FLAG_IPV4_EMBED) == IPV6_COMPARE_OK;
+    }
+
+    return accepted;
+}
@@ -0,0 +1,39 @@
+#pragma once
+//
+// Benchmark loops compiled against the header-only parser
+//
+// bench_inline.c builds these loops with IPV6_PARSE_HEADER_ONLY, so the parse,
+// format and compare calls are inlined and specialized into the loop body. They
+// mirror the library loops in bench.c to measure the gain of inlining.
+//
+
+#include "ipv6.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Parse strings[i * stride] for i in [begin, end), returns the accepted count
+uint32_t bench_inline_from_str (
+    const char* strings,
+    size_t stride,
+    const size_t* lengths,
+    uint32_t begin,
+    uint32_t end);
+
+// Format parsed[i] for i in [begin, end), returns the formatted count
+uint32_t bench_inline_to_str (
+    const ipv6_address_full_t* parsed,
+    uint32_t begin,
+    uint32_t end);
+
+// Compare each of parsed[begin, end) to itself and its neighbor, returns the matches
+uint32_t bench_inline_compare (
+    const ipv6_address_full_t* parsed,
+    uint32_t count,
+    uint32_t begin,
+    uint32_t end);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
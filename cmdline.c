@@ -1,4 +1,7 @@
 #include "ipv6.h"
+#include "ipv6_stats.h"
+#include "ipv6_validate.h"
+#include "ipv6_pipeline.h"
 #include "ipv6_config.h"
 
 #ifdef WIN32
@@ -21,6 +24,8 @@
 #include <alloca.h>
 #endif
 
+#include <stdlib.h>
+
 typedef struct {
     const char*             message;
     ipv6_diag_event_t       event;
@@ -28,29 +33,222 @@ typedef struct {
 } diag_capture_t;
 
 
-// Function that is called by the address parser to report diagnostics
-static void cmdline_parsing_diag_fn (
-    ipv6_diag_event_t event,
-    const ipv6_diag_info_t* info,
-    void* user_data)
+// Print the failure recorded by the address parser
+static void cmdline_print_diag (
+    const char* input,
+    size_t input_bytes,
+    const ipv6_diag_result_t* diag)
+{
+    char message[256];
+    ipv6_diag_describe(diag->event, input, input_bytes, diag->position, message, sizeof(message));
+    printf("error: %s", message);
+}
+
+
+// Parse one address per line from stdin and print Prometheus statistics
+static int cmdline_stats (void)
 {
-	(void)user_data;
-    printf("error: %s, event-code: (%u)\n", info->message, event);
-    printf("    %s\n", info->input);
-    printf("    %*s\n", info->position, info->input);
+    ipv6_stats_t stats;
+    ipv6_address_full_t addr;
+    char line[1024];
+
+    ipv6_stats_init(&stats);
+
+    while (fgets(line, sizeof(line), stdin)) {
+        size_t len = strlen(line);
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+            line[--len] = '\0';
+        }
+        ipv6_from_str_stats(line, len, &addr, &stats);
+    }
+
+    const size_t report_bytes = ipv6_stats_to_prometheus(&stats, NULL, 0) + 1;
+    char* report = (char*)malloc(report_bytes);
+    if (!report) {
+        printf("- out of memory\n");
+        return 6;
+    }
+
+    ipv6_stats_to_prometheus(&stats, report, report_bytes);
+    fputs(report, stdout);
+    free(report);
+    return 0;
+}
+
+
+// Find line number index in a buffer, returns its start and sets its length
+static const char* cmdline_find_line (
+    const char* buffer,
+    size_t buffer_bytes,
+    size_t index,
+    size_t* length)
+{
+    const char* cp = buffer;
+    const char* ep = buffer + buffer_bytes;
+
+    for (; index && cp < ep; --index) {
+        const char* nl = (const char*)memchr(cp, '\n', (size_t)(ep - cp));
+        cp = nl ? nl + 1 : ep;
+    }
+
+    const char* nl = (const char*)memchr(cp, '\n', (size_t)(ep - cp));
+    *length = (size_t)((nl ? nl : ep) - cp);
+    if (*length && cp[*length - 1] == '\r') {
+        (*length)--;
+    }
+    return cp;
+}
+
+
+// Validate a file with one address per line and print failures by event
+static int cmdline_validate (const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        printf("- failed to open: '%s'\n", path);
+        return 7;
+    }
+
+    fseek(file, 0, SEEK_END);
+    const long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    char* buffer = (char*)malloc(size > 0 ? (size_t)size : 1);
+    const size_t buffer_bytes = (buffer && size > 0) ? fread(buffer, 1, (size_t)size, file) : 0;
+    fclose(file);
+
+    ipv6_validate_options_t options;
+    ipv6_validate_report_t report;
+    memset(&options, 0, sizeof(options));
+    options.examples = 3;
+    options.skip_indices = true;
+
+    if (!buffer || !ipv6_validate_lines(buffer, buffer_bytes, &options, &report)) {
+        free(buffer);
+        printf("- out of memory\n");
+        return 6;
+    }
+
+    printf("%zu inputs, %zu valid, %zu invalid\n", report.inputs, report.valid, report.invalid);
+
+    for (uint32_t e = 0; e < IPV6_DIAG_EVENT_COUNT; ++e) {
+        if (!report.event_counts[e]) {
+            continue;
+        }
+
+        printf("\n%s: %zu\n", ipv6_diag_event_str((ipv6_diag_event_t)e), report.event_counts[e]);
+        for (uint32_t i = 0; i < report.example_counts[e]; ++i) {
+            const ipv6_validate_example_t* example = &report.examples[e][i];
+            char message[256];
+            size_t length;
+            const char* line = cmdline_find_line(buffer, buffer_bytes, example->index, &length);
+
+            ipv6_diag_describe((ipv6_diag_event_t)e, line, length, example->position, message, sizeof(message));
+            printf("line %zu: %s", example->index + 1, message);
+        }
+    }
+
+    const int status = report.invalid ? 2 : 0;
+    ipv6_validate_report_free(&report);
+    free(buffer);
+    return status;
+}
+
+
+// Print one parsed line per input line
+static void cmdline_parse_sink (void* context, const ipv6_pipeline_batch_t* batch)
+{
+    char* buffer = (char*)alloca(IPV6_STRING_SIZE);
+    (void)context;
+
+    for (size_t i = 0; i < batch->count; ++i) {
+        if (batch->parsed[i] && ipv6_to_str(&batch->addresses[i], buffer, sizeof(char) * IPV6_STRING_SIZE)) {
+            printf("%s\n", buffer);
+            continue;
+        }
+
+        char message[256];
+        ipv6_diag_describe(batch->diags[i].event, batch->inputs[i], batch->lengths[i],
+            batch->diags[i].position, message, sizeof(message));
+        printf("line %llu: error: %s", (unsigned long long)(batch->first_line + i + 1), message);
+    }
+}
+
+
+// Print the throughput of a pipeline stage
+static void cmdline_print_stage (const char* name, const ipv6_pipeline_stage_t* stage, uint64_t elapsed_ns)
+{
+    const double seconds = elapsed_ns ? (double)elapsed_ns / 1e9 : 1e-9;
+    fprintf(stderr, "%-7s %10llu lines %12llu bytes %10.0f lines/s  busy %8.3f ms  stalled %8.3f ms\n",
+        name, (unsigned long long)stage->lines, (unsigned long long)stage->bytes,
+        (double)stage->lines / seconds, (double)stage->busy_ns / 1e6, (double)stage->stall_ns / 1e6);
+}
+
+
+// Parse a file or stdin with one address per line on the parse pipeline
+static int cmdline_parse (const char* path)
+{
+    FILE* file = path ? fopen(path, "rb") : stdin;
+    if (!file) {
+        printf("- failed to open: '%s'\n", path);
+        return 7;
+    }
+
+    ipv6_pipeline_config_t config;
+    ipv6_pipeline_stats_t stats;
+    memset(&config, 0, sizeof(config));
+    config.read = ipv6_pipeline_read_file;
+    config.read_context = file;
+    config.sink = cmdline_parse_sink;
+
+    const bool ok = ipv6_pipeline_run(&config, &stats);
+    if (path) {
+        fclose(file);
+    }
+    if (!ok) {
+        printf("- out of memory\n");
+        return 6;
+    }
+
+    fprintf(stderr, "%u workers, %.3f ms\n", stats.workers, (double)stats.elapsed_ns / 1e6);
+    cmdline_print_stage("reader", &stats.reader, stats.elapsed_ns);
+    cmdline_print_stage("parser", &stats.parser, stats.elapsed_ns);
+    cmdline_print_stage("sink", &stats.sink, stats.elapsed_ns);
+    return 0;
 }
 
 
 int main (int argc, const char** argv) {
     if (argc < 2) {
         printf("usage: %s <address>\n", argv[0]);
+        printf("       %s --stats < addresses.txt\n", argv[0]);
+        printf("       %s --validate addresses.txt\n", argv[0]);
+        printf("       %s --parse [addresses.txt]\n", argv[0]);
         return 1;
     }
 
+    if (!strcmp(argv[1], "--parse")) {
+        return cmdline_parse(argc > 2 ? argv[2] : NULL);
+    }
+
+    if (!strcmp(argv[1], "--stats")) {
+        return cmdline_stats();
+    }
+
+    if (!strcmp(argv[1], "--validate")) {
+        if (argc < 3) {
+            printf("usage: %s --validate addresses.txt\n", argv[0]);
+            return 1;
+        }
+        return cmdline_validate(argv[2]);
+    }
+
     {
         ipv6_address_full_t addr, addr2;
+        ipv6_diag_result_t diag;
         const char* str = argv[1];
-        if (!ipv6_from_str_diag(str, strlen(str), &addr, cmdline_parsing_diag_fn, NULL)) {
+        if (!ipv6_from_str_compact(str, strlen(str), &addr, &diag)) {
+            cmdline_print_diag(str, strlen(str), &diag);
             printf("- failed to parse: '%s'\n", str);
             return 2;
         }
@@ -61,7 +259,8 @@ int main (int argc, const char** argv) {
             return 3;
         }
 
-        if (!ipv6_from_str_diag(buffer, strlen(buffer), &addr2, cmdline_parsing_diag_fn, NULL)) {
+        if (!ipv6_from_str_compact(buffer, strlen(buffer), &addr2, &diag)) {
+            cmdline_print_diag(buffer, strlen(buffer), &diag);
             printf("- failed to roundtrip: '%s'\n", buffer);
             return 4;
         }
@@ -0,0 +1,166 @@
+#include "ipv6.h"
+#include "ipv6_gen.h"
+#include "ipv6_config.h"
+
+#ifdef HAVE_STDIO_H
+#include <stdio.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <stdlib.h>
+
+//
+// Command line front end for the corpus generator, writes one address per line
+// to stdout. Optionally each line is annotated with the expected parse outcome:
+//
+//     ipv6-gen --count 1000000 --seed 7 --invalid 0.05 --annotate > corpus.tsv
+//
+
+//--------------------------------------------------------------------------------
+static void usage (const char* name)
+{
+    printf("usage: %s [options]\n", name);
+    printf("  --count N          number of addresses (default 10)\n");
+    printf("  --start N          index of the first address (default 0)\n");
+    printf("  --seed N           stream seed (default 1)\n");
+    printf("  --forms C,E,M,4    weights of compressed, expanded, mixed case and IPv4 forms\n");
+    printf("  --prefixes N       distinct /48 prefixes (default 65536)\n");
+    printf("  --zipf S           Zipf exponent over the prefixes, 0 is uniform (default 1)\n");
+    printf("  --port R           rate of [addr]:port (default 0.1)\n");
+    printf("  --mask R           rate of addr/N (default 0.1)\n");
+    printf("  --zone R           rate of addr%%zone (default 0.02)\n");
+    printf("  --embed R          rate of embedded IPv4 (default 0.05)\n");
+    printf("  --invalid R        total error rate spread over every diagnostic event\n");
+    printf("  --error EVENT=R    error rate for one event, e.g. invalid-port=0.01\n");
+    printf("  --annotate         append the expected outcome to each line\n");
+}
+
+//--------------------------------------------------------------------------------
+static bool parse_error_rate (const char* value, ipv6_gen_config_t* config)
+{
+    const char* eq = strchr(value, '=');
+    if (!eq) {
+        return false;
+    }
+
+    for (uint32_t e = 0; e < IPV6_DIAG_EVENT_COUNT; ++e) {
+        const char* name = ipv6_diag_event_str((ipv6_diag_event_t)e);
+        if (strlen(name) == (size_t)(eq - value) && !strncmp(name, value, (size_t)(eq - value))) {
+            if (!ipv6_gen_event_supported((ipv6_diag_event_t)e)) {
+                printf("event is never emitted by the parser: %s\n", name);
+                return false;
+            }
+            config->error_rates[e] = atof(eq + 1);
+            return true;
+        }
+    }
+
+    printf("unknown event: %s\n", value);
+    return false;
+}
+
+//--------------------------------------------------------------------------------
+static bool parse_forms (const char* value, ipv6_gen_config_t* config)
+{
+    char* end = NULL;
+    for (uint32_t f = 0; f < IPV6_GEN_FORM_COUNT; ++f) {
+        config->form_weights[f] = (uint32_t)strtoul(value, &end, 10);
+        if (end == value) {
+            return false;
+        }
+        value = end;
+        if (f + 1 < IPV6_GEN_FORM_COUNT) {
+            if (*value != ',') {
+                return false;
+            }
+            value++;
+        }
+    }
+    return *value == '\0';
+}
+
+int main (int argc, const char** argv) {
+    ipv6_gen_config_t config;
+    uint64_t count = 10;
+    uint64_t start = 0;
+    bool annotate = false;
+
+    ipv6_gen_config_init(&config, 1);
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if (!strcmp(arg, "--annotate")) {
+            annotate = true;
+            continue;
+        }
+        if (!strcmp(arg, "--help") || !strcmp(arg, "-h") || !value) {
+            usage(argv[0]);
+            return 1;
+        }
+
+        bool ok = true;
+        if (!strcmp(arg, "--count")) {
+            count = strtoull(value, NULL, 10);
+        } else if (!strcmp(arg, "--start")) {
+            start = strtoull(value, NULL, 10);
+        } else if (!strcmp(arg, "--seed")) {
+            config.seed = strtoull(value, NULL, 10);
+        } else if (!strcmp(arg, "--forms")) {
+            ok = parse_forms(value, &config);
+        } else if (!strcmp(arg, "--prefixes")) {
+            config.prefix_count = (uint32_t)strtoul(value, NULL, 10);
+        } else if (!strcmp(arg, "--zipf")) {
+            config.zipf_exponent = atof(value);
+        } else if (!strcmp(arg, "--port")) {
+            config.port_rate = atof(value);
+        } else if (!strcmp(arg, "--mask")) {
+            config.mask_rate = atof(value);
+        } else if (!strcmp(arg, "--zone")) {
+            config.zone_rate = atof(value);
+        } else if (!strcmp(arg, "--embed")) {
+            config.embed_rate = atof(value);
+        } else if (!strcmp(arg, "--invalid")) {
+            ipv6_gen_set_invalid_rate(&config, atof(value));
+        } else if (!strcmp(arg, "--error")) {
+            ok = parse_error_rate(value, &config);
+        } else {
+            ok = false;
+        }
+
+        if (!ok) {
+            printf("invalid option: %s %s\n", arg, value);
+            usage(argv[0]);
+            return 1;
+        }
+        i++;
+    }
+
+    ipv6_gen_t gen;
+    if (!ipv6_gen_init(&gen, &config)) {
+        printf("invalid generator configuration\n");
+        return 1;
+    }
+
+    static char out_buffer[1 << 16];
+    setvbuf(stdout, out_buffer, _IOFBF, sizeof(out_buffer));
+
+    char line[IPV6_GEN_STRING_SIZE];
+    for (uint64_t i = start; i < start + count; ++i) {
+        ipv6_gen_info_t info;
+        const size_t len = ipv6_gen_at(&gen, i, line, sizeof(line), &info);
+        fwrite(line, 1, len, stdout);
+        if (annotate) {
+            fputc('\t', stdout);
+            fputs(info.valid ? "valid" : ipv6_diag_event_str(info.expected_event), stdout);
+        }
+        fputc('\n', stdout);
+    }
+
+    fflush(stdout);
+    return 0;
+}
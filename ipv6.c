@@ -1,5 +1,17 @@
+#ifndef IPV6_PARSE_HEADER_ONLY
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L // clock_gettime for PARSE_PROFILE
+#endif
+
 #include "ipv6.h"
 #include "ipv6_config.h"
+#else
+// Included by ipv6.h, header-only builds use the standard headers directly
+// instead of the generated configuration
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#endif
 
 
 #ifdef HAVE_STDIO_H
@@ -14,12 +26,40 @@
 #include <stdarg.h>
 #endif
 
+#ifdef PARSE_PROFILE
+#include "ipv6_profile.h"
+#include "ipv6_clock.h"
+#endif
+
+#include "ipv6_counters.h"
+
+#ifdef PARSE_COUNTERS
+#define IPV6_COUNT(...) __VA_ARGS__
+#else
+#define IPV6_COUNT(...)
+#endif
+
 #if defined(PARSE_TRACE)
 #define IPV6_TRACE(...) printf(__VA_ARGS__)
 #else
 #define IPV6_TRACE(...)
 #endif
 
+//
+// Static probe points for SystemTap / bpftrace / dtrace, provider 'ipv6_parse'.
+// An unattached probe is a single nop so they are left enabled in release builds:
+//
+//   bpftrace -e 'usdt:./libipv6-parse.so:ipv6_parse:error { printf("%d %s\n", arg3, str(arg0, arg1)); }'
+//
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+#define IPV6_PROBE4(name, a, b, c, d) DTRACE_PROBE4(ipv6_parse, name, a, b, c, d)
+#define IPV6_PROBE5(name, a, b, c, d, e) DTRACE_PROBE5(ipv6_parse, name, a, b, c, d, e)
+#else
+#define IPV6_PROBE4(name, a, b, c, d)
+#define IPV6_PROBE5(name, a, b, c, d, e)
+#endif
+
 #ifdef HAVE__SNPRINTF_S
 #define platform_snprintf(buffer, bytes, format, ...) \
     _snprintf_s(buffer, bytes, _TRUNCATE, format, __VA_ARGS__)
@@ -32,9 +72,15 @@
 // Original core address RFC 3513: https://tools.ietf.org/html/rfc3513
 // Replacement address RFC 4291: https://tools.ietf.org/html/rfc4291
 
-const uint32_t IPV6_STRING_SIZE =
+#ifdef IPV6_PARSE_HEADER_ONLY
+#define IPV6_DATA_LINKAGE static
+#else
+#define IPV6_DATA_LINKAGE
+#endif
+
+IPV6_DATA_LINKAGE const uint32_t IPV6_STRING_SIZE =
     sizeof "[1234:1234:1234:1234:1234:1234:1234:1234/128%longinterface]:65535";
-const uint32_t IPV4_STRING_SIZE = sizeof "255.255.255.255:65535";
+IPV6_DATA_LINKAGE const uint32_t IPV4_STRING_SIZE = sizeof "255.255.255.255:65535";
 
 //
 // Distinct states of parsing an address
@@ -49,8 +95,11 @@ typedef enum {
     STATE_PORT              = 6,
     STATE_POST_ADDR         = 7,
     STATE_ERROR             = 8,
+    STATE_WILDCARD          = 9,
 } state_t;
 
+#define STATE_COUNT 10
+
 //
 // Characters are converted into event classes
 // to trigger state transitions
@@ -65,8 +114,16 @@ typedef enum {
     EC_OPEN_BRACKET         = 6,
     EC_CLOSE_BRACKET        = 7,
     EC_WHITESPACE           = 8,
+    EC_ZONE_CHAR            = 9,
+    EC_WILDCARD             = 10,
 } eventclass_t;
 
+#define EC_COUNT 11
+
+// The counters API exposes the state machine dimensions
+typedef char state_count_matches_counters[(STATE_COUNT == IPV6_COUNTERS_STATES) ? 1 : -1];
+typedef char ec_count_matches_counters[(EC_COUNT == IPV6_COUNTERS_EVENTCLASSES) ? 1 : -1];
+
 //
 // Flags to indicate persistent state in the reader
 //
@@ -75,6 +132,11 @@ typedef enum {
     READER_FLAG_ERROR              = 0x00000002,   // indicates an error occurred in parsing
     READER_FLAG_IPV4_EMBEDDING     = 0x00000004,   // indicates IPv4 embedding has occurred
     READER_FLAG_IPV4_COMPAT        = 0x00000008,   // indicates IPv4 compatible address
+    READER_FLAG_NETWORK_ORDER      = 0x00000010,   // components are stored as network order bytes
+    READER_FLAG_RANGE              = 0x00000020,   // range grammar, '*' octets and '-' ending the address
+    READER_FLAG_RANGE_END          = 0x00000040,   // stopped at the '-' of a range
+    READER_FLAG_DOTTED_MASK        = 0x00000080,   // the CIDR mask token is a dotted netmask
+    READER_FLAG_URI_ZONE           = 0x00000100,   // bracketed zones are RFC 6874 escaped, see ipv6_from_uri_host
 } ipv6_reader_state_flag_t;
 
 //
@@ -96,17 +158,42 @@ typedef struct ipv6_reader_state_t {
     int32_t                     zerorun;            // component where run of zeros was begun ::1 would be 0, 1::2 would be 1
     int32_t                     v4_embedding;       // index where v4_embedding occurred
     int32_t                     v4_octets;          // number of octets provided for the v4 address
+    int32_t                     wildcards;          // number of trailing v4 octets given as '*'
     uint32_t                    flags;              // flags recording state
-    ipv6_diag_func_t            diag_func;          // callback for diagnostics
+    ipv6_diag_func_t            diag_func;          // callback for diagnostics, may be NULL
     void*                       user_data;          // user data passed to diag callback
+    ipv6_diag_result_t*         diag_result;        // compact diagnostic record, may be NULL
 } ipv6_reader_state_t;
 
 
+#ifdef PARSE_COUNTERS
+static ipv6_counters_t parse_counters;
+
+//
+// Counters are relaxed atomic adds, the batch, validate and pipeline modules
+// parse on several threads at once
+//
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define COUNTER_ADD(counter, value) _InterlockedExchangeAdd64((volatile __int64*)&(counter), (__int64)(value))
+#define COUNTER_LOAD(counter) (*(volatile const uint64_t*)&(counter))
+#define COUNTER_STORE(counter, value) (*(volatile uint64_t*)&(counter) = (value))
+#else
+#define COUNTER_ADD(counter, value) __atomic_fetch_add(&(counter), (uint64_t)(value), __ATOMIC_RELAXED)
+#define COUNTER_LOAD(counter) __atomic_load_n(&(counter), __ATOMIC_RELAXED)
+#define COUNTER_STORE(counter, value) __atomic_store_n(&(counter), (uint64_t)(value), __ATOMIC_RELAXED)
+#endif
+
+// The counters are all 64 bit words
+#define COUNTER_WORDS (sizeof(ipv6_counters_t) / sizeof(uint64_t))
+typedef char counters_are_words[(sizeof(ipv6_counters_t) % sizeof(uint64_t) == 0) ? 1 : -1];
+#endif
+
 //
-// Enable this section to get a full dump of the parser
+// Names of states and event classes for tracing and counters
 //
+#if defined(PARSE_TRACE) || !defined(IPV6_PARSE_HEADER_ONLY)
 
-#if defined(PARSE_TRACE)
 //--------------------------------------------------------------------------------
 static const char* state_str (state_t state)
 {
@@ -120,6 +207,7 @@ static const char* state_str (state_t state)
         case STATE_PORT:            return "state-port";
         case STATE_POST_ADDR:       return "state-post-addr";
         case STATE_ERROR:           return "state-error";
+        case STATE_WILDCARD:        return "state-wildcard";
         default: break;
     }
     return "<unknown>";
@@ -138,24 +226,35 @@ static const char* eventclass_str (eventclass_t input)
         case EC_OPEN_BRACKET:       return "eventclass-open-bracket";
         case EC_CLOSE_BRACKET:      return "eventclass-close-bracket";
         case EC_WHITESPACE:         return "eventclass-whitespace";
+        case EC_ZONE_CHAR:          return "eventclass-zone-char";
+        case EC_WILDCARD:           return "eventclass-wildcard";
         default:
             break;
     }
 
     return "<unknown>";
 }
-#endif // PARSE_TRACE
+#endif
 
 //
 // Update the current state logging the transition
 //
+// probe change_state(input, input_bytes, position, from state, to state)
+//
 #define CHANGE_STATE(value) \
     IPV6_TRACE("  * %s -> %s %s:%u\n", \
         state_str(state->current), state_str(value), __FILE__, (uint32_t)__LINE__); \
+    IPV6_PROBE5(change_state, state->input, state->input_bytes, state->position, \
+        (int32_t)state->current, (int32_t)(value)); \
     state->current = value;
 
+//
+// probe begin_token(input, input_bytes, state, token position)
+//
 #define BEGIN_TOKEN(offset) \
     IPV6_TRACE("  * %s: token begin at %u\n", state_str(state->current), state->position + offset); \
+    IPV6_PROBE4(begin_token, state->input, state->input_bytes, \
+        (int32_t)state->current, state->position + offset); \
     state->token_position = state->position + offset; \
     state->token_len = 0; \
 
@@ -181,21 +280,48 @@ static const char* eventclass_str (eventclass_t input)
 
 //--------------------------------------------------------------------------------
 // Indicate error, function here for breakpoints
+//
+// probe error(input, input_bytes, position, ipv6_diag_event_t, message)
+//
 static void ipv6_error (ipv6_reader_state_t* state,
     ipv6_diag_event_t event,
     const char* message)
 {
-    ipv6_diag_info_t info;
-    info.message = message;
-    info.input = state->input;
-    info.position = state->position;
+    IPV6_PROBE5(error, state->input, state->input_bytes, state->position, (int32_t)event, message);
+
+    if (state->diag_result) {
+        state->diag_result->event = event;
+        state->diag_result->position = (uint32_t)state->position;
+    }
+
+    if (state->diag_func) {
+        ipv6_diag_info_t info;
+        info.message = message;
+        info.input = state->input;
+        info.position = (uint32_t)state->position;
+        info.pad0 = 0;
+
+        state->diag_func(event, &info, state->user_data);
+    }
 
-    state->diag_func(event, &info, state->user_data);
     state->flags |= READER_FLAG_ERROR;
     state->error_message = message;
     CHANGE_STATE(STATE_ERROR);
 }
 
+#ifdef PARSE_COUNTERS
+//--------------------------------------------------------------------------------
+static void count_token (ipv6_counters_token_t kind, int32_t token_len)
+{
+    const int32_t bucket = token_len < IPV6_COUNTERS_TOKEN_LENGTHS ? token_len : IPV6_COUNTERS_TOKEN_LENGTHS - 1;
+    COUNTER_ADD(parse_counters.token_lengths[kind][bucket], 1);
+}
+#endif
+
+// Token values stop growing past this bound, above the largest valid port,
+// mask or component, so long tokens fail the range checks without overflow
+#define TOKEN_SATURATED 0x100000
+
 //--------------------------------------------------------------------------------
 static int32_t read_decimal_token (ipv6_reader_state_t* state)
 {
@@ -204,15 +330,20 @@ static int32_t read_decimal_token (ipv6_reader_state_t* state)
             state->token_position + state->token_len <= state->input_bytes,
             return 0);
 
+    IPV6_COUNT(count_token(IPV6_COUNTERS_TOKEN_DECIMAL, state->token_len));
+
     const char* cp = state->input + state->token_position;
     const char* ep = cp + state->token_len;
     int32_t accumulate = 0;
     int32_t digit;
-    while (*cp && cp < ep) {
+    while (cp < ep && *cp) {
         switch (*cp) {
             case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9':
                 digit = *cp - '0';
-                accumulate = (accumulate * 10) + digit;
+                // Saturate above every valid value instead of overflowing
+                if (accumulate < TOKEN_SATURATED) {
+                    accumulate = (accumulate * 10) + digit;
+                }
                 break;
 
             default:
@@ -233,11 +364,13 @@ static int32_t read_hexidecimal_token (ipv6_reader_state_t* state)
             state->token_position + state->token_len <= state->input_bytes,
             return 0);
 
+    IPV6_COUNT(count_token(IPV6_COUNTERS_TOKEN_HEX, state->token_len));
+
     const char* cp = state->input + state->token_position;
     const char* ep = cp + state->token_len;
     int32_t accumulate = 0;
     int32_t digit;
-    while (*cp && cp < ep) {
+    while (cp < ep && *cp) {
         switch (*cp) {
             case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9':
                 digit = (*cp - '0');
@@ -255,7 +388,9 @@ static int32_t read_hexidecimal_token (ipv6_reader_state_t* state)
                 ipv6_error(state, IPV6_DIAG_INVALID_INPUT, "Non-hexidecimal token input");
                 return 0;
         }
-        accumulate = (accumulate << 4) | digit;
+        if (accumulate < TOKEN_SATURATED) {
+            accumulate = (accumulate << 4) | digit;
+        }
         cp++;
     }
 
@@ -279,7 +414,13 @@ static void ipv6_parse_component (ipv6_reader_state_t* state) {
             component <= 0xffff,
             return);
 
-    state->address_full->address.components[state->components] = (uint16_t)component;
+    if (state->flags & READER_FLAG_NETWORK_ORDER) {
+        uint8_t* bytes = (uint8_t*)&state->address_full->address.components[state->components];
+        bytes[0] = (uint8_t)(component >> 8);
+        bytes[1] = (uint8_t)component;
+    } else {
+        state->address_full->address.components[state->components] = (uint16_t)component;
+    }
     state->components++;
 
     state->token_position = 0;
@@ -307,14 +448,25 @@ static void ipv4_parse_component (ipv6_reader_state_t* state) {
         state->v4_embedding <= 6,
         return);
 
-    // embed the octets such that they can be trivially treated as host order
-    // node values e.g.: INADDR_LOOPBACK == components[0] << 16 | components[1]
-    // octet 0,1 -> component embedding+0
-    // octet 2,3 -> component embedding+1
-    // even octets are in shifted to the upper 8 bits of the component
-    uint16_t* addr_component = &state->address_full->address.components[state->v4_embedding + (state->v4_octets / 2)];
-    const uint32_t shift = (1 - (state->v4_octets & 1)) * 8;
-    *addr_component |= (uint16_t)octet << shift;
+    VALIDATE("Wildcards must be the last octets",
+        IPV6_DIAG_INVALID_INPUT,
+        state->wildcards == 0,
+        return);
+
+    if (state->flags & READER_FLAG_NETWORK_ORDER) {
+        // octets are already in network order, store them in input order
+        uint8_t* bytes = (uint8_t*)&state->address_full->address.components[state->v4_embedding];
+        bytes[state->v4_octets] = (uint8_t)octet;
+    } else {
+        // embed the octets such that they can be trivially treated as host order
+        // node values e.g.: INADDR_LOOPBACK == components[0] << 16 | components[1]
+        // octet 0,1 -> component embedding+0
+        // octet 2,3 -> component embedding+1
+        // even octets are in shifted to the upper 8 bits of the component
+        uint16_t* addr_component = &state->address_full->address.components[state->v4_embedding + (state->v4_octets / 2)];
+        const uint32_t shift = (1 - (state->v4_octets & 1)) * 8;
+        *addr_component |= (uint16_t)octet << shift;
+    }
 
     state->v4_octets++;
     state->token_position = 0;
@@ -330,8 +482,85 @@ static void ipvx_parse_component (ipv6_reader_state_t* state) {
     }
 }
 
+//--------------------------------------------------------------------------------
+// A '*' octet of a range, 10.1.*.* is 10.1.0.0/16
+static void ipv4_parse_wildcard (ipv6_reader_state_t* state) {
+    // The first octet starts a pure IPv4 address
+    if (!(state->flags & READER_FLAG_IPV4_EMBEDDING) && !(state->flags & READER_FLAG_ZERORUN) &&
+        state->components == 0 && state->brackets == 0) {
+        state->flags |= READER_FLAG_IPV4_EMBEDDING | READER_FLAG_IPV4_COMPAT;
+        state->components += 2;
+    }
+
+    VALIDATE("Wildcards are only allowed in IPv4 addresses",
+        IPV6_DIAG_INVALID_INPUT,
+        state->flags & READER_FLAG_IPV4_COMPAT,
+        return);
+
+    VALIDATE("Only 4 8bit components are allowed in an IPv4 address",
+        IPV6_DIAG_V4_BAD_COMPONENT_COUNT,
+        state->v4_octets < 4,
+        return);
+
+    state->v4_octets++;
+    state->wildcards++;
+}
+
+//--------------------------------------------------------------------------------
+// Dotted netmask of an IPv4 address, 255.255.255.0 is /24
+static void ipv4_parse_netmask (ipv6_reader_state_t* state) {
+    const int32_t end = state->token_position + state->token_len;
+    int32_t position = state->token_position;
+    uint32_t netmask = 0;
+    int32_t octets = 0;
+
+    VALIDATE("Dotted netmasks are only allowed after IPv4 addresses",
+        IPV6_DIAG_INVALID_CIDR_MASK,
+        state->flags & READER_FLAG_IPV4_COMPAT,
+        return);
+
+    while (octets < 4 && position <= end) {
+        state->token_position = position;
+        state->token_len = 0;
+        while (position < end && state->input[position] != '.') {
+            position++;
+            state->token_len++;
+        }
+
+        const int32_t octet = read_decimal_token(state);
+        VALIDATE("Netmask octets must be between 0 and 255",
+            IPV6_DIAG_INVALID_CIDR_MASK,
+            state->token_len > 0 && octet <= 0xff,
+            return);
+
+        netmask = (netmask << 8) | (uint32_t)octet;
+        octets++;
+        position++;
+    }
+
+    // Leading ones then zeros, the host bits plus one are a power of two
+    const uint32_t hosts = ~netmask;
+    VALIDATE("Netmask must be 4 octets of contiguous leading ones",
+        IPV6_DIAG_INVALID_CIDR_MASK,
+        octets == 4 && position == end + 1 && (hosts & (hosts + 1)) == 0,
+        return);
+
+    uint32_t mask = 0;
+    while (mask < 32 && (netmask & (0x80000000u >> mask))) {
+        mask++;
+    }
+
+    state->address_full->mask = mask;
+    state->address_full->flags |= IPV6_FLAG_HAS_MASK;
+}
+
 //--------------------------------------------------------------------------------
 static void ipvx_parse_cidr (ipv6_reader_state_t* state) {
+    if (state->flags & READER_FLAG_DOTTED_MASK) {
+        ipv4_parse_netmask(state);
+        return;
+    }
+
     int32_t mask = read_decimal_token(state);
 
     VALIDATE("CIDR mask must be between 0 and 128 bits",
@@ -356,6 +585,49 @@ static void ipvx_parse_port (ipv6_reader_state_t* state) {
     state->address_full->flags |= IPV6_FLAG_HAS_PORT;
 }
 
+//--------------------------------------------------------------------------------
+// The interface name starts after the '%' being processed
+static void ipvx_begin_iface (ipv6_reader_state_t* state) {
+    state->address_full->iface = state->input + state->position + 1;
+    state->address_full->iface_len = 0;
+}
+
+//--------------------------------------------------------------------------------
+// End of the interface name, a numeric name is a scope id
+static void ipvx_parse_iface (ipv6_reader_state_t* state) {
+    ipv6_address_full_t* out = state->address_full;
+
+    // In a URI host the '%' is written "%25" (RFC 6874)
+    if ((state->flags & READER_FLAG_URI_ZONE) && state->brackets) {
+        VALIDATE("Zone of a URI host must be escaped as %25",
+            IPV6_DIAG_INVALID_INPUT,
+            out->iface_len > 1 && out->iface[0] == '2' && out->iface[1] == '5',
+            return);
+
+        out->iface += 2;
+        out->iface_len -= 2;
+    }
+
+    VALIDATE("Interface name must not be empty",
+        IPV6_DIAG_INVALID_INPUT,
+        out->iface_len > 0,
+        return);
+
+    for (uint32_t i = 0; i < out->iface_len; ++i) {
+        if (out->iface[i] < '0' || out->iface[i] > '9') {
+            return;
+        }
+    }
+
+    state->token_position = (int32_t)(out->iface - state->input);
+    state->token_len = (int32_t)out->iface_len;
+    const int32_t scope_id = read_decimal_token(state);
+    if (scope_id <= 0xffff) {
+        out->zone = (uint16_t)scope_id;
+        out->flags |= IPV6_FLAG_ZONE_ID;
+    }
+}
+
 //--------------------------------------------------------------------------------
 //
 // State transition function for parser, given a current state and a event class input
@@ -366,6 +638,7 @@ static void ipv6_state_transition (
     eventclass_t input)
 {
     IPV6_TRACE("  * transition input: %s <- %s\n", state_str(state->current), eventclass_str(input));
+    IPV6_COUNT(COUNTER_ADD(parse_counters.transitions[state->current][input], 1));
 
     switch (state->current) {
         default:
@@ -404,6 +677,11 @@ static void ipv6_state_transition (
                 case EC_WHITESPACE:
                     break;
 
+                case EC_WILDCARD:
+                    ipv4_parse_wildcard(state);
+                    CHANGE_STATE(STATE_WILDCARD);
+                    break;
+
                 default:
                     INVALID_INPUT();
                     break;
@@ -474,6 +752,7 @@ static void ipv6_state_transition (
                 case EC_IFACE:
                     ipvx_parse_component(state);
                     CHANGE_STATE(STATE_IFACE);
+                    ipvx_begin_iface(state);
                     break;
 
                 case EC_CIDR_MASK:
@@ -529,6 +808,7 @@ static void ipv6_state_transition (
 
                 case EC_IFACE:
                     CHANGE_STATE(STATE_IFACE);
+                    ipvx_begin_iface(state);
                     break;
 
                 case EC_CIDR_MASK:
@@ -544,17 +824,33 @@ static void ipv6_state_transition (
             break;
 
         case STATE_IFACE:
-            // TODO: identify all valid interface characters
+            // Interface names are RFC 6874 unreserved characters
             switch (input) {
+                case EC_DIGIT:
+                case EC_HEX_DIGIT:
+                case EC_ZONE_CHAR:
+                case EC_V4_COMPONENT_SEP:
+                    state->address_full->iface_len++;
+                    break;
+
                 case EC_WHITESPACE:
+                    ipvx_parse_iface(state);
                     CHANGE_STATE(STATE_NONE);
                     break;
 
                 case EC_CLOSE_BRACKET:
+                    ipvx_parse_iface(state);
                     CHANGE_STATE(STATE_POST_ADDR);
                     break;
 
+                case EC_CIDR_MASK:
+                    ipvx_parse_iface(state);
+                    CHANGE_STATE(STATE_CIDR);
+                    BEGIN_TOKEN(1);
+                    break;
+
                 default:
+                    INVALID_INPUT();
                     break;
             }
             break;
@@ -565,6 +861,11 @@ static void ipv6_state_transition (
                     state->token_len++;
                     break;
 
+                case EC_V4_COMPONENT_SEP:
+                    state->flags |= READER_FLAG_DOTTED_MASK;
+                    state->token_len++;
+                    break;
+
                 case EC_CLOSE_BRACKET:
                     ipvx_parse_cidr(state);
                     CHANGE_STATE(STATE_POST_ADDR);
@@ -578,6 +879,21 @@ static void ipv6_state_transition (
                 case EC_IFACE:
                     ipvx_parse_cidr(state);
                     CHANGE_STATE(STATE_IFACE);
+                    ipvx_begin_iface(state);
+                    break;
+
+                default:
+                    INVALID_INPUT();
+                    break;
+            }
+            break;
+
+        case STATE_WILDCARD:
+            // Only more wildcards may follow, no mask, zone or port
+            switch (input) {
+                case EC_V4_COMPONENT_SEP:
+                case EC_WHITESPACE:
+                    CHANGE_STATE(STATE_NONE);
                     break;
 
                 default:
@@ -623,12 +939,15 @@ static void ipv6_state_transition (
 }
 
 //--------------------------------------------------------------------------------
-bool IPV6_API_DEF(ipv6_from_str_diag) (
+static bool read_address (
     const char* input,
     size_t input_bytes,
     ipv6_address_full_t* out,
     ipv6_diag_func_t func,
-    void* user_data)
+    void* user_data,
+    ipv6_diag_result_t* result,
+    uint32_t reader_flags,
+    size_t* range_end)
 {
     const char *cp = input;
     const char* ep = input + input_bytes;
@@ -638,8 +957,9 @@ bool IPV6_API_DEF(ipv6_from_str_diag) (
 
     state.diag_func = func;
     state.user_data = user_data;
+    state.diag_result = result;
 
-    if (!input || !*input || !out) {
+    if (!input || !input_bytes || !*input || !out) {
         ipv6_error(&state, IPV6_DIAG_INVALID_INPUT,
             "Invalid input");
         return false;
@@ -657,8 +977,15 @@ bool IPV6_API_DEF(ipv6_from_str_diag) (
     state.input = input;
     state.input_bytes = (int32_t)input_bytes;
     state.address_full = out;
+    state.flags = reader_flags;
 
-    while (*cp && cp < ep) {
+    if (reader_flags & READER_FLAG_NETWORK_ORDER) {
+        out->flags |= IPV6_FLAG_NETWORK_ORDER;
+    }
+
+    IPV6_COUNT(COUNTER_ADD(parse_counters.parses, 1));
+
+    while (cp < ep && *cp) {
         IPV6_TRACE(
             "  * parse state: %s, cp: '%c' (%02x) position: %d, flags: %08x\n",
             state_str(state.current),
@@ -709,6 +1036,42 @@ bool IPV6_API_DEF(ipv6_from_str_diag) (
                 ipv6_state_transition(&state, EC_WHITESPACE);
                 break;
 
+            // Characters only allowed in interface names
+            case 'G': case 'H': case 'I': case 'J': case 'K': case 'L': case 'M': case 'N': case 'O':
+            case 'P': case 'Q': case 'R': case 'S': case 'T': case 'U': case 'V': case 'W': case 'X':
+            case 'Y': case 'Z':
+            case 'g': case 'h': case 'i': case 'j': case 'k': case 'l': case 'm': case 'n': case 'o':
+            case 'p': case 'q': case 'r': case 's': case 't': case 'u': case 'v': case 'w': case 'x':
+            case 'y': case 'z':
+            case '_': case '~':
+                if (state.current == STATE_IFACE) {
+                    ipv6_state_transition(&state, EC_ZONE_CHAR);
+                } else {
+                    ipv6_error(&state, IPV6_DIAG_INVALID_INPUT_CHAR,
+                        "Invalid input character");
+                }
+                break;
+
+            // Also ends the first address of a range
+            case '-':
+                if (state.current == STATE_IFACE) {
+                    ipv6_state_transition(&state, EC_ZONE_CHAR);
+                } else if (state.flags & READER_FLAG_RANGE) {
+                    state.flags |= READER_FLAG_RANGE_END;
+                } else {
+                    ipv6_error(&state, IPV6_DIAG_INVALID_INPUT_CHAR,
+                        "Invalid input character");
+                }
+                break;
+
+            case '*':
+                if (state.flags & READER_FLAG_RANGE) {
+                    ipv6_state_transition(&state, EC_WILDCARD);
+                } else {
+                    ipv6_error(&state, IPV6_DIAG_INVALID_INPUT_CHAR,
+                        "Invalid input character");
+                }
+                break;
 
             default:
                 ipv6_error(&state, IPV6_DIAG_INVALID_INPUT_CHAR,
@@ -716,15 +1079,22 @@ bool IPV6_API_DEF(ipv6_from_str_diag) (
                 break;
         }
 
-        // Exit the parse if the last state change triggered an error
-        if (state.flags & READER_FLAG_ERROR) {
-            return false;
+        // Exit the parse if the last state change triggered an error or ended a range address
+        if (state.flags & (READER_FLAG_ERROR | READER_FLAG_RANGE_END)) {
+            if (state.flags & READER_FLAG_ERROR) {
+                return false;
+            }
+            break;
         }
 
         cp++;
         state.position++;
     }
 
+    if (range_end) {
+        *range_end = (size_t)state.position;
+    }
+
     // Treat the end of input as whitespace to simplify state transitions
     ipv6_state_transition(&state, EC_WHITESPACE);
 
@@ -742,6 +1112,12 @@ bool IPV6_API_DEF(ipv6_from_str_diag) (
             return false;
         }
         state.address_full->flags |= IPV6_FLAG_IPV4_COMPAT;
+
+        // Wildcard octets are the host bits of a prefix
+        if (state.wildcards) {
+            state.address_full->mask = 32 - 8 * (uint32_t)state.wildcards;
+            state.address_full->flags |= IPV6_FLAG_HAS_MASK;
+        }
         return true;
     }
 
@@ -781,6 +1157,10 @@ bool IPV6_API_DEF(ipv6_from_str_diag) (
         return false;
     }
 
+    IPV6_COUNT(COUNTER_ADD(parse_counters.zerorun_shuffles, 1));
+    IPV6_COUNT(COUNTER_ADD(parse_counters.zerorun_empty, move_count == 0));
+    IPV6_COUNT(COUNTER_ADD(parse_counters.zerorun_components, move_count));
+
     // Copy the right side of the zero run
     memcpy(&dst[target], &src[state.zerorun], move_count * sizeof(uint16_t));
 
@@ -794,36 +1174,487 @@ bool IPV6_API_DEF(ipv6_from_str_diag) (
 }
 
 //--------------------------------------------------------------------------------
-static void ipv6_default_diag (
-    ipv6_diag_event_t event,
-    const ipv6_diag_info_t* info,
+// Common entry point of the parse APIs
+static bool parse_address (
+    const char* input,
+    size_t input_bytes,
+    ipv6_address_full_t* out,
+    ipv6_diag_func_t func,
+    void* user_data,
+    ipv6_diag_result_t* diag_result,
+    uint32_t reader_flags)
+{
+#ifdef PARSE_PROFILE
+    if (ipv6_profile_should_sample()) {
+        const uint64_t start = ipv6_clock_ns();
+        const bool result = read_address(input, input_bytes, out, func, user_data, diag_result, reader_flags, NULL);
+        const uint64_t elapsed = ipv6_clock_ns() - start;
+
+        ipv6_profile_record(IPV6_PROFILE_OP_FROM_STR,
+            result ? ipv6_profile_shape(out->flags) : IPV6_PROFILE_SHAPE_INVALID,
+            elapsed);
+        return result;
+    }
+#endif
+
+    return read_address(input, input_bytes, out, func, user_data, diag_result, reader_flags, NULL);
+}
+
+//--------------------------------------------------------------------------------
+IPV6_API_LINKAGE bool IPV6_API_DEF(ipv6_from_str_diag) (
+    const char* input,
+    size_t input_bytes,
+    ipv6_address_full_t* out,
+    ipv6_diag_func_t func,
     void* user_data)
 {
-    (void)event;
-    (void)info;
-    (void)user_data;
+    return parse_address(input, input_bytes, out, func, user_data, NULL, 0);
 }
 
 //--------------------------------------------------------------------------------
-bool IPV6_API_DEF(ipv6_from_str) (
+IPV6_API_LINKAGE bool IPV6_API_DEF(ipv6_from_str_compact) (
+    const char* input,
+    size_t input_bytes,
+    ipv6_address_full_t* out,
+    ipv6_diag_result_t* result)
+{
+    return parse_address(input, input_bytes, out, NULL, NULL, result, 0);
+}
+
+//--------------------------------------------------------------------------------
+IPV6_API_LINKAGE bool IPV6_API_DEF(ipv6_from_str) (
     const char* input,
     size_t input_bytes,
     ipv6_address_full_t* out)
 {
-    return ipv6_from_str_diag(input, input_bytes, out, ipv6_default_diag, NULL);
+    return parse_address(input, input_bytes, out, NULL, NULL, NULL, 0);
+}
+
+//--------------------------------------------------------------------------------
+IPV6_API_LINKAGE bool IPV6_API_DEF(ipv6_from_str_network) (
+    const char* input,
+    size_t input_bytes,
+    ipv6_address_full_t* out,
+    ipv6_diag_result_t* result)
+{
+    return parse_address(input, input_bytes, out, NULL, NULL, result, READER_FLAG_NETWORK_ORDER);
+}
+
+//--------------------------------------------------------------------------------
+IPV6_API_LINKAGE bool IPV6_API_DEF(ipv6_from_uri_host) (
+    const char* input,
+    size_t input_bytes,
+    ipv6_address_full_t* out,
+    ipv6_diag_result_t* result)
+{
+    return parse_address(input, input_bytes, out, NULL, NULL, result, READER_FLAG_URI_ZONE);
+}
+
+//
+// Reverse DNS names list the nibbles (ip6.arpa) or octets (in-addr.arpa) of
+// an address least significant first, one label each. Names of every label
+// of the address are decoded 8 bytes at a time, four "n." labels per word,
+// others label by label with the token readers of the address parser.
+//
+#define ARPA_IP6_SUFFIX "ip6.arpa"
+#define ARPA_IN_ADDR_SUFFIX "in-addr.arpa"
+#define ARPA_IP6_LABELS 32
+#define ARPA_IN_ADDR_LABELS 4
+#define ARPA_MAX_BYTES (ARPA_IP6_LABELS * 2 + sizeof ARPA_IP6_SUFFIX)
+
+//--------------------------------------------------------------------------------
+// Length of the labels before suffix, including the '.' ending the last
+// label, 0 if the name does not end in suffix
+static size_t arpa_labels_bytes (const char* input, size_t input_bytes, const char* suffix, size_t suffix_bytes)
+{
+    if (input_bytes <= suffix_bytes || input[input_bytes - suffix_bytes - 1] != '.') {
+        return 0;
+    }
+
+    const char* cp = input + input_bytes - suffix_bytes;
+    for (size_t i = 0; i < suffix_bytes; ++i) {
+        const char c = (cp[i] >= 'A' && cp[i] <= 'Z') ? (char)(cp[i] - 'A' + 'a') : cp[i];
+        if (c != suffix[i]) {
+            return 0;
+        }
+    }
+    return input_bytes - suffix_bytes;
+}
+
+//--------------------------------------------------------------------------------
+// 16 bit lanes with bit 8 set where the low byte is in [lo, hi]
+static uint64_t arpa_lanes_in_range (uint64_t lanes, uint32_t lo, uint32_t hi)
+{
+    const uint64_t ones = 0x0001000100010001ULL;
+    const uint64_t at_least = lanes + ones * (0x100 - lo);
+    const uint64_t above = lanes + ones * (0xff - hi);
+    return at_least & ~above & (ones << 8);
+}
+
+//--------------------------------------------------------------------------------
+// Decode the 64 bytes of a full ip6.arpa name, false if any label is not a
+// single hex digit followed by '.'
+static bool arpa_decode_ip6_words (const char* input, uint16_t* components)
+{
+    const uint64_t ones = 0x0001000100010001ULL;
+
+    for (uint32_t word = 0; word < IPV6_NUM_COMPONENTS; ++word) {
+        // Assembled in little-endian lane order on any host, a single load where it matters
+        const uint8_t* bytes = (const uint8_t*)input + word * 8;
+        uint64_t value = 0;
+        for (uint32_t i = 0; i < 8; ++i) {
+            value |= (uint64_t)bytes[i] << (8 * i);
+        }
+
+        if ((value & (ones * 0xff00)) != ones * ('.' << 8)) {
+            return false;
+        }
+
+        const uint64_t lanes = value & (ones * 0xff);
+        const uint64_t digit = arpa_lanes_in_range(lanes, '0', '9');
+        const uint64_t alpha = arpa_lanes_in_range(lanes | (ones * 0x20), 'a', 'f');
+        if ((digit | alpha) != (ones << 8)) {
+            return false;
+        }
+
+        // '0' -> 0, 'a' and 'A' -> 1 + 9
+        const uint64_t nibbles = (lanes & (ones * 0xf)) + (alpha >> 8) * 9;
+        const uint64_t packed = nibbles | (nibbles >> 12);
+
+        // The first word holds the least significant component
+        components[IPV6_NUM_COMPONENTS - 1 - word] = (uint16_t)((packed & 0xff) | ((packed >> 24) & 0xff00));
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------------------
+IPV6_API_LINKAGE bool IPV6_API_DEF(ipv6_from_arpa) (
+    const char* input,
+    size_t input_bytes,
+    ipv6_address_full_t* out,
+    ipv6_diag_result_t* result)
+{
+    ipv6_reader_state_t reader;
+    ipv6_reader_state_t* state = &reader;
+
+    memset(state, 0, sizeof(*state));
+    state->diag_result = result;
+
+    if (!input || !input_bytes || !*input || !out) {
+        ipv6_error(state, IPV6_DIAG_INVALID_INPUT, "Invalid input");
+        return false;
+    }
+
+    if (input_bytes > ARPA_MAX_BYTES) {
+        ipv6_error(state, IPV6_DIAG_STRING_SIZE_EXCEEDED, "Input string size exceeded");
+        return false;
+    }
+
+    memset(out, 0, sizeof(ipv6_address_full_t));
+    state->input = input;
+    state->input_bytes = (int32_t)input_bytes;
+    state->address_full = out;
+
+    // The root label of a fully qualified name is optional
+    const size_t name_bytes = input_bytes - (input[input_bytes - 1] == '.');
+    size_t labels_bytes = arpa_labels_bytes(input, name_bytes, ARPA_IP6_SUFFIX, sizeof ARPA_IP6_SUFFIX - 1);
+    const bool ip6 = labels_bytes != 0;
+    if (!ip6) {
+        labels_bytes = arpa_labels_bytes(input, name_bytes, ARPA_IN_ADDR_SUFFIX, sizeof ARPA_IN_ADDR_SUFFIX - 1);
+    }
+
+    VALIDATE("Name must end in ip6.arpa or in-addr.arpa",
+        IPV6_DIAG_INVALID_INPUT,
+        labels_bytes != 0,
+        return false);
+
+    if (ip6 && labels_bytes == ARPA_IP6_LABELS * 2 &&
+        arpa_decode_ip6_words(input, out->address.components)) {
+        return true;
+    }
+
+    const int32_t max_labels = ip6 ? ARPA_IP6_LABELS : ARPA_IN_ADDR_LABELS;
+    uint8_t values[ARPA_IP6_LABELS];
+    int32_t labels = 0;
+
+    while (state->position < (int32_t)labels_bytes) {
+        state->token_position = state->position;
+        state->token_len = 0;
+        while (input[state->token_position + state->token_len] != '.') {
+            state->position = state->token_position + state->token_len;
+            VALIDATE("Invalid input character",
+                IPV6_DIAG_INVALID_INPUT_CHAR,
+                input[state->position] != '\0',
+                return false);
+            state->token_len++;
+        }
+        state->position = state->token_position;
+
+        VALIDATE("Empty label",
+            IPV6_DIAG_INVALID_INPUT,
+            state->token_len > 0,
+            return false);
+
+        if (ip6) {
+            VALIDATE("Only 32 nibble labels are allowed",
+                IPV6_DIAG_V6_BAD_COMPONENT_COUNT,
+                labels < max_labels,
+                return false);
+
+            VALIDATE("ip6.arpa labels must be a single nibble",
+                IPV6_DIAG_V6_COMPONENT_OUT_OF_RANGE,
+                state->token_len == 1,
+                return false);
+
+            const int32_t nibble = read_hexidecimal_token(state);
+            if (state->flags & READER_FLAG_ERROR) {
+                return false;
+            }
+            values[labels] = (uint8_t)nibble;
+        } else {
+            VALIDATE("Only 4 octet labels are allowed",
+                IPV6_DIAG_V4_BAD_COMPONENT_COUNT,
+                labels < max_labels,
+                return false);
+
+            const int32_t octet = read_decimal_token(state);
+            if (state->flags & READER_FLAG_ERROR) {
+                return false;
+            }
+
+            VALIDATE("in-addr.arpa labels must be <= 255",
+                IPV6_DIAG_V4_COMPONENT_OUT_OF_RANGE,
+                octet <= 0xff,
+                return false);
+            values[labels] = (uint8_t)octet;
+        }
+
+        labels++;
+        state->position = state->token_position + state->token_len + 1;
+    }
+
+    // The last label is the first nibble or octet
+    if (ip6) {
+        for (int32_t i = 0; i < labels; ++i) {
+            const int32_t nibble = labels - 1 - i;
+            out->address.components[nibble / 4] |= (uint16_t)(values[i] << (12 - 4 * (nibble % 4)));
+        }
+    } else {
+        uint32_t value = 0;
+        for (int32_t i = 0; i < labels; ++i) {
+            value |= (uint32_t)values[i] << (8 * (ARPA_IN_ADDR_LABELS - labels + i));
+        }
+        out->address.components[0] = (uint16_t)(value >> 16);
+        out->address.components[1] = (uint16_t)value;
+        out->flags |= IPV6_FLAG_IPV4_COMPAT;
+    }
+
+    // Partial names are the zone of a prefix
+    if (labels < max_labels) {
+        out->mask = (uint32_t)(labels * (ip6 ? 4 : 8));
+        out->flags |= IPV6_FLAG_HAS_MASK;
+    }
+    return true;
+}
+
+//
+// Ranges are read with the address parser in range mode, where '*' is an
+// IPv4 wildcard octet and '-' ends the first address. Prefix ends are then
+// widened to their first or last address.
+//
+
+//--------------------------------------------------------------------------------
+static uint32_t range_bits (const ipv6_address_full_t* address)
+{
+    return (address->flags & IPV6_FLAG_IPV4_COMPAT) ? 32 : 128;
+}
+
+//--------------------------------------------------------------------------------
+// Clear or set the host bits of a prefix, dropping the mask
+static void range_fill (ipv6_address_full_t* address, uint32_t mask, bool ones)
+{
+    const uint32_t bits = range_bits(address);
+    for (uint32_t start = 0; start < bits; start += 16) {
+        const uint16_t host = mask >= start + 16 ? 0 : mask <= start ? 0xffff : (uint16_t)(0xffff >> (mask - start));
+        uint16_t* component = &address->address.components[start / 16];
+        *component = ones ? (uint16_t)(*component | host) : (uint16_t)(*component & ~host);
+    }
+    address->mask = 0;
+    address->flags &= ~(uint32_t)IPV6_FLAG_HAS_MASK;
+}
+
+//--------------------------------------------------------------------------------
+static int32_t range_compare (const ipv6_address_full_t* a, const ipv6_address_full_t* b)
+{
+    for (uint32_t i = 0; i < IPV6_NUM_COMPONENTS; ++i) {
+        if (a->address.components[i] != b->address.components[i]) {
+            return a->address.components[i] < b->address.components[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+//--------------------------------------------------------------------------------
+// Widen a prefix end of a range, end is the position after it for diagnostics
+static bool range_widen (ipv6_reader_state_t* state, ipv6_address_full_t* address, size_t end, bool ones)
+{
+    if (!(address->flags & IPV6_FLAG_HAS_MASK)) {
+        return true;
+    }
+
+    state->position = (int32_t)end;
+    VALIDATE("CIDR mask of an IPv4 address must be between 0 and 32 bits",
+        IPV6_DIAG_INVALID_CIDR_MASK,
+        address->mask <= range_bits(address),
+        return false);
+
+    range_fill(address, address->mask, ones);
+    return true;
+}
+
+//--------------------------------------------------------------------------------
+IPV6_API_LINKAGE bool IPV6_API_DEF(ipv6_range_from_str) (
+    const char* input,
+    size_t input_bytes,
+    ipv6_range_t* out,
+    ipv6_diag_result_t* result)
+{
+    ipv6_reader_state_t reader;
+    ipv6_reader_state_t* state = &reader;
+
+    memset(state, 0, sizeof(*state));
+    state->diag_result = result;
+    state->input = input;
+    state->input_bytes = (int32_t)input_bytes;
+
+    if (!out) {
+        ipv6_error(state, IPV6_DIAG_INVALID_INPUT, "Invalid input");
+        return false;
+    }
+
+    // The first address ends at the '-' or the end of input
+    const size_t first_bytes = input_bytes < IPV6_STRING_SIZE ? input_bytes : IPV6_STRING_SIZE;
+    size_t first_end = 0;
+    if (!read_address(input, first_bytes, &out->first, NULL, NULL, result, READER_FLAG_RANGE, &first_end)) {
+        return false;
+    }
+
+    state->position = (int32_t)first_end;
+    VALIDATE("Input string size exceeded",
+        IPV6_DIAG_STRING_SIZE_EXCEEDED,
+        first_end < first_bytes || first_bytes == input_bytes,
+        return false);
+
+    out->last = out->first;
+    size_t last_end = first_end;
+    if (first_end < first_bytes && input[first_end] == '-') {
+        const size_t offset = first_end + 1;
+        if (!read_address(input + offset, input_bytes - offset, &out->last, NULL, NULL, result,
+                READER_FLAG_RANGE, &last_end)) {
+            if (result) {
+                result->position += (uint32_t)offset;
+            }
+            return false;
+        }
+        last_end += offset;
+
+        state->position = (int32_t)last_end;
+        VALIDATE("Only one '-' is allowed in a range",
+            IPV6_DIAG_INVALID_INPUT_CHAR,
+            last_end >= input_bytes || input[last_end] != '-',
+            return false);
+
+        state->position = (int32_t)first_end;
+        VALIDATE("Range ends must be of the same family",
+            IPV6_DIAG_INVALID_INPUT,
+            ((out->first.flags ^ out->last.flags) & IPV6_FLAG_IPV4_COMPAT) == 0,
+            return false);
+    }
+
+    if (!range_widen(state, &out->first, first_end, false) ||
+        !range_widen(state, &out->last, last_end, true)) {
+        return false;
+    }
+
+    state->position = (int32_t)first_end;
+    VALIDATE("Range must not end below its start",
+        IPV6_DIAG_INVALID_INPUT,
+        range_compare(&out->first, &out->last) <= 0,
+        return false);
+
+    return true;
+}
+
+//--------------------------------------------------------------------------------
+IPV6_API_LINKAGE bool IPV6_API_DEF(ipv6_range_to_prefix) (
+    const ipv6_range_t* range,
+    ipv6_address_full_t* out)
+{
+    const ipv6_address_full_t* first = &range->first;
+    const ipv6_address_full_t* last = &range->last;
+    const uint32_t bits = range_bits(first);
+
+    if (((first->flags ^ last->flags) & IPV6_FLAG_IPV4_COMPAT) != 0) {
+        return false;
+    }
+
+    // Length of the common leading bits
+    uint32_t mask = 0;
+    while (mask < bits) {
+        const uint32_t shift = 15 - mask % 16;
+        if (((first->address.components[mask / 16] ^ last->address.components[mask / 16]) >> shift) & 1) {
+            break;
+        }
+        mask++;
+    }
+
+    // The remaining bits must run from all zeros to all ones
+    ipv6_address_full_t low = *first;
+    ipv6_address_full_t high = *first;
+    range_fill(&low, mask, false);
+    range_fill(&high, mask, true);
+    if (range_compare(&low, first) != 0 || range_compare(&high, last) != 0) {
+        return false;
+    }
+
+    *out = low;
+    out->mask = mask;
+    out->flags |= IPV6_FLAG_HAS_MASK;
+    return true;
+}
+
+//--------------------------------------------------------------------------------
+// Copy of an address with its components in host order
+static const ipv6_address_full_t* host_order (
+    const ipv6_address_full_t* in,
+    ipv6_address_full_t* copy)
+{
+    if (!in || !(in->flags & IPV6_FLAG_NETWORK_ORDER)) {
+        return in;
+    }
+
+    *copy = *in;
+    for (uint32_t i = 0; i < IPV6_NUM_COMPONENTS; ++i) {
+        const uint8_t* bytes = (const uint8_t*)&in->address.components[i];
+        copy->address.components[i] = (uint16_t)((bytes[0] << 8) | bytes[1]);
+    }
+    copy->flags &= ~(uint32_t)IPV6_FLAG_NETWORK_ORDER;
+    return copy;
 }
 
 #define OUTPUT_TRUNCATED() \
-    IPV6_TRACE("  ! buffer truncated at position %u\n", (uint32_t)(wp - out)); \
+    IPV6_TRACE("  ! buffer truncated at position %u\n", (uint32_t)(wp - output)); \
     output_bytes = 0; \
     *output = '\0';
 
 //--------------------------------------------------------------------------------
-size_t IPV6_API_DEF(ipv6_to_str) (
+static size_t write_address (
     const ipv6_address_full_t* in,
     char *output,
     size_t output_bytes)
 {
+    ipv6_address_full_t host;
+
     if (!in || !output) {
         return 0;
     }
@@ -832,6 +1663,8 @@ size_t IPV6_API_DEF(ipv6_to_str) (
         return 0;
     }
 
+    in = host_order(in, &host);
+
     *output = '\0';
 
     const uint16_t* components = in->address.components;
@@ -987,7 +1820,200 @@ size_t IPV6_API_DEF(ipv6_to_str) (
 }
 
 //--------------------------------------------------------------------------------
-ipv6_compare_result_t IPV6_API_DEF(ipv6_compare) (
+IPV6_API_LINKAGE size_t IPV6_API_DEF(ipv6_to_str) (
+    const ipv6_address_full_t* in,
+    char *output,
+    size_t output_bytes)
+{
+#ifdef PARSE_PROFILE
+    if (in && ipv6_profile_should_sample()) {
+        const uint64_t start = ipv6_clock_ns();
+        const size_t result = write_address(in, output, output_bytes);
+        const uint64_t elapsed = ipv6_clock_ns() - start;
+
+        ipv6_profile_record(IPV6_PROFILE_OP_TO_STR, ipv6_profile_shape(in->flags), elapsed);
+        return result;
+    }
+#endif
+
+    return write_address(in, output, output_bytes);
+}
+
+//--------------------------------------------------------------------------------
+IPV6_API_LINKAGE const char* IPV6_API_DEF(ipv6_diag_event_str) (
+    ipv6_diag_event_t event)
+{
+    switch (event) {
+        case IPV6_DIAG_STRING_SIZE_EXCEEDED:        return "string-size-exceeded";
+        case IPV6_DIAG_INVALID_INPUT:               return "invalid-input";
+        case IPV6_DIAG_INVALID_INPUT_CHAR:          return "invalid-input-char";
+        case IPV6_DIAG_TRAILING_ZEROES:             return "trailing-zeroes";
+        case IPV6_DIAG_V6_BAD_COMPONENT_COUNT:      return "v6-bad-component-count";
+        case IPV6_DIAG_V4_BAD_COMPONENT_COUNT:      return "v4-bad-component-count";
+        case IPV6_DIAG_V6_COMPONENT_OUT_OF_RANGE:   return "v6-component-out-of-range";
+        case IPV6_DIAG_V4_COMPONENT_OUT_OF_RANGE:   return "v4-component-out-of-range";
+        case IPV6_DIAG_INVALID_PORT:                return "invalid-port";
+        case IPV6_DIAG_INVALID_CIDR_MASK:           return "invalid-cidr-mask";
+        case IPV6_DIAG_IPV4_REQUIRED_BITS:          return "ipv4-required-bits";
+        case IPV6_DIAG_IPV4_INCORRECT_POSITION:     return "ipv4-incorrect-position";
+        case IPV6_DIAG_INVALID_BRACKETS:            return "invalid-brackets";
+        case IPV6_DIAG_INVALID_ABBREV:              return "invalid-abbrev";
+        case IPV6_DIAG_INVALID_DECIMAL_TOKEN:       return "invalid-decimal-token";
+        case IPV6_DIAG_INVALID_HEX_TOKEN:           return "invalid-hex-token";
+        default:
+            break;
+    }
+
+    return "<unknown>";
+}
+
+//--------------------------------------------------------------------------------
+// General message for an event, the parser passes more specific text to diag functions
+static const char* diag_event_message (ipv6_diag_event_t event)
+{
+    switch (event) {
+        case IPV6_DIAG_STRING_SIZE_EXCEEDED:        return "Input string size exceeded";
+        case IPV6_DIAG_INVALID_INPUT:               return "Invalid input";
+        case IPV6_DIAG_INVALID_INPUT_CHAR:          return "Invalid input character";
+        case IPV6_DIAG_TRAILING_ZEROES:             return "Trailing zeroes are not allowed";
+        case IPV6_DIAG_V6_BAD_COMPONENT_COUNT:      return "Invalid component count";
+        case IPV6_DIAG_V4_BAD_COMPONENT_COUNT:      return "IPv4 address requires 4 octets";
+        case IPV6_DIAG_V6_COMPONENT_OUT_OF_RANGE:   return "IPv6 address components must be <= 65535";
+        case IPV6_DIAG_V4_COMPONENT_OUT_OF_RANGE:   return "IPv4 address components must be <= 255";
+        case IPV6_DIAG_INVALID_PORT:                return "Port must be between 0 and 65535";
+        case IPV6_DIAG_INVALID_CIDR_MASK:           return "CIDR mask must be between 0 and 128 bits";
+        case IPV6_DIAG_IPV4_REQUIRED_BITS:          return "IPv4 embedding requires 32 bits of address space";
+        case IPV6_DIAG_IPV4_INCORRECT_POSITION:     return "IPv4 embedding only allowed in last 32 address bits";
+        case IPV6_DIAG_INVALID_BRACKETS:            return "Invalid brackets";
+        case IPV6_DIAG_INVALID_ABBREV:              return "Only one abbreviation of zeros is allowed";
+        case IPV6_DIAG_INVALID_DECIMAL_TOKEN:       return "Invalid decimal token";
+        case IPV6_DIAG_INVALID_HEX_TOKEN:           return "Invalid hexadecimal token";
+        default:
+            break;
+    }
+
+    return "Unknown diagnostic";
+}
+
+//
+// Bounded output for ipv6_diag_describe, counts the full length when truncated
+//
+typedef struct {
+    char*                       wp;                 // write pointer
+    const char*                 ep;                 // end pointer, one octet reserved for nul
+    size_t                      length;             // length of the full description
+} describe_writer_t;
+
+//--------------------------------------------------------------------------------
+static void describe_put (describe_writer_t* w, char c)
+{
+    if (w->wp < w->ep) {
+        *w->wp++ = c;
+    }
+    w->length++;
+}
+
+//--------------------------------------------------------------------------------
+static void describe_puts (describe_writer_t* w, const char* s)
+{
+    while (*s) {
+        describe_put(w, *s++);
+    }
+}
+
+//--------------------------------------------------------------------------------
+IPV6_API_LINKAGE size_t IPV6_API_DEF(ipv6_diag_describe) (
+    ipv6_diag_event_t event,
+    const char* input,
+    size_t input_bytes,
+    uint32_t position,
+    char* output,
+    size_t output_bytes)
+{
+    describe_writer_t w;
+    char token[16];
+
+    w.wp = output;
+    w.ep = (output && output_bytes) ? output + output_bytes - 1 : output;
+    w.length = 0;
+
+    describe_puts(&w, diag_event_message(event));
+    describe_puts(&w, " (");
+    describe_puts(&w, ipv6_diag_event_str(event));
+    describe_puts(&w, ") at position ");
+    platform_snprintf(token, sizeof(token), "%u", position);
+    describe_puts(&w, token);
+    describe_puts(&w, "\n    ");
+
+    // Input line, control characters are shown as '?' to keep the caret aligned
+    size_t shown = 0;
+    while (input && shown < input_bytes && input[shown]) {
+        const char c = input[shown++];
+        describe_put(&w, (c < ' ' || c > '~') ? '?' : c);
+    }
+
+    // Caret line, errors detected at the end of input point just past it
+    describe_puts(&w, "\n    ");
+    for (size_t i = 0; i < position && i < shown; ++i) {
+        describe_put(&w, ' ');
+    }
+    describe_puts(&w, "^\n");
+
+    if (output && output_bytes) {
+        *w.wp = '\0';
+    }
+    return w.length;
+}
+
+// The counters are a build option of the library, header-only builds leave them out
+#ifndef IPV6_PARSE_HEADER_ONLY
+
+//--------------------------------------------------------------------------------
+bool ipv6_counters_snapshot (
+    ipv6_counters_t* counters)
+{
+#ifdef PARSE_COUNTERS
+    const uint64_t* words = (const uint64_t*)&parse_counters;
+    uint64_t* out = (uint64_t*)counters;
+    for (size_t i = 0; i < COUNTER_WORDS; ++i) {
+        out[i] = COUNTER_LOAD(words[i]);
+    }
+    return true;
+#else
+    memset(counters, 0, sizeof(*counters));
+    return false;
+#endif
+}
+
+//--------------------------------------------------------------------------------
+void ipv6_counters_reset (void)
+{
+#ifdef PARSE_COUNTERS
+    uint64_t* words = (uint64_t*)&parse_counters;
+    for (size_t i = 0; i < COUNTER_WORDS; ++i) {
+        COUNTER_STORE(words[i], 0);
+    }
+#endif
+}
+
+//--------------------------------------------------------------------------------
+const char* ipv6_counters_state_str (
+    uint32_t state)
+{
+    return state_str((state_t)state);
+}
+
+//--------------------------------------------------------------------------------
+const char* ipv6_counters_eventclass_str (
+    uint32_t eventclass)
+{
+    return eventclass_str((eventclass_t)eventclass);
+}
+
+#endif // IPV6_PARSE_HEADER_ONLY
+
+//--------------------------------------------------------------------------------
+IPV6_API_LINKAGE ipv6_compare_result_t IPV6_API_DEF(ipv6_compare) (
     const ipv6_address_full_t* a,
     const ipv6_address_full_t* b,
     uint32_t ignore_flags)
@@ -995,6 +2021,12 @@ ipv6_compare_result_t IPV6_API_DEF(ipv6_compare) (
     const uint16_t* a_components;
     const uint16_t* b_components;
     uint32_t num_components;
+    ipv6_address_full_t a_host;
+    ipv6_address_full_t b_host;
+
+    // Components compare in host order, whichever order they were parsed in
+    a = host_order(a, &a_host);
+    b = host_order(b, &b_host);
 
     // Mask out flags for comparison
     uint32_t compare_flags = (IPV6_FLAG_HAS_MASK | IPV6_FLAG_HAS_PORT) & ~ignore_flags;
@@ -1058,3 +2090,33 @@ ipv6_compare_result_t IPV6_API_DEF(ipv6_compare) (
 
     return IPV6_COMPARE_OK;
 }
+
+//--------------------------------------------------------------------------------
+IPV6_API_LINKAGE void IPV6_API_DEF(ipv6_normalize) (
+    const ipv6_address_full_t* in,
+    ipv6_address_full_t* out)
+{
+    static const uint16_t mapped_prefix[IPV4_EMBED_INDEX] = { 0, 0, 0, 0, 0, 0xffff };
+    ipv6_address_full_t host;
+
+    in = host_order(in, &host);
+    *out = *in;
+
+    // A plain IPv4 address moves to the mapped space, its mask with it
+    if (out->flags & IPV6_FLAG_IPV4_COMPAT) {
+        const uint16_t high = out->address.components[0];
+        const uint16_t low = out->address.components[1];
+        memcpy(&out->address.components[0], mapped_prefix, sizeof(mapped_prefix));
+        out->address.components[IPV4_EMBED_INDEX] = high;
+        out->address.components[IPV4_EMBED_INDEX + 1] = low;
+        if (out->flags & IPV6_FLAG_HAS_MASK) {
+            out->mask += 96;
+        }
+    }
+
+    // The embedding flag follows the value, not how the address was written
+    out->flags &= ~(uint32_t)(IPV6_FLAG_IPV4_COMPAT | IPV6_FLAG_IPV4_EMBED);
+    if (!memcmp(&out->address.components[0], mapped_prefix, sizeof(mapped_prefix))) {
+        out->flags |= IPV6_FLAG_IPV4_EMBED;
+    }
+}
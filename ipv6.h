@@ -17,6 +17,8 @@
 //   - Port notation `[::1]:1119`
 //   - Combinations of the above `[ffff::1.2.3.4/128]:1119`
 // - IPv4 addresses and ports `1.2.3.4`, `1.2.3.4:5555`
+// - IPv4 dotted netmasks `10.0.0.0/255.255.255.0`
+// - Firewall style ranges and wildcards `10.0.0.1-10.0.0.9`, `10.1.*.*` with `ipv6_range_from_str`
 // - Single function to parse both IPv4 and IPv6 addresses and ports
 // - Self contained and multi-platform, eliminates problems with using built-in address parsing routines
 // - Diagnostic information from the parsing API
@@ -41,6 +43,12 @@
 //
 // Full tracing can be enabled by running `cmake -DPARSE_TRACE=1`
 //
+// When `sys/sdt.h` is available the parser carries USDT probes (provider `ipv6_parse`,
+// probes `change_state`, `begin_token` and `error`) that cost a nop until a tracer attaches,
+// e.g. to log rejected inputs on a live host:
+// `bpftrace -e 'usdt:bin/libipv6-parse.so:ipv6_parse:error { printf("%s\n", str(arg0, arg1)); }'`
+// Disable them with `cmake -DPARSE_PROBES=0`
+//
 
 #include <stddef.h>
 #include <stdint.h>
@@ -52,7 +60,9 @@ extern "C" {
 
 
 /// Maximum size of a IPV
+#ifndef IPV6_PARSE_HEADER_ONLY
 extern const uint32_t IPV6_STRING_SIZE;
+#endif
 
 // ### ipv6_flag_t
 //
@@ -65,6 +75,9 @@ typedef enum {
     IPV6_FLAG_HAS_MASK      = 0x00000002,   // the address specifies a CIDR mask
     IPV6_FLAG_IPV4_EMBED    = 0x00000004,   // the address has an embedded IPv4 address in the last 32bits
     IPV6_FLAG_IPV4_COMPAT   = 0x00000008,   // the address is IPv4 compatible (1.2.3.4:5555)
+    IPV6_FLAG_NETWORK_ORDER = 0x00000010,   // components hold network order bytes, see ipv6_from_str_network
+    IPV6_FLAG_ZONE_ID       = 0x00000020,   // the zone is a numeric scope id (fe80::1%3), its value is in zone
+    IPV6_FLAG_ZONE_INTERNED = 0x00000040,   // zone is an id of an ipv6_zone_table_t, iface is its name in the table
 } ipv6_flag_t;
 // ~~~~
 
@@ -93,11 +106,15 @@ typedef struct {
 //
 // Features are indicated using flags, see *ipv6_flag_t*.
 //
+// The zone (fe80::1%eth0) is in iface, pointing into the parsed string. A
+// numeric zone up to 65535 is a scope id and also kept in zone, a named one
+// can be interned with ipv6_zone.h so the address does not refer to the input.
+//
 // ~~~~
 typedef struct {
     ipv6_address_t          address;        // address components
     uint16_t                port;           // port binding
-    uint16_t                pad0;           // first padding
+    uint16_t                zone;           // scope id or interned zone, see IPV6_FLAG_ZONE_ID and IPV6_FLAG_ZONE_INTERNED
     uint32_t                mask;           // number of mask bits N specified for example in ::1/N
     const char*             iface;          // pointer to place in address string where interface is defined
     uint32_t                iface_len;      // number of bytes in the name of the interface
@@ -143,6 +160,8 @@ typedef enum {
     IPV6_DIAG_INVALID_DECIMAL_TOKEN         = 14,
     IPV6_DIAG_INVALID_HEX_TOKEN             = 15,
 } ipv6_diag_event_t;
+
+#define IPV6_DIAG_EVENT_COUNT 16
 // ~~~~
 
 
@@ -160,10 +179,31 @@ typedef struct {
 // ~~~~
 
 
+// ### ipv6_diag_result_t
+//
+// Compact record of a parse failure, see ipv6_from_str_compact
+//
+// ~~~~
+typedef struct {
+    ipv6_diag_event_t   event;      // diagnostic event of the failure
+    uint32_t            position;   // position in input that caused the diagnostic
+} ipv6_diag_result_t;
+// ~~~~
+
+
 /// These macros define the signature type of the API functions
 #define IPV6_API_DECL(name) name
 #define IPV6_API_DEF(name) name
 
+/// Linkage of the API functions, static inline with IPV6_PARSE_HEADER_ONLY
+#if defined(IPV6_PARSE_HEADER_ONLY) && defined(_MSC_VER) && !defined(__cplusplus)
+#define IPV6_API_LINKAGE static __inline
+#elif defined(IPV6_PARSE_HEADER_ONLY)
+#define IPV6_API_LINKAGE static inline
+#else
+#define IPV6_API_LINKAGE
+#endif
+
 // ### ipv6_diag_func_t
 //
 // A diagnostic function that receives information from parsing the address
@@ -179,10 +219,12 @@ typedef void (*ipv6_diag_func_t) (
 //
 // Read an IPv6 address from a string, handles parsing a variety of format
 // information from the spec. Will also handle IPv4 address passed in without
-// any embedding information.
+// any embedding information. An IPv4 address may have a dotted netmask of
+// contiguous leading ones instead of a CIDR mask, 10.0.0.0/255.255.255.0 is
+// read as 10.0.0.0/24.
 //
 // ~~~~
-bool IPV6_API_DECL(ipv6_from_str) (
+IPV6_API_LINKAGE bool IPV6_API_DECL(ipv6_from_str) (
     const char* input,
     size_t input_bytes,
     ipv6_address_full_t* out);
@@ -195,7 +237,7 @@ bool IPV6_API_DECL(ipv6_from_str) (
 // including errors.
 //
 // ~~~~
-bool IPV6_API_DECL(ipv6_from_str_diag) (
+IPV6_API_LINKAGE bool IPV6_API_DECL(ipv6_from_str_diag) (
     const char* input,
     size_t input_bytes,
     ipv6_address_full_t* out,
@@ -203,6 +245,136 @@ bool IPV6_API_DECL(ipv6_from_str_diag) (
     void* user_data);
 // ~~~~
 
+// ### ipv6_from_str_compact
+//
+// Parser that records only the event and position of a failure in result,
+// without building messages or calling a diagnostic function. Use
+// ipv6_diag_describe to render the failure when it is needed.
+//
+// The result argument is optional and only written when parsing fails.
+//
+// ~~~~
+IPV6_API_LINKAGE bool IPV6_API_DECL(ipv6_from_str_compact) (
+    const char* input,
+    size_t input_bytes,
+    ipv6_address_full_t* out,
+    ipv6_diag_result_t* result);
+// ~~~~
+
+// ### ipv6_from_str_network
+//
+// ipv6_from_str_compact storing the address as 16 network order bytes, the
+// layout of an in6_addr, instead of host order components. The address can be
+// copied into sockets, packet headers or memcmp ordered keys as is.
+// IPV6_FLAG_NETWORK_ORDER is set in the flags, IPv4 compatible addresses keep
+// their 4 bytes at the start of the components.
+//
+// ipv6_to_str and ipv6_compare accept either order.
+//
+// ~~~~
+IPV6_API_LINKAGE bool IPV6_API_DECL(ipv6_from_str_network) (
+    const char* input,
+    size_t input_bytes,
+    ipv6_address_full_t* out,
+    ipv6_diag_result_t* result);
+// ~~~~
+
+// ### ipv6_from_uri_host
+//
+// ipv6_from_str_compact for the host of a URI, where the '%' before the zone
+// of a bracketed address is itself percent encoded as "%25" (RFC 6874):
+// [fe80::1%25eth0]:80 has the zone eth0 and [fe80::1%253] the scope id 3.
+// A bracketed zone without the escape is an error. The other parse APIs take
+// the zone as written, so [fe80::1%253] has the scope id 253 there.
+//
+// ~~~~
+IPV6_API_LINKAGE bool IPV6_API_DECL(ipv6_from_uri_host) (
+    const char* input,
+    size_t input_bytes,
+    ipv6_address_full_t* out,
+    ipv6_diag_result_t* result);
+// ~~~~
+
+// ### ipv6_from_arpa
+//
+// Parse a reverse DNS name, the query name of a PTR lookup, into the address
+// it maps: one hex digit label per nibble before ip6.arpa, or one decimal
+// label per octet before in-addr.arpa (an IPv4 compatible address), least
+// significant first. The suffix is matched case-insensitively and a trailing
+// root '.' is allowed.
+//
+// Partial names are the zones of prefixes and set IPV6_FLAG_HAS_MASK:
+//
+//     1.2.3.4.in-addr.arpa                       -> 4.3.2.1
+//     2.0.192.in-addr.arpa                       -> 192.0.2.0/24
+//     8.b.d.0.1.0.0.2.ip6.arpa                   -> 2001:db8::/32
+//     1.0.0.0. ... .8.b.d.0.1.0.0.2.ip6.arpa.    -> 2001:db8::1
+//
+// The result argument is optional and only written when parsing fails.
+//
+// ~~~~
+IPV6_API_LINKAGE bool IPV6_API_DECL(ipv6_from_arpa) (
+    const char* input,
+    size_t input_bytes,
+    ipv6_address_full_t* out,
+    ipv6_diag_result_t* result);
+// ~~~~
+
+// ### ipv6_range_t
+//
+// Inclusive range of addresses of one family, see ipv6_range_from_str
+//
+// ~~~~
+typedef struct {
+    ipv6_address_full_t     first;          // lowest address of the range
+    ipv6_address_full_t     last;           // highest address of the range
+} ipv6_range_t;
+// ~~~~
+
+// ### ipv6_range_from_str
+//
+// Read the address notations of firewall rules as a range, in the same pass
+// over the input as the address parser:
+//
+//     10.0.0.1                                   -> 10.0.0.1 to 10.0.0.1
+//     10.0.0.0/24, 10.0.0.0/255.255.255.0        -> 10.0.0.0 to 10.0.0.255
+//     10.1.*.*                                   -> 10.1.0.0 to 10.1.255.255
+//     10.0.0.1-10.0.0.9                          -> 10.0.0.1 to 10.0.0.9
+//     2001:db8::/127-2001:db8::9                 -> 2001:db8:: to 2001:db8::9
+//
+// Wildcards replace trailing IPv4 octets. The ends of a '-' range are of the
+// same family and may be prefixes themselves; the range starts at the first
+// address of the first end and stops at the last address of the second.
+// Masks are applied and cleared, ports and zones of the ends are kept. A '-'
+// after '%' belongs to the interface name, so only the second end of a range
+// can have a zone.
+//
+// Ends of different families or in descending order fail with
+// IPV6_DIAG_INVALID_INPUT and IPv4 masks above 32 bits with
+// IPV6_DIAG_INVALID_CIDR_MASK. The result argument is optional and only
+// written when parsing fails, its position is in the whole input.
+//
+// ~~~~
+IPV6_API_LINKAGE bool IPV6_API_DECL(ipv6_range_from_str) (
+    const char* input,
+    size_t input_bytes,
+    ipv6_range_t* out,
+    ipv6_diag_result_t* result);
+// ~~~~
+
+// ### ipv6_range_to_prefix
+//
+// If range covers exactly one prefix, write its first address with the prefix
+// length in mask and IPV6_FLAG_HAS_MASK to out and return true, e.g.
+// 10.0.0.0-10.0.0.255 is 10.0.0.0/24. Otherwise return false and leave out
+// unchanged.
+//
+// ~~~~
+IPV6_API_LINKAGE bool IPV6_API_DECL(ipv6_range_to_prefix) (
+    const ipv6_range_t* range,
+    ipv6_address_full_t* out);
+// ~~~~
+
 // ### ipv6_to_str
 //
 // Convert an IPv6 structure to an ASCII string.
@@ -214,13 +386,47 @@ bool IPV6_API_DECL(ipv6_from_str_diag) (
 // Returns the size in bytes of the string minus the nul byte.
 //
 // ~~~~
-size_t IPV6_API_DECL(ipv6_to_str) (
+IPV6_API_LINKAGE size_t IPV6_API_DECL(ipv6_to_str) (
     const ipv6_address_full_t* in,
     char* output,
     size_t output_bytes);
 // ~~~~
 
 
+// ### ipv6_diag_event_str
+//
+// Short stable name of a diagnostic event, e.g. "invalid-port", for use in
+// logs and reports. Returns "<unknown>" for values outside ipv6_diag_event_t.
+//
+// ~~~~
+IPV6_API_LINKAGE const char* IPV6_API_DECL(ipv6_diag_event_str) (
+    ipv6_diag_event_t event);
+// ~~~~
+
+
+// ### ipv6_diag_describe
+//
+// Render a failure recorded by ipv6_from_str_compact as a message followed by
+// the input and a caret under the position, e.g.:
+//
+//     Invalid input character (invalid-input-char) at position 3
+//         ::1g
+//            ^
+//
+// Returns the length of the full description excluding the nul byte, as
+// snprintf does. When that is not less than output_bytes the output was truncated.
+//
+// ~~~~
+IPV6_API_LINKAGE size_t IPV6_API_DECL(ipv6_diag_describe) (
+    ipv6_diag_event_t event,
+    const char* input,
+    size_t input_bytes,
+    uint32_t position,
+    char* output,
+    size_t output_bytes);
+// ~~~~
+
+
 // ### ipv6_compare
 //
 // Compare two addresses, 0 (IPV6_COMPARE_OK) if equal, else ipv6_compare_result_t.
@@ -233,12 +439,40 @@ size_t IPV6_API_DECL(ipv6_to_str) (
 // flags are passed in ignore_flags.
 //
 // ~~~~
-ipv6_compare_result_t IPV6_API_DECL(ipv6_compare) (
+IPV6_API_LINKAGE ipv6_compare_result_t IPV6_API_DECL(ipv6_compare) (
     const ipv6_address_full_t* a,
     const ipv6_address_full_t* b,
     uint32_t ignore_flags);
 // ~~~~
 
+// ### ipv6_normalize
+//
+// Canonical form of an address for use as a key: IPv4 addresses in every
+// form become IPv4-mapped addresses (::ffff:a.b.c.d), so equal addresses have
+// equal components and flags and need no special casing in hash tables, tries
+// or ipv6_compare.
+//
+// - IPv4 compatible addresses (1.2.3.4) move to components[6..7] under the
+//   ::ffff:0:0/96 prefix, a mask grows by 96 bits (1.2.3.0/24 -> /120)
+// - IPV6_FLAG_IPV4_EMBED is set for exactly the ::ffff:0:0/96 addresses and
+//   IPV6_FLAG_IPV4_COMPAT is cleared
+// - Components are converted to host order
+//
+// Port, mask and zone are kept. Other prefixes with an embedded IPv4 address,
+// such as ::1.2.3.4 or 64:ff9b::1.2.3.4, are different addresses and only lose
+// the formatting flag. in and out may be the same address.
+//
+// ~~~~
+IPV6_API_LINKAGE void IPV6_API_DECL(ipv6_normalize) (
+    const ipv6_address_full_t* in,
+    ipv6_address_full_t* out);
+// ~~~~
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
+
+// The implementation is compiled into every including translation unit
+#ifdef IPV6_PARSE_HEADER_ONLY
+#include "ipv6.c"
+#endif
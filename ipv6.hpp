@@ -0,0 +1,986 @@
+#pragma once
+// # C++ interface
+//
+//     Compile-time address literals layered over ipv6.h, requires C++17.
+//
+// ipv6::parse reproduces the grammar of ipv6_from_str_diag as a constexpr
+// function. It yields the same address, flags, diagnostic event and error
+// position as the C parser, so tables of well-known addresses and prefixes
+// can be parsed by the compiler instead of at process startup:
+//
+// ~~~~
+//     using namespace ipv6::literals;
+//
+//     constexpr ipv6_address_full_t documentation = "2001:db8::/32"_ipv6;
+//     static_assert(documentation.mask == 32, "");
+// ~~~~
+//
+// Call sites that accept a single form of address can instantiate the parser
+// for it. Branches for the disabled parts of the grammar are compiled out and
+// input using them fails, otherwise the result matches the full parser:
+//
+// ~~~~
+//     ipv6::parse<ipv6::feature::v6_only>(line);
+//     ipv6::parse<ipv6::feature::v4 | ipv6::feature::port>(peer);
+// ~~~~
+//
+// A malformed literal in a constant expression is a compile error pointing at
+// ipv6::detail::malformed_address_literal. With C++20 the literal operator is
+// consteval and every use is checked at compile time; with C++17 declare the
+// result constexpr to force compile-time evaluation, otherwise a malformed
+// literal aborts at runtime.
+//
+
+#include "ipv6.h"
+#include "ipv6_zone.h"
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+
+#if defined(__cpp_impl_three_way_comparison) && __has_include(<compare>)
+#include <compare>
+#define IPV6_HAVE_THREE_WAY_COMPARISON 1
+#endif
+
+namespace ipv6 {
+
+// ### ipv6::parse_result
+//
+// Outcome of ipv6::parse, the address is zeroed when parsing fails
+//
+// ~~~~
+struct parse_result {
+    ipv6_address_full_t     address;    // parsed address, iface is always NULL
+    ipv6_diag_event_t       event;      // diagnostic event of the failure
+    uint32_t                position;   // position in input of the failure
+    bool                    ok;         // true when the address parsed
+
+    constexpr explicit operator bool () const noexcept { return ok; }
+};
+// ~~~~
+
+// ### ipv6::feature
+//
+// Parts of the grammar accepted by ipv6::parse, combine with |
+//
+// ~~~~
+namespace feature {
+constexpr uint32_t v6 = 0x01;       // hexadecimal components and :: runs
+constexpr uint32_t v4 = 0x02;       // IPv4 dotted quad (IPV6_FLAG_IPV4_COMPAT)
+constexpr uint32_t embed = 0x04;    // IPv4 in the last 32 bits of an IPv6 address
+constexpr uint32_t port = 0x08;     // ports, and the brackets around IPv6 addresses
+constexpr uint32_t mask = 0x10;     // /mask
+constexpr uint32_t zone = 0x20;     // %interface
+
+constexpr uint32_t v6_only = v6;
+constexpr uint32_t all = v6 | v4 | embed | port | mask | zone;
+}
+// ~~~~
+
+namespace detail {
+
+// Same bound as IPV6_STRING_SIZE, which is not a constant expression
+constexpr std::size_t string_size =
+    sizeof "[1234:1234:1234:1234:1234:1234:1234:1234/128%longinterface]:65535";
+
+// Token values stop growing past this bound, see TOKEN_SATURATED in ipv6.c
+constexpr int32_t token_saturated = 0x100000;
+
+//
+// Parser states and event classes, mirrors state_t and eventclass_t in ipv6.c
+//
+enum class state : uint8_t {
+    none,
+    addr_component,
+    v6_separator,
+    zerorun,
+    cidr,
+    iface,
+    port,
+    post_addr,
+    error,
+};
+
+enum class eventclass : uint8_t {
+    digit,
+    hex_digit,
+    v4_component_sep,
+    v6_component_sep,
+    cidr_mask,
+    iface,
+    open_bracket,
+    close_bracket,
+    whitespace,
+    zone_char,
+};
+
+//
+// constexpr port of ipv6_reader_state_t and the functions operating on it.
+// Keep in sync with ipv6.c, test_cpp.cpp checks both parsers agree.
+//
+// Features restricts the grammar, a disabled feature is an error where its
+// syntax would begin.
+//
+template <uint32_t Features>
+struct reader {
+    static constexpr bool has (uint32_t feature) noexcept { return (Features & feature) != 0; }
+
+    std::string_view        input;
+    ipv6_address_full_t     out {};
+    state                   current = state::none;
+    int32_t                 position = 0;
+    int32_t                 components = 0;
+    int32_t                 token_position = 0;
+    int32_t                 token_len = 0;
+    int32_t                 brackets = 0;
+    int32_t                 zerorun = 0;
+    int32_t                 v4_embedding = 0;
+    int32_t                 v4_octets = 0;
+    int32_t                 iface_position = 0;
+    int32_t                 iface_len = 0;
+    bool                    has_zerorun = false;
+    bool                    has_error = false;
+    bool                    has_embedding = false;
+    bool                    is_compat = false;
+    bool                    dotted_mask = false;
+    ipv6_diag_event_t       event = IPV6_DIAG_INVALID_INPUT;
+    uint32_t                error_position = 0;
+
+    constexpr explicit reader (std::string_view s) noexcept : input(s) {}
+
+    constexpr void error (ipv6_diag_event_t e) noexcept {
+        event = e;
+        error_position = (uint32_t)position;
+        has_error = true;
+        current = state::error;
+    }
+
+    constexpr void begin_token (int32_t offset) noexcept {
+        token_position = position + offset;
+        token_len = 0;
+    }
+
+    constexpr char at (int32_t i) const noexcept {
+        return (std::size_t)i < input.size() ? input[(std::size_t)i] : '\0';
+    }
+
+    constexpr int32_t read_decimal_token () noexcept {
+        int32_t accumulate = 0;
+        for (int32_t i = token_position; i < token_position + token_len && at(i); ++i) {
+            const char c = at(i);
+            if (c < '0' || c > '9') {
+                error(IPV6_DIAG_INVALID_INPUT);
+                return 0;
+            }
+            if (accumulate < token_saturated) {
+                accumulate = accumulate * 10 + (c - '0');
+            }
+        }
+        return accumulate;
+    }
+
+    constexpr int32_t read_hexidecimal_token () noexcept {
+        int32_t accumulate = 0;
+        for (int32_t i = token_position; i < token_position + token_len && at(i); ++i) {
+            const char c = at(i);
+            int32_t digit = 0;
+            if (c >= '0' && c <= '9') {
+                digit = c - '0';
+            } else if (c >= 'a' && c <= 'f') {
+                digit = 10 + (c - 'a');
+            } else if (c >= 'A' && c <= 'F') {
+                digit = 10 + (c - 'A');
+            } else {
+                error(IPV6_DIAG_INVALID_INPUT);
+                return 0;
+            }
+            if (accumulate < token_saturated) {
+                accumulate = (accumulate << 4) | digit;
+            }
+        }
+        return accumulate;
+    }
+
+    constexpr void ipv6_parse_component () noexcept {
+        const int32_t component = read_hexidecimal_token();
+        if (components >= 8) {
+            return error(IPV6_DIAG_V6_BAD_COMPONENT_COUNT);
+        }
+        if (component > 0xffff) {
+            return error(IPV6_DIAG_V6_COMPONENT_OUT_OF_RANGE);
+        }
+        out.address.components[components++] = (uint16_t)component;
+        token_position = 0;
+        token_len = 0;
+    }
+
+    constexpr void ipv4_parse_component () noexcept {
+        const int32_t octet = read_decimal_token();
+        if (v4_octets >= 4) {
+            return error(IPV6_DIAG_V4_BAD_COMPONENT_COUNT);
+        }
+        if (octet > 0xff) {
+            return error(IPV6_DIAG_V4_COMPONENT_OUT_OF_RANGE);
+        }
+        if (v4_embedding > 6) {
+            return error(IPV6_DIAG_IPV4_REQUIRED_BITS);
+        }
+        uint16_t& component = out.address.components[v4_embedding + (v4_octets / 2)];
+        component = (uint16_t)(component | (octet << ((1 - (v4_octets & 1)) * 8)));
+        v4_octets++;
+        token_position = 0;
+        token_len = 0;
+    }
+
+    constexpr void ipvx_parse_component () noexcept {
+        if (has_embedding) {
+            ipv4_parse_component();
+        } else {
+            ipv6_parse_component();
+        }
+    }
+
+    constexpr void ipv4_parse_netmask () noexcept {
+        const int32_t end = token_position + token_len;
+        int32_t at_position = token_position;
+        uint32_t netmask = 0;
+        int32_t octets = 0;
+        if (!is_compat) {
+            return error(IPV6_DIAG_INVALID_CIDR_MASK);
+        }
+        while (octets < 4 && at_position <= end) {
+            token_position = at_position;
+            token_len = 0;
+            while (at_position < end && at(at_position) != '.') {
+                at_position++;
+                token_len++;
+            }
+            const int32_t octet = read_decimal_token();
+            if (token_len == 0 || octet > 0xff) {
+                return error(IPV6_DIAG_INVALID_CIDR_MASK);
+            }
+            netmask = (netmask << 8) | (uint32_t)octet;
+            octets++;
+            at_position++;
+        }
+        const uint32_t hosts = ~netmask;
+        if (octets != 4 || at_position != end + 1 || (hosts & (hosts + 1)) != 0) {
+            return error(IPV6_DIAG_INVALID_CIDR_MASK);
+        }
+        uint32_t mask = 0;
+        while (mask < 32 && (netmask & (0x80000000u >> mask))) {
+            mask++;
+        }
+        out.mask = mask;
+        out.flags |= IPV6_FLAG_HAS_MASK;
+    }
+
+    constexpr void ipvx_parse_cidr () noexcept {
+        if (dotted_mask) {
+            return ipv4_parse_netmask();
+        }
+        const int32_t mask = read_decimal_token();
+        if (mask < 0 || mask > 128) {
+            return error(IPV6_DIAG_INVALID_CIDR_MASK);
+        }
+        out.mask = (uint32_t)mask;
+        out.flags |= IPV6_FLAG_HAS_MASK;
+    }
+
+    constexpr void ipvx_parse_port () noexcept {
+        const int32_t port = read_decimal_token();
+        if (port < 0 || port > 0xffff) {
+            return error(IPV6_DIAG_INVALID_PORT);
+        }
+        out.port = (uint16_t)port;
+        out.flags |= IPV6_FLAG_HAS_PORT;
+    }
+
+    constexpr void ipvx_begin_iface () noexcept {
+        current = state::iface;
+        iface_position = position + 1;
+        iface_len = 0;
+    }
+
+    constexpr void ipvx_parse_iface () noexcept {
+        if (iface_len == 0) {
+            return error(IPV6_DIAG_INVALID_INPUT);
+        }
+        for (int32_t i = iface_position; i < iface_position + iface_len; ++i) {
+            if (at(i) < '0' || at(i) > '9') {
+                return;
+            }
+        }
+        token_position = iface_position;
+        token_len = iface_len;
+        const int32_t scope_id = read_decimal_token();
+        if (scope_id <= 0xffff) {
+            out.zone = (uint16_t)scope_id;
+            out.flags |= IPV6_FLAG_ZONE_ID;
+        }
+    }
+
+    // Mirrors ipv6_state_transition
+    constexpr void transition (eventclass input) noexcept {
+        switch (current) {
+            case state::error:
+            case state::zerorun:
+                break;
+
+            case state::none:
+                switch (input) {
+                    case eventclass::digit:
+                    case eventclass::hex_digit:
+                        current = state::addr_component;
+                        begin_token(0);
+                        token_len++;
+                        break;
+                    case eventclass::open_bracket:
+                        if (brackets != 1) {
+                            return error(IPV6_DIAG_INVALID_BRACKETS);
+                        }
+                        break;
+                    case eventclass::close_bracket:
+                        current = state::post_addr;
+                        break;
+                    case eventclass::v6_component_sep:
+                        if constexpr (!has(feature::v6)) {
+                            return error(IPV6_DIAG_INVALID_INPUT);
+                        }
+                        current = state::v6_separator;
+                        break;
+                    case eventclass::cidr_mask:
+                        current = state::cidr;
+                        begin_token(1);
+                        break;
+                    case eventclass::whitespace:
+                        break;
+                    default:
+                        return error(IPV6_DIAG_INVALID_INPUT);
+                }
+                break;
+
+            case state::addr_component:
+                switch (input) {
+                    case eventclass::digit:
+                    case eventclass::hex_digit:
+                        token_len++;
+                        break;
+                    case eventclass::close_bracket:
+                        ipvx_parse_component();
+                        if (!has_error) {
+                            current = state::post_addr;
+                        }
+                        break;
+                    case eventclass::whitespace:
+                        ipvx_parse_component();
+                        if (!has_error) {
+                            current = state::none;
+                        }
+                        break;
+                    case eventclass::v6_component_sep:
+                        if (is_compat) {
+                            if constexpr (!has(feature::port)) {
+                                return error(IPV6_DIAG_INVALID_INPUT);
+                            }
+                            ipvx_parse_component();
+                            if (!has_error) {
+                                current = state::port;
+                                begin_token(1);
+                            }
+                            break;
+                        }
+                        if constexpr (!has(feature::v6)) {
+                            return error(IPV6_DIAG_INVALID_INPUT);
+                        }
+                        if (has_embedding) {
+                            return error(IPV6_DIAG_IPV4_INCORRECT_POSITION);
+                        }
+                        ipvx_parse_component();
+                        if (!has_error) {
+                            current = state::v6_separator;
+                        }
+                        break;
+                    case eventclass::v4_component_sep:
+                        if (!has_embedding) {
+                            v4_embedding = components;
+                            has_embedding = true;
+                            if (components >= 7) {
+                                return error(IPV6_DIAG_IPV4_REQUIRED_BITS);
+                            }
+                            if (!has_zerorun && components == 0) {
+                                if constexpr (!has(feature::v4)) {
+                                    return error(IPV6_DIAG_INVALID_INPUT);
+                                }
+                                is_compat = true;
+                            } else if constexpr (!has(feature::embed)) {
+                                return error(IPV6_DIAG_INVALID_INPUT);
+                            }
+                            components += 2;
+                        }
+                        ipvx_parse_component();
+                        if (!has_error) {
+                            current = state::none;
+                        }
+                        break;
+                    case eventclass::iface:
+                        ipvx_parse_component();
+                        if (!has_error) {
+                            ipvx_begin_iface();
+                        }
+                        break;
+                    case eventclass::cidr_mask:
+                        ipvx_parse_component();
+                        if (!has_error) {
+                            current = state::cidr;
+                            begin_token(1);
+                        }
+                        break;
+                    default:
+                        return error(IPV6_DIAG_INVALID_INPUT);
+                }
+                break;
+
+            case state::v6_separator:
+                switch (input) {
+                    case eventclass::v6_component_sep:
+                        if (has_zerorun) {
+                            return error(IPV6_DIAG_INVALID_ABBREV);
+                        }
+                        zerorun = components;
+                        has_zerorun = true;
+                        break;
+                    case eventclass::whitespace:
+                        current = state::none;
+                        break;
+                    case eventclass::close_bracket:
+                        current = state::post_addr;
+                        break;
+                    case eventclass::open_bracket:
+                        return error(IPV6_DIAG_INVALID_BRACKETS);
+                    case eventclass::digit:
+                    case eventclass::hex_digit:
+                        current = state::addr_component;
+                        begin_token(0);
+                        token_len++;
+                        break;
+                    case eventclass::iface:
+                        ipvx_begin_iface();
+                        break;
+                    case eventclass::cidr_mask:
+                        current = state::cidr;
+                        begin_token(1);
+                        break;
+                    default:
+                        return error(IPV6_DIAG_INVALID_INPUT);
+                }
+                break;
+
+            case state::iface:
+                switch (input) {
+                    case eventclass::digit:
+                    case eventclass::hex_digit:
+                    case eventclass::zone_char:
+                    case eventclass::v4_component_sep:
+                        iface_len++;
+                        break;
+                    case eventclass::whitespace:
+                        ipvx_parse_iface();
+                        if (!has_error) {
+                            current = state::none;
+                        }
+                        break;
+                    case eventclass::close_bracket:
+                        ipvx_parse_iface();
+                        if (!has_error) {
+                            current = state::post_addr;
+                        }
+                        break;
+                    case eventclass::cidr_mask:
+                        ipvx_parse_iface();
+                        if (!has_error) {
+                            current = state::cidr;
+                            begin_token(1);
+                        }
+                        break;
+                    default:
+                        return error(IPV6_DIAG_INVALID_INPUT);
+                }
+                break;
+
+            case state::cidr:
+                switch (input) {
+                    case eventclass::digit:
+                        token_len++;
+                        break;
+                    case eventclass::v4_component_sep:
+                        dotted_mask = true;
+                        token_len++;
+                        break;
+                    case eventclass::close_bracket:
+                        ipvx_parse_cidr();
+                        if (!has_error) {
+                            current = state::post_addr;
+                        }
+                        break;
+                    case eventclass::whitespace:
+                        ipvx_parse_cidr();
+                        if (!has_error) {
+                            current = state::none;
+                        }
+                        break;
+                    case eventclass::iface:
+                        ipvx_parse_cidr();
+                        if (!has_error) {
+                            ipvx_begin_iface();
+                        }
+                        break;
+                    default:
+                        return error(IPV6_DIAG_INVALID_INPUT);
+                }
+                break;
+
+            case state::post_addr:
+                switch (input) {
+                    case eventclass::whitespace:
+                        break;
+                    case eventclass::v6_component_sep:
+                        if constexpr (!has(feature::port)) {
+                            return error(IPV6_DIAG_INVALID_INPUT);
+                        }
+                        current = state::port;
+                        begin_token(1);
+                        break;
+                    default:
+                        return error(IPV6_DIAG_INVALID_INPUT);
+                }
+                break;
+
+            case state::port:
+                switch (input) {
+                    case eventclass::digit:
+                        token_len++;
+                        break;
+                    case eventclass::whitespace:
+                        ipvx_parse_port();
+                        if (!has_error) {
+                            current = state::none;
+                        }
+                        break;
+                    default:
+                        return error(IPV6_DIAG_INVALID_INPUT);
+                }
+                break;
+        }
+    }
+
+    // Mirrors read_address
+    constexpr bool run () noexcept {
+        if (input.data() == nullptr || input.empty() || input[0] == '\0') {
+            error(IPV6_DIAG_INVALID_INPUT);
+            return false;
+        }
+        if (input.size() > string_size) {
+            error(IPV6_DIAG_STRING_SIZE_EXCEEDED);
+            return false;
+        }
+
+        for (; (std::size_t)position < input.size() && at(position); ++position) {
+            switch (at(position)) {
+                case '0': case '1': case '2': case '3': case '4':
+                case '5': case '6': case '7': case '8': case '9':
+                    transition(eventclass::digit);
+                    break;
+                case 'A': case 'B': case 'C': case 'D': case 'E': case 'F':
+                case 'a': case 'b': case 'c': case 'd': case 'e': case 'f':
+                    if (has(feature::v6) || current == state::iface) {
+                        transition(eventclass::hex_digit);
+                    } else {
+                        error(IPV6_DIAG_INVALID_INPUT_CHAR);
+                    }
+                    break;
+                case ':':
+                    if constexpr (has(feature::v6) || has(feature::port)) {
+                        transition(eventclass::v6_component_sep);
+                    } else {
+                        error(IPV6_DIAG_INVALID_INPUT_CHAR);
+                    }
+                    break;
+                case '.':
+                    if (has(feature::v4) || has(feature::embed) || current == state::iface) {
+                        transition(eventclass::v4_component_sep);
+                    } else {
+                        error(IPV6_DIAG_INVALID_INPUT_CHAR);
+                    }
+                    break;
+                case '/':
+                    if constexpr (has(feature::mask)) {
+                        transition(eventclass::cidr_mask);
+                    } else {
+                        error(IPV6_DIAG_INVALID_INPUT_CHAR);
+                    }
+                    break;
+                case '%':
+                    if constexpr (has(feature::zone)) {
+                        transition(eventclass::iface);
+                    } else {
+                        error(IPV6_DIAG_INVALID_INPUT_CHAR);
+                    }
+                    break;
+                case '[':
+                    if constexpr (has(feature::port)) {
+                        brackets++;
+                        transition(eventclass::open_bracket);
+                    } else {
+                        error(IPV6_DIAG_INVALID_INPUT_CHAR);
+                    }
+                    break;
+                case ']':
+                    if constexpr (has(feature::port)) {
+                        transition(eventclass::close_bracket);
+                    } else {
+                        error(IPV6_DIAG_INVALID_INPUT_CHAR);
+                    }
+                    break;
+                case ' ': case '\t': case '\n': case '\r':
+                    transition(eventclass::whitespace);
+                    break;
+                case 'G': case 'H': case 'I': case 'J': case 'K': case 'L': case 'M': case 'N': case 'O':
+                case 'P': case 'Q': case 'R': case 'S': case 'T': case 'U': case 'V': case 'W': case 'X':
+                case 'Y': case 'Z':
+                case 'g': case 'h': case 'i': case 'j': case 'k': case 'l': case 'm': case 'n': case 'o':
+                case 'p': case 'q': case 'r': case 's': case 't': case 'u': case 'v': case 'w': case 'x':
+                case 'y': case 'z':
+                case '-': case '_': case '~':
+                    if (current == state::iface) {
+                        transition(eventclass::zone_char);
+                    } else {
+                        error(IPV6_DIAG_INVALID_INPUT_CHAR);
+                    }
+                    break;
+                default:
+                    error(IPV6_DIAG_INVALID_INPUT_CHAR);
+                    break;
+            }
+            if (has_error) {
+                return false;
+            }
+        }
+
+        transition(eventclass::whitespace);
+        if (has_error) {
+            return false;
+        }
+
+        if (is_compat) {
+            if (v4_octets != 4) {
+                error(IPV6_DIAG_V4_BAD_COMPONENT_COUNT);
+                return false;
+            }
+            out.flags |= IPV6_FLAG_IPV4_COMPAT;
+            return true;
+        }
+
+        if (has_embedding) {
+            if (v4_octets != 4) {
+                error(IPV6_DIAG_V4_BAD_COMPONENT_COUNT);
+                return false;
+            }
+            out.flags |= IPV6_FLAG_IPV4_EMBED;
+        }
+
+        if (!has_zerorun) {
+            if (components < IPV6_NUM_COMPONENTS) {
+                error(IPV6_DIAG_V6_BAD_COMPONENT_COUNT);
+                return false;
+            }
+            return true;
+        }
+
+        // Move the components right of the zero run to the end
+        const int32_t move_count = components - zerorun;
+        const int32_t target = IPV6_NUM_COMPONENTS - move_count;
+        if (move_count < 0 || move_count > IPV6_NUM_COMPONENTS || target < 0) {
+            return false;
+        }
+
+        uint16_t dst[IPV6_NUM_COMPONENTS] = {};
+        for (int32_t i = 0; i < move_count; ++i) {
+            dst[target + i] = out.address.components[zerorun + i];
+        }
+        for (int32_t i = 0; i < zerorun; ++i) {
+            dst[i] = out.address.components[i];
+        }
+        for (int32_t i = 0; i < IPV6_NUM_COMPONENTS; ++i) {
+            out.address.components[i] = dst[i];
+        }
+        return true;
+    }
+};
+
+// Not constexpr: reaching it during constant evaluation is the compile error
+// reported for a malformed literal
+[[noreturn]] inline void malformed_address_literal () noexcept {
+    std::abort();
+}
+
+// Copy of an address with host order components, see host_order in ipv6.c.
+// Network order components hold the most significant byte first in memory.
+constexpr ipv6_address_full_t host_order (ipv6_address_full_t value) noexcept {
+    if (value.flags & IPV6_FLAG_NETWORK_ORDER) {
+#if !(defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+        for (int i = 0; i < IPV6_NUM_COMPONENTS; ++i) {
+            const uint16_t component = value.address.components[i];
+            value.address.components[i] = (uint16_t)((component << 8) | (component >> 8));
+        }
+#endif
+        value.flags &= ~(uint32_t)IPV6_FLAG_NETWORK_ORDER;
+    }
+    return value;
+}
+
+} // namespace detail
+
+// ### ipv6::parse
+//
+// Parse an address at compile time or runtime, see ipv6_from_str_diag.
+// Features selects the accepted grammar, see ipv6::feature.
+//
+// ~~~~
+template <uint32_t Features = feature::all>
+constexpr parse_result parse (std::string_view input) noexcept {
+    detail::reader<Features> reader(input);
+    const bool ok = reader.run();
+
+    parse_result result {};
+    if (ok) {
+        result.address = reader.out;
+    }
+    result.event = ok ? IPV6_DIAG_INVALID_INPUT : reader.event;
+    result.position = ok ? 0 : reader.error_position;
+    result.ok = ok;
+    return result;
+}
+// ~~~~
+
+// ### ipv6::address
+//
+// Trivially copyable value wrapper of ipv6_address_full_t that never allocates.
+//
+// Equality, ordering and hashing cover the components, flags, port, mask and
+// zone, so addresses can key std::unordered_map and std::map directly.
+// Ordering is by components first; it is a total order for containers, for
+// format aware matching use ipv6_compare on native().
+//
+// The interface pointer of the parsed address refers into the input string
+// and is not kept, numeric and interned zones are (see ipv6_zone.h). from
+// rejects a zone name unless it is given a table to intern it in, so
+// fe80::1%eth0 and fe80::1%eth1 never become one key. The constructor drops
+// the name of a zone that is not interned, intern it first.
+//
+// Addresses parsed by ipv6_from_str_network are kept in host order, so they
+// equal, order and hash like the same address parsed by ipv6_from_str.
+//
+// ~~~~
+class address {
+public:
+    constexpr address () noexcept : value_() {}
+    constexpr explicit address (const ipv6_address_full_t& value) noexcept : value_(detail::host_order(value)) {
+        if (!(value_.flags & (IPV6_FLAG_ZONE_ID | IPV6_FLAG_ZONE_INTERNED))) {
+            value_.zone = 0;
+        }
+        if (!(value_.flags & IPV6_FLAG_ZONE_INTERNED)) {
+            value_.iface = nullptr;
+            value_.iface_len = 0;
+        }
+    }
+
+    // Parse with the C library, diag receives the failure when not NULL
+    static std::optional<address> from (
+        std::string_view input,
+        ipv6_diag_result_t* diag = nullptr) noexcept;
+
+    // Parse with the C library, interning a zone name in table
+    static std::optional<address> from (
+        std::string_view input,
+        ipv6_zone_table_t* table,
+        ipv6_diag_result_t* diag = nullptr) noexcept;
+
+    // Format like ipv6_to_str without a nul terminator, see std::to_chars
+    std::to_chars_result to_chars (
+        char* first,
+        char* last) const noexcept;
+
+    // Canonical key of the address, see ipv6_normalize
+    address normalized () const noexcept;
+
+    constexpr const ipv6_address_full_t& native () const noexcept { return value_; }
+    constexpr const uint16_t* components () const noexcept { return value_.address.components; }
+    constexpr uint16_t port () const noexcept { return value_.port; }
+    constexpr uint32_t mask () const noexcept { return value_.mask; }
+    constexpr uint16_t zone () const noexcept { return value_.zone; }
+    constexpr uint32_t flags () const noexcept { return value_.flags; }
+    constexpr bool has_port () const noexcept { return (value_.flags & IPV6_FLAG_HAS_PORT) != 0; }
+    constexpr bool has_mask () const noexcept { return (value_.flags & IPV6_FLAG_HAS_MASK) != 0; }
+
+    // Negative, zero or positive as a orders before, equal to or after b
+    static constexpr int compare (const address& a, const address& b) noexcept;
+
+    constexpr std::size_t hash () const noexcept;
+
+    friend constexpr bool operator== (const address& a, const address& b) noexcept { return compare(a, b) == 0; }
+    friend constexpr bool operator!= (const address& a, const address& b) noexcept { return compare(a, b) != 0; }
+#if defined(IPV6_HAVE_THREE_WAY_COMPARISON)
+    friend constexpr std::strong_ordering operator<=> (const address& a, const address& b) noexcept {
+        const int c = compare(a, b);
+        return c < 0 ? std::strong_ordering::less : c > 0 ? std::strong_ordering::greater : std::strong_ordering::equal;
+    }
+#else
+    friend constexpr bool operator< (const address& a, const address& b) noexcept { return compare(a, b) < 0; }
+    friend constexpr bool operator<= (const address& a, const address& b) noexcept { return compare(a, b) <= 0; }
+    friend constexpr bool operator> (const address& a, const address& b) noexcept { return compare(a, b) > 0; }
+    friend constexpr bool operator>= (const address& a, const address& b) noexcept { return compare(a, b) >= 0; }
+#endif
+
+private:
+    ipv6_address_full_t     value_;
+};
+// ~~~~
+
+static_assert(std::is_trivially_copyable<address>::value, "ipv6::address must be trivially copyable");
+static_assert(sizeof(address) == sizeof(ipv6_address_full_t), "ipv6::address must not add state");
+
+//--------------------------------------------------------------------------------
+inline std::optional<address> address::from (
+    std::string_view input,
+    ipv6_diag_result_t* diag) noexcept
+{
+    return from(input, nullptr, diag);
+}
+
+//--------------------------------------------------------------------------------
+inline std::optional<address> address::from (
+    std::string_view input,
+    ipv6_zone_table_t* table,
+    ipv6_diag_result_t* diag) noexcept
+{
+    ipv6_address_full_t value;
+    ipv6_diag_result_t result;
+    if (!ipv6_from_str_compact(input.data(), input.size(), &value, diag ? diag : &result)) {
+        return std::nullopt;
+    }
+
+    // A zone name would be dropped, report it unless it can be interned
+    const bool named = value.iface_len != 0 && !(value.flags & IPV6_FLAG_ZONE_ID);
+    if (named && (!table || !ipv6_zone_intern_address(table, &value))) {
+        if (diag) {
+            diag->event = IPV6_DIAG_INVALID_INPUT;
+            diag->position = (uint32_t)(value.iface - input.data());
+        }
+        return std::nullopt;
+    }
+    return address(value);
+}
+
+//--------------------------------------------------------------------------------
+inline std::to_chars_result address::to_chars (
+    char* first,
+    char* last) const noexcept
+{
+    char buffer[detail::string_size];
+    const std::size_t length = ipv6_to_str(&value_, buffer, sizeof(buffer));
+    if (length == 0 || length > (std::size_t)(last - first)) {
+        return { last, std::errc::value_too_large };
+    }
+    std::memcpy(first, buffer, length);
+    return { first + length, std::errc() };
+}
+
+//--------------------------------------------------------------------------------
+inline address address::normalized () const noexcept {
+    ipv6_address_full_t value;
+    ipv6_normalize(&value_, &value);
+    return address(value);
+}
+
+//--------------------------------------------------------------------------------
+constexpr int address::compare (const address& a, const address& b) noexcept {
+    for (int i = 0; i < IPV6_NUM_COMPONENTS; ++i) {
+        if (a.value_.address.components[i] != b.value_.address.components[i]) {
+            return a.value_.address.components[i] < b.value_.address.components[i] ? -1 : 1;
+        }
+    }
+    if (a.value_.flags != b.value_.flags) {
+        return a.value_.flags < b.value_.flags ? -1 : 1;
+    }
+    if (a.value_.port != b.value_.port) {
+        return a.value_.port < b.value_.port ? -1 : 1;
+    }
+    if (a.value_.mask != b.value_.mask) {
+        return a.value_.mask < b.value_.mask ? -1 : 1;
+    }
+    if (a.value_.zone != b.value_.zone) {
+        return a.value_.zone < b.value_.zone ? -1 : 1;
+    }
+    return 0;
+}
+
+//--------------------------------------------------------------------------------
+constexpr std::size_t address::hash () const noexcept {
+    // Pack into two words and mix them with the splitmix64 finalizer
+    uint64_t hi = 0;
+    uint64_t lo = 0;
+    for (int i = 0; i < 4; ++i) {
+        hi = (hi << 16) | value_.address.components[i];
+        lo = (lo << 16) | value_.address.components[i + 4];
+    }
+    uint64_t h = hi ^ (lo * 0x9e3779b97f4a7c15ULL) ^
+        ((uint64_t)value_.flags << 48 | (uint64_t)value_.zone << 32 | (uint64_t)value_.port << 16 | value_.mask) *
+        0xc2b2ae3d27d4eb4fULL;
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return (std::size_t)h;
+}
+
+namespace literals {
+
+#if defined(__cpp_consteval)
+#define IPV6_LITERAL_EVAL consteval
+#else
+#define IPV6_LITERAL_EVAL constexpr
+#endif
+
+// ### operator""_ipv6
+//
+// Address literal, a malformed literal does not compile
+//
+// ~~~~
+IPV6_LITERAL_EVAL ipv6_address_full_t operator""_ipv6 (const char* str, std::size_t len) {
+    const parse_result result = parse(std::string_view(str, len));
+    if (!result.ok) {
+        detail::malformed_address_literal();
+    }
+    return result.address;
+}
+// ~~~~
+
+#undef IPV6_LITERAL_EVAL
+
+} // namespace literals
+
+} // namespace ipv6
+
+template <>
+struct std::hash<ipv6::address> {
+    std::size_t operator() (const ipv6::address& a) const noexcept { return a.hash(); }
+};
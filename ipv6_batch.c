@@ -0,0 +1,461 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L // sysconf, sched_yield
+#endif
+
+#include "ipv6_batch.h"
+#include "ipv6_parallel.h"
+#include "ipv6_config.h"
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <stdlib.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+//
+// Each worker owns a range of chunk indices packed in one 64-bit word, the
+// next chunk in the low half and the end in the high half. The owner takes
+// chunks from the front and thieves take the back half, both with a CAS on
+// the same word, so a chunk is claimed exactly once without locks. No work
+// is created while the loop runs: a worker that finds every range empty is
+// done, chunks in flight between a victim and a thief are run by the thief.
+//
+#if defined(_MSC_VER)
+#define PARALLEL_LOAD(p) ((uint64_t)InterlockedCompareExchange64((volatile LONG64*)(p), 0, 0))
+#define PARALLEL_STORE(p, v) InterlockedExchange64((volatile LONG64*)(p), (LONG64)(v))
+#define PARALLEL_CAS(p, expected, desired) \
+    ((uint64_t)InterlockedCompareExchange64((volatile LONG64*)(p), (LONG64)(desired), (LONG64)(expected)) == (expected))
+#else
+#define PARALLEL_LOAD(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define PARALLEL_STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define PARALLEL_CAS(p, expected, desired) \
+    __atomic_compare_exchange_n((p), &(expected), (desired), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#endif
+
+#define PARALLEL_CACHE_LINE 64
+#define PARALLEL_MAX_CHUNKS 0xfffffffeu
+
+#define RANGE_PACK(next, end) (((uint64_t)(end) << 32) | (uint64_t)(next))
+#define RANGE_NEXT(range) ((uint32_t)(range))
+#define RANGE_END(range) ((uint32_t)((range) >> 32))
+
+//
+// Range of one worker, padded so workers do not share cache lines
+//
+typedef struct {
+    uint64_t                    range;
+    uint8_t                     pad[PARALLEL_CACHE_LINE - sizeof(uint64_t)];
+} parallel_range_t;
+
+typedef struct {
+    parallel_range_t*           ranges;
+    uint32_t                    workers;
+    ipv6_chunk_func_t           func;
+    void*                       arg;
+} parallel_job_t;
+
+//--------------------------------------------------------------------------------
+static bool parallel_pop (parallel_range_t* own, size_t* chunk)
+{
+    uint64_t range = PARALLEL_LOAD(&own->range);
+    while (RANGE_NEXT(range) < RANGE_END(range)) {
+        const uint64_t taken = RANGE_PACK(RANGE_NEXT(range) + 1, RANGE_END(range));
+        if (PARALLEL_CAS(&own->range, range, taken)) {
+            *chunk = RANGE_NEXT(range);
+            return true;
+        }
+        range = PARALLEL_LOAD(&own->range);
+    }
+    return false;
+}
+
+//--------------------------------------------------------------------------------
+// Move the back half of another worker's range into the empty own range
+static bool parallel_steal (parallel_job_t* job, uint32_t worker)
+{
+    for (uint32_t i = 1; i < job->workers; ++i) {
+        parallel_range_t* victim = &job->ranges[(worker + i) % job->workers];
+        uint64_t range = PARALLEL_LOAD(&victim->range);
+
+        while (RANGE_NEXT(range) < RANGE_END(range)) {
+            const uint32_t remaining = RANGE_END(range) - RANGE_NEXT(range);
+            const uint32_t split = RANGE_END(range) - (remaining + 1) / 2;
+            const uint64_t kept = RANGE_PACK(RANGE_NEXT(range), split);
+            if (PARALLEL_CAS(&victim->range, range, kept)) {
+                PARALLEL_STORE(&job->ranges[worker].range, RANGE_PACK(split, RANGE_END(range)));
+                return true;
+            }
+            range = PARALLEL_LOAD(&victim->range);
+        }
+    }
+    return false;
+}
+
+//--------------------------------------------------------------------------------
+static void parallel_worker (void* arg, uint32_t worker)
+{
+    parallel_job_t* job = (parallel_job_t*)arg;
+    size_t chunk;
+
+    if (worker >= job->workers) {
+        return;
+    }
+
+    do {
+        while (parallel_pop(&job->ranges[worker], &chunk)) {
+            job->func(job->arg, worker, chunk);
+        }
+    } while (parallel_steal(job, worker));
+}
+
+//
+// Minimal thread shim
+//
+typedef struct {
+    ipv6_thread_func_t          func;
+    void*                       arg;
+} parallel_thread_start_t;
+
+#if defined(_WIN32)
+//--------------------------------------------------------------------------------
+static DWORD WINAPI parallel_thread_main (LPVOID arg)
+{
+    parallel_thread_start_t start = *(parallel_thread_start_t*)arg;
+    free(arg);
+    start.func(start.arg);
+    return 0;
+}
+
+//--------------------------------------------------------------------------------
+bool ipv6_thread_start (ipv6_thread_t* thread, ipv6_thread_func_t func, void* arg)
+{
+    parallel_thread_start_t* start = (parallel_thread_start_t*)malloc(sizeof(parallel_thread_start_t));
+    if (!start) {
+        return false;
+    }
+    start->func = func;
+    start->arg = arg;
+    *thread = CreateThread(NULL, 0, parallel_thread_main, start, 0, NULL);
+    if (!*thread) {
+        free(start);
+        return false;
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------------------
+void ipv6_thread_join (ipv6_thread_t thread)
+{
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+
+//--------------------------------------------------------------------------------
+void ipv6_thread_yield (void)
+{
+    SwitchToThread();
+}
+
+//--------------------------------------------------------------------------------
+uint32_t ipv6_cpu_count (void)
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (uint32_t)info.dwNumberOfProcessors;
+}
+#else
+//--------------------------------------------------------------------------------
+static void* parallel_thread_main (void* arg)
+{
+    parallel_thread_start_t start = *(parallel_thread_start_t*)arg;
+    free(arg);
+    start.func(start.arg);
+    return NULL;
+}
+
+//--------------------------------------------------------------------------------
+bool ipv6_thread_start (ipv6_thread_t* thread, ipv6_thread_func_t func, void* arg)
+{
+    parallel_thread_start_t* start = (parallel_thread_start_t*)malloc(sizeof(parallel_thread_start_t));
+    if (!start) {
+        return false;
+    }
+    start->func = func;
+    start->arg = arg;
+    if (pthread_create(thread, NULL, parallel_thread_main, start) != 0) {
+        free(start);
+        return false;
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------------------
+void ipv6_thread_join (ipv6_thread_t thread)
+{
+    pthread_join(thread, NULL);
+}
+
+//--------------------------------------------------------------------------------
+void ipv6_thread_yield (void)
+{
+    sched_yield();
+}
+
+//--------------------------------------------------------------------------------
+uint32_t ipv6_cpu_count (void)
+{
+#ifdef _SC_NPROCESSORS_ONLN
+    const long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (uint32_t)count : 1;
+#else
+    return 1;
+#endif
+}
+#endif
+
+//
+// Worker threads of a loop, the calling thread is worker 0
+//
+typedef struct {
+    parallel_job_t*             job;
+    uint32_t                    worker;
+} parallel_thread_arg_t;
+
+//--------------------------------------------------------------------------------
+static void parallel_thread (void* arg)
+{
+    parallel_thread_arg_t* thread_arg = (parallel_thread_arg_t*)arg;
+    parallel_worker(thread_arg->job, thread_arg->worker);
+}
+
+//--------------------------------------------------------------------------------
+uint32_t ipv6_parallel_workers (
+    uint32_t threads,
+    const ipv6_executor_t* executor,
+    size_t chunks)
+{
+    uint32_t workers = executor ? executor->workers : (threads ? threads : ipv6_cpu_count());
+    if (workers > IPV6_BATCH_MAX_WORKERS) {
+        workers = IPV6_BATCH_MAX_WORKERS;
+    }
+    if (workers > chunks) {
+        workers = (uint32_t)chunks;
+    }
+    return workers ? workers : 1;
+}
+
+//--------------------------------------------------------------------------------
+size_t ipv6_parallel_chunk_size (
+    size_t count,
+    size_t requested)
+{
+    size_t size = requested ? requested : IPV6_BATCH_DEFAULT_CHUNK;
+    if (count / size >= PARALLEL_MAX_CHUNKS) {
+        size = count / PARALLEL_MAX_CHUNKS + 1;
+    }
+    return size;
+}
+
+//--------------------------------------------------------------------------------
+void ipv6_parallel_for (
+    uint32_t workers,
+    size_t chunks,
+    const ipv6_executor_t* executor,
+    ipv6_chunk_func_t func,
+    void* arg)
+{
+    ipv6_thread_t threads[IPV6_BATCH_MAX_WORKERS];
+    parallel_thread_arg_t thread_args[IPV6_BATCH_MAX_WORKERS];
+    bool started[IPV6_BATCH_MAX_WORKERS];
+    parallel_job_t job;
+
+    job.ranges = workers > 1 ? (parallel_range_t*)malloc(workers * sizeof(parallel_range_t)) : NULL;
+    if (!job.ranges) {
+        for (size_t c = 0; c < chunks; ++c) {
+            func(arg, 0, c);
+        }
+        return;
+    }
+
+    job.workers = workers;
+    job.func = func;
+    job.arg = arg;
+    for (uint32_t w = 0; w < workers; ++w) {
+        job.ranges[w].range = RANGE_PACK(chunks * w / workers, chunks * (w + 1) / workers);
+    }
+
+    if (executor) {
+        executor->run(executor->context, workers, parallel_worker, &job);
+    } else {
+        for (uint32_t w = 1; w < workers; ++w) {
+            thread_args[w].job = &job;
+            thread_args[w].worker = w;
+            started[w] = ipv6_thread_start(&threads[w], parallel_thread, &thread_args[w]);
+        }
+
+        // Ranges of threads that failed to start are stolen like any other
+        parallel_worker(&job, 0);
+
+        for (uint32_t w = 1; w < workers; ++w) {
+            if (started[w]) {
+                ipv6_thread_join(threads[w]);
+            }
+        }
+    }
+
+    // An executor that skipped workers leaves their ranges unclaimed
+    for (uint32_t w = 0; w < workers; ++w) {
+        size_t chunk;
+        while (parallel_pop(&job.ranges[w], &chunk)) {
+            func(arg, 0, chunk);
+        }
+    }
+
+    free(job.ranges);
+}
+
+//
+// Batch calls keep a result count per worker, padded against false sharing
+//
+typedef struct {
+    size_t                      count;
+    uint8_t                     pad[PARALLEL_CACHE_LINE - sizeof(size_t)];
+} batch_counter_t;
+
+typedef struct {
+    const char* const*          inputs;
+    const size_t*               lengths;
+    const ipv6_address_full_t*  addresses;
+    size_t                      count;
+    size_t                      chunk_size;
+    ipv6_address_full_t*        out;
+    bool*                       parsed;
+    ipv6_diag_result_t*         diags;
+    char*                       output;
+    size_t                      stride;
+    size_t*                     output_lengths;
+    batch_counter_t             counters[IPV6_BATCH_MAX_WORKERS];
+} batch_job_t;
+
+//--------------------------------------------------------------------------------
+static void batch_from_str_chunk (void* arg, uint32_t worker, size_t chunk)
+{
+    batch_job_t* job = (batch_job_t*)arg;
+    const size_t begin = chunk * job->chunk_size;
+    const size_t end = job->count - begin < job->chunk_size ? job->count : begin + job->chunk_size;
+    ipv6_diag_result_t diag;
+    size_t valid = 0;
+
+    for (size_t i = begin; i < end; ++i) {
+        const char* input = job->inputs[i];
+        const size_t length = job->lengths ? job->lengths[i] : (input ? strlen(input) : 0);
+        ipv6_diag_result_t* result = job->diags ? &job->diags[i] : &diag;
+        const bool ok = ipv6_from_str_compact(input, length, &job->out[i], result);
+
+        if (ok) {
+            valid++;
+        } else {
+            memset(&job->out[i], 0, sizeof(job->out[i]));
+        }
+        if (job->parsed) {
+            job->parsed[i] = ok;
+        }
+    }
+    job->counters[worker].count += valid;
+}
+
+//--------------------------------------------------------------------------------
+static void batch_to_str_chunk (void* arg, uint32_t worker, size_t chunk)
+{
+    batch_job_t* job = (batch_job_t*)arg;
+    const size_t begin = chunk * job->chunk_size;
+    const size_t end = job->count - begin < job->chunk_size ? job->count : begin + job->chunk_size;
+    size_t written = 0;
+
+    for (size_t i = begin; i < end; ++i) {
+        const size_t length = ipv6_to_str(&job->addresses[i], job->output + i * job->stride, job->stride);
+        if (length) {
+            written++;
+        }
+        if (job->output_lengths) {
+            job->output_lengths[i] = length;
+        }
+    }
+    job->counters[worker].count += written;
+}
+
+//--------------------------------------------------------------------------------
+static size_t batch_run (
+    batch_job_t* job,
+    const ipv6_batch_options_t* options,
+    ipv6_chunk_func_t func)
+{
+    const ipv6_executor_t* executor = options ? options->executor : NULL;
+    job->chunk_size = ipv6_parallel_chunk_size(job->count, options ? options->chunk : 0);
+
+    const size_t chunks = (job->count + job->chunk_size - 1) / job->chunk_size;
+    const uint32_t workers = ipv6_parallel_workers(options ? options->threads : 0, executor, chunks);
+    for (uint32_t w = 0; w < workers; ++w) {
+        job->counters[w].count = 0;
+    }
+
+    ipv6_parallel_for(workers, chunks, executor, func, job);
+
+    size_t total = 0;
+    for (uint32_t w = 0; w < workers; ++w) {
+        total += job->counters[w].count;
+    }
+    return total;
+}
+
+//--------------------------------------------------------------------------------
+size_t ipv6_batch_from_str (
+    const char* const* inputs,
+    const size_t* lengths,
+    size_t count,
+    ipv6_address_full_t* out,
+    bool* parsed,
+    ipv6_diag_result_t* diags,
+    const ipv6_batch_options_t* options)
+{
+    batch_job_t job;
+
+    memset(&job, 0, offsetof(batch_job_t, counters));
+    job.inputs = inputs;
+    job.lengths = lengths;
+    job.count = count;
+    job.out = out;
+    job.parsed = parsed;
+    job.diags = diags;
+
+    return batch_run(&job, options, batch_from_str_chunk);
+}
+
+//--------------------------------------------------------------------------------
+size_t ipv6_batch_to_str (
+    const ipv6_address_full_t* in,
+    size_t count,
+    char* output,
+    size_t stride,
+    size_t* lengths,
+    const ipv6_batch_options_t* options)
+{
+    batch_job_t job;
+
+    memset(&job, 0, offsetof(batch_job_t, counters));
+    job.addresses = in;
+    job.count = count;
+    job.output = output;
+    job.stride = stride;
+    job.output_lengths = lengths;
+
+    return batch_run(&job, options, batch_to_str_chunk);
+}
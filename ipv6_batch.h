@@ -0,0 +1,102 @@
+#pragma once
+// # Batch parsing and formatting
+//
+//     Parse and format large arrays of addresses on every core.
+//
+// The input is cut into chunks of a few thousand addresses. Each worker
+// starts on its own contiguous run of chunks and, once it runs dry, steals
+// half of the remaining run of another worker, so expensive forms clustered
+// in one part of the input do not leave the other cores idle. Workers are
+// threads started for the call, or the threads of a caller supplied executor.
+//
+// Results are written by input index and do not depend on the worker count.
+//
+
+#include "ipv6.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/// Addresses per chunk when ipv6_batch_options_t.chunk is 0
+#define IPV6_BATCH_DEFAULT_CHUNK 1024
+
+/// Upper bound on workers of a batch call
+#define IPV6_BATCH_MAX_WORKERS 256
+
+// ### ipv6_work_func_t
+//
+// Body of one worker, see ipv6_executor_t
+//
+// ~~~~
+typedef void (*ipv6_work_func_t) (
+    void* arg,
+    uint32_t worker);
+// ~~~~
+
+// ### ipv6_executor_t
+//
+// Threads supplied by the caller. run must call work(arg, w) once for every
+// w in [0, workers) and return when all calls have returned. The calls may
+// run concurrently or one after another, work is balanced either way.
+//
+// ~~~~
+typedef struct {
+    void                    (*run) (void* context, uint32_t workers, ipv6_work_func_t work, void* arg);
+    void*                   context;            // passed to run
+    uint32_t                workers;            // calls run may execute concurrently, 0 for 1
+    uint32_t                pad0;
+} ipv6_executor_t;
+// ~~~~
+
+// ### ipv6_batch_options_t
+//
+// Settings for a batch call, zero initialize for defaults
+//
+// ~~~~
+typedef struct {
+    uint32_t                threads;            // worker threads, 0 for one per CPU, unused with an executor
+    uint32_t                chunk;              // addresses per chunk, 0 for IPV6_BATCH_DEFAULT_CHUNK
+    const ipv6_executor_t*  executor;           // NULL to start threads for the call
+} ipv6_batch_options_t;
+// ~~~~
+
+
+// ### ipv6_batch_from_str
+//
+// Parse count strings into out. lengths may be NULL for nul terminated
+// inputs. parsed and diags may be NULL, otherwise they receive the outcome of
+// each input. Entries of out that failed to parse are zeroed. Returns the
+// number of inputs that parsed.
+//
+// ~~~~
+size_t ipv6_batch_from_str (
+    const char* const* inputs,
+    const size_t* lengths,
+    size_t count,
+    ipv6_address_full_t* out,
+    bool* parsed,
+    ipv6_diag_result_t* diags,
+    const ipv6_batch_options_t* options);
+// ~~~~
+
+// ### ipv6_batch_to_str
+//
+// Format count addresses with ipv6_to_str, address i into the stride bytes
+// at output + i * stride. lengths may be NULL, otherwise it receives the
+// result of each ipv6_to_str. Returns the number of addresses that fit.
+//
+// ~~~~
+size_t ipv6_batch_to_str (
+    const ipv6_address_full_t* in,
+    size_t count,
+    char* output,
+    size_t stride,
+    size_t* lengths,
+    const ipv6_batch_options_t* options);
+// ~~~~
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,378 @@
+#include "ipv6_cache.h"
+#include "ipv6_config.h"
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <stdlib.h>
+
+//
+// Entries are plain words accessed with relaxed atomics. A writer makes the
+// sequence odd with a CAS, stores the words and makes it even again with a
+// release store. A reader loads the sequence, copies the words and accepts
+// the copy only if the sequence was even and did not change in between.
+//
+#if defined(_MSC_VER)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#define CACHE_LOAD(p) (*(volatile const uint64_t*)(p))
+#define CACHE_STORE(p, v) (*(volatile uint64_t*)(p) = (v))
+#define CACHE_LOAD_U32(p) (*(volatile const uint32_t*)(p))
+#define CACHE_STORE_U32(p, v) (*(volatile uint32_t*)(p) = (v))
+#define CACHE_LOAD_ACQUIRE_U32(p) (*(volatile const uint32_t*)(p))
+#define CACHE_STORE_RELEASE_U32(p, v) (MemoryBarrier(), *(volatile uint32_t*)(p) = (v))
+#define CACHE_CAS_U32(p, expected, desired) \
+    ((uint32_t)InterlockedCompareExchange((volatile LONG*)(p), (LONG)(desired), (LONG)(expected)) == (expected))
+#define CACHE_FETCH_ADD_U32(p, v) ((uint32_t)InterlockedExchangeAdd((volatile LONG*)(p), (LONG)(v)))
+#define CACHE_FENCE_ACQUIRE() MemoryBarrier()
+#define CACHE_FENCE_RELEASE() MemoryBarrier()
+#else
+#define CACHE_LOAD(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#define CACHE_STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define CACHE_LOAD_U32(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#define CACHE_STORE_U32(p, v) __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define CACHE_LOAD_ACQUIRE_U32(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define CACHE_STORE_RELEASE_U32(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define CACHE_CAS_U32(p, expected, desired) \
+    __atomic_compare_exchange_n((p), &(expected), (desired), false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)
+#define CACHE_FETCH_ADD_U32(p, v) __atomic_fetch_add((p), (v), __ATOMIC_RELAXED)
+#define CACHE_FENCE_ACQUIRE() __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define CACHE_FENCE_RELEASE() __atomic_thread_fence(__ATOMIC_RELEASE)
+#endif
+
+#define CACHE_KEY_WORDS (IPV6_CACHE_MAX_KEY / 8)
+#define CACHE_ALIGNMENT 64
+
+//
+// Packing of cache_entry_t.meta, 0 for an empty entry
+//
+#define META_VALID              0x100ULL
+#define META_PARSED             0x200ULL
+#define META_LENGTH(m)          ((size_t)((m) & 0xff))
+#define META_EVENT(m)           ((ipv6_diag_event_t)(((m) >> 16) & 0xff))
+#define META_POSITION(m)        ((uint32_t)(((m) >> 24) & 0xffff))
+#define META_IFACE_OFFSET(m)    ((size_t)(((m) >> 40) & 0xff))
+#define META_IFACE_LENGTH(m)    ((uint32_t)(((m) >> 48) & 0xff))
+#define META_MASK(m)            ((uint32_t)(((m) >> 56) & 0xff))
+
+//
+// One cached input and its result, two cache lines
+//
+typedef struct {
+    uint32_t                    seq;                // odd while being written
+    uint32_t                    referenced;         // CLOCK bit, set by hits
+    uint64_t                    hash;
+    uint64_t                    meta;               // key length, outcome, interface offset and length, mask
+    uint64_t                    components[2];      // ipv6_address_t
+    uint64_t                    extra;              // port, zone and flags
+    uint64_t                    key[CACHE_KEY_WORDS];
+    uint64_t                    pad0;
+} cache_entry_t;
+
+struct ipv6_cache_t {
+    cache_entry_t*              entries;            // sets of IPV6_CACHE_WAYS entries
+    uint32_t*                   hands;              // CLOCK hand of each set
+    size_t                      set_mask;
+    size_t                      memory;
+    void*                       allocation;
+};
+
+//
+// Result copied out of an entry
+//
+typedef struct {
+    uint64_t                    meta;
+    uint64_t                    components[2];
+    uint64_t                    extra;
+} cache_value_t;
+
+//--------------------------------------------------------------------------------
+static uint64_t cache_hash (const uint64_t* key, size_t length)
+{
+    uint64_t h = (uint64_t)length * 0x9e3779b97f4a7c15ULL;
+    for (size_t i = 0; i < (length + 7) / 8; ++i) {
+        h = (h ^ key[i]) * 0xbf58476d1ce4e5b9ULL;
+        h ^= h >> 29;
+    }
+    h ^= h >> 32;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 29;
+    return h;
+}
+
+//--------------------------------------------------------------------------------
+static bool cache_find (
+    ipv6_cache_t* cache,
+    const uint64_t* key,
+    size_t length,
+    uint64_t hash,
+    cache_value_t* value)
+{
+    cache_entry_t* set = &cache->entries[(hash & cache->set_mask) * IPV6_CACHE_WAYS];
+
+    for (uint32_t w = 0; w < IPV6_CACHE_WAYS; ++w) {
+        cache_entry_t* entry = &set[w];
+        const uint32_t seq = CACHE_LOAD_ACQUIRE_U32(&entry->seq);
+        if (seq & 1) {
+            continue;
+        }
+
+        value->meta = CACHE_LOAD(&entry->meta);
+        if (CACHE_LOAD(&entry->hash) != hash || !(value->meta & META_VALID) || META_LENGTH(value->meta) != length) {
+            continue;
+        }
+
+        bool match = true;
+        for (size_t i = 0; i < (length + 7) / 8 && match; ++i) {
+            match = CACHE_LOAD(&entry->key[i]) == key[i];
+        }
+        if (!match) {
+            continue;
+        }
+
+        value->components[0] = CACHE_LOAD(&entry->components[0]);
+        value->components[1] = CACHE_LOAD(&entry->components[1]);
+        value->extra = CACHE_LOAD(&entry->extra);
+
+        CACHE_FENCE_ACQUIRE();
+        if (CACHE_LOAD_U32(&entry->seq) != seq) {
+            continue;
+        }
+
+        // Only write the shared line when the bit is not set yet
+        if (!CACHE_LOAD_U32(&entry->referenced)) {
+            CACHE_STORE_U32(&entry->referenced, 1);
+        }
+        return true;
+    }
+    return false;
+}
+
+//--------------------------------------------------------------------------------
+static void cache_insert (
+    ipv6_cache_t* cache,
+    const uint64_t* key,
+    size_t length,
+    uint64_t hash,
+    const cache_value_t* value)
+{
+    const size_t set_index = hash & cache->set_mask;
+    cache_entry_t* set = &cache->entries[set_index * IPV6_CACHE_WAYS];
+    cache_entry_t* victim = NULL;
+
+    for (uint32_t w = 0; w < IPV6_CACHE_WAYS && !victim; ++w) {
+        if (!CACHE_LOAD(&set[w].meta)) {
+            victim = &set[w];
+        }
+    }
+
+    // CLOCK: clear referenced bits under the hand until an unreferenced entry
+    for (uint32_t step = 0; step < 2 * IPV6_CACHE_WAYS && !victim; ++step) {
+        cache_entry_t* entry = &set[CACHE_FETCH_ADD_U32(&cache->hands[set_index], 1) % IPV6_CACHE_WAYS];
+        if (CACHE_LOAD_U32(&entry->referenced)) {
+            CACHE_STORE_U32(&entry->referenced, 0);
+        } else {
+            victim = entry;
+        }
+    }
+    if (!victim) {
+        victim = &set[hash % IPV6_CACHE_WAYS];
+    }
+
+    // Another writer holds the entry, the result is simply not cached
+    uint32_t seq = CACHE_LOAD_U32(&victim->seq);
+    if ((seq & 1) || !CACHE_CAS_U32(&victim->seq, seq, seq + 1)) {
+        return;
+    }
+    CACHE_FENCE_RELEASE();
+
+    CACHE_STORE(&victim->hash, hash);
+    CACHE_STORE(&victim->meta, value->meta);
+    CACHE_STORE(&victim->components[0], value->components[0]);
+    CACHE_STORE(&victim->components[1], value->components[1]);
+    CACHE_STORE(&victim->extra, value->extra);
+    for (size_t i = 0; i < (length + 7) / 8; ++i) {
+        CACHE_STORE(&victim->key[i], key[i]);
+    }
+    CACHE_STORE_U32(&victim->referenced, 0);
+
+    CACHE_STORE_RELEASE_U32(&victim->seq, seq + 2);
+}
+
+//--------------------------------------------------------------------------------
+static bool cache_unpack (
+    const cache_value_t* value,
+    const char* input,
+    ipv6_address_full_t* out,
+    ipv6_diag_result_t* result)
+{
+    memset(out, 0, sizeof(*out));
+
+    if (!(value->meta & META_PARSED)) {
+        if (result) {
+            result->event = META_EVENT(value->meta);
+            result->position = META_POSITION(value->meta);
+        }
+        return false;
+    }
+
+    memcpy(&out->address, value->components, sizeof(out->address));
+    out->port = (uint16_t)(value->extra & 0xffff);
+    out->zone = (uint16_t)((value->extra >> 16) & 0xffff);
+    out->mask = META_MASK(value->meta);
+    out->flags = (uint32_t)(value->extra >> 32);
+    if (META_IFACE_LENGTH(value->meta)) {
+        out->iface = input + META_IFACE_OFFSET(value->meta);
+        out->iface_len = META_IFACE_LENGTH(value->meta);
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------------------
+static void cache_pack (
+    size_t length,
+    bool parsed,
+    const char* input,
+    const ipv6_address_full_t* out,
+    const ipv6_diag_result_t* diag,
+    cache_value_t* value)
+{
+    memset(value, 0, sizeof(*value));
+    value->meta = META_VALID | (uint64_t)length;
+
+    if (!parsed) {
+        value->meta |= ((uint64_t)diag->event & 0xff) << 16;
+        value->meta |= ((uint64_t)diag->position & 0xffff) << 24;
+        return;
+    }
+
+    value->meta |= META_PARSED;
+    if (out->iface && out->iface >= input && out->iface + out->iface_len <= input + length) {
+        value->meta |= (uint64_t)(out->iface - input) << 40;
+        value->meta |= (uint64_t)out->iface_len << 48;
+    }
+    value->meta |= ((uint64_t)out->mask & 0xff) << 56;
+    memcpy(value->components, &out->address, sizeof(out->address));
+    value->extra = (uint64_t)out->port | ((uint64_t)out->zone << 16) | ((uint64_t)out->flags << 32);
+}
+
+//--------------------------------------------------------------------------------
+// Zero padded copy of the input, false if it is too long to cache
+static bool cache_key (const char* input, size_t input_bytes, uint64_t* key)
+{
+    if (!input || input_bytes > IPV6_CACHE_MAX_KEY) {
+        return false;
+    }
+    memset(key, 0, CACHE_KEY_WORDS * sizeof(uint64_t));
+    memcpy(key, input, input_bytes);
+    return true;
+}
+
+//--------------------------------------------------------------------------------
+ipv6_cache_t* ipv6_cache_create (
+    size_t entries)
+{
+    size_t sets = 1;
+    while (sets * IPV6_CACHE_WAYS < entries) {
+        sets *= 2;
+    }
+
+    ipv6_cache_t* cache = (ipv6_cache_t*)malloc(sizeof(ipv6_cache_t));
+    if (!cache) {
+        return NULL;
+    }
+
+    cache->memory = sets * IPV6_CACHE_WAYS * sizeof(cache_entry_t) + CACHE_ALIGNMENT + sets * sizeof(uint32_t);
+    cache->allocation = calloc(1, cache->memory);
+    if (!cache->allocation) {
+        free(cache);
+        return NULL;
+    }
+
+    const uintptr_t aligned = ((uintptr_t)cache->allocation + CACHE_ALIGNMENT - 1) & ~(uintptr_t)(CACHE_ALIGNMENT - 1);
+    cache->entries = (cache_entry_t*)aligned;
+    cache->hands = (uint32_t*)(cache->entries + sets * IPV6_CACHE_WAYS);
+    cache->set_mask = sets - 1;
+    cache->memory += sizeof(ipv6_cache_t);
+    return cache;
+}
+
+//--------------------------------------------------------------------------------
+void ipv6_cache_destroy (
+    ipv6_cache_t* cache)
+{
+    if (cache) {
+        free(cache->allocation);
+        free(cache);
+    }
+}
+
+//--------------------------------------------------------------------------------
+size_t ipv6_cache_memory (
+    const ipv6_cache_t* cache)
+{
+    return cache->memory;
+}
+
+//--------------------------------------------------------------------------------
+bool ipv6_cache_lookup (
+    ipv6_cache_t* cache,
+    const char* input,
+    size_t input_bytes,
+    ipv6_address_full_t* out,
+    bool* parsed,
+    ipv6_diag_result_t* result)
+{
+    uint64_t key[CACHE_KEY_WORDS];
+    cache_value_t value;
+
+    if (!cache_key(input, input_bytes, key) ||
+        !cache_find(cache, key, input_bytes, cache_hash(key, input_bytes), &value)) {
+        return false;
+    }
+
+    const bool ok = cache_unpack(&value, input, out, result);
+    if (parsed) {
+        *parsed = ok;
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------------------
+bool ipv6_cache_from_str (
+    ipv6_cache_t* cache,
+    const char* input,
+    size_t input_bytes,
+    ipv6_address_full_t* out,
+    ipv6_diag_result_t* result)
+{
+    uint64_t key[CACHE_KEY_WORDS];
+    cache_value_t value;
+    ipv6_diag_result_t diag;
+
+    if (!out || !cache_key(input, input_bytes, key)) {
+        const bool ok = ipv6_from_str_compact(input, input_bytes, out, result);
+        if (!ok && out) {
+            memset(out, 0, sizeof(*out));
+        }
+        return ok;
+    }
+
+    const uint64_t hash = cache_hash(key, input_bytes);
+    if (cache_find(cache, key, input_bytes, hash, &value)) {
+        return cache_unpack(&value, input, out, result);
+    }
+
+    const bool ok = ipv6_from_str_compact(input, input_bytes, out, &diag);
+    if (!ok) {
+        memset(out, 0, sizeof(*out));
+        if (result) {
+            *result = diag;
+        }
+    }
+
+    cache_pack(input_bytes, ok, input, out, &diag, &value);
+    cache_insert(cache, key, input_bytes, hash, &value);
+    return ok;
+}
@@ -0,0 +1,103 @@
+#pragma once
+// # Parse cache
+//
+//     Concurrent cache of parse results keyed by the input bytes.
+//
+// Services that see the same few thousand strings over and over, such as
+// X-Forwarded-For values, can look the input up instead of parsing it. A hit
+// costs a hash of the input and a compare against the stored key.
+//
+// The cache is a fixed array of sets of IPV6_CACHE_WAYS entries, allocated
+// once by ipv6_cache_create. Entries are replaced with the CLOCK algorithm
+// within their set. Every entry is guarded by a sequence lock: lookups only
+// read shared memory, apart from setting a referenced bit that is usually
+// set already, and retry or miss when they overlap a writer. Writers claim an
+// entry with a CAS and skip the insert if another writer holds it. One cache
+// can be shared by any number of threads.
+//
+// Failures are cached too, with their diagnostic event and position. The
+// interface pointer of a hit is rebased onto the caller's input.
+//
+
+#include "ipv6.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/// Entries per set
+#define IPV6_CACHE_WAYS 8
+
+/// Longest input that is cached, longer inputs are always parsed
+#define IPV6_CACHE_MAX_KEY 72
+
+// ### ipv6_cache_t
+//
+// Opaque cache, see ipv6_cache_create
+//
+// ~~~~
+typedef struct ipv6_cache_t ipv6_cache_t;
+// ~~~~
+
+// ### ipv6_cache_create
+//
+// Allocate a cache of at least entries entries, rounded up to a power of two
+// number of sets. Returns NULL if memory could not be allocated.
+//
+// ~~~~
+ipv6_cache_t* ipv6_cache_create (
+    size_t entries);
+// ~~~~
+
+// ### ipv6_cache_destroy
+//
+// Release a cache, no thread may be using it
+//
+// ~~~~
+void ipv6_cache_destroy (
+    ipv6_cache_t* cache);
+// ~~~~
+
+// ### ipv6_cache_memory
+//
+// Bytes allocated by the cache, fixed for its lifetime
+//
+// ~~~~
+size_t ipv6_cache_memory (
+    const ipv6_cache_t* cache);
+// ~~~~
+
+// ### ipv6_cache_from_str
+//
+// Parse as ipv6_from_str_compact, answering from the cache when the same
+// input was seen before and storing the result otherwise. out is zeroed
+// when parsing fails. The result argument is optional.
+//
+// ~~~~
+bool ipv6_cache_from_str (
+    ipv6_cache_t* cache,
+    const char* input,
+    size_t input_bytes,
+    ipv6_address_full_t* out,
+    ipv6_diag_result_t* result);
+// ~~~~
+
+// ### ipv6_cache_lookup
+//
+// Look an input up without parsing it. Returns false on a miss, otherwise
+// fills out, parsed and result (optional) as ipv6_cache_from_str would.
+//
+// ~~~~
+bool ipv6_cache_lookup (
+    ipv6_cache_t* cache,
+    const char* input,
+    size_t input_bytes,
+    ipv6_address_full_t* out,
+    bool* parsed,
+    ipv6_diag_result_t* result);
+// ~~~~
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,196 @@
+#include "ipv6_classify.h"
+
+//
+// Prefixes are stored as the value and length of the high and low 64 bits
+// of the address in host order, IPv4 prefixes as 32 bit values. Each table is
+// sorted by the top four bits of its prefixes, the bucket arrays hold the
+// index of the first prefix of every group and the end of the table.
+//
+#define CLASSIFY_MASK_HI(len) ((len) >= 64 ? ~0ULL : ~(~0ULL >> ((len) & 63)))
+#define CLASSIFY_MASK_LO(len) ((len) >= 128 ? ~0ULL : (len) <= 64 ? 0ULL : ~(~0ULL >> (((len) - 64) & 63)))
+#define CLASSIFY_MASK_V4(len) ((len) >= 32 ? ~0U : ~(~0U >> ((len) & 31)))
+
+#define V6_PREFIX(hi, lo, len, classes) \
+    { (hi), (lo), CLASSIFY_MASK_HI(len), CLASSIFY_MASK_LO(len), (classes) }
+
+#define V4_PREFIX(a, b, c, d, len, classes) \
+    { ((uint32_t)(a) << 24) | ((uint32_t)(b) << 16) | ((uint32_t)(c) << 8) | (uint32_t)(d), \
+      CLASSIFY_MASK_V4(len), (classes) }
+
+typedef struct {
+    uint64_t                    hi;
+    uint64_t                    lo;
+    uint64_t                    mask_hi;
+    uint64_t                    mask_lo;
+    uint32_t                    classes;
+} classify_v6_prefix_t;
+
+typedef struct {
+    uint32_t                    value;
+    uint32_t                    mask;
+    uint32_t                    classes;
+} classify_v4_prefix_t;
+
+static const classify_v6_prefix_t classify_v6_prefixes[] = {
+    // 0::/4
+    V6_PREFIX(0x0000000000000000ULL, 0x0000000000000000ULL, 128, IPV6_CLASS_UNSPECIFIED),
+    V6_PREFIX(0x0000000000000000ULL, 0x0000000000000001ULL, 128, IPV6_CLASS_LOOPBACK),
+    V6_PREFIX(0x0000000000000000ULL, 0x0000ffff00000000ULL, 96, IPV6_CLASS_IPV4_MAPPED),
+    V6_PREFIX(0x0064ff9b00000000ULL, 0x0000000000000000ULL, 96, IPV6_CLASS_NAT64),
+    V6_PREFIX(0x0064ff9b00010000ULL, 0x0000000000000000ULL, 48, IPV6_CLASS_NAT64),
+    V6_PREFIX(0x0100000000000000ULL, 0x0000000000000000ULL, 64, IPV6_CLASS_DISCARD),
+    // 2000::/4
+    V6_PREFIX(0x2001000000000000ULL, 0x0000000000000000ULL, 23, IPV6_CLASS_IETF_PROTOCOL),
+    V6_PREFIX(0x2001000000000000ULL, 0x0000000000000000ULL, 32, IPV6_CLASS_TEREDO),
+    V6_PREFIX(0x2001000200000000ULL, 0x0000000000000000ULL, 48, IPV6_CLASS_BENCHMARKING),
+    V6_PREFIX(0x2001001000000000ULL, 0x0000000000000000ULL, 28, IPV6_CLASS_ORCHID),
+    V6_PREFIX(0x2001002000000000ULL, 0x0000000000000000ULL, 28, IPV6_CLASS_ORCHID),
+    V6_PREFIX(0x20010db800000000ULL, 0x0000000000000000ULL, 32, IPV6_CLASS_DOCUMENTATION),
+    V6_PREFIX(0x2002000000000000ULL, 0x0000000000000000ULL, 16, IPV6_CLASS_6TO4),
+    // 3000::/4
+    V6_PREFIX(0x3fff000000000000ULL, 0x0000000000000000ULL, 20, IPV6_CLASS_DOCUMENTATION),
+    // f000::/4
+    V6_PREFIX(0xfc00000000000000ULL, 0x0000000000000000ULL, 7, IPV6_CLASS_UNIQUE_LOCAL),
+    V6_PREFIX(0xfe80000000000000ULL, 0x0000000000000000ULL, 10, IPV6_CLASS_LINK_LOCAL),
+    V6_PREFIX(0xfec0000000000000ULL, 0x0000000000000000ULL, 10, IPV6_CLASS_SITE_LOCAL),
+    V6_PREFIX(0xff00000000000000ULL, 0x0000000000000000ULL, 8, IPV6_CLASS_MULTICAST),
+};
+
+static const uint8_t classify_v6_buckets[17] = {
+    0, 6, 6, 13, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 18 };
+
+static const classify_v4_prefix_t classify_v4_prefixes[] = {
+    // 0.0.0.0/4
+    V4_PREFIX(0, 0, 0, 0, 8, IPV6_CLASS_THIS_NETWORK),
+    V4_PREFIX(10, 0, 0, 0, 8, IPV6_CLASS_PRIVATE),
+    // 96.0.0.0/4
+    V4_PREFIX(100, 64, 0, 0, 10, IPV6_CLASS_SHARED),
+    // 112.0.0.0/4
+    V4_PREFIX(127, 0, 0, 0, 8, IPV6_CLASS_LOOPBACK),
+    // 160.0.0.0/4
+    V4_PREFIX(169, 254, 0, 0, 16, IPV6_CLASS_LINK_LOCAL),
+    V4_PREFIX(172, 16, 0, 0, 12, IPV6_CLASS_PRIVATE),
+    // 192.0.0.0/4
+    V4_PREFIX(192, 0, 0, 0, 24, IPV6_CLASS_IETF_PROTOCOL),
+    V4_PREFIX(192, 0, 2, 0, 24, IPV6_CLASS_DOCUMENTATION),
+    V4_PREFIX(192, 88, 99, 0, 24, IPV6_CLASS_6TO4),
+    V4_PREFIX(192, 168, 0, 0, 16, IPV6_CLASS_PRIVATE),
+    V4_PREFIX(198, 18, 0, 0, 15, IPV6_CLASS_BENCHMARKING),
+    V4_PREFIX(198, 51, 100, 0, 24, IPV6_CLASS_DOCUMENTATION),
+    V4_PREFIX(203, 0, 113, 0, 24, IPV6_CLASS_DOCUMENTATION),
+    // 224.0.0.0/4
+    V4_PREFIX(224, 0, 0, 0, 4, IPV6_CLASS_MULTICAST),
+    // 240.0.0.0/4
+    V4_PREFIX(240, 0, 0, 0, 4, IPV6_CLASS_RESERVED),
+    V4_PREFIX(255, 255, 255, 255, 32, IPV6_CLASS_BROADCAST),
+};
+
+static const uint8_t classify_v4_buckets[17] = {
+    0, 2, 2, 2, 2, 2, 2, 3, 4, 4, 4, 6, 6, 13, 13, 14, 16 };
+
+//--------------------------------------------------------------------------------
+// Host order component i of an address in either order
+static uint64_t classify_component (const ipv6_address_full_t* in, uint32_t i)
+{
+    if (in->flags & IPV6_FLAG_NETWORK_ORDER) {
+        const uint8_t* bytes = (const uint8_t*)&in->address.components[i];
+        return ((uint64_t)bytes[0] << 8) | bytes[1];
+    }
+    return in->address.components[i];
+}
+
+//--------------------------------------------------------------------------------
+static uint32_t classify_v4 (uint32_t value)
+{
+    const uint32_t bucket = value >> 28;
+    uint32_t classes = IPV6_CLASS_IPV4;
+
+    for (uint32_t i = classify_v4_buckets[bucket]; i < classify_v4_buckets[bucket + 1]; ++i) {
+        const classify_v4_prefix_t* prefix = &classify_v4_prefixes[i];
+        const uint32_t match = (value & prefix->mask) == prefix->value;
+        classes |= prefix->classes & (0u - match);
+    }
+    return classes;
+}
+
+//--------------------------------------------------------------------------------
+static uint32_t classify_v6 (uint64_t hi, uint64_t lo)
+{
+    const uint32_t bucket = (uint32_t)(hi >> 60);
+    uint32_t classes = 0;
+
+    for (uint32_t i = classify_v6_buckets[bucket]; i < classify_v6_buckets[bucket + 1]; ++i) {
+        const classify_v6_prefix_t* prefix = &classify_v6_prefixes[i];
+        const uint32_t match = ((hi & prefix->mask_hi) == prefix->hi) & ((lo & prefix->mask_lo) == prefix->lo);
+        classes |= prefix->classes & (0u - match);
+    }
+
+    // The scope is the low nibble of the second byte of a multicast address
+    const uint32_t scope = (uint32_t)(hi >> 48) & 0xf;
+    classes |= (scope << IPV6_CLASS_SCOPE_SHIFT) & (0u - ((classes & IPV6_CLASS_MULTICAST) != 0));
+
+    // IPv4-mapped addresses are IPv4 addresses to any socket
+    if (classes & IPV6_CLASS_IPV4_MAPPED) {
+        classes |= classify_v4((uint32_t)lo);
+    }
+    return classes;
+}
+
+//--------------------------------------------------------------------------------
+uint32_t ipv6_classify (
+    const ipv6_address_full_t* in)
+{
+    if (in->flags & IPV6_FLAG_IPV4_COMPAT) {
+        return classify_v4((uint32_t)((classify_component(in, 0) << 16) | classify_component(in, 1)));
+    }
+
+    const uint64_t hi = (classify_component(in, 0) << 48) | (classify_component(in, 1) << 32) |
+        (classify_component(in, 2) << 16) | classify_component(in, 3);
+    const uint64_t lo = (classify_component(in, 4) << 48) | (classify_component(in, 5) << 32) |
+        (classify_component(in, 6) << 16) | classify_component(in, 7);
+    return classify_v6(hi, lo);
+}
+
+//--------------------------------------------------------------------------------
+void ipv6_classify_batch (
+    const ipv6_address_full_t* in,
+    size_t count,
+    uint32_t* out)
+{
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = ipv6_classify(&in[i]);
+    }
+}
+
+//--------------------------------------------------------------------------------
+const char* ipv6_class_str (
+    ipv6_class_t value)
+{
+    switch (value) {
+        case IPV6_CLASS_UNSPECIFIED:        return "unspecified";
+        case IPV6_CLASS_LOOPBACK:           return "loopback";
+        case IPV6_CLASS_LINK_LOCAL:         return "link-local";
+        case IPV6_CLASS_SITE_LOCAL:         return "site-local";
+        case IPV6_CLASS_UNIQUE_LOCAL:       return "unique-local";
+        case IPV6_CLASS_PRIVATE:            return "private";
+        case IPV6_CLASS_SHARED:             return "shared";
+        case IPV6_CLASS_MULTICAST:          return "multicast";
+        case IPV6_CLASS_DOCUMENTATION:      return "documentation";
+        case IPV6_CLASS_BENCHMARKING:       return "benchmarking";
+        case IPV6_CLASS_IPV4_MAPPED:        return "ipv4-mapped";
+        case IPV6_CLASS_NAT64:              return "nat64";
+        case IPV6_CLASS_6TO4:               return "6to4";
+        case IPV6_CLASS_TEREDO:             return "teredo";
+        case IPV6_CLASS_ORCHID:             return "orchid";
+        case IPV6_CLASS_DISCARD:            return "discard";
+        case IPV6_CLASS_IETF_PROTOCOL:      return "ietf-protocol";
+        case IPV6_CLASS_THIS_NETWORK:       return "this-network";
+        case IPV6_CLASS_RESERVED:           return "reserved";
+        case IPV6_CLASS_BROADCAST:          return "broadcast";
+        case IPV6_CLASS_IPV4:               return "ipv4";
+        default:
+            break;
+    }
+
+    return "<unknown>";
+}
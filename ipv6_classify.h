@@ -0,0 +1,92 @@
+#pragma once
+// # Address classification
+//
+//     Special-purpose address ranges of the IANA registries (RFC 6890).
+//
+// ipv6_classify returns every special-purpose range an address falls in as a
+// bitmask of ipv6_class_t. IPv4 compatible addresses (1.2.3.4) are checked
+// against the IPv4 registry and carry IPV6_CLASS_IPV4, IPv4-mapped addresses
+// (::ffff:1.2.3.4) against both. An address with no bits set is ordinary
+// global unicast.
+//
+// The ranges are a compiled table of prefixes grouped by their top four bits:
+// an address is only compared with the few prefixes of its group, each
+// compare being a masked equality test without branches.
+//
+
+#include "ipv6.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+// ### ipv6_class_t
+//
+// Classes returned by ipv6_classify, a range may set several
+//
+// ~~~~
+typedef enum {
+    IPV6_CLASS_UNSPECIFIED      = 0x00000001,   // ::, 0.0.0.0/8 is IPV6_CLASS_THIS_NETWORK
+    IPV6_CLASS_LOOPBACK         = 0x00000002,   // ::1, 127.0.0.0/8
+    IPV6_CLASS_LINK_LOCAL       = 0x00000004,   // fe80::/10, 169.254.0.0/16
+    IPV6_CLASS_SITE_LOCAL       = 0x00000008,   // fec0::/10, deprecated
+    IPV6_CLASS_UNIQUE_LOCAL     = 0x00000010,   // fc00::/7
+    IPV6_CLASS_PRIVATE          = 0x00000020,   // 10.0.0.0/8, 172.16.0.0/12, 192.168.0.0/16
+    IPV6_CLASS_SHARED           = 0x00000040,   // 100.64.0.0/10, carrier-grade NAT
+    IPV6_CLASS_MULTICAST        = 0x00000080,   // ff00::/8, 224.0.0.0/4, see IPV6_CLASS_SCOPE
+    IPV6_CLASS_DOCUMENTATION    = 0x00000100,   // 2001:db8::/32, 3fff::/20, 192.0.2.0/24, 198.51.100.0/24, 203.0.113.0/24
+    IPV6_CLASS_BENCHMARKING     = 0x00000200,   // 2001:2::/48, 198.18.0.0/15
+    IPV6_CLASS_IPV4_MAPPED      = 0x00000400,   // ::ffff:0:0/96
+    IPV6_CLASS_NAT64            = 0x00000800,   // 64:ff9b::/96 well-known, 64:ff9b:1::/48 local-use
+    IPV6_CLASS_6TO4             = 0x00001000,   // 2002::/16, 192.88.99.0/24 relay anycast
+    IPV6_CLASS_TEREDO           = 0x00002000,   // 2001::/32
+    IPV6_CLASS_ORCHID           = 0x00004000,   // 2001:10::/28, 2001:20::/28
+    IPV6_CLASS_DISCARD          = 0x00008000,   // 100::/64
+    IPV6_CLASS_IETF_PROTOCOL    = 0x00010000,   // 2001::/23, 192.0.0.0/24
+    IPV6_CLASS_THIS_NETWORK     = 0x00020000,   // 0.0.0.0/8
+    IPV6_CLASS_RESERVED         = 0x00040000,   // 240.0.0.0/4
+    IPV6_CLASS_BROADCAST        = 0x00080000,   // 255.255.255.255
+    IPV6_CLASS_IPV4             = 0x00100000,   // IPv4 address, see IPV6_FLAG_IPV4_COMPAT
+} ipv6_class_t;
+
+#define IPV6_CLASS_COUNT 21
+
+/// Scope field (RFC 4291) of an IPv6 multicast class, 0 for anything else
+#define IPV6_CLASS_SCOPE_SHIFT 28
+#define IPV6_CLASS_SCOPE(classes) (((uint32_t)(classes)) >> IPV6_CLASS_SCOPE_SHIFT)
+// ~~~~
+
+// ### ipv6_classify
+//
+// Classes of an address, in host or network order. Port, mask and zone are
+// ignored.
+//
+// ~~~~
+uint32_t ipv6_classify (
+    const ipv6_address_full_t* in);
+// ~~~~
+
+// ### ipv6_classify_batch
+//
+// ipv6_classify for count addresses
+//
+// ~~~~
+void ipv6_classify_batch (
+    const ipv6_address_full_t* in,
+    size_t count,
+    uint32_t* out);
+// ~~~~
+
+// ### ipv6_class_str
+//
+// Name of a single class bit, e.g. "link-local"
+//
+// ~~~~
+const char* ipv6_class_str (
+    ipv6_class_t value);
+// ~~~~
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,35 @@
+#pragma once
+//
+// Monotonic nanosecond clock shared by the statistics and profiling modules
+// and the benchmark. Translation units using it on POSIX must define
+// _POSIX_C_SOURCE before any system header for clock_gettime to be declared.
+//
+
+#include "ipv6_config.h"
+
+#include <stdint.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(HAVE_TIME_H)
+#include <time.h>
+#endif
+
+//--------------------------------------------------------------------------------
+// Monotonic time in nanoseconds, 0 when no clock is available
+static inline uint64_t ipv6_clock_ns (void)
+{
+#if defined(_WIN32)
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (uint64_t)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+#elif defined(HAVE_TIME_H) && defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#else
+    return 0;
+#endif
+}
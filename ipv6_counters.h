@@ -0,0 +1,101 @@
+#pragma once
+// # Parser hot-path counters
+//
+//     Counts of the parser's internal work for optimization studies.
+//
+// Built in with `cmake -DPARSE_COUNTERS=1`. The parser then counts every
+// (state, event class) transition of its state machine, the length of every
+// decimal and hexadecimal token it converts and how often the zero-run
+// shuffle at the end of a parse moves components.
+//
+// Counters are global relaxed atomic adds, so parses running on several
+// threads, e.g. in ipv6_batch.h, are all counted. A snapshot taken while
+// parses run is not a consistent cut, each counter is read on its own.
+//
+// Without PARSE_COUNTERS ipv6_counters_snapshot returns false.
+//
+// `bin/ipv6-bench --counters` prints the counters of the timed ipv6_from_str
+// rounds of each corpus.
+//
+
+#include "ipv6.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/// Number of parser states and event classes, see ipv6_counters_state_str
+#define IPV6_COUNTERS_STATES 10
+#define IPV6_COUNTERS_EVENTCLASSES 11
+
+/// Token length buckets, the last bucket counts longer tokens
+#define IPV6_COUNTERS_TOKEN_LENGTHS 8
+
+// ### ipv6_counters_token_t
+//
+// Kind of token converted by the parser
+//
+// ~~~~
+typedef enum {
+    IPV6_COUNTERS_TOKEN_HEX     = 0,    // IPv6 address component
+    IPV6_COUNTERS_TOKEN_DECIMAL = 1,    // IPv4 octet, port or CIDR mask
+} ipv6_counters_token_t;
+
+#define IPV6_COUNTERS_TOKEN_KINDS 2
+// ~~~~
+
+// ### ipv6_counters_t
+//
+// Snapshot of the counters
+//
+// ~~~~
+typedef struct {
+    uint64_t                parses;                                                         // inputs reaching the state machine
+    uint64_t                transitions[IPV6_COUNTERS_STATES][IPV6_COUNTERS_EVENTCLASSES];  // by (state, event class)
+    uint64_t                token_lengths[IPV6_COUNTERS_TOKEN_KINDS][IPV6_COUNTERS_TOKEN_LENGTHS];
+    uint64_t                zerorun_shuffles;                                               // parses running the zero-run memcpy
+    uint64_t                zerorun_empty;                                                  // shuffles moving no components, e.g. 1::
+    uint64_t                zerorun_components;                                             // components moved right of the run
+} ipv6_counters_t;
+// ~~~~
+
+
+// ### ipv6_counters_snapshot
+//
+// Copy the current counters, returns false if counters are not compiled in
+//
+// ~~~~
+bool ipv6_counters_snapshot (
+    ipv6_counters_t* counters);
+// ~~~~
+
+// ### ipv6_counters_reset
+//
+// Zero all counters
+//
+// ~~~~
+void ipv6_counters_reset (void);
+// ~~~~
+
+// ### ipv6_counters_state_str
+//
+// Name of a parser state index, e.g. "state-addr-component"
+//
+// ~~~~
+const char* ipv6_counters_state_str (
+    uint32_t state);
+// ~~~~
+
+// ### ipv6_counters_eventclass_str
+//
+// Name of an event class index, e.g. "eventclass-hex-digit"
+//
+// ~~~~
+const char* ipv6_counters_eventclass_str (
+    uint32_t eventclass);
+// ~~~~
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,337 @@
+#pragma once
+// # C++ formatting
+//
+//     std::format and fmt support for addresses, requires C++17.
+//
+// ipv6::format_to writes an address through any output iterator without an
+// intermediate buffer. The default output is identical to ipv6_to_str.
+// std::formatter is specialized when the standard library provides
+// std::format, fmt::formatter when fmt is included before this header.
+// Both cover ipv6::address and ipv6_address_full_t.
+//
+// Format spec characters, combinable in any order:
+//
+// ~~~~
+//     e   expanded, all eight components with four digits and no :: run
+//     U   uppercase hexadecimal digits, the arpa suffixes stay lowercase
+//     P   omit the port and its brackets
+//     M   omit the mask
+//     r   reverse DNS (PTR) name: nibbles under ip6.arpa, IPv4 octets under in-addr.arpa
+//
+//     fmt::format("{}", a)        // [2001:db8::1]:80
+//     fmt::format("{:eP}", a)     // 2001:0db8:0000:0000:0000:0000:0000:0001
+//     fmt::format("{:r}", a)      // 1.0.0.0.[...].8.b.d.0.1.0.0.2.ip6.arpa
+// ~~~~
+//
+
+#include "ipv6.hpp"
+
+#if __has_include(<version>)
+#include <version>
+#endif
+
+#if defined(__cpp_lib_format)
+#include <format>
+#endif
+
+namespace ipv6 {
+
+// ### ipv6::format_spec
+//
+// Parsed format spec, see the spec characters above
+//
+// ~~~~
+struct format_spec {
+    bool                    expanded = false;
+    bool                    uppercase = false;
+    bool                    no_port = false;
+    bool                    no_mask = false;
+    bool                    ptr = false;
+};
+// ~~~~
+
+namespace detail {
+
+constexpr char hex_digits[2][16] = {
+    { '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f' },
+    { '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F' },
+};
+
+//--------------------------------------------------------------------------------
+// Parse spec characters from [first, last) up to '}', returns the position of
+// the '}' or of the first unknown character with ok cleared
+template <typename It>
+constexpr It parse_format_spec (It first, It last, format_spec& spec, bool& ok) {
+    ok = true;
+    for (; first != last && *first != '}'; ++first) {
+        switch (*first) {
+            case 'e': spec.expanded = true; break;
+            case 'U': spec.uppercase = true; break;
+            case 'P': spec.no_port = true; break;
+            case 'M': spec.no_mask = true; break;
+            case 'r': spec.ptr = true; break;
+            default:
+                ok = false;
+                return first;
+        }
+    }
+    return first;
+}
+
+//--------------------------------------------------------------------------------
+template <typename OutputIt>
+constexpr OutputIt emit_string (OutputIt out, const char* s) {
+    for (; *s; ++s) {
+        *out++ = *s;
+    }
+    return out;
+}
+
+//--------------------------------------------------------------------------------
+template <typename OutputIt>
+constexpr OutputIt emit_decimal (OutputIt out, uint32_t value) {
+    uint32_t divisor = 1;
+    while (value / divisor >= 10) {
+        divisor *= 10;
+    }
+    for (; divisor; divisor /= 10) {
+        *out++ = (char)('0' + (value / divisor) % 10);
+    }
+    return out;
+}
+
+//--------------------------------------------------------------------------------
+// Component in hex, without leading zeros unless expanded
+template <typename OutputIt>
+constexpr OutputIt emit_hex (OutputIt out, uint16_t value, bool expanded, const char* digits) {
+    int shift = 12;
+    if (!expanded) {
+        while (shift > 0 && !(value >> shift)) {
+            shift -= 4;
+        }
+    }
+    for (; shift >= 0; shift -= 4) {
+        *out++ = digits[(value >> shift) & 0xf];
+    }
+    return out;
+}
+
+//--------------------------------------------------------------------------------
+template <typename OutputIt>
+constexpr OutputIt emit_ipv4 (OutputIt out, uint16_t hi, uint16_t lo) {
+    out = emit_decimal(out, (uint32_t)(hi >> 8));
+    *out++ = '.';
+    out = emit_decimal(out, (uint32_t)(hi & 0xff));
+    *out++ = '.';
+    out = emit_decimal(out, (uint32_t)(lo >> 8));
+    *out++ = '.';
+    return emit_decimal(out, (uint32_t)(lo & 0xff));
+}
+
+//--------------------------------------------------------------------------------
+template <typename OutputIt>
+constexpr OutputIt emit_ptr (OutputIt out, const ipv6_address_full_t& in, const char* digits) {
+    const uint16_t* components = in.address.components;
+
+    if (in.flags & IPV6_FLAG_IPV4_COMPAT) {
+        out = emit_decimal(out, (uint32_t)(components[1] & 0xff));
+        *out++ = '.';
+        out = emit_decimal(out, (uint32_t)(components[1] >> 8));
+        *out++ = '.';
+        out = emit_decimal(out, (uint32_t)(components[0] & 0xff));
+        *out++ = '.';
+        out = emit_decimal(out, (uint32_t)(components[0] >> 8));
+        return emit_string(out, ".in-addr.arpa");
+    }
+
+    for (int i = IPV6_NUM_COMPONENTS - 1; i >= 0; --i) {
+        for (int shift = 0; shift < 16; shift += 4) {
+            *out++ = digits[(components[i] >> shift) & 0xf];
+            *out++ = '.';
+        }
+    }
+    return emit_string(out, "ip6.arpa");
+}
+
+} // namespace detail
+
+// ### ipv6::format_to
+//
+// Write an address through an output iterator, returns the iterator past the
+// output. With a default spec the output matches ipv6_to_str, for addresses
+// in either order.
+//
+// ~~~~
+template <typename OutputIt>
+constexpr OutputIt format_to (
+    OutputIt out,
+    const ipv6_address_full_t& in,
+    const format_spec& spec = format_spec())
+// ~~~~
+{
+    // Network order addresses are formatted like ipv6_to_str does, in host order
+    const ipv6_address_full_t host = detail::host_order(in);
+    const char* digits = detail::hex_digits[spec.uppercase ? 1 : 0];
+    const uint16_t* components = host.address.components;
+    const bool port = (host.flags & IPV6_FLAG_HAS_PORT) && !spec.no_port;
+    const bool mask = (host.flags & IPV6_FLAG_HAS_MASK) && !spec.no_mask;
+
+    if (spec.ptr) {
+        return detail::emit_ptr(out, host, digits);
+    }
+
+    // IPv4 compatible addresses are a dotted quad with an optional port
+    if (host.flags & IPV6_FLAG_IPV4_COMPAT) {
+        out = detail::emit_ipv4(out, components[0], components[1]);
+        if (port) {
+            *out++ = ':';
+            out = detail::emit_decimal(out, host.port);
+        }
+        return out;
+    }
+
+    // Longest run of zero components, same selection as write_address
+    uint32_t longest_span = 0;
+    uint32_t longest_position = 0;
+    if (!spec.expanded) {
+        uint32_t spans_position = 0;
+        uint8_t spans[IPV6_NUM_COMPONENTS] = {};
+        for (uint32_t i = 0; i < IPV6_NUM_COMPONENTS; ++i) {
+            if (components[i]) {
+                if (spans[spans_position] > longest_span) {
+                    longest_position = spans_position;
+                    longest_span = spans[spans_position];
+                }
+                spans_position = i + 1;
+            } else {
+                spans[spans_position]++;
+            }
+        }
+        if (spans_position < IPV6_NUM_COMPONENTS && spans[spans_position] > longest_span) {
+            longest_position = spans_position;
+            longest_span = spans[spans_position];
+        }
+    }
+
+    if (port) {
+        *out++ = '[';
+    }
+
+    for (uint32_t i = 0; i < IPV6_NUM_COMPONENTS; ++i) {
+        const bool embed = i == 6 && (host.flags & IPV6_FLAG_IPV4_EMBED) && !spec.expanded;
+        const uint32_t first = i;
+        if (embed) {
+            i++;
+        }
+
+        if (i == longest_position && longest_span > 1) {
+            *out++ = ':';
+            if (i == 0) {
+                *out++ = ':';
+            }
+            i += longest_span - 1;
+            continue;
+        }
+
+        if (embed) {
+            out = detail::emit_ipv4(out, components[first], components[first + 1]);
+        } else {
+            out = detail::emit_hex(out, components[i], spec.expanded, digits);
+        }
+        if (i < IPV6_NUM_COMPONENTS - 1) {
+            *out++ = ':';
+        }
+    }
+
+    if (mask) {
+        *out++ = '/';
+        out = detail::emit_decimal(out, host.mask);
+    }
+
+    if (port) {
+        *out++ = ']';
+        *out++ = ':';
+        out = detail::emit_decimal(out, host.port);
+    }
+    return out;
+}
+
+//--------------------------------------------------------------------------------
+template <typename OutputIt>
+constexpr OutputIt format_to (
+    OutputIt out,
+    const address& in,
+    const format_spec& spec = format_spec())
+{
+    return format_to(out, in.native(), spec);
+}
+
+} // namespace ipv6
+
+#if defined(__cpp_lib_format)
+
+//
+// std::format support
+//
+template <>
+struct std::formatter<ipv6_address_full_t> {
+    ipv6::format_spec spec;
+
+    constexpr auto parse (std::format_parse_context& ctx) {
+        bool ok = true;
+        auto it = ipv6::detail::parse_format_spec(ctx.begin(), ctx.end(), spec, ok);
+        if (!ok) {
+            throw std::format_error("invalid ipv6 address format spec");
+        }
+        return it;
+    }
+
+    template <typename FormatContext>
+    auto format (const ipv6_address_full_t& in, FormatContext& ctx) const {
+        return ipv6::format_to(ctx.out(), in, spec);
+    }
+};
+
+template <>
+struct std::formatter<ipv6::address> : std::formatter<ipv6_address_full_t> {
+    template <typename FormatContext>
+    auto format (const ipv6::address& in, FormatContext& ctx) const {
+        return ipv6::format_to(ctx.out(), in.native(), spec);
+    }
+};
+
+#endif // __cpp_lib_format
+
+#if defined(FMT_VERSION)
+
+//
+// fmt support, include fmt/format.h before this header
+//
+template <>
+struct fmt::formatter<ipv6_address_full_t> {
+    ipv6::format_spec spec;
+
+    constexpr auto parse (fmt::format_parse_context& ctx) -> decltype(ctx.begin()) {
+        bool ok = true;
+        auto it = ipv6::detail::parse_format_spec(ctx.begin(), ctx.end(), spec, ok);
+        if (!ok) {
+            throw fmt::format_error("invalid ipv6 address format spec");
+        }
+        return it;
+    }
+
+    template <typename FormatContext>
+    auto format (const ipv6_address_full_t& in, FormatContext& ctx) const -> decltype(ctx.out()) {
+        return ipv6::format_to(ctx.out(), in, spec);
+    }
+};
+
+template <>
+struct fmt::formatter<ipv6::address> : fmt::formatter<ipv6_address_full_t> {
+    template <typename FormatContext>
+    auto format (const ipv6::address& in, FormatContext& ctx) const -> decltype(ctx.out()) {
+        return ipv6::format_to(ctx.out(), in.native(), spec);
+    }
+};
+
+#endif // FMT_VERSION
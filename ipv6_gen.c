@@ -0,0 +1,726 @@
+#include "ipv6_gen.h"
+#include "ipv6_config.h"
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <math.h>
+
+//
+// Each address is produced from a private random stream keyed by (seed, index)
+// so that any position of the corpus can be regenerated independently. The
+// address is first described as a gen_item_t, then written out in the chosen
+// form, with error injection applied as targeted mutations that are known to
+// trigger exactly one parser diagnostic.
+//
+
+//
+// Random stream for a single generated address, splitmix64
+//
+typedef struct {
+    uint64_t                state;
+} gen_rng_t;
+
+//
+// Output cursor, ipv6_gen_at guarantees the buffer holds IPV6_GEN_STRING_SIZE bytes
+//
+typedef struct {
+    char*                   wp;                 // write pointer
+    gen_rng_t*              case_rng;           // random case for hex letters, NULL for lower case
+} gen_writer_t;
+
+//
+// Intermediate description of the address to be written
+//
+typedef struct {
+    ipv6_gen_form_t         form;
+    uint16_t                components[IPV6_NUM_COMPONENTS];
+    uint32_t                v4;                 // IPv4 address or embedded value, host order
+    uint32_t                port;
+    uint32_t                mask;
+    uint32_t                zone;
+    bool                    has_port;
+    bool                    has_mask;
+    bool                    has_zone;
+    bool                    has_embed;
+} gen_item_t;
+
+#define GEN_MAX_ZIPF_PREFIXES 0x7fffffff
+
+static const char hex_lower[] = "0123456789abcdef";
+static const char hex_upper[] = "0123456789ABCDEF";
+
+// Characters that the parser never accepts outside an interface name
+static const char invalid_chars[] = "ghijklmnopqrstuvwxyzGHIJKLMNOPQRSTUVWXYZ-_!@#$^&*()+=,;\"'<>?";
+
+//--------------------------------------------------------------------------------
+static uint64_t rng_next (gen_rng_t* rng)
+{
+    uint64_t z = (rng->state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+//--------------------------------------------------------------------------------
+static uint32_t rng_range (gen_rng_t* rng, uint32_t n)
+{
+    return (uint32_t)(((rng_next(rng) >> 32) * (uint64_t)n) >> 32);
+}
+
+//--------------------------------------------------------------------------------
+// Uniform double in [0, 1)
+static double rng_unit (gen_rng_t* rng)
+{
+    return (double)(rng_next(rng) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+//--------------------------------------------------------------------------------
+static uint64_t hash64 (uint64_t a, uint64_t b)
+{
+    gen_rng_t rng;
+    rng.state = a ^ (b * 0xD1B54A32D192ED03ULL);
+    return rng_next(&rng);
+}
+
+//--------------------------------------------------------------------------------
+// Zipf sampling by rejection-inversion, W. Hormann and G. Derflinger,
+// "Rejection-inversion to generate variates from monotone discrete distributions"
+static double zipf_helper1 (double x)
+{
+    return (fabs(x) > 1e-8) ? log1p(x) / x : 1.0 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x));
+}
+
+static double zipf_helper2 (double x)
+{
+    return (fabs(x) > 1e-8) ? expm1(x) / x : 1.0 + x * 0.5 * (1.0 + x * (1.0 / 3.0) * (1.0 + 0.25 * x));
+}
+
+static double zipf_h_integral (double exponent, double x)
+{
+    const double log_x = log(x);
+    return zipf_helper2((1.0 - exponent) * log_x) * log_x;
+}
+
+static double zipf_h (double exponent, double x)
+{
+    return exp(-exponent * log(x));
+}
+
+static double zipf_h_integral_inverse (double exponent, double x)
+{
+    double t = x * (1.0 - exponent);
+    if (t < -1.0) {
+        t = -1.0;
+    }
+    return exp(zipf_helper1(t) * x);
+}
+
+//--------------------------------------------------------------------------------
+// Returns a rank in [0, prefix_count), rank 0 being the most frequent
+static uint32_t zipf_sample (const ipv6_gen_t* gen, gen_rng_t* rng)
+{
+    const double exponent = gen->config.zipf_exponent;
+    const uint32_t n = gen->config.prefix_count;
+
+    for (;;) {
+        const double u = gen->zipf_h_n + rng_unit(rng) * (gen->zipf_h_x1 - gen->zipf_h_n);
+        const double x = zipf_h_integral_inverse(exponent, u);
+        double k = floor(x + 0.5);
+        if (k < 1.0) {
+            k = 1.0;
+        } else if (k > (double)n) {
+            k = (double)n;
+        }
+        if (k - x <= gen->zipf_s
+            || u >= zipf_h_integral(exponent, k + 0.5) - zipf_h(exponent, k)) {
+            return (uint32_t)k - 1;
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------
+static void put_char (gen_writer_t* w, char c)
+{
+    *w->wp++ = c;
+}
+
+//--------------------------------------------------------------------------------
+static void put_hex (gen_writer_t* w, uint32_t value, uint32_t min_digits)
+{
+    char digits[8];
+    uint32_t n = 0;
+    do {
+        digits[n++] = (char)(value & 0xf);
+        value >>= 4;
+    } while (value && n < sizeof(digits));
+
+    while (n < min_digits) {
+        digits[n++] = 0;
+    }
+
+    while (n) {
+        const uint32_t digit = (uint32_t)digits[--n];
+        if (w->case_rng && (rng_next(w->case_rng) & 1)) {
+            put_char(w, hex_upper[digit]);
+        } else {
+            put_char(w, hex_lower[digit]);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------
+static void put_dec (gen_writer_t* w, uint32_t value)
+{
+    char digits[10];
+    uint32_t n = 0;
+    do {
+        digits[n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+
+    while (n) {
+        put_char(w, digits[--n]);
+    }
+}
+
+//--------------------------------------------------------------------------------
+// Write count octets of a dotted quad, octets beyond the 4th are taken from extra.
+// The octet at bad_index is replaced by bad_value, pass an index >= count for none.
+static void put_v4 (
+    gen_writer_t* w,
+    uint32_t v4,
+    uint32_t count,
+    uint32_t extra,
+    uint32_t bad_index,
+    uint32_t bad_value)
+{
+    for (uint32_t i = 0; i < count; ++i) {
+        if (i > 0) {
+            put_char(w, '.');
+        }
+        if (i == bad_index) {
+            put_dec(w, bad_value);
+        } else {
+            put_dec(w, (i < 4) ? (v4 >> (24 - i * 8)) & 0xff : extra);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------
+// Write count hex components, abbreviating the longest run of two or more zero
+// components when compress is set
+static void put_v6 (
+    gen_writer_t* w,
+    const uint16_t* components,
+    uint32_t count,
+    bool compress,
+    uint32_t min_digits)
+{
+    uint32_t run_start = count;
+    uint32_t run_len = 0;
+
+    if (compress) {
+        for (uint32_t i = 0; i < count; ) {
+            uint32_t len = 0;
+            while (i + len < count && components[i + len] == 0) {
+                len++;
+            }
+            if (len > run_len && len > 1) {
+                run_start = i;
+                run_len = len;
+            }
+            i += len ? len : 1;
+        }
+    }
+
+    bool need_sep = false;
+    for (uint32_t i = 0; i < count; ) {
+        if (i == run_start) {
+            put_char(w, ':');
+            put_char(w, ':');
+            i += run_len;
+            need_sep = false;
+            continue;
+        }
+        if (need_sep) {
+            put_char(w, ':');
+        }
+        put_hex(w, components[i], min_digits);
+        need_sep = true;
+        i++;
+    }
+}
+
+//--------------------------------------------------------------------------------
+// Separator between the IPv6 components and an embedded IPv4 address, unless
+// the components ended with the zero run abbreviation
+static void put_embed_separator (gen_writer_t* w, const char* output)
+{
+    if (w->wp == output || w->wp[-1] != ':') {
+        put_char(w, ':');
+    }
+}
+
+//--------------------------------------------------------------------------------
+void ipv6_gen_config_init (
+    ipv6_gen_config_t* config,
+    uint64_t seed)
+{
+    memset(config, 0, sizeof(*config));
+    config->seed = seed;
+    config->form_weights[IPV6_GEN_FORM_COMPRESSED] = 60;
+    config->form_weights[IPV6_GEN_FORM_EXPANDED] = 10;
+    config->form_weights[IPV6_GEN_FORM_MIXED_CASE] = 10;
+    config->form_weights[IPV6_GEN_FORM_IPV4] = 20;
+    config->prefix_count = 65536;
+    config->zipf_exponent = 1.0;
+    config->port_rate = 0.1;
+    config->mask_rate = 0.1;
+    config->zone_rate = 0.02;
+    config->embed_rate = 0.05;
+}
+
+//--------------------------------------------------------------------------------
+bool ipv6_gen_event_supported (
+    ipv6_diag_event_t event)
+{
+    switch (event) {
+        case IPV6_DIAG_STRING_SIZE_EXCEEDED:
+        case IPV6_DIAG_INVALID_INPUT:
+        case IPV6_DIAG_INVALID_INPUT_CHAR:
+        case IPV6_DIAG_V6_BAD_COMPONENT_COUNT:
+        case IPV6_DIAG_V4_BAD_COMPONENT_COUNT:
+        case IPV6_DIAG_V6_COMPONENT_OUT_OF_RANGE:
+        case IPV6_DIAG_V4_COMPONENT_OUT_OF_RANGE:
+        case IPV6_DIAG_INVALID_PORT:
+        case IPV6_DIAG_INVALID_CIDR_MASK:
+        case IPV6_DIAG_IPV4_REQUIRED_BITS:
+        case IPV6_DIAG_IPV4_INCORRECT_POSITION:
+        case IPV6_DIAG_INVALID_BRACKETS:
+        case IPV6_DIAG_INVALID_ABBREV:
+            return true;
+
+        // Defined by the API but not reachable from any input
+        case IPV6_DIAG_TRAILING_ZEROES:
+        case IPV6_DIAG_INVALID_DECIMAL_TOKEN:
+        case IPV6_DIAG_INVALID_HEX_TOKEN:
+        default:
+            break;
+    }
+    return false;
+}
+
+//--------------------------------------------------------------------------------
+void ipv6_gen_set_invalid_rate (
+    ipv6_gen_config_t* config,
+    double rate)
+{
+    uint32_t supported = 0;
+    for (uint32_t e = 0; e < IPV6_DIAG_EVENT_COUNT; ++e) {
+        supported += ipv6_gen_event_supported((ipv6_diag_event_t)e);
+    }
+
+    for (uint32_t e = 0; e < IPV6_DIAG_EVENT_COUNT; ++e) {
+        config->error_rates[e] = ipv6_gen_event_supported((ipv6_diag_event_t)e)
+            ? rate / supported
+            : 0.0;
+    }
+}
+
+//--------------------------------------------------------------------------------
+bool ipv6_gen_init (
+    ipv6_gen_t* gen,
+    const ipv6_gen_config_t* config)
+{
+    memset(gen, 0, sizeof(*gen));
+    gen->config = *config;
+
+    for (uint32_t f = 0; f < IPV6_GEN_FORM_COUNT; ++f) {
+        gen->form_total += config->form_weights[f];
+    }
+    if (gen->form_total == 0) {
+        return false;
+    }
+
+#define RATE_VALID(r) ((r) >= 0.0 && (r) <= 1.0)
+    if (!RATE_VALID(config->port_rate)
+        || !RATE_VALID(config->mask_rate)
+        || !RATE_VALID(config->zone_rate)
+        || !RATE_VALID(config->embed_rate)
+        || config->zipf_exponent < 0.0)
+    {
+        return false;
+    }
+
+    for (uint32_t e = 0; e < IPV6_DIAG_EVENT_COUNT; ++e) {
+        if (!RATE_VALID(config->error_rates[e])) {
+            return false;
+        }
+        if (ipv6_gen_event_supported((ipv6_diag_event_t)e)) {
+            gen->error_total += config->error_rates[e];
+        }
+    }
+    if (gen->error_total > 1.0) {
+        return false;
+    }
+#undef RATE_VALID
+
+    if (gen->config.prefix_count == 0) {
+        gen->config.prefix_count = 1;
+    }
+    if (gen->config.prefix_count > GEN_MAX_ZIPF_PREFIXES) {
+        gen->config.prefix_count = GEN_MAX_ZIPF_PREFIXES;
+    }
+
+    const double exponent = gen->config.zipf_exponent;
+    gen->zipf_h_x1 = zipf_h_integral(exponent, 1.5) - 1.0;
+    gen->zipf_h_n = zipf_h_integral(exponent, (double)gen->config.prefix_count + 0.5);
+    gen->zipf_s = 2.0 - zipf_h_integral_inverse(exponent,
+        zipf_h_integral(exponent, 2.5) - zipf_h(exponent, 2.0));
+    return true;
+}
+
+//--------------------------------------------------------------------------------
+// Choose the injected error for this address, IPV6_DIAG_EVENT_COUNT for none
+static uint32_t choose_error (const ipv6_gen_t* gen, gen_rng_t* rng)
+{
+    if (gen->error_total <= 0.0) {
+        return IPV6_DIAG_EVENT_COUNT;
+    }
+
+    double u = rng_unit(rng);
+    if (u >= gen->error_total) {
+        return IPV6_DIAG_EVENT_COUNT;
+    }
+
+    for (uint32_t e = 0; e < IPV6_DIAG_EVENT_COUNT; ++e) {
+        if (!ipv6_gen_event_supported((ipv6_diag_event_t)e)) {
+            continue;
+        }
+        if (u < gen->config.error_rates[e]) {
+            return e;
+        }
+        u -= gen->config.error_rates[e];
+    }
+    return IPV6_DIAG_EVENT_COUNT;
+}
+
+//--------------------------------------------------------------------------------
+static ipv6_gen_form_t choose_form (const ipv6_gen_t* gen, gen_rng_t* rng)
+{
+    uint32_t pick = rng_range(rng, gen->form_total);
+    for (uint32_t f = 0; f < IPV6_GEN_FORM_COUNT; ++f) {
+        if (pick < gen->config.form_weights[f]) {
+            return (ipv6_gen_form_t)f;
+        }
+        pick -= gen->config.form_weights[f];
+    }
+    return IPV6_GEN_FORM_COMPRESSED;
+}
+
+//--------------------------------------------------------------------------------
+// Fill in the address value and decorations, before any error injection
+static void build_item (
+    const ipv6_gen_t* gen,
+    gen_rng_t* rng,
+    uint32_t error,
+    gen_item_t* item)
+{
+    memset(item, 0, sizeof(*item));
+    item->form = choose_form(gen, rng);
+
+    // Errors that need a particular kind of address
+    switch (error) {
+        case IPV6_DIAG_V6_BAD_COMPONENT_COUNT:
+        case IPV6_DIAG_V6_COMPONENT_OUT_OF_RANGE:
+        case IPV6_DIAG_IPV4_REQUIRED_BITS:
+        case IPV6_DIAG_IPV4_INCORRECT_POSITION:
+        case IPV6_DIAG_INVALID_ABBREV:
+            if (item->form == IPV6_GEN_FORM_IPV4) {
+                item->form = IPV6_GEN_FORM_COMPRESSED;
+            }
+            break;
+        default:
+            break;
+    }
+
+    // Prefix locality, the same rank always maps to the same /48 (or IPv4 /16)
+    const uint32_t rank = zipf_sample(gen, rng);
+    const uint64_t prefix = hash64(gen->config.seed ^ 0x5bd1e995ULL, rank);
+    const bool v6 = item->form != IPV6_GEN_FORM_IPV4;
+
+    item->v4 = (uint32_t)(prefix >> 32) & 0xffff0000;
+    item->v4 |= (uint32_t)rng_next(rng) & 0xffff;
+
+    item->has_port = rng_unit(rng) < gen->config.port_rate;
+    item->has_mask = rng_unit(rng) < gen->config.mask_rate;
+    item->has_zone = v6 && rng_unit(rng) < gen->config.zone_rate;
+    item->has_embed = v6 && rng_unit(rng) < gen->config.embed_rate;
+    item->port = rng_range(rng, 65536);
+    item->zone = 1 + rng_range(rng, 64);
+
+    uint16_t* c = item->components;
+    if (item->has_zone) {
+        // Zones are only meaningful for link-local addresses
+        c[0] = 0xfe80;
+    } else {
+        c[0] = (uint16_t)(0x2000 | (prefix & 0x1fff));
+        c[1] = (uint16_t)(prefix >> 13);
+        c[2] = (uint16_t)(prefix >> 29);
+        c[3] = (uint16_t)rng_range(rng, 256);
+    }
+
+    // Interface identifier, most of them with a run of zeros
+    const uint64_t iid = rng_next(rng);
+    for (uint32_t i = 4; i < IPV6_NUM_COMPONENTS; ++i) {
+        c[i] = (uint16_t)(iid >> ((i - 4) * 16));
+    }
+    if (rng_range(rng, 4) != 0) {
+        const uint32_t start = 3 + rng_range(rng, 4);
+        const uint32_t len = 1 + rng_range(rng, IPV6_NUM_COMPONENTS - start);
+        for (uint32_t i = start; i < start + len; ++i) {
+            c[i] = 0;
+        }
+    }
+
+    if (item->has_embed) {
+        // Mostly IPv4-mapped, some NAT64 well-known prefix, the rest from the prefix pool
+        switch (rng_range(rng, 4)) {
+            case 0:
+            case 1:
+                memset(c, 0, 5 * sizeof(uint16_t));
+                c[5] = 0xffff;
+                break;
+            case 2:
+                memset(c, 0, 6 * sizeof(uint16_t));
+                c[0] = 0x64;
+                c[1] = 0xff9b;
+                break;
+            default:
+                break;
+        }
+    }
+
+    if (v6) {
+        item->mask = rng_range(rng, 129);
+    } else {
+        item->mask = rng_range(rng, 33);
+        // The dotted quad grammar does not allow a mask and a port together
+        if (item->has_port) {
+            item->has_mask = false;
+        }
+    }
+
+    // The zone consumes everything up to the closing bracket, so a mask cannot follow it
+    if (item->has_zone) {
+        item->has_mask = false;
+    }
+}
+
+//--------------------------------------------------------------------------------
+size_t ipv6_gen_at (
+    const ipv6_gen_t* gen,
+    uint64_t index,
+    char* output,
+    size_t output_bytes,
+    ipv6_gen_info_t* info)
+{
+    ipv6_gen_info_t local_info;
+    gen_rng_t rng;
+    gen_rng_t case_rng;
+    gen_writer_t w;
+    gen_item_t item;
+
+    if (!gen || !output || output_bytes < IPV6_GEN_STRING_SIZE) {
+        return 0;
+    }
+    if (!info) {
+        info = &local_info;
+    }
+
+    rng.state = hash64(gen->config.seed, index);
+    case_rng.state = rng_next(&rng);
+
+    const uint32_t error = choose_error(gen, &rng);
+    build_item(gen, &rng, error, &item);
+
+    // Error specific adjustments to the decorations
+    switch (error) {
+        case IPV6_DIAG_INVALID_PORT:
+            item.has_port = true;
+            item.has_mask = item.has_mask && item.form != IPV6_GEN_FORM_IPV4;
+            item.port = 65536 + rng_range(&rng, 34464);
+            break;
+
+        case IPV6_DIAG_INVALID_CIDR_MASK:
+            item.has_mask = true;
+            item.has_zone = false;
+            item.has_port = item.has_port && item.form != IPV6_GEN_FORM_IPV4;
+            item.mask = 129 + rng_range(&rng, 871);
+            break;
+
+        case IPV6_DIAG_INVALID_BRACKETS:
+            if (item.form == IPV6_GEN_FORM_IPV4) {
+                item.form = IPV6_GEN_FORM_COMPRESSED;
+                item.has_mask = false;
+            }
+            break;
+
+        case IPV6_DIAG_V4_BAD_COMPONENT_COUNT:
+        case IPV6_DIAG_V4_COMPONENT_OUT_OF_RANGE:
+        case IPV6_DIAG_IPV4_INCORRECT_POSITION:
+            if (item.form != IPV6_GEN_FORM_IPV4) {
+                item.has_embed = true;
+            }
+            break;
+
+        case IPV6_DIAG_V6_BAD_COMPONENT_COUNT:
+            item.has_embed = false;
+            break;
+
+        case IPV6_DIAG_INVALID_INPUT_CHAR:
+            // Letters are allowed in interface names
+            item.has_zone = false;
+            break;
+
+        default:
+            break;
+    }
+
+    const bool v6 = item.form != IPV6_GEN_FORM_IPV4;
+    const bool compress = item.form != IPV6_GEN_FORM_EXPANDED;
+    const uint32_t min_digits = (item.form == IPV6_GEN_FORM_EXPANDED) ? 4 : 1;
+    const bool bracket = v6 && (item.has_port || error == IPV6_DIAG_INVALID_BRACKETS);
+
+    w.wp = output;
+    w.case_rng = (item.form == IPV6_GEN_FORM_MIXED_CASE) ? &case_rng : NULL;
+
+    if (error == IPV6_DIAG_STRING_SIZE_EXCEEDED) {
+        // A fully decorated expanded address with a zone long enough to exceed the limit
+        const size_t target = IPV6_STRING_SIZE + 1 + rng_range(&rng, 8);
+        put_char(&w, '[');
+        put_v6(&w, item.components, IPV6_NUM_COMPONENTS, false, 4);
+        put_char(&w, '/');
+        put_dec(&w, 128);
+        put_char(&w, '%');
+        while ((size_t)(w.wp - output) + 7 < target) {
+            put_char(&w, (char)('0' + rng_range(&rng, 10)));
+        }
+        put_char(&w, ']');
+        put_char(&w, ':');
+        put_dec(&w, 10000 + rng_range(&rng, 55536));
+    } else {
+        if (error == IPV6_DIAG_INVALID_INPUT) {
+            put_char(&w, '%');
+        }
+        if (bracket) {
+            put_char(&w, '[');
+        }
+        if (error == IPV6_DIAG_INVALID_BRACKETS) {
+            put_char(&w, '[');
+        }
+        if (error == IPV6_DIAG_V6_COMPONENT_OUT_OF_RANGE) {
+            put_hex(&w, 0x10000 + rng_range(&rng, 0xf0000), 5);
+            put_char(&w, ':');
+        }
+
+        // Address core
+        uint32_t v4_octets = 4;
+        uint32_t bad_octet = 4;
+        uint32_t bad_value = 0;
+        if (error == IPV6_DIAG_V4_BAD_COMPONENT_COUNT) {
+            v4_octets = rng_range(&rng, 2) ? 3 : 5;
+        }
+        if (error == IPV6_DIAG_V4_COMPONENT_OUT_OF_RANGE) {
+            bad_octet = rng_range(&rng, 4);
+            bad_value = 256 + rng_range(&rng, 744);
+        }
+
+        if (!v6) {
+            put_v4(&w, item.v4, v4_octets, rng_range(&rng, 256), bad_octet, bad_value);
+        } else if (error == IPV6_DIAG_V6_BAD_COMPONENT_COUNT) {
+            uint16_t components[IPV6_NUM_COMPONENTS + 1];
+            memcpy(components, item.components, sizeof(item.components));
+            components[IPV6_NUM_COMPONENTS] = (uint16_t)rng_next(&rng);
+            put_v6(&w, components, rng_range(&rng, 2) ? 7 : 9, false, min_digits);
+        } else if (error == IPV6_DIAG_IPV4_REQUIRED_BITS) {
+            // Seven components leave no room for the embedding
+            put_v6(&w, item.components, 7, false, min_digits);
+            put_char(&w, ':');
+            put_v4(&w, item.v4, 4, 0, 4, 0);
+        } else if (error == IPV6_DIAG_INVALID_ABBREV) {
+            put_hex(&w, item.components[0], min_digits);
+            put_char(&w, ':');
+            put_hex(&w, item.components[1], min_digits);
+            put_char(&w, ':');
+            put_char(&w, ':');
+            put_hex(&w, item.components[4] | 1, min_digits);
+            put_char(&w, ':');
+            put_char(&w, ':');
+            put_hex(&w, item.components[7] | 1, min_digits);
+        } else if (item.has_embed) {
+            put_v6(&w, item.components, IPV6_NUM_COMPONENTS - IPV4_NUM_COMPONENTS, compress, min_digits);
+            put_embed_separator(&w, output);
+            put_v4(&w, item.v4, v4_octets, rng_range(&rng, 256), bad_octet, bad_value);
+        } else {
+            put_v6(&w, item.components, IPV6_NUM_COMPONENTS, compress, min_digits);
+        }
+
+        if (error == IPV6_DIAG_IPV4_INCORRECT_POSITION) {
+            // An IPv6 component after the embedded address
+            put_char(&w, ':');
+            put_hex(&w, 0xa + rng_range(&rng, 0xfff6), min_digits);
+        }
+
+        if (item.has_mask) {
+            put_char(&w, '/');
+            if (!v6 && item.mask <= 32 && (item.mask & 1)) {
+                // Odd IPv4 mask lengths are written as dotted netmasks
+                put_v4(&w, ~0u << (32 - item.mask), 4, 0, 4, 0);
+            } else {
+                put_dec(&w, item.mask);
+            }
+        }
+        if (item.has_zone) {
+            // Half the zones are interface names, the others scope ids
+            put_char(&w, '%');
+            if (item.zone > 32) {
+                put_char(&w, 'e');
+                put_char(&w, 'n');
+            }
+            put_dec(&w, item.zone);
+        }
+        if (bracket) {
+            put_char(&w, ']');
+        }
+        if (item.has_port) {
+            put_char(&w, ':');
+            put_dec(&w, item.port);
+        }
+    }
+
+    const size_t length = (size_t)(w.wp - output);
+    *w.wp = '\0';
+
+    if (error == IPV6_DIAG_INVALID_INPUT_CHAR) {
+        output[rng_range(&rng, (uint32_t)length)] =
+            invalid_chars[rng_range(&rng, (uint32_t)(sizeof(invalid_chars) - 1))];
+    }
+
+    info->form = item.form;
+    info->zone = item.has_zone;
+    info->valid = error == IPV6_DIAG_EVENT_COUNT;
+    info->expected_event = info->valid ? IPV6_DIAG_INVALID_INPUT : (ipv6_diag_event_t)error;
+    info->flags = 0;
+    if (info->valid) {
+        info->flags |= item.has_port ? IPV6_FLAG_HAS_PORT : 0;
+        info->flags |= item.has_mask ? IPV6_FLAG_HAS_MASK : 0;
+        info->flags |= item.has_embed ? IPV6_FLAG_IPV4_EMBED : 0;
+        info->flags |= v6 ? 0 : IPV6_FLAG_IPV4_COMPAT;
+        info->flags |= item.has_zone && item.zone <= 32 ? IPV6_FLAG_ZONE_ID : 0;
+    }
+
+    return length;
+}
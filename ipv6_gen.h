@@ -0,0 +1,157 @@
+#pragma once
+// # Synthetic address corpus generator
+//
+//     Deterministic generator of address strings for benchmarks, fuzzing and
+//     cache experiments.
+//
+// Every generated string is a pure function of (config, index), there is no
+// sequential state. A corpus of any size can be regenerated, split between
+// threads or sampled at random positions without storing fixture files.
+//
+// The generator controls:
+//
+// - Text form: compressed (RFC 5952), expanded, mixed case or IPv4 dotted quad
+// - Decoration rates: `[...]:port`, `/mask`, `%zone` and embedded IPv4
+// - Prefix locality: a Zipfian distribution over /48 prefixes (/16 for IPv4)
+// - Error injection: a rate for each ipv6_diag_event_t the parser emits
+//
+
+#include "ipv6.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/// Buffer size that is always sufficient for ipv6_gen_at
+#define IPV6_GEN_STRING_SIZE 96
+
+// ### ipv6_gen_form_t
+//
+// Text form of a generated address, weighted by ipv6_gen_config_t.form_weights
+//
+// ~~~~
+typedef enum {
+    IPV6_GEN_FORM_COMPRESSED    = 0,    // canonical text, longest zero run abbreviated
+    IPV6_GEN_FORM_EXPANDED      = 1,    // all 8 components with 4 digits each
+    IPV6_GEN_FORM_MIXED_CASE    = 2,    // compressed with random upper/lower case digits
+    IPV6_GEN_FORM_IPV4          = 3,    // IPv4 dotted quad
+} ipv6_gen_form_t;
+
+#define IPV6_GEN_FORM_COUNT 4
+// ~~~~
+
+// ### ipv6_gen_config_t
+//
+// Generator settings, use ipv6_gen_config_init for defaults. Rates are
+// probabilities in [0, 1] applied independently per address.
+//
+// Error rates are indexed by ipv6_diag_event_t, each rate is the probability
+// that an address is mutated to fail with exactly that event. Events the
+// parser never emits (see ipv6_gen_event_supported) are ignored.
+//
+// ~~~~
+typedef struct {
+    uint64_t                seed;                               // stream selector
+    uint32_t                form_weights[IPV6_GEN_FORM_COUNT];  // relative weight of each form
+    uint32_t                prefix_count;                       // number of distinct /48 prefixes
+    double                  zipf_exponent;                      // prefix skew, 0 is uniform
+    double                  port_rate;                          // [addr]:port, a.b.c.d:port
+    double                  mask_rate;                          // addr/N
+    double                  zone_rate;                          // fe80::x%zone (IPv6 forms only)
+    double                  embed_rate;                         // x::a.b.c.d (IPv6 forms only)
+    double                  error_rates[IPV6_DIAG_EVENT_COUNT]; // per diagnostic event
+} ipv6_gen_config_t;
+// ~~~~
+
+// ### ipv6_gen_t
+//
+// Initialized generator, read-only after ipv6_gen_init so it can be shared
+// between threads.
+//
+// ~~~~
+typedef struct {
+    ipv6_gen_config_t       config;
+    uint32_t                form_total;         // sum of form weights
+    double                  error_total;        // sum of supported error rates
+    double                  zipf_h_x1;          // rejection-inversion sampling constants
+    double                  zipf_h_n;
+    double                  zipf_s;
+} ipv6_gen_t;
+// ~~~~
+
+// ### ipv6_gen_info_t
+//
+// Description of a generated address, the expected outcome of parsing it
+//
+// ~~~~
+typedef struct {
+    ipv6_gen_form_t         form;               // text form
+    uint32_t                flags;              // ipv6_flag_t set by a successful parse
+    bool                    valid;              // the string parses successfully
+    bool                    zone;               // the string has a %zone suffix
+    ipv6_diag_event_t       expected_event;     // diagnostic expected when !valid
+} ipv6_gen_info_t;
+// ~~~~
+
+
+// ### ipv6_gen_config_init
+//
+// Default configuration: mostly compressed IPv6 with some IPv4, light
+// decoration, 65536 prefixes with a Zipf exponent of 1 and no errors.
+//
+// ~~~~
+void ipv6_gen_config_init (
+    ipv6_gen_config_t* config,
+    uint64_t seed);
+// ~~~~
+
+// ### ipv6_gen_init
+//
+// Validate the configuration and precompute sampling constants.
+// Returns false if all form weights are zero or a rate is outside [0, 1].
+//
+// ~~~~
+bool ipv6_gen_init (
+    ipv6_gen_t* gen,
+    const ipv6_gen_config_t* config);
+// ~~~~
+
+// ### ipv6_gen_set_invalid_rate
+//
+// Spread a total error rate evenly over every supported diagnostic event
+//
+// ~~~~
+void ipv6_gen_set_invalid_rate (
+    ipv6_gen_config_t* config,
+    double rate);
+// ~~~~
+
+// ### ipv6_gen_event_supported
+//
+// True if the parser can emit the event and the generator can inject it
+//
+// ~~~~
+bool ipv6_gen_event_supported (
+    ipv6_diag_event_t event);
+// ~~~~
+
+// ### ipv6_gen_at
+//
+// Write the address at position index of the stream to output, which must
+// hold at least IPV6_GEN_STRING_SIZE bytes. The info argument is optional.
+//
+// Returns the string length excluding the nul byte, 0 if output is too small.
+//
+// ~~~~
+size_t ipv6_gen_at (
+    const ipv6_gen_t* gen,
+    uint64_t index,
+    char* output,
+    size_t output_bytes,
+    ipv6_gen_info_t* info);
+// ~~~~
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
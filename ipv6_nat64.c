@@ -0,0 +1,185 @@
+#include "ipv6_nat64.h"
+#include "ipv6_config.h"
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+//
+// Addresses are handled as two host order 64 bit halves, bit 0 of the
+// address being the top bit of hi. The u-octet is the top byte of lo.
+//
+typedef struct {
+    uint64_t                    hi;
+    uint64_t                    lo;
+} nat64_bits_t;
+
+//--------------------------------------------------------------------------------
+static bool nat64_prefix_len_valid (uint32_t prefix_len)
+{
+    switch (prefix_len) {
+        case 32: case 40: case 48: case 56: case 64: case 96:
+            return true;
+        default:
+            return false;
+    }
+}
+
+//--------------------------------------------------------------------------------
+// Host order bits of an address, and its normalized flags
+static uint32_t nat64_load (const ipv6_address_full_t* in, nat64_bits_t* bits)
+{
+    ipv6_address_full_t normalized;
+    ipv6_normalize(in, &normalized);
+
+    const uint16_t* c = normalized.address.components;
+    bits->hi = ((uint64_t)c[0] << 48) | ((uint64_t)c[1] << 32) | ((uint64_t)c[2] << 16) | c[3];
+    bits->lo = ((uint64_t)c[4] << 48) | ((uint64_t)c[5] << 32) | ((uint64_t)c[6] << 16) | c[7];
+    return normalized.flags;
+}
+
+//--------------------------------------------------------------------------------
+static void nat64_store (const nat64_bits_t* bits, ipv6_address_full_t* out)
+{
+    for (uint32_t i = 0; i < 4; ++i) {
+        out->address.components[i] = (uint16_t)(bits->hi >> (48 - 16 * i));
+        out->address.components[i + 4] = (uint16_t)(bits->lo >> (48 - 16 * i));
+    }
+}
+
+//--------------------------------------------------------------------------------
+// Keep the first prefix_len bits
+static void nat64_mask (nat64_bits_t* bits, uint32_t prefix_len)
+{
+    bits->hi &= prefix_len >= 64 ? ~0ULL : ~(~0ULL >> prefix_len);
+    bits->lo &= prefix_len <= 64 ? 0ULL : ~(~0ULL >> (prefix_len - 64));
+}
+
+//--------------------------------------------------------------------------------
+static void nat64_embed (nat64_bits_t* bits, uint32_t prefix_len, uint32_t ipv4)
+{
+    if (prefix_len == 96) {
+        bits->lo |= ipv4;
+    } else if (prefix_len == 64) {
+        bits->lo |= (uint64_t)ipv4 << 24;
+    } else {
+        // The high bits end the first half, the rest follow the u-octet
+        const uint32_t high_bits = 64 - prefix_len;
+        const uint32_t low_bits = 32 - high_bits;
+        bits->hi |= (uint64_t)ipv4 >> low_bits;
+        bits->lo |= ((uint64_t)ipv4 & ((1ULL << low_bits) - 1)) << (56 - low_bits);
+    }
+}
+
+//--------------------------------------------------------------------------------
+static uint32_t nat64_embedded (const nat64_bits_t* bits, uint32_t prefix_len)
+{
+    if (prefix_len == 96) {
+        return (uint32_t)bits->lo;
+    }
+    if (prefix_len == 64) {
+        return (uint32_t)(bits->lo >> 24);
+    }
+
+    const uint32_t high_bits = 64 - prefix_len;
+    const uint32_t low_bits = 32 - high_bits;
+    return (uint32_t)(((bits->hi & ((1ULL << high_bits) - 1)) << low_bits) |
+        ((bits->lo >> (56 - low_bits)) & ((1ULL << low_bits) - 1)));
+}
+
+//--------------------------------------------------------------------------------
+bool ipv6_nat64_synthesize (
+    const ipv6_address_full_t* prefix,
+    uint32_t prefix_len,
+    const ipv6_address_full_t* ipv4,
+    ipv6_address_full_t* out)
+{
+    nat64_bits_t v4_bits;
+    nat64_bits_t bits;
+    const uint32_t v4_flags = nat64_load(ipv4, &v4_bits);
+    const uint16_t port = ipv4->port;
+
+    nat64_load(prefix, &bits);
+    memset(out, 0, sizeof(*out));
+
+    // Normalized IPv4 addresses are IPv4-mapped
+    if (!nat64_prefix_len_valid(prefix_len) || !(v4_flags & IPV6_FLAG_IPV4_EMBED)) {
+        return false;
+    }
+
+    nat64_mask(&bits, prefix_len);
+    nat64_embed(&bits, prefix_len, (uint32_t)v4_bits.lo);
+    nat64_store(&bits, out);
+    out->port = port;
+    out->flags = (v4_flags & IPV6_FLAG_HAS_PORT) | (prefix_len == 96 ? IPV6_FLAG_IPV4_EMBED : 0);
+    return true;
+}
+
+//--------------------------------------------------------------------------------
+bool ipv6_nat64_extract (
+    const ipv6_address_full_t* in,
+    const ipv6_address_full_t* prefix,
+    uint32_t prefix_len,
+    ipv6_address_full_t* out)
+{
+    nat64_bits_t bits;
+    const uint32_t flags = nat64_load(in, &bits);
+    const uint16_t port = in->port;
+    bool valid = nat64_prefix_len_valid(prefix_len) && (prefix_len == 96 || (bits.lo >> 56) == 0);
+
+    if (valid && prefix) {
+        nat64_bits_t expected;
+        nat64_bits_t masked = bits;
+        nat64_load(prefix, &expected);
+        nat64_mask(&expected, prefix_len);
+        nat64_mask(&masked, prefix_len);
+        valid = masked.hi == expected.hi && masked.lo == expected.lo;
+    }
+
+    memset(out, 0, sizeof(*out));
+    if (!valid) {
+        return false;
+    }
+
+    const uint32_t ipv4 = nat64_embedded(&bits, prefix_len);
+    out->address.components[0] = (uint16_t)(ipv4 >> 16);
+    out->address.components[1] = (uint16_t)ipv4;
+    out->port = port;
+    out->flags = IPV6_FLAG_IPV4_COMPAT | (flags & IPV6_FLAG_HAS_PORT);
+    return true;
+}
+
+//--------------------------------------------------------------------------------
+size_t ipv6_nat64_synthesize_batch (
+    const ipv6_address_full_t* prefix,
+    uint32_t prefix_len,
+    const ipv6_address_full_t* ipv4,
+    size_t count,
+    ipv6_address_full_t* out)
+{
+    size_t synthesized = 0;
+    for (size_t i = 0; i < count; ++i) {
+        synthesized += ipv6_nat64_synthesize(prefix, prefix_len, &ipv4[i], &out[i]);
+    }
+    return synthesized;
+}
+
+//--------------------------------------------------------------------------------
+size_t ipv6_nat64_extract_batch (
+    const ipv6_address_full_t* in,
+    size_t count,
+    const ipv6_address_full_t* prefix,
+    uint32_t prefix_len,
+    ipv6_address_full_t* out,
+    bool* extracted)
+{
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const bool ok = ipv6_nat64_extract(&in[i], prefix, prefix_len, &out[i]);
+        if (extracted) {
+            extracted[i] = ok;
+        }
+        total += ok;
+    }
+    return total;
+}
@@ -0,0 +1,95 @@
+#pragma once
+// # NAT64 addresses
+//
+//     Embed IPv4 addresses in NAT64 prefixes and extract them (RFC 6052).
+//
+// A DNS64 resolver synthesizes an IPv6 address from an IPv4 address and a
+// NAT64 prefix of 32, 40, 48, 56, 64 or 96 bits; a NAT64 translator or log
+// correlator recovers the IPv4 address from it. The IPv4 bits follow the
+// prefix and skip bits 64 to 71, the u-octet, which is always zero:
+//
+//      /32  prefix:v4(32):u:suffix
+//      /40  prefix:v4(24):u:v4(8):suffix
+//      /48  prefix:v4(16):u:v4(16):suffix
+//      /56  prefix:v4(8):u:v4(24):suffix
+//      /64  prefix:u:v4(32):suffix
+//      /96  prefix:v4(32)
+//
+// The bits are placed with shifts on the address as two 64 bit halves, no
+// text formatting is involved. Addresses in host or network order are
+// accepted, results are in host order.
+//
+
+#include "ipv6.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/// Well-known prefix 64:ff9b::/96 (RFC 6052)
+#define IPV6_NAT64_WELL_KNOWN_LENGTH 96
+
+// ### ipv6_nat64_synthesize
+//
+// Embed ipv4, an IPv4 compatible (1.2.3.4) or IPv4-mapped (::ffff:1.2.3.4)
+// address, in the first prefix_len bits of prefix. The port of ipv4 is kept.
+// /96 results are flagged IPV6_FLAG_IPV4_EMBED so they format as
+// 64:ff9b::1.2.3.4. Returns false for other prefix lengths or if ipv4 is
+// not an IPv4 address, out is zeroed then.
+//
+// ~~~~
+bool ipv6_nat64_synthesize (
+    const ipv6_address_full_t* prefix,
+    uint32_t prefix_len,
+    const ipv6_address_full_t* ipv4,
+    ipv6_address_full_t* out);
+// ~~~~
+
+// ### ipv6_nat64_extract
+//
+// Recover the IPv4 address embedded in in with a prefix_len bit prefix, as an
+// IPv4 compatible address with the port of in. When prefix is not NULL, in
+// must start with its first prefix_len bits. Returns false for other prefix
+// lengths, a non-zero u-octet or a prefix mismatch, out is zeroed then.
+//
+// ~~~~
+bool ipv6_nat64_extract (
+    const ipv6_address_full_t* in,
+    const ipv6_address_full_t* prefix,
+    uint32_t prefix_len,
+    ipv6_address_full_t* out);
+// ~~~~
+
+// ### ipv6_nat64_synthesize_batch
+//
+// ipv6_nat64_synthesize of count IPv4 addresses with one prefix, returns the
+// number synthesized
+//
+// ~~~~
+size_t ipv6_nat64_synthesize_batch (
+    const ipv6_address_full_t* prefix,
+    uint32_t prefix_len,
+    const ipv6_address_full_t* ipv4,
+    size_t count,
+    ipv6_address_full_t* out);
+// ~~~~
+
+// ### ipv6_nat64_extract_batch
+//
+// ipv6_nat64_extract of count addresses with one prefix, extracted[i]
+// records each outcome and may be NULL. Returns the number extracted.
+//
+// ~~~~
+size_t ipv6_nat64_extract_batch (
+    const ipv6_address_full_t* in,
+    size_t count,
+    const ipv6_address_full_t* prefix,
+    uint32_t prefix_len,
+    ipv6_address_full_t* out,
+    bool* extracted);
+// ~~~~
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
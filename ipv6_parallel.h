@@ -0,0 +1,69 @@
+#pragma once
+//
+// Threads and the work-stealing loop over chunk indices shared by the batch,
+// validation and pipeline modules. Not part of the public API.
+//
+
+#include "ipv6_batch.h"
+
+#if defined(_WIN32)
+typedef void* ipv6_thread_t;
+#else
+#include <pthread.h>
+typedef pthread_t ipv6_thread_t;
+#endif
+
+typedef void (*ipv6_thread_func_t) (
+    void* arg);
+
+//--------------------------------------------------------------------------------
+// Start func(arg) on a new thread, false if the thread could not be started
+bool ipv6_thread_start (
+    ipv6_thread_t* thread,
+    ipv6_thread_func_t func,
+    void* arg);
+
+//--------------------------------------------------------------------------------
+void ipv6_thread_join (
+    ipv6_thread_t thread);
+
+//--------------------------------------------------------------------------------
+// Give up the rest of the time slice, for waits that outlast a short spin
+void ipv6_thread_yield (void);
+
+//--------------------------------------------------------------------------------
+uint32_t ipv6_cpu_count (void);
+
+//
+// Body of a parallel loop, called once for every chunk by some worker
+//
+typedef void (*ipv6_chunk_func_t) (
+    void* arg,
+    uint32_t worker,
+    size_t chunk);
+
+//--------------------------------------------------------------------------------
+// Number of workers a loop over chunks will use, callers size per worker
+// state with it. threads is 0 for one per CPU, executor may be NULL.
+uint32_t ipv6_parallel_workers (
+    uint32_t threads,
+    const ipv6_executor_t* executor,
+    size_t chunks);
+
+//--------------------------------------------------------------------------------
+// Chunk size for count items, at least requested and never more chunks than
+// a worker range can index
+size_t ipv6_parallel_chunk_size (
+    size_t count,
+    size_t requested);
+
+//--------------------------------------------------------------------------------
+// Run func for every chunk in [0, chunks) on workers workers, returns when all
+// chunks are done. Falls back to the calling thread for anything that cannot
+// be started.
+void ipv6_parallel_for (
+    uint32_t workers,
+    size_t chunks,
+    const ipv6_executor_t* executor,
+    ipv6_chunk_func_t func,
+    void* arg);
@@ -0,0 +1,524 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L // clock_gettime
+#endif
+
+#include "ipv6_pipeline.h"
+#include "ipv6_parallel.h"
+#include "ipv6_clock.h"
+#include "ipv6_config.h"
+
+#ifdef HAVE_STDIO_H
+#include <stdio.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <stdlib.h>
+
+//
+// Batches circulate through three rings: free (sink to reader), parse (reader
+// to workers) and done (workers to sink). The rings are bounded MPMC queues
+// of batch pointers, each cell carrying a sequence number that tells
+// producers and consumers whose turn it is. A NULL batch is the end marker,
+// the reader sends one per worker and every worker passes it on to the sink.
+// Workers finish batches out of order, the sink puts them back in order by
+// batch number before calling the sink function.
+//
+#if defined(_MSC_VER)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#define PIPELINE_LOAD(p) ((uint64_t)InterlockedCompareExchange64((volatile LONG64*)(p), 0, 0))
+#define PIPELINE_STORE(p, v) InterlockedExchange64((volatile LONG64*)(p), (LONG64)(v))
+#define PIPELINE_CAS(p, expected, desired) \
+    ((uint64_t)InterlockedCompareExchange64((volatile LONG64*)(p), (LONG64)(desired), (LONG64)(expected)) == (expected))
+#else
+#define PIPELINE_LOAD(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define PIPELINE_STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define PIPELINE_CAS(p, expected, desired) \
+    __atomic_compare_exchange_n((p), &(expected), (desired), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#endif
+
+#define PIPELINE_CACHE_LINE 64
+#define PIPELINE_READ_BYTES (64 * 1024)
+#define PIPELINE_SPINS 64
+
+// Average line bytes a batch arena is sized for, a full arena ends the batch early
+#define PIPELINE_AVERAGE_LINE 48
+
+typedef struct {
+    uint64_t                    seq;
+    void*                       value;
+} pipeline_cell_t;
+
+typedef struct {
+    pipeline_cell_t*            cells;
+    uint64_t                    mask;
+    uint8_t                     pad0[PIPELINE_CACHE_LINE];
+    uint64_t                    head;               // next cell to pop
+    uint8_t                     pad1[PIPELINE_CACHE_LINE];
+    uint64_t                    tail;               // next cell to push
+    uint8_t                     pad2[PIPELINE_CACHE_LINE];
+} pipeline_ring_t;
+
+typedef struct {
+    uint64_t                    seq;                // batch number in input order
+    ipv6_pipeline_batch_t       view;               // what the sink sees
+    const char**                inputs;
+    uint32_t*                   lengths;
+    ipv6_address_full_t*        addresses;
+    bool*                       parsed;
+    ipv6_diag_result_t*         diags;
+    char*                       arena;              // line text
+    size_t                      arena_bytes;
+} pipeline_batch_t;
+
+//
+// Parse worker with its own counters
+//
+typedef struct pipeline_t pipeline_t;
+
+typedef struct {
+    pipeline_t*                 pipeline;
+    ipv6_pipeline_stage_t       stats;
+    uint8_t                     pad[PIPELINE_CACHE_LINE];
+} pipeline_worker_t;
+
+struct pipeline_t {
+    const ipv6_pipeline_config_t* config;
+    uint32_t                    batch_size;
+    uint32_t                    batch_count;
+    uint32_t                    workers;            // workers started
+    pipeline_batch_t*           batches;
+    pipeline_batch_t**          pending;            // sink reorder window, by seq % batch_count
+    pipeline_worker_t*          worker_state;
+    ipv6_thread_t*              threads;
+    pipeline_ring_t             free_ring;
+    pipeline_ring_t             parse_ring;
+    pipeline_ring_t             done_ring;
+
+    // Reader state
+    char*                       read_buffer;
+    size_t                      read_pos;
+    size_t                      read_end;
+    bool                        read_eof;
+    uint64_t                    next_line;
+    uint64_t                    next_seq;
+    ipv6_pipeline_stage_t       reader;
+    ipv6_pipeline_stage_t       parser;             // parsing on the calling thread
+    ipv6_pipeline_stage_t       sink;
+};
+
+//--------------------------------------------------------------------------------
+static bool pipeline_ring_init (pipeline_ring_t* ring, uint32_t min_capacity)
+{
+    uint64_t capacity = 2;
+    while (capacity < min_capacity) {
+        capacity *= 2;
+    }
+
+    memset(ring, 0, sizeof(*ring));
+    ring->cells = (pipeline_cell_t*)malloc((size_t)capacity * sizeof(pipeline_cell_t));
+    if (!ring->cells) {
+        return false;
+    }
+    for (uint64_t i = 0; i < capacity; ++i) {
+        ring->cells[i].seq = i;
+        ring->cells[i].value = NULL;
+    }
+    ring->mask = capacity - 1;
+    return true;
+}
+
+//--------------------------------------------------------------------------------
+static bool pipeline_ring_push (pipeline_ring_t* ring, void* value)
+{
+    uint64_t pos = PIPELINE_LOAD(&ring->tail);
+    for (;;) {
+        pipeline_cell_t* cell = &ring->cells[pos & ring->mask];
+        const uint64_t seq = PIPELINE_LOAD(&cell->seq);
+        const int64_t diff = (int64_t)(seq - pos);
+        if (diff == 0) {
+            if (PIPELINE_CAS(&ring->tail, pos, pos + 1)) {
+                cell->value = value;
+                PIPELINE_STORE(&cell->seq, pos + 1);
+                return true;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = PIPELINE_LOAD(&ring->tail);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------
+static bool pipeline_ring_pop (pipeline_ring_t* ring, void** value)
+{
+    uint64_t pos = PIPELINE_LOAD(&ring->head);
+    for (;;) {
+        pipeline_cell_t* cell = &ring->cells[pos & ring->mask];
+        const uint64_t seq = PIPELINE_LOAD(&cell->seq);
+        const int64_t diff = (int64_t)(seq - (pos + 1));
+        if (diff == 0) {
+            if (PIPELINE_CAS(&ring->head, pos, pos + 1)) {
+                *value = cell->value;
+                PIPELINE_STORE(&cell->seq, pos + ring->mask + 1);
+                return true;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = PIPELINE_LOAD(&ring->head);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------
+// Spin briefly, then yield, until the ring accepts the value
+static void pipeline_push_wait (pipeline_ring_t* ring, void* value, ipv6_pipeline_stage_t* stage)
+{
+    if (pipeline_ring_push(ring, value)) {
+        return;
+    }
+
+    const uint64_t start = ipv6_clock_ns();
+    for (uint32_t spins = 0; !pipeline_ring_push(ring, value); ++spins) {
+        if (spins >= PIPELINE_SPINS) {
+            ipv6_thread_yield();
+        }
+    }
+    stage->stall_ns += ipv6_clock_ns() - start;
+}
+
+//--------------------------------------------------------------------------------
+static void* pipeline_pop_wait (pipeline_ring_t* ring, ipv6_pipeline_stage_t* stage)
+{
+    void* value;
+    if (pipeline_ring_pop(ring, &value)) {
+        return value;
+    }
+
+    const uint64_t start = ipv6_clock_ns();
+    for (uint32_t spins = 0; !pipeline_ring_pop(ring, &value); ++spins) {
+        if (spins >= PIPELINE_SPINS) {
+            ipv6_thread_yield();
+        }
+    }
+    stage->stall_ns += ipv6_clock_ns() - start;
+    return value;
+}
+
+//--------------------------------------------------------------------------------
+// Cut the next lines of input into a batch, returns false at the end of input
+static bool pipeline_fill (pipeline_t* pipeline, pipeline_batch_t* batch)
+{
+    const uint64_t start = ipv6_clock_ns();
+    size_t used = 0;
+    size_t count = 0;
+
+    batch->seq = pipeline->next_seq;
+    batch->view.first_line = pipeline->next_line;
+
+    // A line only starts where the arena can hold the longest line
+    while (count < pipeline->batch_size && batch->arena_bytes - used >= IPV6_PIPELINE_MAX_LINE) {
+        char* line = batch->arena + used;
+        size_t length = 0;
+        bool found = false;
+        bool ended = false;
+
+        while (!ended) {
+            if (pipeline->read_pos == pipeline->read_end) {
+                if (pipeline->read_eof) {
+                    break;
+                }
+                const size_t got = pipeline->config->read(pipeline->config->read_context,
+                    pipeline->read_buffer, PIPELINE_READ_BYTES);
+                pipeline->read_eof = got == 0;
+                pipeline->read_pos = 0;
+                pipeline->read_end = got;
+                pipeline->reader.bytes += got;
+                continue;
+            }
+
+            const char* cp = pipeline->read_buffer + pipeline->read_pos;
+            const size_t available = pipeline->read_end - pipeline->read_pos;
+            const char* nl = (const char*)memchr(cp, '\n', available);
+            const size_t segment = nl ? (size_t)(nl - cp) : available;
+            const size_t kept = segment < IPV6_PIPELINE_MAX_LINE - length ? segment : IPV6_PIPELINE_MAX_LINE - length;
+
+            memcpy(line + length, cp, kept);
+            length += kept;
+            found = true;
+            ended = nl != NULL;
+            pipeline->read_pos += nl ? segment + 1 : segment;
+        }
+
+        if (!found) {
+            break;
+        }
+        if (length && line[length - 1] == '\r') {
+            length--;
+        }
+
+        batch->inputs[count] = line;
+        batch->lengths[count] = (uint32_t)length;
+        used += length;
+        count++;
+    }
+
+    batch->view.count = count;
+    pipeline->next_line += count;
+    if (count) {
+        pipeline->next_seq++;
+        pipeline->reader.batches++;
+        pipeline->reader.lines += count;
+    }
+    pipeline->reader.busy_ns += ipv6_clock_ns() - start;
+    return count != 0;
+}
+
+//--------------------------------------------------------------------------------
+static void pipeline_parse (pipeline_batch_t* batch, ipv6_pipeline_stage_t* stage)
+{
+    const uint64_t start = ipv6_clock_ns();
+
+    for (size_t i = 0; i < batch->view.count; ++i) {
+        batch->parsed[i] = ipv6_from_str_compact(batch->inputs[i], batch->lengths[i],
+            &batch->addresses[i], &batch->diags[i]);
+        if (!batch->parsed[i]) {
+            memset(&batch->addresses[i], 0, sizeof(batch->addresses[i]));
+        }
+        stage->bytes += batch->lengths[i];
+    }
+
+    stage->batches++;
+    stage->lines += batch->view.count;
+    stage->busy_ns += ipv6_clock_ns() - start;
+}
+
+//--------------------------------------------------------------------------------
+static void pipeline_deliver (pipeline_t* pipeline, pipeline_batch_t* batch)
+{
+    const uint64_t start = ipv6_clock_ns();
+
+    pipeline->config->sink(pipeline->config->sink_context, &batch->view);
+
+    for (size_t i = 0; i < batch->view.count; ++i) {
+        pipeline->sink.bytes += batch->lengths[i];
+    }
+    pipeline->sink.batches++;
+    pipeline->sink.lines += batch->view.count;
+    pipeline->sink.busy_ns += ipv6_clock_ns() - start;
+}
+
+//--------------------------------------------------------------------------------
+static void pipeline_reader_thread (void* arg)
+{
+    pipeline_t* pipeline = (pipeline_t*)arg;
+
+    for (;;) {
+        pipeline_batch_t* batch = (pipeline_batch_t*)pipeline_pop_wait(&pipeline->free_ring, &pipeline->reader);
+        if (!pipeline_fill(pipeline, batch)) {
+            break;
+        }
+        pipeline_push_wait(&pipeline->parse_ring, batch, &pipeline->reader);
+    }
+
+    for (uint32_t w = 0; w < pipeline->workers; ++w) {
+        pipeline_push_wait(&pipeline->parse_ring, NULL, &pipeline->reader);
+    }
+}
+
+//--------------------------------------------------------------------------------
+static void pipeline_worker_thread (void* arg)
+{
+    pipeline_worker_t* worker = (pipeline_worker_t*)arg;
+    pipeline_t* pipeline = worker->pipeline;
+
+    for (;;) {
+        pipeline_batch_t* batch = (pipeline_batch_t*)pipeline_pop_wait(&pipeline->parse_ring, &worker->stats);
+        if (batch) {
+            pipeline_parse(batch, &worker->stats);
+        }
+        pipeline_push_wait(&pipeline->done_ring, batch, &worker->stats);
+        if (!batch) {
+            return;
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------
+// Sink on the calling thread, until every worker has passed on its end marker
+static void pipeline_sink (pipeline_t* pipeline)
+{
+    uint64_t next = 0;
+    uint32_t ended = 0;
+
+    while (ended < pipeline->workers) {
+        pipeline_batch_t* batch = (pipeline_batch_t*)pipeline_pop_wait(&pipeline->done_ring, &pipeline->sink);
+        if (!batch) {
+            ended++;
+            continue;
+        }
+
+        pipeline->pending[batch->seq % pipeline->batch_count] = batch;
+        while ((batch = pipeline->pending[next % pipeline->batch_count]) != NULL && batch->seq == next) {
+            pipeline->pending[next % pipeline->batch_count] = NULL;
+            pipeline_deliver(pipeline, batch);
+            pipeline_push_wait(&pipeline->free_ring, batch, &pipeline->sink);
+            next++;
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------
+static void pipeline_free (pipeline_t* pipeline)
+{
+    if (pipeline->batches) {
+        for (uint32_t b = 0; b < pipeline->batch_count; ++b) {
+            pipeline_batch_t* batch = &pipeline->batches[b];
+            free(batch->inputs);
+            free(batch->lengths);
+            free(batch->addresses);
+            free(batch->parsed);
+            free(batch->diags);
+            free(batch->arena);
+        }
+    }
+    free(pipeline->batches);
+    free(pipeline->pending);
+    free(pipeline->worker_state);
+    free(pipeline->threads);
+    free(pipeline->free_ring.cells);
+    free(pipeline->parse_ring.cells);
+    free(pipeline->done_ring.cells);
+    free(pipeline->read_buffer);
+}
+
+//--------------------------------------------------------------------------------
+static bool pipeline_alloc (pipeline_t* pipeline, uint32_t workers)
+{
+    pipeline->batches = (pipeline_batch_t*)calloc(pipeline->batch_count, sizeof(pipeline_batch_t));
+    pipeline->pending = (pipeline_batch_t**)calloc(pipeline->batch_count, sizeof(pipeline_batch_t*));
+    pipeline->worker_state = (pipeline_worker_t*)calloc(workers, sizeof(pipeline_worker_t));
+    pipeline->threads = (ipv6_thread_t*)calloc(workers, sizeof(ipv6_thread_t));
+    pipeline->read_buffer = (char*)malloc(PIPELINE_READ_BYTES);
+
+    bool ok = pipeline->batches && pipeline->pending && pipeline->worker_state &&
+        pipeline->threads && pipeline->read_buffer &&
+        pipeline_ring_init(&pipeline->free_ring, pipeline->batch_count) &&
+        pipeline_ring_init(&pipeline->parse_ring, pipeline->batch_count + workers) &&
+        pipeline_ring_init(&pipeline->done_ring, pipeline->batch_count + workers);
+
+    for (uint32_t b = 0; ok && b < pipeline->batch_count; ++b) {
+        pipeline_batch_t* batch = &pipeline->batches[b];
+        const size_t size = pipeline->batch_size;
+        batch->arena_bytes = size * PIPELINE_AVERAGE_LINE > IPV6_PIPELINE_MAX_LINE ?
+            size * PIPELINE_AVERAGE_LINE : IPV6_PIPELINE_MAX_LINE;
+        batch->inputs = (const char**)malloc(size * sizeof(const char*));
+        batch->lengths = (uint32_t*)malloc(size * sizeof(uint32_t));
+        batch->addresses = (ipv6_address_full_t*)malloc(size * sizeof(ipv6_address_full_t));
+        batch->parsed = (bool*)malloc(size * sizeof(bool));
+        batch->diags = (ipv6_diag_result_t*)malloc(size * sizeof(ipv6_diag_result_t));
+        batch->arena = (char*)malloc(batch->arena_bytes);
+        ok = batch->inputs && batch->lengths && batch->addresses && batch->parsed && batch->diags && batch->arena;
+
+        batch->view.inputs = batch->inputs;
+        batch->view.lengths = batch->lengths;
+        batch->view.addresses = batch->addresses;
+        batch->view.parsed = batch->parsed;
+        batch->view.diags = batch->diags;
+    }
+    return ok;
+}
+
+//--------------------------------------------------------------------------------
+bool ipv6_pipeline_run (
+    const ipv6_pipeline_config_t* config,
+    ipv6_pipeline_stats_t* stats)
+{
+    const uint64_t start = ipv6_clock_ns();
+    pipeline_t pipeline;
+    ipv6_thread_t reader;
+
+    memset(&pipeline, 0, sizeof(pipeline));
+    pipeline.config = config;
+
+    uint32_t workers = config->workers ? config->workers : ipv6_cpu_count();
+    if (workers > IPV6_BATCH_MAX_WORKERS) {
+        workers = IPV6_BATCH_MAX_WORKERS;
+    }
+    pipeline.batch_size = config->batch_size ? config->batch_size : IPV6_PIPELINE_DEFAULT_BATCH;
+    pipeline.batch_count = config->batches ? config->batches : 4 * workers;
+    if (pipeline.batch_count < 2) {
+        pipeline.batch_count = 2;
+    }
+
+    if (!pipeline_alloc(&pipeline, workers)) {
+        pipeline_free(&pipeline);
+        return false;
+    }
+
+    for (uint32_t b = 0; b < pipeline.batch_count; ++b) {
+        pipeline_ring_push(&pipeline.free_ring, &pipeline.batches[b]);
+    }
+
+    // The reader learns the worker count before it starts
+    for (uint32_t w = 0; w < workers; ++w) {
+        pipeline.worker_state[w].pipeline = &pipeline;
+        if (!ipv6_thread_start(&pipeline.threads[pipeline.workers], pipeline_worker_thread, &pipeline.worker_state[pipeline.workers])) {
+            break;
+        }
+        pipeline.workers++;
+    }
+
+    if (pipeline.workers && ipv6_thread_start(&reader, pipeline_reader_thread, &pipeline)) {
+        pipeline_sink(&pipeline);
+        ipv6_thread_join(reader);
+    } else {
+        // Stop any started workers, then run the stages in turn
+        for (uint32_t w = 0; w < pipeline.workers; ++w) {
+            pipeline_push_wait(&pipeline.parse_ring, NULL, &pipeline.reader);
+        }
+        pipeline_batch_t* batch = &pipeline.batches[0];
+        while (pipeline_fill(&pipeline, batch)) {
+            pipeline_parse(batch, &pipeline.parser);
+            pipeline_deliver(&pipeline, batch);
+        }
+    }
+
+    for (uint32_t w = 0; w < pipeline.workers; ++w) {
+        ipv6_thread_join(pipeline.threads[w]);
+    }
+
+    if (stats) {
+        memset(stats, 0, sizeof(*stats));
+        stats->reader = pipeline.reader;
+        stats->parser = pipeline.parser;
+        stats->sink = pipeline.sink;
+        for (uint32_t w = 0; w < workers; ++w) {
+            const ipv6_pipeline_stage_t* stage = &pipeline.worker_state[w].stats;
+            stats->parser.batches += stage->batches;
+            stats->parser.lines += stage->lines;
+            stats->parser.bytes += stage->bytes;
+            stats->parser.busy_ns += stage->busy_ns;
+            stats->parser.stall_ns += stage->stall_ns;
+        }
+        stats->workers = pipeline.workers;
+        stats->elapsed_ns = ipv6_clock_ns() - start;
+    }
+
+    pipeline_free(&pipeline);
+    return true;
+}
+
+//--------------------------------------------------------------------------------
+size_t ipv6_pipeline_read_file (
+    void* context,
+    char* buffer,
+    size_t buffer_bytes)
+{
+    return fread(buffer, 1, buffer_bytes, (FILE*)context);
+}
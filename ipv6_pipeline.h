@@ -0,0 +1,147 @@
+#pragma once
+// # Parse pipeline
+//
+//     Read, parse and consume a stream of addresses on several threads.
+//
+// ipv6_pipeline_run connects three stages with bounded lock-free rings:
+//
+// - A reader thread pulls bytes from a read function (file, stdin, socket)
+//   and cuts them into batches of lines
+// - Parse workers run ipv6_from_str_compact on every line of a batch
+// - The sink function receives the parsed batches on the calling thread,
+//   in input order
+//
+// Batches are handed over whole, not line by line. A fixed set of batches
+// circulates between the stages, so memory is bounded and a slow sink or slow
+// workers stall the reader instead of queueing input (back-pressure). Every
+// stage counts its throughput and the time it spent waiting on the others.
+//
+
+#include "ipv6.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/// Lines per batch when ipv6_pipeline_config_t.batch_size is 0
+#define IPV6_PIPELINE_DEFAULT_BATCH 1024
+
+/// Longest line kept, longer lines are truncated and fail as too long either way
+#define IPV6_PIPELINE_MAX_LINE 256
+
+// ### ipv6_pipeline_batch_t
+//
+// Parsed lines handed to the sink. The arrays, the line text and interface
+// pointers into it are valid until the sink returns.
+//
+// ~~~~
+typedef struct {
+    uint64_t                    first_line;     // 0-based line number of entry 0
+    size_t                      count;          // entries in the arrays
+    const char* const*          inputs;         // line text without the newline, not nul terminated
+    const uint32_t*             lengths;        // line lengths
+    const ipv6_address_full_t*  addresses;      // parsed addresses, zeroed where parsing failed
+    const bool*                 parsed;         // outcome of each line
+    const ipv6_diag_result_t*   diags;          // failure of each line where parsed is false
+} ipv6_pipeline_batch_t;
+// ~~~~
+
+// ### ipv6_pipeline_read_func_t
+//
+// Fill up to buffer_bytes of buffer, returns the bytes read. Returning 0 ends
+// the input, at the end of the source or on an error.
+//
+// ~~~~
+typedef size_t (*ipv6_pipeline_read_func_t) (
+    void* context,
+    char* buffer,
+    size_t buffer_bytes);
+// ~~~~
+
+// ### ipv6_pipeline_sink_func_t
+//
+// Consume a batch, called on the thread running ipv6_pipeline_run
+//
+// ~~~~
+typedef void (*ipv6_pipeline_sink_func_t) (
+    void* context,
+    const ipv6_pipeline_batch_t* batch);
+// ~~~~
+
+// ### ipv6_pipeline_config_t
+//
+// Stages of a pipeline, zero initialize the tuning fields for defaults
+//
+// ~~~~
+typedef struct {
+    ipv6_pipeline_read_func_t   read;
+    void*                       read_context;
+    ipv6_pipeline_sink_func_t   sink;
+    void*                       sink_context;
+    uint32_t                    workers;        // parse workers, 0 for one per CPU
+    uint32_t                    batch_size;     // lines per batch, 0 for IPV6_PIPELINE_DEFAULT_BATCH
+    uint32_t                    batches;        // batches in flight, 0 for 4 per worker
+    uint32_t                    pad0;
+} ipv6_pipeline_config_t;
+// ~~~~
+
+// ### ipv6_pipeline_stage_t
+//
+// Counters of one stage. busy_ns is time spent working, stall_ns time spent
+// waiting for another stage: for the reader, on a free batch; for workers,
+// on input; for the sink, on parsed batches.
+//
+// ~~~~
+typedef struct {
+    uint64_t                    batches;        // batches handled
+    uint64_t                    lines;          // lines handled
+    uint64_t                    bytes;          // bytes read, or line bytes handled
+    uint64_t                    busy_ns;
+    uint64_t                    stall_ns;
+} ipv6_pipeline_stage_t;
+// ~~~~
+
+// ### ipv6_pipeline_stats_t
+//
+// Counters of a pipeline run, parser sums all workers
+//
+// ~~~~
+typedef struct {
+    ipv6_pipeline_stage_t       reader;
+    ipv6_pipeline_stage_t       parser;
+    ipv6_pipeline_stage_t       sink;
+    uint64_t                    elapsed_ns;     // wall time of the run
+    uint32_t                    workers;        // parse workers that ran
+    uint32_t                    pad0;
+} ipv6_pipeline_stats_t;
+// ~~~~
+
+
+// ### ipv6_pipeline_run
+//
+// Run a pipeline until the read function ends the input and the sink has
+// received every line. stats may be NULL. Returns false if memory could not
+// be allocated, nothing is read then. If no thread can be started the stages
+// run one after another on the calling thread.
+//
+// ~~~~
+bool ipv6_pipeline_run (
+    const ipv6_pipeline_config_t* config,
+    ipv6_pipeline_stats_t* stats);
+// ~~~~
+
+// ### ipv6_pipeline_read_file
+//
+// Read function for a FILE*, pass the file as read_context
+//
+// ~~~~
+size_t ipv6_pipeline_read_file (
+    void* context,
+    char* buffer,
+    size_t buffer_bytes);
+// ~~~~
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,392 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L // pthread keys
+#endif
+
+#include "ipv6_profile.h"
+#include "ipv6_config.h"
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <stdlib.h>
+
+#ifdef PARSE_PROFILE
+
+//
+// Thread histograms are written only by their owning thread with relaxed
+// atomic stores and read by snapshots with relaxed loads, so recording is
+// wait-free. Records are pushed on a singly linked list with a CAS and never
+// removed. A thread exit hook marks the record of the thread free and the
+// next thread to take a sample adopts it, counts included, so short lived
+// workers do not grow the list and snapshots keep their samples.
+//
+#if defined(_MSC_VER)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#define PROFILE_THREAD_LOCAL __declspec(thread)
+#define PROFILE_LOAD(p) (*(volatile const uint64_t*)(p))
+#define PROFILE_STORE(p, v) (*(volatile uint64_t*)(p) = (v))
+#define PROFILE_LOAD_U32(p) (*(volatile const uint32_t*)(p))
+#define PROFILE_STORE_U32(p, v) (*(volatile uint32_t*)(p) = (v))
+#define PROFILE_LOAD_PTR(p) (*(void* volatile*)(p))
+#define PROFILE_CAS_PTR(p, expected, desired) \
+    (InterlockedCompareExchangePointer((PVOID volatile*)(p), (desired), (expected)) == (expected))
+#define PROFILE_CAS_ACQUIRE_U32(p, expected, desired) \
+    ((uint32_t)InterlockedCompareExchange((volatile LONG*)(p), (LONG)(desired), (LONG)(expected)) == (expected))
+#define PROFILE_STORE_RELEASE_U32(p, v) (MemoryBarrier(), *(volatile uint32_t*)(p) = (v))
+#else
+#define PROFILE_THREAD_LOCAL __thread
+#define PROFILE_LOAD(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#define PROFILE_STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define PROFILE_LOAD_U32(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#define PROFILE_STORE_U32(p, v) __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define PROFILE_LOAD_PTR(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define PROFILE_CAS_PTR(p, expected, desired) \
+    __atomic_compare_exchange_n((p), &(expected), (desired), false, __ATOMIC_RELEASE, __ATOMIC_RELAXED)
+#define PROFILE_CAS_ACQUIRE_U32(p, expected, desired) \
+    __atomic_compare_exchange_n((p), &(expected), (desired), false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)
+#define PROFILE_STORE_RELEASE_U32(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#endif
+
+#if defined(_WIN32)
+#ifndef _MSC_VER
+#include <windows.h>
+#endif
+#else
+#include <pthread.h>
+#endif
+
+//
+// Histograms of one thread
+//
+typedef struct profile_thread_t {
+    struct profile_thread_t*    next;
+    uint32_t                    in_use;         // owned by a live thread
+    ipv6_profile_histogram_t    histograms[IPV6_PROFILE_OP_COUNT][IPV6_PROFILE_SHAPE_COUNT];
+} profile_thread_t;
+
+static profile_thread_t* profile_threads = NULL;
+static uint32_t profile_sample_rate = IPV6_PROFILE_DEFAULT_SAMPLE_RATE;
+static ipv6_profile_snapshot_t profile_baseline;
+
+static PROFILE_THREAD_LOCAL profile_thread_t* profile_thread = NULL;
+static PROFILE_THREAD_LOCAL uint32_t profile_calls = 0;
+
+#endif // PARSE_PROFILE
+
+//--------------------------------------------------------------------------------
+static uint64_t profile_bucket_upper (uint32_t bucket)
+{
+    if (bucket < IPV6_PROFILE_SUB_BUCKETS) {
+        return bucket;
+    }
+
+    const uint32_t msb = bucket / IPV6_PROFILE_SUB_BUCKETS + 3;
+    const uint64_t lower = (uint64_t)(IPV6_PROFILE_SUB_BUCKETS + bucket % IPV6_PROFILE_SUB_BUCKETS) << (msb - 4);
+    return lower + (1ULL << (msb - 4)) - 1;
+}
+
+//--------------------------------------------------------------------------------
+ipv6_profile_shape_t ipv6_profile_shape (
+    uint32_t flags)
+{
+    if (flags & IPV6_FLAG_IPV4_COMPAT) {
+        return IPV6_PROFILE_SHAPE_V4;
+    }
+    if (flags & IPV6_FLAG_HAS_MASK) {
+        return IPV6_PROFILE_SHAPE_MASKED;
+    }
+    if (flags & IPV6_FLAG_HAS_PORT) {
+        return IPV6_PROFILE_SHAPE_BRACKETED;
+    }
+    return IPV6_PROFILE_SHAPE_V6;
+}
+
+//--------------------------------------------------------------------------------
+const char* ipv6_profile_shape_str (
+    ipv6_profile_shape_t shape)
+{
+    switch (shape) {
+        case IPV6_PROFILE_SHAPE_V6:         return "v6";
+        case IPV6_PROFILE_SHAPE_V4:         return "v4";
+        case IPV6_PROFILE_SHAPE_BRACKETED:  return "bracketed";
+        case IPV6_PROFILE_SHAPE_MASKED:     return "masked";
+        case IPV6_PROFILE_SHAPE_INVALID:    return "invalid";
+        default:
+            break;
+    }
+
+    return "<unknown>";
+}
+
+//--------------------------------------------------------------------------------
+uint64_t ipv6_profile_value_at_percentile (
+    const ipv6_profile_histogram_t* histogram,
+    double percentile)
+{
+    if (!histogram->count) {
+        return 0;
+    }
+
+    uint64_t target = (uint64_t)(percentile / 100.0 * (double)histogram->count + 0.5);
+    if (target < 1) {
+        target = 1;
+    }
+
+    uint64_t cumulative = 0;
+    for (uint32_t i = 0; i < IPV6_PROFILE_BUCKETS; ++i) {
+        cumulative += histogram->buckets[i];
+        if (cumulative >= target) {
+            return profile_bucket_upper(i);
+        }
+    }
+
+    return profile_bucket_upper(IPV6_PROFILE_BUCKETS - 1);
+}
+
+#ifdef PARSE_PROFILE
+
+//--------------------------------------------------------------------------------
+static uint32_t profile_bucket (uint64_t ns)
+{
+    if (ns < IPV6_PROFILE_SUB_BUCKETS) {
+        return (uint32_t)ns;
+    }
+    if (ns >> 32) {
+        return IPV6_PROFILE_BUCKETS - 1;
+    }
+
+    uint32_t msb = 0;
+    while ((ns >> msb) > 1) {
+        msb++;
+    }
+
+    // msb >= 4, keep the 4 bits below the leading one as the sub-bucket
+    return (msb - 3) * IPV6_PROFILE_SUB_BUCKETS +
+        (uint32_t)((ns >> (msb - 4)) & (IPV6_PROFILE_SUB_BUCKETS - 1));
+}
+
+//--------------------------------------------------------------------------------
+void ipv6_profile_set_sample_rate (
+    uint32_t rate)
+{
+    PROFILE_STORE_U32(&profile_sample_rate, rate);
+}
+
+//--------------------------------------------------------------------------------
+bool ipv6_profile_should_sample (void)
+{
+    const uint32_t rate = PROFILE_LOAD_U32(&profile_sample_rate);
+    if (!rate || ++profile_calls < rate) {
+        return false;
+    }
+
+    profile_calls = 0;
+    return true;
+}
+
+//--------------------------------------------------------------------------------
+// Thread exit hook, hands the record to the next thread that registers
+static void profile_release_thread (void* data)
+{
+    profile_thread_t* thread = (profile_thread_t*)data;
+    profile_thread = NULL;
+    PROFILE_STORE_RELEASE_U32(&thread->in_use, 0);
+}
+
+#if defined(_WIN32)
+static DWORD profile_exit_key = FLS_OUT_OF_INDEXES;
+static INIT_ONCE profile_exit_once = INIT_ONCE_STATIC_INIT;
+
+//--------------------------------------------------------------------------------
+static VOID WINAPI profile_thread_exit (PVOID data)
+{
+    if (data) {
+        profile_release_thread(data);
+    }
+}
+
+//--------------------------------------------------------------------------------
+static BOOL CALLBACK profile_create_exit_key (PINIT_ONCE once, PVOID param, PVOID* context)
+{
+    (void)once;
+    (void)param;
+    (void)context;
+    profile_exit_key = FlsAlloc(profile_thread_exit);
+    return TRUE;
+}
+
+//--------------------------------------------------------------------------------
+// Release the record when the calling thread exits, if the hook is available
+static void profile_watch_thread (profile_thread_t* thread)
+{
+    InitOnceExecuteOnce(&profile_exit_once, profile_create_exit_key, NULL, NULL);
+    if (profile_exit_key != FLS_OUT_OF_INDEXES) {
+        FlsSetValue(profile_exit_key, thread);
+    }
+}
+#else
+static pthread_key_t profile_exit_key;
+static pthread_once_t profile_exit_once = PTHREAD_ONCE_INIT;
+static bool profile_exit_key_valid = false;
+
+//--------------------------------------------------------------------------------
+static void profile_create_exit_key (void)
+{
+    profile_exit_key_valid = pthread_key_create(&profile_exit_key, profile_release_thread) == 0;
+}
+
+//--------------------------------------------------------------------------------
+// Release the record when the calling thread exits, if the hook is available
+static void profile_watch_thread (profile_thread_t* thread)
+{
+    pthread_once(&profile_exit_once, profile_create_exit_key);
+    if (profile_exit_key_valid) {
+        pthread_setspecific(profile_exit_key, thread);
+    }
+}
+#endif
+
+//--------------------------------------------------------------------------------
+// Adopt a free record or allocate and publish a new one for the calling thread
+static profile_thread_t* profile_register_thread (void)
+{
+    profile_thread_t* thread = (profile_thread_t*)PROFILE_LOAD_PTR(&profile_threads);
+    for (; thread; thread = thread->next) {
+        uint32_t expected = 0;
+        if (PROFILE_LOAD_U32(&thread->in_use) == 0 && PROFILE_CAS_ACQUIRE_U32(&thread->in_use, expected, 1)) {
+            break;
+        }
+    }
+
+    if (!thread) {
+        thread = (profile_thread_t*)calloc(1, sizeof(profile_thread_t));
+        if (!thread) {
+            return NULL;
+        }
+        thread->in_use = 1;
+
+        profile_thread_t* head = (profile_thread_t*)PROFILE_LOAD_PTR(&profile_threads);
+        do {
+            thread->next = head;
+        } while (!PROFILE_CAS_PTR(&profile_threads, head, thread));
+    }
+
+    profile_watch_thread(thread);
+    profile_thread = thread;
+    return thread;
+}
+
+//--------------------------------------------------------------------------------
+void ipv6_profile_record (
+    ipv6_profile_op_t op,
+    ipv6_profile_shape_t shape,
+    uint64_t elapsed_ns)
+{
+    profile_thread_t* thread = profile_thread ? profile_thread : profile_register_thread();
+    if (!thread) {
+        return;
+    }
+
+    ipv6_profile_histogram_t* h = &thread->histograms[op][shape];
+    uint64_t* bucket = &h->buckets[profile_bucket(elapsed_ns)];
+
+    PROFILE_STORE(&h->count, PROFILE_LOAD(&h->count) + 1);
+    PROFILE_STORE(&h->sum_ns, PROFILE_LOAD(&h->sum_ns) + elapsed_ns);
+    PROFILE_STORE(bucket, PROFILE_LOAD(bucket) + 1);
+}
+
+//--------------------------------------------------------------------------------
+// Sum of all thread histograms without the baseline
+static void profile_collect (ipv6_profile_snapshot_t* snapshot)
+{
+    memset(snapshot, 0, sizeof(*snapshot));
+    snapshot->sample_rate = PROFILE_LOAD_U32(&profile_sample_rate);
+
+    const profile_thread_t* thread = (const profile_thread_t*)PROFILE_LOAD_PTR(&profile_threads);
+    for (; thread; thread = thread->next) {
+        snapshot->threads++;
+        for (uint32_t op = 0; op < IPV6_PROFILE_OP_COUNT; ++op) {
+            for (uint32_t shape = 0; shape < IPV6_PROFILE_SHAPE_COUNT; ++shape) {
+                const ipv6_profile_histogram_t* from = &thread->histograms[op][shape];
+                ipv6_profile_histogram_t* into = &snapshot->histograms[op][shape];
+
+                into->count += PROFILE_LOAD(&from->count);
+                into->sum_ns += PROFILE_LOAD(&from->sum_ns);
+                for (uint32_t i = 0; i < IPV6_PROFILE_BUCKETS; ++i) {
+                    into->buckets[i] += PROFILE_LOAD(&from->buckets[i]);
+                }
+            }
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------
+bool ipv6_profile_snapshot (
+    ipv6_profile_snapshot_t* snapshot)
+{
+    profile_collect(snapshot);
+
+    for (uint32_t op = 0; op < IPV6_PROFILE_OP_COUNT; ++op) {
+        for (uint32_t shape = 0; shape < IPV6_PROFILE_SHAPE_COUNT; ++shape) {
+            const ipv6_profile_histogram_t* base = &profile_baseline.histograms[op][shape];
+            ipv6_profile_histogram_t* h = &snapshot->histograms[op][shape];
+
+            h->count -= base->count;
+            h->sum_ns -= base->sum_ns;
+            for (uint32_t i = 0; i < IPV6_PROFILE_BUCKETS; ++i) {
+                h->buckets[i] -= base->buckets[i];
+            }
+        }
+    }
+
+    return true;
+}
+
+//--------------------------------------------------------------------------------
+void ipv6_profile_reset (void)
+{
+    profile_collect(&profile_baseline);
+}
+
+#else // PARSE_PROFILE
+
+//--------------------------------------------------------------------------------
+void ipv6_profile_set_sample_rate (
+    uint32_t rate)
+{
+    (void)rate;
+}
+
+//--------------------------------------------------------------------------------
+bool ipv6_profile_should_sample (void)
+{
+    return false;
+}
+
+//--------------------------------------------------------------------------------
+void ipv6_profile_record (
+    ipv6_profile_op_t op,
+    ipv6_profile_shape_t shape,
+    uint64_t elapsed_ns)
+{
+    (void)op;
+    (void)shape;
+    (void)elapsed_ns;
+}
+
+//--------------------------------------------------------------------------------
+bool ipv6_profile_snapshot (
+    ipv6_profile_snapshot_t* snapshot)
+{
+    memset(snapshot, 0, sizeof(*snapshot));
+    return false;
+}
+
+//--------------------------------------------------------------------------------
+void ipv6_profile_reset (void)
+{
+}
+
+#endif // PARSE_PROFILE
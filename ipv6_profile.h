@@ -0,0 +1,166 @@
+#pragma once
+// # Sampled latency profiling
+//
+//     Continuous low overhead latency histograms of the parse and format APIs.
+//
+// Built in with `cmake -DPARSE_PROFILE=1`. One in every N calls of the
+// ipv6_from_str family and ipv6_to_str is timed with the monotonic clock and
+// recorded in a histogram keyed by the shape of the address, so that tail
+// latency can be attributed to unusual forms.
+//
+// Each thread records into its own histograms. They are registered on a
+// lock-free list the first time the thread takes a sample and live for the
+// rest of the process, so snapshots still include threads that have exited.
+// When a thread exits its histograms are handed, with their counts, to the
+// next thread that starts sampling, so the list only grows to the number of
+// threads sampling at the same time.
+// Recording never takes a lock and never writes memory shared with other
+// threads.
+//
+// Histograms are log-linear (HDR style): 16 linear sub-buckets per power of
+// two, a relative error below 6.25%, from 0 up to 2^32 ns.
+//
+// Without PARSE_PROFILE the hooks are not compiled into the parser.
+// ipv6_profile_snapshot then returns false.
+//
+
+#include "ipv6.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/// Linear sub-buckets per power of two
+#define IPV6_PROFILE_SUB_BUCKETS 16
+
+/// Total buckets covering [0, 2^32) nanoseconds, larger values land in the last bucket
+#define IPV6_PROFILE_BUCKETS ((32 - 4 + 1) * IPV6_PROFILE_SUB_BUCKETS)
+
+/// Default 1-in-N sampling rate
+#define IPV6_PROFILE_DEFAULT_SAMPLE_RATE 64
+
+// ### ipv6_profile_op_t
+//
+// Profiled API
+//
+// ~~~~
+typedef enum {
+    IPV6_PROFILE_OP_FROM_STR    = 0,    // ipv6_from_str, ipv6_from_str_diag, ipv6_from_str_compact
+    IPV6_PROFILE_OP_TO_STR      = 1,    // ipv6_to_str
+} ipv6_profile_op_t;
+
+#define IPV6_PROFILE_OP_COUNT 2
+// ~~~~
+
+// ### ipv6_profile_shape_t
+//
+// Shape of the address, derived from its flags. Masked and bracketed
+// refer to IPv6 addresses, IPv4 addresses are always IPV6_PROFILE_SHAPE_V4.
+//
+// ~~~~
+typedef enum {
+    IPV6_PROFILE_SHAPE_V6           = 0,    // plain IPv6, including embedded IPv4
+    IPV6_PROFILE_SHAPE_V4           = 1,    // IPv4 dotted quad with optional port or mask
+    IPV6_PROFILE_SHAPE_BRACKETED    = 2,    // [addr]:port
+    IPV6_PROFILE_SHAPE_MASKED       = 3,    // addr/N
+    IPV6_PROFILE_SHAPE_INVALID      = 4,    // rejected by the parser
+} ipv6_profile_shape_t;
+
+#define IPV6_PROFILE_SHAPE_COUNT 5
+// ~~~~
+
+// ### ipv6_profile_histogram_t
+//
+// Latency distribution of one (op, shape) pair
+//
+// ~~~~
+typedef struct {
+    uint64_t                count;                          // samples
+    uint64_t                sum_ns;                         // total sampled latency
+    uint64_t                buckets[IPV6_PROFILE_BUCKETS];  // samples per bucket
+} ipv6_profile_histogram_t;
+// ~~~~
+
+// ### ipv6_profile_snapshot_t
+//
+// Merged histograms of every thread since the last reset
+//
+// ~~~~
+typedef struct {
+    uint32_t                sample_rate;                    // 1-in-N rate at the time of the snapshot
+    uint32_t                threads;                        // most threads that have sampled at the same time
+    ipv6_profile_histogram_t histograms[IPV6_PROFILE_OP_COUNT][IPV6_PROFILE_SHAPE_COUNT];
+} ipv6_profile_snapshot_t;
+// ~~~~
+
+
+// ### ipv6_profile_set_sample_rate
+//
+// Time one in every rate calls per thread, 1 times every call and 0 stops
+// sampling. Takes effect immediately in all threads.
+//
+// ~~~~
+void ipv6_profile_set_sample_rate (
+    uint32_t rate);
+// ~~~~
+
+// ### ipv6_profile_snapshot
+//
+// Merge the histograms of all threads, less the state captured by the last
+// ipv6_profile_reset. Returns false if profiling is not compiled in.
+//
+// Snapshot and reset may run concurrently with recording threads, but not
+// with each other.
+//
+// ~~~~
+bool ipv6_profile_snapshot (
+    ipv6_profile_snapshot_t* snapshot);
+// ~~~~
+
+// ### ipv6_profile_reset
+//
+// Start a new measurement period. Thread histograms are not modified; the
+// current totals become the baseline subtracted by later snapshots.
+//
+// ~~~~
+void ipv6_profile_reset (void);
+// ~~~~
+
+// ### ipv6_profile_value_at_percentile
+//
+// Upper bound in nanoseconds of the bucket holding the given percentile
+// (0 - 100) of a histogram, 0 for an empty histogram.
+//
+// ~~~~
+uint64_t ipv6_profile_value_at_percentile (
+    const ipv6_profile_histogram_t* histogram,
+    double percentile);
+// ~~~~
+
+// ### ipv6_profile_shape_str
+//
+// Short name of a shape, e.g. "bracketed"
+//
+// ~~~~
+const char* ipv6_profile_shape_str (
+    ipv6_profile_shape_t shape);
+// ~~~~
+
+
+//
+// Hooks called by ipv6.c in PARSE_PROFILE builds
+//
+bool ipv6_profile_should_sample (void);
+
+ipv6_profile_shape_t ipv6_profile_shape (
+    uint32_t flags);
+
+void ipv6_profile_record (
+    ipv6_profile_op_t op,
+    ipv6_profile_shape_t shape,
+    uint64_t elapsed_ns);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,276 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L // if_nametoindex
+#endif
+
+#include "ipv6_sockaddr.h"
+#include "ipv6_config.h"
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#if !defined(_WIN32)
+#include <net/if.h>
+#endif
+
+//
+// Components are host order 16 bit words, socket addresses network order
+// bytes. On little-endian hosts both directions swap the bytes within every
+// 16 bit lane, done on two 64 bit words at a time. Addresses parsed with
+// ipv6_from_str_network are network order already and copied as they are.
+//
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define SOCKADDR_BIG_ENDIAN 1
+#endif
+
+#define SOCKADDR_LOW_BYTES 0x00ff00ff00ff00ffULL
+
+//--------------------------------------------------------------------------------
+static void sockaddr_swap_components (const void* in, void* out)
+{
+    uint64_t lanes[2];
+    memcpy(lanes, in, sizeof(lanes));
+#ifndef SOCKADDR_BIG_ENDIAN
+    lanes[0] = ((lanes[0] & SOCKADDR_LOW_BYTES) << 8) | ((lanes[0] >> 8) & SOCKADDR_LOW_BYTES);
+    lanes[1] = ((lanes[1] & SOCKADDR_LOW_BYTES) << 8) | ((lanes[1] >> 8) & SOCKADDR_LOW_BYTES);
+#endif
+    memcpy(out, lanes, sizeof(lanes));
+}
+
+//--------------------------------------------------------------------------------
+static uint16_t sockaddr_swap_port (uint16_t port)
+{
+#ifndef SOCKADDR_BIG_ENDIAN
+    return (uint16_t)((port << 8) | (port >> 8));
+#else
+    return port;
+#endif
+}
+
+//--------------------------------------------------------------------------------
+// Network order bytes of the address, addresses parsed by ipv6_from_str_network are copied
+static void sockaddr_address_bytes (const ipv6_address_full_t* in, uint8_t* out)
+{
+    if (in->flags & IPV6_FLAG_NETWORK_ORDER) {
+        memcpy(out, in->address.components, sizeof(in->address.components));
+    } else {
+        sockaddr_swap_components(in->address.components, out);
+    }
+}
+
+//--------------------------------------------------------------------------------
+// Network order bytes of an IPv4 compatible address
+static void sockaddr_ipv4_bytes (const ipv6_address_full_t* in, uint8_t* out)
+{
+    if (in->flags & IPV6_FLAG_NETWORK_ORDER) {
+        memcpy(out, in->address.components, 4);
+    } else {
+        out[0] = (uint8_t)(in->address.components[0] >> 8);
+        out[1] = (uint8_t)in->address.components[0];
+        out[2] = (uint8_t)(in->address.components[1] >> 8);
+        out[3] = (uint8_t)in->address.components[1];
+    }
+}
+
+//--------------------------------------------------------------------------------
+// Scope of the zone: a number, or the index of the interface it names
+static bool sockaddr_scope_id (const ipv6_address_full_t* in, uint32_t* scope_id)
+{
+    *scope_id = 0;
+    if (in->flags & IPV6_FLAG_ZONE_ID) {
+        *scope_id = in->zone;
+        return true;
+    }
+    if (!in->iface || !in->iface_len) {
+        return true;
+    }
+
+    uint64_t value = 0;
+    uint32_t i = 0;
+    for (; i < in->iface_len && in->iface[i] >= '0' && in->iface[i] <= '9'; ++i) {
+        value = value * 10 + (uint64_t)(in->iface[i] - '0');
+        if (value > UINT32_MAX) {
+            return false;
+        }
+    }
+    if (i == in->iface_len) {
+        *scope_id = (uint32_t)value;
+        return true;
+    }
+
+#if !defined(_WIN32)
+    char name[IF_NAMESIZE];
+    if (in->iface_len < sizeof(name)) {
+        memcpy(name, in->iface, in->iface_len);
+        name[in->iface_len] = '\0';
+        *scope_id = (uint32_t)if_nametoindex(name);
+    }
+#endif
+    return *scope_id != 0;
+}
+
+//--------------------------------------------------------------------------------
+void ipv6_to_in6_addr (
+    const ipv6_address_full_t* in,
+    struct in6_addr* out)
+{
+    if (in->flags & IPV6_FLAG_IPV4_COMPAT) {
+        memset(out->s6_addr, 0, 10);
+        out->s6_addr[10] = 0xff;
+        out->s6_addr[11] = 0xff;
+        sockaddr_ipv4_bytes(in, &out->s6_addr[12]);
+        return;
+    }
+    sockaddr_address_bytes(in, out->s6_addr);
+}
+
+//--------------------------------------------------------------------------------
+void ipv6_from_in6_addr (
+    const struct in6_addr* in,
+    ipv6_address_full_t* out)
+{
+    static const uint16_t mapped_prefix[6] = { 0, 0, 0, 0, 0, 0xffff };
+
+    memset(out, 0, sizeof(*out));
+    sockaddr_swap_components(in->s6_addr, out->address.components);
+    if (!memcmp(out->address.components, mapped_prefix, sizeof(mapped_prefix))) {
+        out->flags |= IPV6_FLAG_IPV4_EMBED;
+    }
+}
+
+//--------------------------------------------------------------------------------
+size_t ipv6_to_sockaddr (
+    const ipv6_address_full_t* in,
+    struct sockaddr* out,
+    size_t out_bytes)
+{
+    if (in->flags & IPV6_FLAG_IPV4_COMPAT) {
+        struct sockaddr_in sin;
+        uint8_t octets[4];
+        if (out_bytes < sizeof(sin)) {
+            return 0;
+        }
+        sockaddr_ipv4_bytes(in, octets);
+
+        memset(&sin, 0, sizeof(sin));
+#ifdef SIN6_LEN
+        sin.sin_len = sizeof(sin);
+#endif
+        sin.sin_family = AF_INET;
+        sin.sin_port = sockaddr_swap_port(in->port);
+        memcpy(&sin.sin_addr, octets, sizeof(octets));
+        memcpy(out, &sin, sizeof(sin));
+        return sizeof(sin);
+    }
+
+    struct sockaddr_in6 sin6;
+    uint32_t scope_id;
+    if (out_bytes < sizeof(sin6) || !sockaddr_scope_id(in, &scope_id)) {
+        return 0;
+    }
+
+    memset(&sin6, 0, sizeof(sin6));
+#ifdef SIN6_LEN
+    sin6.sin6_len = sizeof(sin6);
+#endif
+    sin6.sin6_family = AF_INET6;
+    sin6.sin6_port = sockaddr_swap_port(in->port);
+    sin6.sin6_scope_id = scope_id;
+    sockaddr_address_bytes(in, sin6.sin6_addr.s6_addr);
+    memcpy(out, &sin6, sizeof(sin6));
+    return sizeof(sin6);
+}
+
+//--------------------------------------------------------------------------------
+bool ipv6_from_sockaddr (
+    const struct sockaddr* in,
+    size_t in_bytes,
+    ipv6_address_full_t* out,
+    uint32_t* scope_id)
+{
+    if (scope_id) {
+        *scope_id = 0;
+    }
+
+    if (in_bytes >= sizeof(struct sockaddr_in) && in->sa_family == AF_INET) {
+        struct sockaddr_in sin;
+        uint8_t octets[4];
+        memcpy(&sin, in, sizeof(sin));
+        memcpy(octets, &sin.sin_addr, sizeof(octets));
+
+        memset(out, 0, sizeof(*out));
+        out->address.components[0] = (uint16_t)((octets[0] << 8) | octets[1]);
+        out->address.components[1] = (uint16_t)((octets[2] << 8) | octets[3]);
+        out->port = sockaddr_swap_port(sin.sin_port);
+        out->flags = IPV6_FLAG_IPV4_COMPAT | (out->port ? IPV6_FLAG_HAS_PORT : 0);
+        return true;
+    }
+
+    if (in_bytes >= sizeof(struct sockaddr_in6) && in->sa_family == AF_INET6) {
+        struct sockaddr_in6 sin6;
+        memcpy(&sin6, in, sizeof(sin6));
+
+        ipv6_from_in6_addr(&sin6.sin6_addr, out);
+        out->port = sockaddr_swap_port(sin6.sin6_port);
+        out->flags |= out->port ? IPV6_FLAG_HAS_PORT : 0;
+        if (sin6.sin6_scope_id && sin6.sin6_scope_id <= 0xffff) {
+            out->zone = (uint16_t)sin6.sin6_scope_id;
+            out->flags |= IPV6_FLAG_ZONE_ID;
+        }
+        if (scope_id) {
+            *scope_id = (uint32_t)sin6.sin6_scope_id;
+        }
+        return true;
+    }
+
+    return false;
+}
+
+//--------------------------------------------------------------------------------
+void ipv6_to_in6_addr_batch (
+    const ipv6_address_full_t* in,
+    size_t count,
+    struct in6_addr* out)
+{
+    for (size_t i = 0; i < count; ++i) {
+        ipv6_to_in6_addr(&in[i], &out[i]);
+    }
+}
+
+//--------------------------------------------------------------------------------
+size_t ipv6_to_sockaddr_batch (
+    const ipv6_address_full_t* in,
+    size_t count,
+    struct sockaddr_storage* out,
+    uint32_t* lengths)
+{
+    size_t converted = 0;
+    for (size_t i = 0; i < count; ++i) {
+        lengths[i] = (uint32_t)ipv6_to_sockaddr(&in[i], (struct sockaddr*)&out[i], sizeof(out[i]));
+        converted += lengths[i] != 0;
+    }
+    return converted;
+}
+
+//--------------------------------------------------------------------------------
+size_t ipv6_from_sockaddr_batch (
+    const struct sockaddr_storage* in,
+    size_t count,
+    ipv6_address_full_t* out,
+    uint32_t* scope_ids,
+    bool* parsed)
+{
+    size_t read = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const bool ok = ipv6_from_sockaddr((const struct sockaddr*)&in[i], sizeof(in[i]), &out[i],
+            scope_ids ? &scope_ids[i] : NULL);
+        if (!ok) {
+            memset(&out[i], 0, sizeof(out[i]));
+        }
+        if (parsed) {
+            parsed[i] = ok;
+        }
+        read += ok;
+    }
+    return read;
+}
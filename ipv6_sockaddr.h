@@ -0,0 +1,136 @@
+#pragma once
+// # Socket addresses
+//
+//     Convert parsed addresses to and from the socket API structures.
+//
+// Connecting to a parsed address no longer needs a round trip through
+// ipv6_to_str and inet_pton: the host order components are swapped into
+// network order bytes directly, or copied without a swap where
+// ipv6_from_str_network stored them in network order.
+//
+// - IPv4 compatible addresses (1.2.3.4:80) become AF_INET sockaddr_in
+// - Everything else becomes AF_INET6 sockaddr_in6, an interface zone
+//   (fe80::1%2) sets sin6_scope_id, by number or by interface name
+// - The port is copied in network order, 0 where none was given
+//
+// Reading a sockaddr back sets IPV6_FLAG_IPV4_COMPAT for AF_INET and
+// IPV6_FLAG_IPV4_EMBED for IPv4-mapped AF_INET6 addresses (::ffff:1.2.3.4), so
+// they format like the socket layer shows them.
+//
+
+#include "ipv6.h"
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+// ### ipv6_to_in6_addr
+//
+// Write the 128 bit address in network order. IPv4 compatible addresses are
+// written IPv4-mapped (::ffff:1.2.3.4). Port, mask and zone are not part of an
+// in6_addr and are ignored.
+//
+// ~~~~
+void ipv6_to_in6_addr (
+    const ipv6_address_full_t* in,
+    struct in6_addr* out);
+// ~~~~
+
+// ### ipv6_from_in6_addr
+//
+// Read a network order address, IPv4-mapped addresses are flagged
+// IPV6_FLAG_IPV4_EMBED
+//
+// ~~~~
+void ipv6_from_in6_addr (
+    const struct in6_addr* in,
+    ipv6_address_full_t* out);
+// ~~~~
+
+// ### ipv6_to_sockaddr
+//
+// Write a sockaddr_in or sockaddr_in6 to out, returns its size for the
+// address length argument of connect, bind or sendto. Returns 0 if out_bytes
+// is too small or the zone names no interface on this host.
+//
+// e.g.
+//
+//      struct sockaddr_storage storage;
+//      socklen_t length = (socklen_t)ipv6_to_sockaddr(&addr, (struct sockaddr*)&storage, sizeof(storage));
+//      if (length) connect(fd, (struct sockaddr*)&storage, length);
+//
+// ~~~~
+size_t ipv6_to_sockaddr (
+    const ipv6_address_full_t* in,
+    struct sockaddr* out,
+    size_t out_bytes);
+// ~~~~
+
+// ### ipv6_from_sockaddr
+//
+// Read an AF_INET or AF_INET6 socket address of in_bytes bytes, returns false
+// for other families or a short buffer. IPV6_FLAG_HAS_PORT is set for non-zero
+// ports. The zone has no string to point to, its sin6_scope_id is written to
+// scope_id, which may be NULL, and kept in zone with IPV6_FLAG_ZONE_ID when it
+// fits.
+//
+// ~~~~
+bool ipv6_from_sockaddr (
+    const struct sockaddr* in,
+    size_t in_bytes,
+    ipv6_address_full_t* out,
+    uint32_t* scope_id);
+// ~~~~
+
+// ### ipv6_to_in6_addr_batch
+//
+// ipv6_to_in6_addr for count addresses
+//
+// ~~~~
+void ipv6_to_in6_addr_batch (
+    const ipv6_address_full_t* in,
+    size_t count,
+    struct in6_addr* out);
+// ~~~~
+
+// ### ipv6_to_sockaddr_batch
+//
+// ipv6_to_sockaddr for count addresses into sockaddr_storage entries.
+// lengths[i] receives the address length, 0 where the conversion failed.
+// Returns the number of addresses converted.
+//
+// ~~~~
+size_t ipv6_to_sockaddr_batch (
+    const ipv6_address_full_t* in,
+    size_t count,
+    struct sockaddr_storage* out,
+    uint32_t* lengths);
+// ~~~~
+
+// ### ipv6_from_sockaddr_batch
+//
+// ipv6_from_sockaddr for count sockaddr_storage entries, scope_ids may be
+// NULL. Entries of other families are zeroed and parsed[i] set false, parsed
+// may be NULL. Returns the number of addresses read.
+//
+// ~~~~
+size_t ipv6_from_sockaddr_batch (
+    const struct sockaddr_storage* in,
+    size_t count,
+    ipv6_address_full_t* out,
+    uint32_t* scope_ids,
+    bool* parsed);
+// ~~~~
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,199 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L // clock_gettime
+#endif
+
+#include "ipv6_stats.h"
+#include "ipv6_config.h"
+
+#ifdef HAVE_STDIO_H
+#include <stdio.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#ifdef HAVE_STDARG_H
+#include <stdarg.h>
+#endif
+
+#include "ipv6_clock.h"
+
+//
+// Output cursor for the Prometheus report, counts the full length even when
+// the output buffer is exhausted
+//
+typedef struct {
+    char*                   output;
+    size_t                  output_bytes;
+    size_t                  length;
+} stats_writer_t;
+
+//--------------------------------------------------------------------------------
+static uint32_t length_bucket (size_t input_bytes)
+{
+    const size_t bucket = input_bytes ? (input_bytes - 1) / IPV6_STATS_LENGTH_WIDTH : 0;
+    return bucket < IPV6_STATS_LENGTH_BUCKETS ? (uint32_t)bucket : IPV6_STATS_LENGTH_BUCKETS - 1;
+}
+
+//--------------------------------------------------------------------------------
+static uint32_t latency_bucket (uint64_t ns)
+{
+    uint32_t bucket = 0;
+    while (ns > 1 && bucket < IPV6_STATS_LATENCY_BUCKETS - 1) {
+        ns >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+//--------------------------------------------------------------------------------
+void ipv6_stats_init (
+    ipv6_stats_t* stats)
+{
+    memset(stats, 0, sizeof(*stats));
+}
+
+//--------------------------------------------------------------------------------
+bool ipv6_from_str_stats (
+    const char* input,
+    size_t input_bytes,
+    ipv6_address_full_t* out,
+    ipv6_stats_t* stats)
+{
+    ipv6_diag_result_t diag;
+
+    const uint64_t start = ipv6_clock_ns();
+    const bool result = ipv6_from_str_compact(input, input_bytes, out, &diag);
+    const uint64_t elapsed = ipv6_clock_ns() - start;
+
+    stats->inputs++;
+    stats->bytes += input_bytes;
+    stats->latency_ns += elapsed;
+    stats->lengths[length_bucket(input_bytes)]++;
+    stats->latency[latency_bucket(elapsed)]++;
+
+    if (result) {
+        stats->accepted++;
+        stats->flags[out->flags & (IPV6_STATS_FLAG_COMBOS - 1)]++;
+    } else if ((uint32_t)diag.event < IPV6_DIAG_EVENT_COUNT) {
+        stats->events[diag.event]++;
+    }
+
+    return result;
+}
+
+//--------------------------------------------------------------------------------
+void ipv6_stats_merge (
+    ipv6_stats_t* into,
+    const ipv6_stats_t* from)
+{
+    into->inputs += from->inputs;
+    into->accepted += from->accepted;
+    into->bytes += from->bytes;
+    into->latency_ns += from->latency_ns;
+
+    for (uint32_t i = 0; i < IPV6_DIAG_EVENT_COUNT; ++i) {
+        into->events[i] += from->events[i];
+    }
+    for (uint32_t i = 0; i < IPV6_STATS_FLAG_COMBOS; ++i) {
+        into->flags[i] += from->flags[i];
+    }
+    for (uint32_t i = 0; i < IPV6_STATS_LENGTH_BUCKETS; ++i) {
+        into->lengths[i] += from->lengths[i];
+    }
+    for (uint32_t i = 0; i < IPV6_STATS_LATENCY_BUCKETS; ++i) {
+        into->latency[i] += from->latency[i];
+    }
+}
+
+//--------------------------------------------------------------------------------
+static void stats_printf (stats_writer_t* w, const char* format, ...)
+{
+    char* wp = NULL;
+    size_t remaining = 0;
+    va_list args;
+
+    if (w->length < w->output_bytes) {
+        wp = w->output + w->length;
+        remaining = w->output_bytes - w->length;
+    }
+
+    va_start(args, format);
+    const int written = vsnprintf(wp, remaining, format, args);
+    va_end(args);
+
+    if (written > 0) {
+        w->length += (size_t)written;
+    }
+}
+
+//--------------------------------------------------------------------------------
+static void stats_header (stats_writer_t* w, const char* name, const char* type, const char* help)
+{
+    stats_printf(w, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+//--------------------------------------------------------------------------------
+size_t ipv6_stats_to_prometheus (
+    const ipv6_stats_t* stats,
+    char* output,
+    size_t output_bytes)
+{
+    stats_writer_t w;
+    uint64_t cumulative;
+
+    w.output = output;
+    w.output_bytes = output ? output_bytes : 0;
+    w.length = 0;
+
+    if (w.output_bytes) {
+        *output = '\0';
+    }
+
+    stats_header(&w, "ipv6_parse_inputs_total", "counter", "Addresses passed to the parser by result.");
+    stats_printf(&w, "ipv6_parse_inputs_total{result=\"accepted\"} %llu\n",
+        (unsigned long long)stats->accepted);
+    stats_printf(&w, "ipv6_parse_inputs_total{result=\"rejected\"} %llu\n",
+        (unsigned long long)(stats->inputs - stats->accepted));
+
+    stats_header(&w, "ipv6_parse_diag_events_total", "counter", "Rejected addresses by diagnostic event.");
+    for (uint32_t i = 0; i < IPV6_DIAG_EVENT_COUNT; ++i) {
+        stats_printf(&w, "ipv6_parse_diag_events_total{event=\"%s\"} %llu\n",
+            ipv6_diag_event_str((ipv6_diag_event_t)i), (unsigned long long)stats->events[i]);
+    }
+
+    stats_header(&w, "ipv6_parse_accepted_flags_total", "counter", "Accepted addresses by notation features.");
+    for (uint32_t i = 0; i < IPV6_STATS_FLAG_COMBOS; ++i) {
+        stats_printf(&w, "ipv6_parse_accepted_flags_total{port=\"%d\",mask=\"%d\",embed=\"%d\",compat=\"%d\"} %llu\n",
+            (i & IPV6_FLAG_HAS_PORT) != 0,
+            (i & IPV6_FLAG_HAS_MASK) != 0,
+            (i & IPV6_FLAG_IPV4_EMBED) != 0,
+            (i & IPV6_FLAG_IPV4_COMPAT) != 0,
+            (unsigned long long)stats->flags[i]);
+    }
+
+    stats_header(&w, "ipv6_parse_input_bytes", "histogram", "Length of parser input in bytes.");
+    cumulative = 0;
+    for (uint32_t i = 0; i < IPV6_STATS_LENGTH_BUCKETS - 1; ++i) {
+        cumulative += stats->lengths[i];
+        stats_printf(&w, "ipv6_parse_input_bytes_bucket{le=\"%u\"} %llu\n",
+            (i + 1) * IPV6_STATS_LENGTH_WIDTH, (unsigned long long)cumulative);
+    }
+    stats_printf(&w, "ipv6_parse_input_bytes_bucket{le=\"+Inf\"} %llu\n", (unsigned long long)stats->inputs);
+    stats_printf(&w, "ipv6_parse_input_bytes_sum %llu\n", (unsigned long long)stats->bytes);
+    stats_printf(&w, "ipv6_parse_input_bytes_count %llu\n", (unsigned long long)stats->inputs);
+
+    stats_header(&w, "ipv6_parse_latency_seconds", "histogram", "Time spent parsing an address.");
+    cumulative = 0;
+    for (uint32_t i = 0; i < IPV6_STATS_LATENCY_BUCKETS - 1; ++i) {
+        cumulative += stats->latency[i];
+        stats_printf(&w, "ipv6_parse_latency_seconds_bucket{le=\"%g\"} %llu\n",
+            (double)(2ULL << i) * 1e-9, (unsigned long long)cumulative);
+    }
+    stats_printf(&w, "ipv6_parse_latency_seconds_bucket{le=\"+Inf\"} %llu\n", (unsigned long long)stats->inputs);
+    stats_printf(&w, "ipv6_parse_latency_seconds_sum %g\n", (double)stats->latency_ns * 1e-9);
+    stats_printf(&w, "ipv6_parse_latency_seconds_count %llu\n", (unsigned long long)stats->inputs);
+
+    return w.length;
+}
@@ -0,0 +1,105 @@
+#pragma once
+// # Aggregated parse statistics
+//
+//     Opt-in counters describing the traffic seen by the parser.
+//
+// ipv6_from_str_stats parses like ipv6_from_str and records the outcome in a
+// caller owned ipv6_stats_t instead of reporting through a diagnostic callback.
+// The structure is plain counters with no locking: keep one per thread and
+// combine them with ipv6_stats_merge when a report is needed.
+//
+// Recorded per input:
+//
+// - Count, bytes and accepted / rejected outcome
+// - The ipv6_diag_event_t of every rejection
+// - The port / mask / embed / compat flag combination of every accepted address
+// - Histograms of input length and parse latency
+//
+// ipv6_stats_to_prometheus renders the counters in the Prometheus text
+// exposition format, `ipv6-cmd --stats` does this for addresses read from stdin.
+//
+
+#include "ipv6.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/// Number of flag combinations, indexed by the low ipv6_flag_t bits
+#define IPV6_STATS_FLAG_COMBOS 16
+
+/// Input length buckets of IPV6_STATS_LENGTH_WIDTH bytes, the last bucket is open ended
+#define IPV6_STATS_LENGTH_BUCKETS 9
+#define IPV6_STATS_LENGTH_WIDTH 8
+
+/// Latency buckets, bucket N counts parses of [2^N, 2^(N+1)) nanoseconds, the last is open ended
+#define IPV6_STATS_LATENCY_BUCKETS 24
+
+// ### ipv6_stats_t
+//
+// Counters filled by ipv6_from_str_stats
+//
+// ~~~~
+typedef struct {
+    uint64_t                inputs;                                 // addresses parsed
+    uint64_t                accepted;                               // addresses parsed successfully
+    uint64_t                bytes;                                  // total input bytes
+    uint64_t                latency_ns;                             // total parse time in nanoseconds
+    uint64_t                events[IPV6_DIAG_EVENT_COUNT];          // rejections by ipv6_diag_event_t
+    uint64_t                flags[IPV6_STATS_FLAG_COMBOS];          // accepted addresses by flag combination
+    uint64_t                lengths[IPV6_STATS_LENGTH_BUCKETS];     // input length histogram
+    uint64_t                latency[IPV6_STATS_LATENCY_BUCKETS];    // log2 nanosecond latency histogram
+} ipv6_stats_t;
+// ~~~~
+
+
+// ### ipv6_stats_init
+//
+// Zero all counters
+//
+// ~~~~
+void ipv6_stats_init (
+    ipv6_stats_t* stats);
+// ~~~~
+
+// ### ipv6_from_str_stats
+//
+// Parse as ipv6_from_str, recording the input and its outcome in stats.
+// The stats argument must not be shared between threads without locking.
+//
+// ~~~~
+bool ipv6_from_str_stats (
+    const char* input,
+    size_t input_bytes,
+    ipv6_address_full_t* out,
+    ipv6_stats_t* stats);
+// ~~~~
+
+// ### ipv6_stats_merge
+//
+// Add the counters of from into into
+//
+// ~~~~
+void ipv6_stats_merge (
+    ipv6_stats_t* into,
+    const ipv6_stats_t* from);
+// ~~~~
+
+// ### ipv6_stats_to_prometheus
+//
+// Write the counters as Prometheus text exposition format.
+//
+// Returns the length of the full report excluding the nul byte, as snprintf
+// does. When that is not less than output_bytes the output was truncated.
+//
+// ~~~~
+size_t ipv6_stats_to_prometheus (
+    const ipv6_stats_t* stats,
+    char* output,
+    size_t output_bytes);
+// ~~~~
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,294 @@
+#include "ipv6_validate.h"
+#include "ipv6_parallel.h"
+#include "ipv6_config.h"
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <stdlib.h>
+
+//
+// The input is cut into chunks that the work-stealing loop hands to workers
+// in any order: index ranges for arrays, byte ranges for buffers. A buffer
+// chunk owns the lines that start inside it, so it needs no newline search
+// before the loop. Counts are summed per worker. Failures are recorded per
+// chunk with chunk local indices, merging the chunks in order yields them in
+// ascending index order for any worker count.
+//
+
+// Inputs and bytes per chunk
+#define VALIDATE_INPUTS_PER_CHUNK 1024
+#define VALIDATE_BYTES_PER_CHUNK (16 * 1024)
+
+//
+// A failing input, index is local to the chunk
+//
+typedef struct {
+    size_t                      index;
+    uint32_t                    event;
+    uint32_t                    position;
+} validate_failure_t;
+
+//
+// Failures and input count of one chunk
+//
+typedef struct {
+    validate_failure_t*         failures;
+    size_t                      failure_count;
+    size_t                      inputs;
+} validate_chunk_t;
+
+//
+// Totals of one worker
+//
+typedef struct {
+    size_t                      event_counts[IPV6_DIAG_EVENT_COUNT];
+    bool                        out_of_memory;
+} validate_worker_t;
+
+typedef struct {
+    const char* const*          inputs;             // array mode
+    const size_t*               lengths;
+    const char*                 buffer;             // lines mode when not NULL
+    size_t                      size;               // inputs or bytes
+    size_t                      chunk_size;
+    uint32_t                    max_examples;
+    bool                        collect_failures;
+    validate_chunk_t*           chunks;
+    validate_worker_t           workers[IPV6_BATCH_MAX_WORKERS];
+} validate_job_t;
+
+//
+// Failure list being built for a chunk
+//
+typedef struct {
+    validate_job_t*             job;
+    validate_worker_t*          worker;
+    validate_chunk_t*           chunk;
+    size_t                      capacity;
+    uint32_t                    example_counts[IPV6_DIAG_EVENT_COUNT];
+} validate_recorder_t;
+
+//--------------------------------------------------------------------------------
+static void validate_record (
+    validate_recorder_t* recorder,
+    size_t index,
+    const ipv6_diag_result_t* diag)
+{
+    validate_chunk_t* chunk = recorder->chunk;
+    const uint32_t event = (uint32_t)diag->event < IPV6_DIAG_EVENT_COUNT ?
+        (uint32_t)diag->event : IPV6_DIAG_INVALID_INPUT;
+
+    recorder->worker->event_counts[event]++;
+
+    // Without indices only the failures that can still become examples are kept
+    if (!recorder->job->collect_failures) {
+        if (recorder->example_counts[event] >= recorder->job->max_examples) {
+            return;
+        }
+        recorder->example_counts[event]++;
+    }
+
+    if (recorder->worker->out_of_memory) {
+        return;
+    }
+
+    if (chunk->failure_count == recorder->capacity) {
+        const size_t capacity = recorder->capacity ? recorder->capacity * 2 : 16;
+        validate_failure_t* failures = (validate_failure_t*)realloc(chunk->failures, capacity * sizeof(validate_failure_t));
+        if (!failures) {
+            recorder->worker->out_of_memory = true;
+            return;
+        }
+        chunk->failures = failures;
+        recorder->capacity = capacity;
+    }
+
+    validate_failure_t* failure = &chunk->failures[chunk->failure_count++];
+    failure->index = index;
+    failure->event = event;
+    failure->position = diag->position;
+}
+
+//--------------------------------------------------------------------------------
+static void validate_chunk (void* arg, uint32_t worker, size_t chunk)
+{
+    validate_job_t* job = (validate_job_t*)arg;
+    validate_recorder_t recorder;
+    ipv6_address_full_t addr;
+    ipv6_diag_result_t diag;
+
+    memset(&recorder, 0, sizeof(recorder));
+    recorder.job = job;
+    recorder.worker = &job->workers[worker];
+    recorder.chunk = &job->chunks[chunk];
+
+    const size_t begin = chunk * job->chunk_size;
+    const size_t end = job->size - begin < job->chunk_size ? job->size : begin + job->chunk_size;
+
+    if (!job->buffer) {
+        for (size_t i = begin; i < end; ++i) {
+            const char* input = job->inputs[i];
+            const size_t length = job->lengths ? job->lengths[i] : (input ? strlen(input) : 0);
+            if (!ipv6_from_str_compact(input, length, &addr, &diag)) {
+                validate_record(&recorder, i - begin, &diag);
+            }
+        }
+        recorder.chunk->inputs = end - begin;
+        return;
+    }
+
+    // Lines starting in [begin, end), the first starts after the newline before begin
+    const char* ep = job->buffer + job->size;
+    const char* cp = job->buffer + begin;
+    if (begin) {
+        const char* nl = (const char*)memchr(cp - 1, '\n', (size_t)(ep - cp) + 1);
+        cp = nl ? nl + 1 : ep;
+    }
+
+    size_t line = 0;
+    while (cp < job->buffer + end) {
+        const char* nl = (const char*)memchr(cp, '\n', (size_t)(ep - cp));
+        const char* line_end = nl ? nl : ep;
+        size_t length = (size_t)(line_end - cp);
+        if (length && cp[length - 1] == '\r') {
+            length--;
+        }
+
+        if (!ipv6_from_str_compact(cp, length, &addr, &diag)) {
+            validate_record(&recorder, line, &diag);
+        }
+
+        line++;
+        cp = nl ? nl + 1 : ep;
+    }
+    recorder.chunk->inputs = line;
+}
+
+//--------------------------------------------------------------------------------
+// Run all chunks, then merge them in order into the report
+static bool validate_execute (
+    validate_job_t* job,
+    const ipv6_validate_options_t* options,
+    ipv6_validate_report_t* report)
+{
+    const ipv6_executor_t* executor = options ? options->executor : NULL;
+    const size_t chunk_count = (job->size + job->chunk_size - 1) / job->chunk_size;
+    const uint32_t workers = ipv6_parallel_workers(options ? options->threads : 0, executor, chunk_count);
+    bool ok = true;
+
+    job->max_examples = (options && options->examples && options->examples < IPV6_VALIDATE_MAX_EXAMPLES) ?
+        options->examples : IPV6_VALIDATE_MAX_EXAMPLES;
+    job->collect_failures = !(options && options->skip_indices);
+    memset(job->workers, 0, workers * sizeof(validate_worker_t));
+
+    job->chunks = (validate_chunk_t*)calloc(chunk_count ? chunk_count : 1, sizeof(validate_chunk_t));
+    if (!job->chunks) {
+        return false;
+    }
+
+    ipv6_parallel_for(workers, chunk_count, executor, validate_chunk, job);
+
+    for (uint32_t w = 0; w < workers; ++w) {
+        for (uint32_t e = 0; e < IPV6_DIAG_EVENT_COUNT; ++e) {
+            report->event_counts[e] += job->workers[w].event_counts[e];
+            report->invalid += job->workers[w].event_counts[e];
+        }
+        ok = ok && !job->workers[w].out_of_memory;
+    }
+
+    size_t offset = 0;
+    for (uint32_t e = 0; e < IPV6_DIAG_EVENT_COUNT; ++e) {
+        report->event_offsets[e] = offset;
+        offset += report->event_counts[e];
+    }
+
+    if (ok && job->collect_failures && report->invalid) {
+        report->indices = (size_t*)malloc(report->invalid * sizeof(size_t));
+        ok = report->indices != NULL;
+    }
+
+    // Chunks in order give global indices, examples and a counting sort of
+    // the failures into event groups, all in ascending index order
+    size_t cursor[IPV6_DIAG_EVENT_COUNT];
+    memcpy(cursor, report->event_offsets, sizeof(cursor));
+
+    for (size_t c = 0; c < chunk_count; ++c) {
+        validate_chunk_t* chunk = &job->chunks[c];
+
+        for (size_t i = 0; ok && i < chunk->failure_count; ++i) {
+            const validate_failure_t* failure = &chunk->failures[i];
+            const size_t index = report->inputs + failure->index;
+
+            if (report->example_counts[failure->event] < job->max_examples) {
+                ipv6_validate_example_t* example = &report->examples[failure->event][report->example_counts[failure->event]++];
+                example->index = index;
+                example->position = failure->position;
+                example->pad0 = 0;
+            }
+            if (report->indices) {
+                report->indices[cursor[failure->event]++] = index;
+            }
+        }
+
+        report->inputs += chunk->inputs;
+        free(chunk->failures);
+    }
+    report->valid = report->inputs - report->invalid;
+
+    free(job->chunks);
+
+    if (!ok) {
+        ipv6_validate_report_free(report);
+    }
+    return ok;
+}
+
+//--------------------------------------------------------------------------------
+bool ipv6_validate_bulk (
+    const char* const* inputs,
+    const size_t* lengths,
+    size_t count,
+    const ipv6_validate_options_t* options,
+    ipv6_validate_report_t* report)
+{
+    validate_job_t job;
+
+    memset(&job, 0, offsetof(validate_job_t, workers));
+    memset(report, 0, sizeof(*report));
+
+    job.inputs = inputs;
+    job.lengths = lengths;
+    job.size = count;
+    job.chunk_size = ipv6_parallel_chunk_size(count, VALIDATE_INPUTS_PER_CHUNK);
+
+    return validate_execute(&job, options, report);
+}
+
+//--------------------------------------------------------------------------------
+bool ipv6_validate_lines (
+    const char* buffer,
+    size_t buffer_bytes,
+    const ipv6_validate_options_t* options,
+    ipv6_validate_report_t* report)
+{
+    validate_job_t job;
+
+    memset(&job, 0, offsetof(validate_job_t, workers));
+    memset(report, 0, sizeof(*report));
+
+    job.buffer = buffer;
+    job.size = buffer_bytes;
+    job.chunk_size = ipv6_parallel_chunk_size(buffer_bytes, VALIDATE_BYTES_PER_CHUNK);
+
+    return validate_execute(&job, options, report);
+}
+
+//--------------------------------------------------------------------------------
+void ipv6_validate_report_free (
+    ipv6_validate_report_t* report)
+{
+    free(report->indices);
+    memset(report, 0, sizeof(*report));
+}
@@ -0,0 +1,115 @@
+#pragma once
+// # Bulk validation
+//
+//     Validate large sets of addresses and report every failure by category.
+//
+// ipv6_validate_bulk checks an array of strings and ipv6_validate_lines
+// checks a buffer of newline separated addresses. Neither stops at the first
+// failure. The report carries the totals, the number of failures for each
+// ipv6_diag_event_t, the indices of all failing inputs grouped by event, and
+// the first examples of each event with the position of the error.
+//
+// Work is balanced over several threads by the work-stealing loop of the
+// batch API, or runs on a caller supplied executor (see ipv6_batch.h). The
+// report is the same for any thread count.
+//
+
+#include "ipv6.h"
+#include "ipv6_batch.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/// Maximum number of examples kept per diagnostic event
+#define IPV6_VALIDATE_MAX_EXAMPLES 16
+
+// ### ipv6_validate_options_t
+//
+// Settings for a validation run, zero initialize for defaults
+//
+// ~~~~
+typedef struct {
+    uint32_t                threads;            // worker threads, 0 for one per CPU
+    uint32_t                examples;           // examples per event, 0 for IPV6_VALIDATE_MAX_EXAMPLES
+    bool                    skip_indices;       // do not collect failing indices, only counts and examples
+    const ipv6_executor_t*  executor;           // NULL to start threads for the call
+} ipv6_validate_options_t;
+// ~~~~
+
+// ### ipv6_validate_example_t
+//
+// A failing input, index is the array index or the 0-based line number
+//
+// ~~~~
+typedef struct {
+    size_t                  index;              // index of the input
+    uint32_t                position;           // position of the error in the input
+    uint32_t                pad0;
+} ipv6_validate_example_t;
+// ~~~~
+
+// ### ipv6_validate_report_t
+//
+// Result of a validation run, release with ipv6_validate_report_free.
+//
+// The failing indices of event e, in ascending order, are
+// `indices[event_offsets[e] .. event_offsets[e] + event_counts[e])`.
+//
+// ~~~~
+typedef struct {
+    size_t                  inputs;                                 // inputs validated
+    size_t                  valid;                                  // inputs that parsed
+    size_t                  invalid;                                // inputs that failed
+    size_t                  event_counts[IPV6_DIAG_EVENT_COUNT];    // failures by event
+    size_t                  event_offsets[IPV6_DIAG_EVENT_COUNT];   // start of each event group in indices
+    size_t*                 indices;                                // failing indices grouped by event, NULL with skip_indices
+    uint32_t                example_counts[IPV6_DIAG_EVENT_COUNT];  // examples kept by event
+    ipv6_validate_example_t examples[IPV6_DIAG_EVENT_COUNT][IPV6_VALIDATE_MAX_EXAMPLES];
+} ipv6_validate_report_t;
+// ~~~~
+
+
+// ### ipv6_validate_bulk
+//
+// Validate count strings. lengths may be NULL for nul terminated inputs.
+// options may be NULL for defaults. Returns false if memory could not be
+// allocated, the report is then empty. Work of a thread that cannot be
+// started is taken over by the other workers.
+//
+// ~~~~
+bool ipv6_validate_bulk (
+    const char* const* inputs,
+    const size_t* lengths,
+    size_t count,
+    const ipv6_validate_options_t* options,
+    ipv6_validate_report_t* report);
+// ~~~~
+
+// ### ipv6_validate_lines
+//
+// Validate a buffer with one address per line. Lines end with "\n" or "\r\n",
+// the last line does not need a terminator. Empty lines are inputs and fail
+// with IPV6_DIAG_INVALID_INPUT. Indices are 0-based line numbers.
+//
+// ~~~~
+bool ipv6_validate_lines (
+    const char* buffer,
+    size_t buffer_bytes,
+    const ipv6_validate_options_t* options,
+    ipv6_validate_report_t* report);
+// ~~~~
+
+// ### ipv6_validate_report_free
+//
+// Release the memory held by a report
+//
+// ~~~~
+void ipv6_validate_report_free (
+    ipv6_validate_report_t* report);
+// ~~~~
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
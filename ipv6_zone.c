@@ -0,0 +1,206 @@
+#include "ipv6_zone.h"
+#include "ipv6_config.h"
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <stdlib.h>
+
+//
+// Name i is stored in names[i * IPV6_ZONE_NAME_SIZE] and has id i + 1. The
+// index is an open addressed hash table of ids, 0 marking a free bucket,
+// with at least twice as many buckets as names so probes stay short.
+//
+struct ipv6_zone_table_t {
+    char*                       names;
+    uint16_t*                   index;
+    uint32_t                    index_mask;
+    uint32_t                    capacity;
+    uint32_t                    count;
+};
+
+//--------------------------------------------------------------------------------
+// FNV-1a
+static uint32_t zone_hash (const char* name, size_t name_bytes)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < name_bytes; ++i) {
+        hash = (hash ^ (uint8_t)name[i]) * 16777619u;
+    }
+    return hash;
+}
+
+//--------------------------------------------------------------------------------
+static const char* zone_slot (const ipv6_zone_table_t* table, uint16_t zone)
+{
+    return table->names + (size_t)(zone - 1) * IPV6_ZONE_NAME_SIZE;
+}
+
+//--------------------------------------------------------------------------------
+// Bucket holding the name, or the free bucket where it belongs
+static uint32_t zone_probe (const ipv6_zone_table_t* table, const char* name, size_t name_bytes)
+{
+    uint32_t bucket = zone_hash(name, name_bytes) & table->index_mask;
+    for (;;) {
+        const uint16_t zone = table->index[bucket];
+        if (zone == 0) {
+            return bucket;
+        }
+
+        const char* slot = zone_slot(table, zone);
+        if (memcmp(slot, name, name_bytes) == 0 && slot[name_bytes] == '\0') {
+            return bucket;
+        }
+        bucket = (bucket + 1) & table->index_mask;
+    }
+}
+
+//--------------------------------------------------------------------------------
+ipv6_zone_table_t* ipv6_zone_table_create (
+    uint32_t capacity)
+{
+    if (capacity == 0 || capacity > IPV6_ZONE_MAX_NAMES) {
+        return NULL;
+    }
+
+    uint32_t buckets = 1;
+    while (buckets < 2 * capacity) {
+        buckets *= 2;
+    }
+
+    ipv6_zone_table_t* table = (ipv6_zone_table_t*)malloc(sizeof(ipv6_zone_table_t));
+    if (!table) {
+        return NULL;
+    }
+
+    table->names = (char*)calloc(capacity, IPV6_ZONE_NAME_SIZE);
+    table->index = (uint16_t*)calloc(buckets, sizeof(uint16_t));
+    if (!table->names || !table->index) {
+        free(table->names);
+        free(table->index);
+        free(table);
+        return NULL;
+    }
+
+    table->index_mask = buckets - 1;
+    table->capacity = capacity;
+    table->count = 0;
+    return table;
+}
+
+//--------------------------------------------------------------------------------
+void ipv6_zone_table_destroy (
+    ipv6_zone_table_t* table)
+{
+    if (table) {
+        free(table->names);
+        free(table->index);
+        free(table);
+    }
+}
+
+//--------------------------------------------------------------------------------
+uint16_t ipv6_zone_intern (
+    ipv6_zone_table_t* table,
+    const char* name,
+    size_t name_bytes)
+{
+    if (name_bytes == 0 || name_bytes >= IPV6_ZONE_NAME_SIZE || memchr(name, '\0', name_bytes)) {
+        return 0;
+    }
+
+    const uint32_t bucket = zone_probe(table, name, name_bytes);
+    if (table->index[bucket] != 0) {
+        return table->index[bucket];
+    }
+    if (table->count == table->capacity) {
+        return 0;
+    }
+
+    // The slot is written before the id is published, see ipv6_zone_name
+    const uint16_t zone = (uint16_t)(table->count + 1);
+    char* slot = table->names + (size_t)table->count * IPV6_ZONE_NAME_SIZE;
+    memcpy(slot, name, name_bytes);
+    slot[name_bytes] = '\0';
+    table->index[bucket] = zone;
+    table->count++;
+    return zone;
+}
+
+//--------------------------------------------------------------------------------
+uint16_t ipv6_zone_find (
+    const ipv6_zone_table_t* table,
+    const char* name,
+    size_t name_bytes)
+{
+    if (name_bytes == 0 || name_bytes >= IPV6_ZONE_NAME_SIZE) {
+        return 0;
+    }
+    return table->index[zone_probe(table, name, name_bytes)];
+}
+
+//--------------------------------------------------------------------------------
+const char* ipv6_zone_name (
+    const ipv6_zone_table_t* table,
+    uint16_t zone)
+{
+    // Slots are written once and interned names are never empty, so this
+    // does not read count, which another thread may be updating
+    if (zone == 0 || zone > table->capacity) {
+        return NULL;
+    }
+
+    const char* slot = zone_slot(table, zone);
+    return slot[0] != '\0' ? slot : NULL;
+}
+
+//--------------------------------------------------------------------------------
+uint32_t ipv6_zone_count (
+    const ipv6_zone_table_t* table)
+{
+    return table->count;
+}
+
+//--------------------------------------------------------------------------------
+bool ipv6_zone_intern_address (
+    ipv6_zone_table_t* table,
+    ipv6_address_full_t* address)
+{
+    if (address->flags & IPV6_FLAG_ZONE_INTERNED) {
+        return true;
+    }
+
+    if (address->flags & IPV6_FLAG_ZONE_ID) {
+        address->iface = NULL;
+        address->iface_len = 0;
+        return true;
+    }
+
+    if (!address->iface || address->iface_len == 0) {
+        return true;
+    }
+
+    const uint16_t zone = ipv6_zone_intern(table, address->iface, address->iface_len);
+    if (zone == 0) {
+        return false;
+    }
+
+    address->zone = zone;
+    address->iface = zone_slot(table, zone);
+    address->flags |= IPV6_FLAG_ZONE_INTERNED;
+    return true;
+}
+
+//--------------------------------------------------------------------------------
+size_t ipv6_zone_intern_batch (
+    ipv6_zone_table_t* table,
+    ipv6_address_full_t* addresses,
+    size_t count)
+{
+    size_t interned = 0;
+    for (size_t i = 0; i < count; ++i) {
+        interned += ipv6_zone_intern_address(table, &addresses[i]);
+    }
+    return interned;
+}
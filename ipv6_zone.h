@@ -0,0 +1,129 @@
+#pragma once
+// # Zone interning
+//
+//     Map interface names to small ids so zoned addresses outlive their input.
+//
+// The parser leaves the zone of fe80::1%eth0 as iface and iface_len, which
+// point into the input string. ipv6_zone_intern_address copies the name into
+// a table once and stores its id in zone with IPV6_FLAG_ZONE_INTERNED; iface
+// then points at the table's copy, so the address stays valid after the input
+// is freed and can be copied and compared by value. Numeric zones (fe80::1%3)
+// need no table, the parser keeps them in zone with IPV6_FLAG_ZONE_ID.
+//
+// Names live in fixed slots allocated with the table and never move. A table
+// is not synchronized: intern from one thread or under a lock. Looking up the
+// names of ids already returned is safe from any thread.
+//
+
+#include "ipv6.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/// Longest interned name, plus the terminating nul
+#define IPV6_ZONE_NAME_SIZE 64
+
+/// Most names a table can hold, ids are 1 to 65535
+#define IPV6_ZONE_MAX_NAMES 65535
+
+// ### ipv6_zone_table_t
+//
+// Opaque interning table, see ipv6_zone_table_create
+//
+// ~~~~
+typedef struct ipv6_zone_table_t ipv6_zone_table_t;
+// ~~~~
+
+// ### ipv6_zone_table_create
+//
+// Create a table for up to capacity names, at most IPV6_ZONE_MAX_NAMES.
+// Returns NULL if capacity is out of range or allocation fails.
+//
+// ~~~~
+ipv6_zone_table_t* ipv6_zone_table_create (
+    uint32_t capacity);
+// ~~~~
+
+// ### ipv6_zone_table_destroy
+//
+// Free a table, the iface of addresses interned in it must not be used after
+//
+// ~~~~
+void ipv6_zone_table_destroy (
+    ipv6_zone_table_t* table);
+// ~~~~
+
+// ### ipv6_zone_intern
+//
+// Id of a name, interning it the first time it is seen. Names are compared
+// byte for byte. Returns 0 if the name is empty, does not fit in
+// IPV6_ZONE_NAME_SIZE or the table is full.
+//
+// ~~~~
+uint16_t ipv6_zone_intern (
+    ipv6_zone_table_t* table,
+    const char* name,
+    size_t name_bytes);
+// ~~~~
+
+// ### ipv6_zone_find
+//
+// Id of an interned name without interning it, 0 if it is not in the table
+//
+// ~~~~
+uint16_t ipv6_zone_find (
+    const ipv6_zone_table_t* table,
+    const char* name,
+    size_t name_bytes);
+// ~~~~
+
+// ### ipv6_zone_name
+//
+// Nul terminated name of an id, NULL if no name has that id
+//
+// ~~~~
+const char* ipv6_zone_name (
+    const ipv6_zone_table_t* table,
+    uint16_t zone);
+// ~~~~
+
+// ### ipv6_zone_count
+//
+// Number of names interned
+//
+// ~~~~
+uint32_t ipv6_zone_count (
+    const ipv6_zone_table_t* table);
+// ~~~~
+
+// ### ipv6_zone_intern_address
+//
+// Make the zone of a parsed address independent of its input. A named zone
+// is interned: zone gets its id, IPV6_FLAG_ZONE_INTERNED is set and iface
+// points at the table's copy. A numeric zone only drops its iface pointer.
+// Returns true if the address has no zone left pointing into the input,
+// false if the name could not be interned; the address is unchanged then.
+//
+// ~~~~
+bool ipv6_zone_intern_address (
+    ipv6_zone_table_t* table,
+    ipv6_address_full_t* address);
+// ~~~~
+
+// ### ipv6_zone_intern_batch
+//
+// ipv6_zone_intern_address of count addresses, returns the number for which
+// it returned true
+//
+// ~~~~
+size_t ipv6_zone_intern_batch (
+    ipv6_zone_table_t* table,
+    ipv6_address_full_t* addresses,
+    size_t count);
+// ~~~~
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -1,4 +1,16 @@
 #include "ipv6.h"
+#include "ipv6_gen.h"
+#include "ipv6_stats.h"
+#include "ipv6_profile.h"
+#include "ipv6_validate.h"
+#include "ipv6_batch.h"
+#include "ipv6_counters.h"
+#include "ipv6_cache.h"
+#include "ipv6_pipeline.h"
+#include "ipv6_sockaddr.h"
+#include "ipv6_classify.h"
+#include "ipv6_nat64.h"
+#include "ipv6_zone.h"
 #include "ipv6_config.h"
 #include "ipv6_test_config.h"
 
@@ -24,6 +36,10 @@
 #include <winsock2.h>
 #endif
 
+#if !defined(_WIN32)
+#include <pthread.h>
+#endif
+
 #ifdef HAVE_WS_2_TCPIP_H
 #include <ws2tcpip.h>
 #endif
@@ -136,7 +152,6 @@ typedef struct {
 #define TEST_FAILED(...) \
     printf("  FAILED %s:%d", (const char *)__FILE__, (int32_t)__LINE__); \
     printf(__VA_ARGS__); \
-    failed = true; \
     status->failed_count++; \
     status->total_tests++
 
@@ -245,7 +260,6 @@ static void test_parsing (test_status_t* status) {
     for (uint32_t i = 0; i < LENGTHOF(tests); ++i) {
         ipv6_address_full_t test;
         ipv6_address_full_t parsed;
-        bool failed = false;
 
         memset(&test, 0, sizeof(test));
         memset(&parsed, 0, sizeof(parsed));
@@ -339,24 +353,32 @@ static void test_parsing_diag (test_status_t* status) {
         { "0:0:0:0:0:0:0:0:0", IPV6_DIAG_V6_BAD_COMPONENT_COUNT }, // too many components
         { "0:::", IPV6_DIAG_INVALID_ABBREV }, // invalid abbreviation
         { "1ffff::", IPV6_DIAG_V6_COMPONENT_OUT_OF_RANGE }, // out of bounds separator
+        { "ffffffff::1", IPV6_DIAG_V6_COMPONENT_OUT_OF_RANGE }, // component overflowing 32 bits
         { "ffff::/129", IPV6_DIAG_INVALID_CIDR_MASK }, // out of bounds CIDR mask
         { "[[f::]", IPV6_DIAG_INVALID_BRACKETS }, // invalid brackets
         { "[f::[", IPV6_DIAG_INVALID_BRACKETS }, // invalid brackets
         { "]f::]", IPV6_DIAG_INVALID_INPUT }, // invalid brackets
         { "[f::]::", IPV6_DIAG_INVALID_INPUT }, // invalid port spec
         { "[f::]:70000", IPV6_DIAG_INVALID_PORT }, // invalid port spec
+        { "[f::]:4294967296", IPV6_DIAG_INVALID_PORT }, // port overflowing 32 bits
+        { "ffff::/4294967424", IPV6_DIAG_INVALID_CIDR_MASK }, // mask overflowing 32 bits
         { "ffff::1.2.3.4:bbbb", IPV6_DIAG_IPV4_INCORRECT_POSITION }, // ipv6 separator after embedding
         { "1.2.3.4:bbbb::", IPV6_DIAG_INVALID_INPUT }, // invalid port string
         { "ffff::1.2.3.4.5", IPV6_DIAG_V4_BAD_COMPONENT_COUNT }, // invalid octet count
         { "111.222.333.444", IPV6_DIAG_V4_COMPONENT_OUT_OF_RANGE }, // component is too large for IPv4
         { "111.222.255.255:70000", IPV6_DIAG_INVALID_PORT }, // port is too large
         { "111.222.255:1010", IPV6_DIAG_V4_BAD_COMPONENT_COUNT }, // wrong number of components
+        { "10.0.0.0/255.0.255.0", IPV6_DIAG_INVALID_CIDR_MASK }, // netmask ones are not contiguous
+        { "10.0.0.0/255.255.0", IPV6_DIAG_INVALID_CIDR_MASK }, // netmask with three octets
+        { "10.0.0.0/255..255.0", IPV6_DIAG_INVALID_CIDR_MASK }, // empty netmask octet
+        { "ffff::/255.255.0.0", IPV6_DIAG_INVALID_CIDR_MASK }, // netmask of an IPv6 address
+        { "10.1.*.*", IPV6_DIAG_INVALID_INPUT_CHAR }, // wildcards are only read as ranges
+        { "10.0.0.1-10.0.0.9", IPV6_DIAG_INVALID_INPUT_CHAR }, // ranges are only read as ranges
     };
 
     for (uint32_t i = 0; i < LENGTHOF(tests); ++i) {
         ipv6_address_full_t addr;
         diag_test_capture_t capture;
-        bool failed = false;
 
         memset(&addr, 0, sizeof(addr));
         memset(&capture, 0, sizeof(capture));
@@ -400,6 +422,70 @@ static void test_parsing_diag (test_status_t* status) {
                 TEST_PASSED();
             }
         }
+
+        // The compact parser must record the same event without a callback
+        ipv6_diag_result_t result;
+        memset(&result, 0xff, sizeof(result));
+        if (ipv6_from_str_compact(tests[i].input, strlen(tests[i].input), &addr, &result)) {
+            TEST_FAILED("    ipv6_from_str_compact was expected to fail\n");
+        }
+        else if (result.event != tests[i].expected_event || result.position > strlen(tests[i].input)) {
+            TEST_FAILED("    ipv6_from_str_compact failed, event %u != %u (expected), position %u\n",
+                result.event,
+                tests[i].expected_event,
+                result.position);
+        }
+        else {
+            TEST_PASSED();
+        }
+    }
+}
+
+// Rendering of compact diagnostics
+static void test_diag_describe (test_status_t* status) {
+    const char* input = "::1g";
+    ipv6_address_full_t addr;
+    ipv6_diag_result_t result;
+
+    if (ipv6_from_str_compact(input, strlen(input), &addr, &result) ||
+        result.event != IPV6_DIAG_INVALID_INPUT_CHAR ||
+        result.position != 3) {
+        TEST_FAILED("    expected invalid-input-char at position 3\n");
+        return;
+    }
+    TEST_PASSED();
+
+    const char* expected =
+        "Invalid input character (invalid-input-char) at position 3\n"
+        "    ::1g\n"
+        "       ^\n";
+
+    char buffer[128];
+    const size_t length = ipv6_diag_describe(result.event, input, strlen(input), result.position,
+        buffer, sizeof(buffer));
+    if (length != strlen(expected) || strcmp(buffer, expected)) {
+        TEST_FAILED("    unexpected description:\n%s\n", buffer);
+    } else {
+        TEST_PASSED();
+    }
+
+    // Truncation reports the full length and stays nul terminated
+    char small[10];
+    if (ipv6_diag_describe(result.event, input, strlen(input), result.position, small, sizeof(small)) != length ||
+        strlen(small) != sizeof(small) - 1) {
+        TEST_FAILED("    truncated description\n");
+    } else {
+        TEST_PASSED();
+    }
+
+    // End of input errors place the caret just past the input
+    input = "1:2:3";
+    ipv6_from_str_compact(input, strlen(input), &addr, &result);
+    ipv6_diag_describe(result.event, input, strlen(input), result.position, buffer, sizeof(buffer));
+    if (result.position != 5 || !strstr(buffer, "\n    1:2:3\n         ^\n")) {
+        TEST_FAILED("    unexpected end of input description:\n%s\n", buffer);
+    } else {
+        TEST_PASSED();
     }
 }
 
@@ -471,7 +557,6 @@ static void test_comparisons(test_status_t* status) {
     for (uint32_t i = 0; i < LENGTHOF(tests); ++i) {
         ipv6_address_full_t left, right;
         diag_test_capture_t capture;
-        bool failed = false;
 
         memset(&left, 0, sizeof(left));
         memset(&right, 0, sizeof(right));
@@ -522,7 +607,6 @@ static void test_comparisons(test_status_t* status) {
 
 static void test_api_use_loopback_const (test_status_t* status) {
     // Just treat all of the checks in this function as a single test
-    bool failed = false;
     status->total_tests = 1;
 
     // test using the host order network constant directly in an ipv6_address_full_t
@@ -589,10 +673,68 @@ static void test_api_use_loopback_const (test_status_t* status) {
     }
 }
 
+// Every spelling of an address must normalize to the same key
+static void test_normalize (test_status_t* status) {
+    typedef struct {
+        const char*         str;
+        const char*         same_as;    // normalizes identically
+        const char*         expected;   // ipv6_to_str of the normalized address
+    } test_normalize_t;
+
+    const test_normalize_t tests[] = {
+        { "1.2.3.4", "::ffff:1.2.3.4", "::ffff:1.2.3.4" },
+        { "1.2.3.4", "::ffff:102:304", "::ffff:1.2.3.4" },
+        { "1.2.3.4", "0:0:0:0:0:ffff:0102:0304", "::ffff:1.2.3.4" },
+        { "10.1.2.0/24", "::ffff:10.1.2.0/120", "::ffff:10.1.2.0/120" },
+        { "10.1.2.3:80", "[::ffff:a01:203]:80", "[::ffff:10.1.2.3]:80" },
+        { "::1.2.3.4", "::102:304", "::102:304" },
+        { "64:ff9b::1.2.3.4", "64:ff9b::102:304", "64:ff9b::102:304" },
+        { "2001:db8::1", "2001:0db8:0:0::1", "2001:db8::1" },
+    };
+
+    for (uint32_t i = 0; i < LENGTHOF(tests); ++i) {
+        ipv6_address_full_t a, b, network;
+        char str[IPV6_GEN_STRING_SIZE];
+
+        if (!ipv6_from_str(tests[i].str, strlen(tests[i].str), &a) ||
+            !ipv6_from_str(tests[i].same_as, strlen(tests[i].same_as), &b) ||
+            !ipv6_from_str_network(tests[i].str, strlen(tests[i].str), &network, NULL)) {
+            TEST_FAILED("    failed to parse %s or %s\n", tests[i].str, tests[i].same_as);
+            continue;
+        }
+
+        // In place, and from network order
+        ipv6_normalize(&a, &a);
+        ipv6_normalize(&b, &b);
+        ipv6_normalize(&network, &network);
+
+        if (memcmp(&a.address, &b.address, sizeof(a.address)) || a.flags != b.flags ||
+            a.mask != b.mask || a.port != b.port ||
+            memcmp(&a.address, &network.address, sizeof(a.address)) || a.flags != network.flags ||
+            ipv6_compare(&a, &b, 0) != IPV6_COMPARE_OK ||
+            !ipv6_to_str(&a, str, sizeof(str)) || strcmp(str, tests[i].expected)) {
+            TEST_FAILED("    %s and %s normalize differently (%s)\n", tests[i].str, tests[i].same_as, str);
+        } else {
+            TEST_PASSED();
+        }
+    }
+
+    // Distinct addresses stay distinct
+    ipv6_address_full_t mapped, compat;
+    ipv6_from_str("1.2.3.4", 7, &mapped);
+    ipv6_from_str("::1.2.3.4", 9, &compat);
+    ipv6_normalize(&mapped, &mapped);
+    ipv6_normalize(&compat, &compat);
+    if (!memcmp(&mapped.address, &compat.address, sizeof(mapped.address))) {
+        TEST_FAILED("    ::1.2.3.4 normalized into the mapped space\n");
+    } else {
+        TEST_PASSED();
+    }
+}
+
 static void test_invalid_to_str(test_status_t* status) {
     ipv6_address_full_t address;
     const char* test_str = "::1:2:3:4:5";
-    bool failed;
     
     if (!ipv6_from_str(test_str, strlen(test_str), &address)) {
         TEST_FAILED("    ipv6_from_str failed for %s\n", test_str);
@@ -619,13 +761,1670 @@ static void test_invalid_to_str(test_status_t* status) {
     }    
 }
 
+// Every generated address must parse with the outcome the generator predicts
+static void test_generator (test_status_t* status) {
+    ipv6_gen_config_t config;
+    ipv6_gen_t gen;
+
+    ipv6_gen_config_init(&config, 1234);
+    config.port_rate = 0.3;
+    config.mask_rate = 0.3;
+    config.zone_rate = 0.2;
+    config.embed_rate = 0.3;
+    ipv6_gen_set_invalid_rate(&config, 0.5);
+
+    if (!ipv6_gen_init(&gen, &config)) {
+        TEST_FAILED("    ipv6_gen_init failed\n");
+        return;
+    }
+
+    uint32_t events_seen[IPV6_DIAG_EVENT_COUNT];
+    memset(events_seen, 0, sizeof(events_seen));
+
+    for (uint32_t i = 0; i < 20000; ++i) {
+        char str[IPV6_GEN_STRING_SIZE];
+        char again[IPV6_GEN_STRING_SIZE];
+        ipv6_gen_info_t info;
+        ipv6_address_full_t addr;
+        diag_test_capture_t capture;
+
+        const size_t len = ipv6_gen_at(&gen, i, str, sizeof(str), &info);
+        ipv6_gen_at(&gen, i, again, sizeof(again), NULL);
+        if (len == 0 || strlen(str) != len || strcmp(str, again) != 0) {
+            TEST_FAILED("    ipv6_gen_at is not deterministic at index %u: %s\n", i, str);
+            continue;
+        }
+
+        memset(&capture, 0, sizeof(capture));
+        const bool parsed = ipv6_from_str_diag(str, len, &addr, test_parsing_diag_fn, &capture);
+
+        if (info.valid) {
+            if (!parsed) {
+                TEST_FAILED("    generated address failed to parse: %s (%s)\n",
+                    str, capture.message);
+            } else if (addr.flags != info.flags) {
+                TEST_FAILED("    generated address flags %08x != %08x (expected): %s\n",
+                    addr.flags, info.flags, str);
+            } else {
+                TEST_PASSED();
+            }
+        } else {
+            events_seen[info.expected_event]++;
+            if (parsed) {
+                TEST_FAILED("    generated error was accepted: %s (%s)\n",
+                    str, ipv6_diag_event_str(info.expected_event));
+            } else if (capture.calls != 1 || capture.event != info.expected_event) {
+                TEST_FAILED("    generated error %s reported as %s: %s\n",
+                    ipv6_diag_event_str(info.expected_event),
+                    ipv6_diag_event_str(capture.event),
+                    str);
+            } else {
+                TEST_PASSED();
+            }
+        }
+    }
+
+    // Every supported event should be produced by a 50% error rate
+    for (uint32_t e = 0; e < IPV6_DIAG_EVENT_COUNT; ++e) {
+        if (ipv6_gen_event_supported((ipv6_diag_event_t)e) && events_seen[e] == 0) {
+            TEST_FAILED("    event never generated: %s\n", ipv6_diag_event_str((ipv6_diag_event_t)e));
+        }
+    }
+
+    // A different seed must produce a different stream
+    char first[IPV6_GEN_STRING_SIZE];
+    char second[IPV6_GEN_STRING_SIZE];
+    ipv6_gen_at(&gen, 0, first, sizeof(first), NULL);
+    config.seed++;
+    ipv6_gen_init(&gen, &config);
+    ipv6_gen_at(&gen, 0, second, sizeof(second), NULL);
+    if (!strcmp(first, second)) {
+        TEST_FAILED("    seeds %u and %u generated the same address: %s\n", 1234, 1235, first);
+    } else {
+        TEST_PASSED();
+    }
+}
+
+// Statistics must count outcomes, events and flags and merge across collectors
+static void test_stats (test_status_t* status) {
+    const char* inputs[] = {
+        "::1",
+        "[::1]:80",
+        "10.0.0.1/8",
+        "::ffff:1.2.3.4",
+        "[::1]:99999",
+        "1:2:3:4:5:6:7:8:9",
+    };
+
+    ipv6_stats_t a, b;
+    ipv6_address_full_t addr;
+
+    ipv6_stats_init(&a);
+    ipv6_stats_init(&b);
+
+    for (uint32_t i = 0; i < LENGTHOF(inputs); ++i) {
+        // Split over two collectors as separate threads would
+        ipv6_from_str_stats(inputs[i], strlen(inputs[i]), &addr, (i & 1) ? &b : &a);
+    }
+    ipv6_stats_merge(&a, &b);
+
+    if (a.inputs != 6 || a.accepted != 4) {
+        TEST_FAILED("    expected 6 inputs, 4 accepted: %u, %u\n", (uint32_t)a.inputs, (uint32_t)a.accepted);
+    } else {
+        TEST_PASSED();
+    }
+
+    if (a.events[IPV6_DIAG_INVALID_PORT] != 1 || a.events[IPV6_DIAG_V6_BAD_COMPONENT_COUNT] != 1) {
+        TEST_FAILED("    rejection events not counted\n");
+    } else {
+        TEST_PASSED();
+    }
+
+    if (a.flags[0] != 1 ||
+        a.flags[IPV6_FLAG_HAS_PORT] != 1 ||
+        a.flags[IPV6_FLAG_HAS_MASK | IPV6_FLAG_IPV4_COMPAT] != 1 ||
+        a.flags[IPV6_FLAG_IPV4_EMBED] != 1) {
+        TEST_FAILED("    flag combinations not counted\n");
+    } else {
+        TEST_PASSED();
+    }
+
+    uint64_t lengths = 0, latency = 0;
+    for (uint32_t i = 0; i < IPV6_STATS_LENGTH_BUCKETS; ++i) {
+        lengths += a.lengths[i];
+    }
+    for (uint32_t i = 0; i < IPV6_STATS_LATENCY_BUCKETS; ++i) {
+        latency += a.latency[i];
+    }
+    if (lengths != 6 || latency != 6 || a.lengths[0] != 2 || a.lengths[2] != 1) {
+        TEST_FAILED("    histograms do not cover every input\n");
+    } else {
+        TEST_PASSED();
+    }
+
+    char report[8192];
+    const size_t length = ipv6_stats_to_prometheus(&a, report, sizeof(report));
+    if (length >= sizeof(report) || strlen(report) != length ||
+        !strstr(report, "ipv6_parse_inputs_total{result=\"rejected\"} 2\n") ||
+        !strstr(report, "ipv6_parse_diag_events_total{event=\"invalid-port\"} 1\n") ||
+        !strstr(report, "ipv6_parse_accepted_flags_total{port=\"1\",mask=\"0\",embed=\"0\",compat=\"0\"} 1\n") ||
+        !strstr(report, "ipv6_parse_input_bytes_bucket{le=\"+Inf\"} 6\n")) {
+        TEST_FAILED("    unexpected prometheus report:\n%s\n", report);
+    } else {
+        TEST_PASSED();
+    }
+
+    // Truncated output reports the full length and stays nul terminated
+    char small[32];
+    if (ipv6_stats_to_prometheus(&a, small, sizeof(small)) != length || strlen(small) != sizeof(small) - 1) {
+        TEST_FAILED("    truncated prometheus report\n");
+    } else {
+        TEST_PASSED();
+    }
+}
+
+// Sampled profiles must attribute every call to its shape when sampling 1-in-1
+static void test_profile (test_status_t* status) {
+    const struct {
+        const char*             input;
+        ipv6_profile_shape_t    shape;
+    } inputs[] = {
+        { "::1",                IPV6_PROFILE_SHAPE_V6 },
+        { "::ffff:1.2.3.4",     IPV6_PROFILE_SHAPE_V6 },
+        { "1.2.3.4:80",         IPV6_PROFILE_SHAPE_V4 },
+        { "[::1]:80",           IPV6_PROFILE_SHAPE_BRACKETED },
+        { "2001:db8::/32",      IPV6_PROFILE_SHAPE_MASKED },
+        { "1:2:3",              IPV6_PROFILE_SHAPE_INVALID },
+    };
+
+    static ipv6_profile_snapshot_t snapshot;
+    ipv6_address_full_t addr;
+    char buffer[64];
+
+#ifndef PARSE_PROFILE
+    if (ipv6_profile_snapshot(&snapshot)) {
+        TEST_FAILED("    snapshot available without PARSE_PROFILE\n");
+    } else {
+        TEST_PASSED();
+    }
+    return;
+#endif
+
+    ipv6_profile_set_sample_rate(1);
+    ipv6_profile_reset();
+
+    for (uint32_t round = 0; round < 10; ++round) {
+        for (uint32_t i = 0; i < LENGTHOF(inputs); ++i) {
+            if (ipv6_from_str(inputs[i].input, strlen(inputs[i].input), &addr)) {
+                ipv6_to_str(&addr, buffer, sizeof(buffer));
+            }
+        }
+    }
+
+    if (!ipv6_profile_snapshot(&snapshot) || snapshot.threads < 1) {
+        TEST_FAILED("    ipv6_profile_snapshot failed\n");
+        return;
+    }
+
+    for (uint32_t shape = 0; shape < IPV6_PROFILE_SHAPE_COUNT; ++shape) {
+        uint64_t expected = 0;
+        for (uint32_t i = 0; i < LENGTHOF(inputs); ++i) {
+            expected += (inputs[i].shape == (ipv6_profile_shape_t)shape) ? 10 : 0;
+        }
+
+        const ipv6_profile_histogram_t* parse = &snapshot.histograms[IPV6_PROFILE_OP_FROM_STR][shape];
+        const ipv6_profile_histogram_t* format = &snapshot.histograms[IPV6_PROFILE_OP_TO_STR][shape];
+        const uint64_t expected_format = (shape == IPV6_PROFILE_SHAPE_INVALID) ? 0 : expected;
+
+        if (parse->count != expected || format->count != expected_format) {
+            TEST_FAILED("    shape %s sampled %u parses, %u formats, expected %u\n",
+                ipv6_profile_shape_str((ipv6_profile_shape_t)shape),
+                (uint32_t)parse->count, (uint32_t)format->count, (uint32_t)expected);
+        } else if (ipv6_profile_value_at_percentile(parse, 50.0) >
+                   ipv6_profile_value_at_percentile(parse, 99.0)) {
+            TEST_FAILED("    shape %s percentiles out of order\n",
+                ipv6_profile_shape_str((ipv6_profile_shape_t)shape));
+        } else {
+            TEST_PASSED();
+        }
+    }
+
+    // Reset starts a new period and a zero rate stops sampling
+    ipv6_profile_reset();
+    ipv6_profile_set_sample_rate(0);
+    ipv6_from_str("::1", 3, &addr);
+    ipv6_from_str("::1", 3, &addr);
+    ipv6_profile_snapshot(&snapshot);
+    if (snapshot.histograms[IPV6_PROFILE_OP_FROM_STR][IPV6_PROFILE_SHAPE_V6].count > 1) {
+        TEST_FAILED("    samples recorded after reset with sampling disabled\n");
+    } else {
+        TEST_PASSED();
+    }
+
+    // Exited workers hand their histograms on, counts included
+    static const char* batch_inputs[1000];
+    static ipv6_address_full_t batch_out[LENGTHOF(batch_inputs)];
+    ipv6_batch_options_t options;
+    const uint32_t calls = 50;
+    memset(&options, 0, sizeof(options));
+    options.threads = 4;
+    for (uint32_t i = 0; i < LENGTHOF(batch_inputs); ++i) {
+        batch_inputs[i] = "2001:db8::1";
+    }
+
+    ipv6_profile_set_sample_rate(1);
+    ipv6_profile_reset();
+    for (uint32_t call = 0; call < calls; ++call) {
+        ipv6_batch_from_str(batch_inputs, NULL, LENGTHOF(batch_inputs), batch_out, NULL, NULL, &options);
+    }
+    ipv6_profile_snapshot(&snapshot);
+    const uint64_t sampled = snapshot.histograms[IPV6_PROFILE_OP_FROM_STR][IPV6_PROFILE_SHAPE_V6].count;
+    if (snapshot.threads > 2 * options.threads || sampled != (uint64_t)calls * LENGTHOF(batch_inputs)) {
+        TEST_FAILED("    %u thread records, %llu samples after %u batches\n",
+            snapshot.threads, (unsigned long long)sampled, calls);
+    } else {
+        TEST_PASSED();
+    }
+
+    ipv6_profile_set_sample_rate(IPV6_PROFILE_DEFAULT_SAMPLE_RATE);
+}
+
+// Entry points compiled with IPV6_PARSE_HEADER_ONLY, see test_header_only.c
+bool test_header_only_from_str (const char* input, size_t input_bytes, ipv6_address_full_t* out, ipv6_diag_result_t* result);
+size_t test_header_only_to_str (const ipv6_address_full_t* in, char* output, size_t output_bytes);
+ipv6_compare_result_t test_header_only_compare (const ipv6_address_full_t* a, const ipv6_address_full_t* b, uint32_t ignore_flags);
+
+// The header-only build must behave exactly like the library
+static void test_header_only (test_status_t* status) {
+    ipv6_gen_config_t config;
+    ipv6_gen_t gen;
+
+    ipv6_gen_config_init(&config, 4321);
+    config.port_rate = 0.3;
+    config.mask_rate = 0.3;
+    config.embed_rate = 0.3;
+    ipv6_gen_set_invalid_rate(&config, 0.3);
+
+    if (!ipv6_gen_init(&gen, &config)) {
+        TEST_FAILED("    ipv6_gen_init failed\n");
+        return;
+    }
+
+    for (uint32_t i = 0; i < 2000; ++i) {
+        char str[IPV6_GEN_STRING_SIZE];
+        char lib_str[IPV6_GEN_STRING_SIZE];
+        char inline_str[IPV6_GEN_STRING_SIZE];
+        ipv6_address_full_t lib_addr, inline_addr;
+        ipv6_diag_result_t lib_diag, inline_diag;
+
+        const size_t len = ipv6_gen_at(&gen, i, str, sizeof(str), NULL);
+        const bool lib_parsed = ipv6_from_str_compact(str, len, &lib_addr, &lib_diag);
+        const bool inline_parsed = test_header_only_from_str(str, len, &inline_addr, &inline_diag);
+
+        if (lib_parsed != inline_parsed) {
+            TEST_FAILED("    header-only parse result differs: %s\n", str);
+        } else if (!lib_parsed) {
+            if (lib_diag.event != inline_diag.event || lib_diag.position != inline_diag.position) {
+                TEST_FAILED("    header-only diagnostic differs: %s\n", str);
+            } else {
+                TEST_PASSED();
+            }
+        } else {
+            const size_t lib_len = ipv6_to_str(&lib_addr, lib_str, sizeof(lib_str));
+            const size_t inline_len = test_header_only_to_str(&inline_addr, inline_str, sizeof(inline_str));
+            if (lib_len != inline_len || strcmp(lib_str, inline_str) ||
+                test_header_only_compare(&lib_addr, &inline_addr, 0) != IPV6_COMPARE_OK) {
+                TEST_FAILED("    header-only address differs: %s -> %s != %s\n", str, inline_str, lib_str);
+            } else {
+                TEST_PASSED();
+            }
+        }
+    }
+}
+
+// Executor running the workers one after another in reverse order
+static void test_reverse_executor (void* context, uint32_t workers, ipv6_work_func_t work, void* arg) {
+    (*(uint32_t*)context)++;
+    for (uint32_t w = workers; w > 0; --w) {
+        work(arg, w - 1);
+    }
+}
+
+// Batch calls must match the single address calls for any worker count and chunk size
+static void test_batch (test_status_t* status) {
+    static char strs[5000][IPV6_GEN_STRING_SIZE];
+    static const char* inputs[LENGTHOF(strs)];
+    static ipv6_address_full_t addrs[LENGTHOF(strs)];
+    static ipv6_diag_result_t diags[LENGTHOF(strs)];
+    static bool parsed[LENGTHOF(strs)];
+    static char output[LENGTHOF(strs)][IPV6_GEN_STRING_SIZE];
+    static size_t lengths[LENGTHOF(strs)];
+    ipv6_gen_config_t config;
+    ipv6_gen_t gen;
+    uint32_t executor_runs = 0;
+    size_t expected_valid = 0;
+
+    ipv6_gen_config_init(&config, 6065);
+    config.port_rate = 0.3;
+    config.mask_rate = 0.3;
+    config.embed_rate = 0.3;
+    ipv6_gen_set_invalid_rate(&config, 0.3);
+
+    if (!ipv6_gen_init(&gen, &config)) {
+        TEST_FAILED("    ipv6_gen_init failed\n");
+        return;
+    }
+
+    for (uint32_t i = 0; i < LENGTHOF(strs); ++i) {
+        ipv6_address_full_t addr;
+        ipv6_diag_result_t diag;
+        ipv6_gen_at(&gen, i, strs[i], sizeof(strs[i]), NULL);
+        inputs[i] = strs[i];
+        expected_valid += ipv6_from_str_compact(strs[i], strlen(strs[i]), &addr, &diag) ? 1 : 0;
+    }
+
+    ipv6_executor_t executor = { test_reverse_executor, &executor_runs, 3, 0 };
+    ipv6_batch_options_t runs[4];
+    memset(runs, 0, sizeof(runs));
+    runs[0].threads = 1;
+    runs[1].threads = 4;
+    runs[2].threads = 8;
+    runs[2].chunk = 7;
+    runs[3].executor = &executor;
+    runs[3].chunk = 13;
+
+    for (uint32_t r = 0; r < LENGTHOF(runs); ++r) {
+        memset(addrs, 0xff, sizeof(addrs));
+        const size_t valid = ipv6_batch_from_str(inputs, NULL, LENGTHOF(strs), addrs, parsed, diags, &runs[r]);
+        const size_t written = ipv6_batch_to_str(addrs, LENGTHOF(strs), output[0], sizeof(output[0]), lengths, &runs[r]);
+        uint32_t mismatches = 0;
+
+        for (uint32_t i = 0; i < LENGTHOF(strs); ++i) {
+            ipv6_address_full_t addr;
+            ipv6_diag_result_t diag;
+            char str[IPV6_GEN_STRING_SIZE];
+            const bool ok = ipv6_from_str_compact(strs[i], strlen(strs[i]), &addr, &diag);
+            if (!ok) {
+                memset(&addr, 0, sizeof(addr));
+            }
+            const size_t length = ipv6_to_str(&addr, str, sizeof(str));
+
+            if (parsed[i] != ok || memcmp(&addrs[i], &addr, sizeof(addr)) ||
+                (!ok && (diags[i].event != diag.event || diags[i].position != diag.position)) ||
+                lengths[i] != length || strcmp(output[i], str)) {
+                mismatches++;
+            }
+        }
+
+        if (valid != expected_valid || written != LENGTHOF(strs) || mismatches) {
+            TEST_FAILED("    batch run %u: %u valid, %u written, %u mismatches\n",
+                r, (uint32_t)valid, (uint32_t)written, mismatches);
+        } else {
+            TEST_PASSED();
+        }
+    }
+
+    // The executor runs both calls, an empty batch is fine
+    if (executor_runs != 2 || ipv6_batch_from_str(inputs, NULL, 0, addrs, NULL, NULL, NULL) != 0) {
+        TEST_FAILED("    executor used %u times\n", executor_runs);
+    } else {
+        TEST_PASSED();
+    }
+}
+
+// Counters must count every parse of a multi-threaded batch
+static void test_counters (test_status_t* status) {
+    static const char* inputs[20000];
+    static ipv6_address_full_t addrs[LENGTHOF(inputs)];
+    ipv6_counters_t counters;
+    ipv6_batch_options_t options;
+
+    for (uint32_t i = 0; i < LENGTHOF(inputs); ++i) {
+        inputs[i] = (i & 1) ? "2001:db8::1" : "10.0.0.1";
+    }
+
+    ipv6_counters_reset();
+    memset(&options, 0, sizeof(options));
+    options.threads = 4;
+    ipv6_batch_from_str(inputs, NULL, LENGTHOF(inputs), addrs, NULL, NULL, &options);
+
+    // Without PARSE_COUNTERS there is nothing to count
+    if (!ipv6_counters_snapshot(&counters)) {
+        TEST_PASSED();
+        return;
+    }
+
+    uint64_t decimal_tokens = 0;
+    for (uint32_t i = 0; i < IPV6_COUNTERS_TOKEN_LENGTHS; ++i) {
+        decimal_tokens += counters.token_lengths[IPV6_COUNTERS_TOKEN_DECIMAL][i];
+    }
+    if (counters.parses != LENGTHOF(inputs) || decimal_tokens != 4 * LENGTHOF(inputs) / 2 ||
+        counters.zerorun_shuffles != LENGTHOF(inputs) / 2) {
+        TEST_FAILED("    counted %llu parses, %llu decimal tokens, %llu shuffles\n",
+            (unsigned long long)counters.parses, (unsigned long long)decimal_tokens,
+            (unsigned long long)counters.zerorun_shuffles);
+    } else {
+        TEST_PASSED();
+    }
+    ipv6_counters_reset();
+}
+
+// Inputs shared by the cache tests, with their uncached results
+typedef struct {
+    char                    strs[600][IPV6_GEN_STRING_SIZE];
+    ipv6_address_full_t     addrs[600];
+    ipv6_diag_result_t      diags[600];
+    bool                    parsed[600];
+    ipv6_cache_t*           cache;
+    uint32_t                mismatches[4];
+} test_cache_corpus_t;
+
+// Parse the corpus through the cache, counting results that differ from the parser
+static uint32_t test_cache_pass (test_cache_corpus_t* corpus, uint32_t seed, uint32_t count) {
+    uint32_t mismatches = 0;
+    for (uint32_t n = 0; n < count; ++n) {
+        const uint32_t i = (n * 7919 + seed * 104729) % LENGTHOF(corpus->strs);
+        ipv6_address_full_t addr;
+        ipv6_diag_result_t diag = { IPV6_DIAG_INVALID_INPUT, 0 };
+        const bool ok = ipv6_cache_from_str(corpus->cache, corpus->strs[i], strlen(corpus->strs[i]), &addr, &diag);
+
+        if (ok != corpus->parsed[i] ||
+            memcmp(&addr, &corpus->addrs[i], sizeof(addr)) ||
+            (!ok && (diag.event != corpus->diags[i].event || diag.position != corpus->diags[i].position))) {
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+#if !defined(_WIN32)
+typedef struct {
+    test_cache_corpus_t*    corpus;
+    uint32_t                thread;
+} test_cache_thread_t;
+
+static void* test_cache_thread (void* arg) {
+    test_cache_thread_t* thread = (test_cache_thread_t*)arg;
+    thread->corpus->mismatches[thread->thread] = test_cache_pass(thread->corpus, thread->thread, 20000);
+    return NULL;
+}
+#endif
+
+// The cache must answer exactly like the parser, stay bounded and keep recent inputs
+static void test_cache (test_status_t* status) {
+    static test_cache_corpus_t corpus;
+    ipv6_gen_config_t config;
+    ipv6_gen_t gen;
+
+    ipv6_gen_config_init(&config, 6066);
+    config.port_rate = 0.3;
+    config.mask_rate = 0.3;
+    config.zone_rate = 0.2;
+    config.embed_rate = 0.3;
+    ipv6_gen_set_invalid_rate(&config, 0.3);
+
+    if (!ipv6_gen_init(&gen, &config)) {
+        TEST_FAILED("    ipv6_gen_init failed\n");
+        return;
+    }
+
+    for (uint32_t i = 0; i < LENGTHOF(corpus.strs); ++i) {
+        const size_t len = ipv6_gen_at(&gen, i, corpus.strs[i], sizeof(corpus.strs[i]), NULL);
+        corpus.parsed[i] = ipv6_from_str_compact(corpus.strs[i], len, &corpus.addrs[i], &corpus.diags[i]);
+        if (!corpus.parsed[i]) {
+            memset(&corpus.addrs[i], 0, sizeof(corpus.addrs[i]));
+        }
+    }
+
+    // Fewer entries than inputs, so every pass evicts
+    corpus.cache = ipv6_cache_create(128);
+    if (!corpus.cache) {
+        TEST_FAILED("    ipv6_cache_create failed\n");
+        return;
+    }
+    const size_t memory = ipv6_cache_memory(corpus.cache);
+
+    for (uint32_t pass = 0; pass < 3; ++pass) {
+        const uint32_t mismatches = test_cache_pass(&corpus, pass, 5000);
+        if (mismatches) {
+            TEST_FAILED("    pass %u: %u results differ from the parser\n", pass, mismatches);
+        } else {
+            TEST_PASSED();
+        }
+    }
+
+    // The latest input is a hit that matches, an unseen one is a miss
+    ipv6_address_full_t addr;
+    bool parsed = false;
+    ipv6_cache_from_str(corpus.cache, "2001:db8::77", 12, &addr, NULL);
+    if (!ipv6_cache_lookup(corpus.cache, "2001:db8::77", 12, &addr, &parsed, NULL) || !parsed ||
+        addr.address.components[7] != 0x77 ||
+        ipv6_cache_lookup(corpus.cache, "2001:db8::78", 12, &addr, &parsed, NULL) ||
+        ipv6_cache_memory(corpus.cache) != memory) {
+        TEST_FAILED("    lookup after insert\n");
+    } else {
+        TEST_PASSED();
+    }
+
+#if !defined(_WIN32)
+    // Shared by threads, every answer must still match the parser
+    pthread_t threads[LENGTHOF(corpus.mismatches)];
+    test_cache_thread_t args[LENGTHOF(corpus.mismatches)];
+    bool started[LENGTHOF(corpus.mismatches)];
+    for (uint32_t t = 0; t < LENGTHOF(threads); ++t) {
+        args[t].corpus = &corpus;
+        args[t].thread = t;
+        started[t] = pthread_create(&threads[t], NULL, test_cache_thread, &args[t]) == 0;
+        if (!started[t]) {
+            test_cache_thread(&args[t]);
+        }
+    }
+    uint32_t mismatches = 0;
+    for (uint32_t t = 0; t < LENGTHOF(threads); ++t) {
+        if (started[t]) {
+            pthread_join(threads[t], NULL);
+        }
+        mismatches += corpus.mismatches[t];
+    }
+    if (mismatches) {
+        TEST_FAILED("    %u results differ from the parser across threads\n", mismatches);
+    } else {
+        TEST_PASSED();
+    }
+#endif
+
+    ipv6_cache_destroy(corpus.cache);
+}
+
+// Text fed to the pipeline in small reads, and the lines it should produce
+typedef struct {
+    char                    text[2000 * 64];
+    size_t                  text_bytes;
+    size_t                  read_pos;
+    size_t                  read_bytes;
+    char                    lines[2000][IPV6_PIPELINE_MAX_LINE];
+    uint32_t                lengths[2000];
+    size_t                  count;
+    uint64_t                next_line;
+    uint32_t                mismatches;
+} test_pipeline_input_t;
+
+static size_t test_pipeline_read (void* context, char* buffer, size_t buffer_bytes) {
+    test_pipeline_input_t* input = (test_pipeline_input_t*)context;
+    size_t bytes = input->text_bytes - input->read_pos;
+    if (bytes > input->read_bytes) {
+        bytes = input->read_bytes;
+    }
+    if (bytes > buffer_bytes) {
+        bytes = buffer_bytes;
+    }
+    memcpy(buffer, input->text + input->read_pos, bytes);
+    input->read_pos += bytes;
+    return bytes;
+}
+
+// Batches must arrive in order, with the results of parsing each line alone
+static void test_pipeline_sink (void* context, const ipv6_pipeline_batch_t* batch) {
+    test_pipeline_input_t* input = (test_pipeline_input_t*)context;
+    if (batch->first_line != input->next_line || batch->first_line + batch->count > input->count) {
+        input->mismatches++;
+        return;
+    }
+
+    for (size_t i = 0; i < batch->count; ++i) {
+        const size_t line = (size_t)batch->first_line + i;
+        ipv6_address_full_t addr;
+        ipv6_diag_result_t diag;
+        const bool ok = ipv6_from_str_compact(input->lines[line], input->lengths[line], &addr, &diag);
+        if (!ok) {
+            memset(&addr, 0, sizeof(addr));
+        }
+
+        if (batch->lengths[i] != input->lengths[line] ||
+            memcmp(batch->inputs[i], input->lines[line], input->lengths[line]) ||
+            batch->parsed[i] != ok ||
+            memcmp(&batch->addresses[i].address, &addr.address, sizeof(addr.address)) ||
+            batch->addresses[i].port != addr.port || batch->addresses[i].mask != addr.mask ||
+            batch->addresses[i].flags != addr.flags ||
+            (!ok && (batch->diags[i].event != diag.event || batch->diags[i].position != diag.position))) {
+            input->mismatches++;
+        }
+    }
+    input->next_line += batch->count;
+}
+
+// Add a line to the pipeline input, as the pipeline should see it
+static void test_pipeline_line (test_pipeline_input_t* input, const char* text, size_t len, const char* newline) {
+    const size_t kept = len < IPV6_PIPELINE_MAX_LINE ? len : IPV6_PIPELINE_MAX_LINE;
+    memcpy(input->lines[input->count], text, kept);
+    input->lengths[input->count++] = (uint32_t)kept;
+    memcpy(input->text + input->text_bytes, text, len);
+    input->text_bytes += len;
+    memcpy(input->text + input->text_bytes, newline, strlen(newline));
+    input->text_bytes += strlen(newline);
+}
+
+// The pipeline must deliver every line once, in order, for any worker count
+static void test_pipeline (test_status_t* status) {
+    static test_pipeline_input_t input;
+    ipv6_gen_config_t gen_config;
+    ipv6_gen_t gen;
+
+    ipv6_gen_config_init(&gen_config, 6067);
+    gen_config.port_rate = 0.3;
+    gen_config.mask_rate = 0.3;
+    gen_config.embed_rate = 0.3;
+    ipv6_gen_set_invalid_rate(&gen_config, 0.3);
+
+    if (!ipv6_gen_init(&gen, &gen_config)) {
+        TEST_FAILED("    ipv6_gen_init failed\n");
+        return;
+    }
+
+    // Mixed line endings, an empty line, an overlong line and no final newline
+    char long_line[400];
+    memset(long_line, 'a', sizeof(long_line));
+    for (uint32_t i = 0; i < 1500; ++i) {
+        char str[IPV6_GEN_STRING_SIZE];
+        const size_t len = ipv6_gen_at(&gen, i, str, sizeof(str), NULL);
+        test_pipeline_line(&input, str, len, (i % 5) ? "\n" : "\r\n");
+        if (i == 700) {
+            test_pipeline_line(&input, "", 0, "\n");
+            test_pipeline_line(&input, long_line, sizeof(long_line), "\n");
+        }
+    }
+    test_pipeline_line(&input, "::1", 3, "");
+
+    const uint32_t workers[] = { 1, 3 };
+    for (uint32_t r = 0; r < LENGTHOF(workers); ++r) {
+        ipv6_pipeline_config_t config;
+        ipv6_pipeline_stats_t stats;
+        memset(&config, 0, sizeof(config));
+        config.read = test_pipeline_read;
+        config.read_context = &input;
+        config.sink = test_pipeline_sink;
+        config.sink_context = &input;
+        config.workers = workers[r];
+        config.batch_size = 37;
+        config.batches = 3;
+
+        input.read_pos = 0;
+        input.read_bytes = 37 + r * 1000;
+        input.next_line = 0;
+        input.mismatches = 0;
+
+        if (!ipv6_pipeline_run(&config, &stats) ||
+            input.mismatches || input.next_line != input.count ||
+            stats.reader.lines != input.count || stats.parser.lines != input.count ||
+            stats.sink.lines != input.count || stats.reader.bytes != input.text_bytes ||
+            stats.sink.batches != stats.reader.batches || stats.workers == 0) {
+            TEST_FAILED("    %u workers: %u mismatches, %u of %u lines\n",
+                workers[r], input.mismatches, (uint32_t)input.next_line, (uint32_t)input.count);
+        } else {
+            TEST_PASSED();
+        }
+    }
+
+    // Empty input never reaches the sink
+    static test_pipeline_input_t empty_input;
+    test_pipeline_input_t* empty = &empty_input;
+    ipv6_pipeline_config_t config;
+    ipv6_pipeline_stats_t stats;
+    memset(&config, 0, sizeof(config));
+    config.read = test_pipeline_read;
+    config.read_context = empty;
+    config.sink = test_pipeline_sink;
+    config.sink_context = empty;
+    if (!ipv6_pipeline_run(&config, &stats) || empty->next_line || stats.sink.batches) {
+        TEST_FAILED("    empty input\n");
+    } else {
+        TEST_PASSED();
+    }
+}
+
+// Socket addresses must match what inet_pton produces from the same text
+static void test_sockaddr (test_status_t* status) {
+    typedef struct {
+        const char*         str;        // input to the parser
+        const char*         pton;       // address text for inet_pton
+        int                 family;
+        uint16_t            port;
+        uint32_t            scope_id;
+    } test_sockaddr_t;
+
+    const test_sockaddr_t tests[] = {
+        { "::1", "::1", AF_INET6, 0, 0 },
+        { "[2001:db8::1:2]:443", "2001:db8::1:2", AF_INET6, 443, 0 },
+        { "fe80::1%3", "fe80::1", AF_INET6, 0, 3 },
+        { "[fe80::aa:1%42]:8080", "fe80::aa:1", AF_INET6, 8080, 42 },
+        { "::ffff:10.1.2.3", "::ffff:10.1.2.3", AF_INET6, 0, 0 },
+        { "1:2:3:4:5:6:7:8", "1:2:3:4:5:6:7:8", AF_INET6, 0, 0 },
+        { "ffff:fe00::ff", "ffff:fe00::ff", AF_INET6, 0, 0 },
+        { "127.0.0.1", "127.0.0.1", AF_INET, 0, 0 },
+        { "192.168.1.254:65535", "192.168.1.254", AF_INET, 65535, 0 },
+    };
+
+    ipv6_address_full_t addrs[LENGTHOF(tests)];
+    struct sockaddr_storage storage[LENGTHOF(tests)];
+    uint32_t lengths[LENGTHOF(tests)];
+
+    for (uint32_t i = 0; i < LENGTHOF(tests); ++i) {
+        ipv6_address_full_t back;
+        uint32_t scope_id = 0;
+        bool matches = ipv6_from_str(tests[i].str, strlen(tests[i].str), &addrs[i]);
+        const size_t length = matches ?
+            ipv6_to_sockaddr(&addrs[i], (struct sockaddr*)&storage[i], sizeof(storage[i])) : 0;
+
+        if (tests[i].family == AF_INET) {
+            struct sockaddr_in expected;
+            struct sockaddr_in actual;
+            memcpy(&actual, &storage[i], sizeof(actual));
+            matches = length == sizeof(actual) && actual.sin_family == AF_INET &&
+                inet_pton(AF_INET, tests[i].pton, &expected.sin_addr) == 1 &&
+                !memcmp(&actual.sin_addr, &expected.sin_addr, sizeof(expected.sin_addr)) &&
+                actual.sin_port == htons(tests[i].port);
+        } else {
+            struct sockaddr_in6 expected;
+            struct sockaddr_in6 actual;
+            memcpy(&actual, &storage[i], sizeof(actual));
+            matches = length == sizeof(actual) && actual.sin6_family == AF_INET6 &&
+                inet_pton(AF_INET6, tests[i].pton, &expected.sin6_addr) == 1 &&
+                !memcmp(&actual.sin6_addr, &expected.sin6_addr, sizeof(expected.sin6_addr)) &&
+                actual.sin6_port == htons(tests[i].port) && actual.sin6_scope_id == tests[i].scope_id;
+        }
+
+        // Reading it back gives the same address, port and scope
+        matches = matches &&
+            ipv6_from_sockaddr((const struct sockaddr*)&storage[i], length, &back, &scope_id) &&
+            !memcmp(&back.address, &addrs[i].address, sizeof(back.address)) &&
+            back.port == tests[i].port && scope_id == tests[i].scope_id &&
+            (back.flags & IPV6_FLAG_IPV4_COMPAT) == (addrs[i].flags & IPV6_FLAG_IPV4_COMPAT);
+
+        if (!matches) {
+            TEST_FAILED("    sockaddr for %s does not match inet_pton\n", tests[i].str);
+        } else {
+            TEST_PASSED();
+        }
+    }
+
+    // IPv4 goes into an in6_addr mapped, the mapping is flagged on the way back
+    struct in6_addr in6;
+    struct in6_addr expected6;
+    ipv6_address_full_t back;
+    ipv6_to_in6_addr(&addrs[LENGTHOF(tests) - 1], &in6);
+    ipv6_from_in6_addr(&in6, &back);
+    if (inet_pton(AF_INET6, "::ffff:192.168.1.254", &expected6) != 1 ||
+        memcmp(&in6, &expected6, sizeof(in6)) || back.flags != IPV6_FLAG_IPV4_EMBED) {
+        TEST_FAILED("    IPv4 in6_addr is not mapped\n");
+    } else {
+        TEST_PASSED();
+    }
+
+    // The parser records the zone, a zone that is too large has no scope
+    ipv6_address_full_t addr;
+    const char* zoned = "[fe80::1%25]:80";
+    if (!ipv6_from_str(zoned, strlen(zoned), &addr) || addr.iface != zoned + 9 || addr.iface_len != 2 ||
+        !ipv6_from_str("fe80::1%99999999999", 19, &addr) ||
+        ipv6_to_sockaddr(&addr, (struct sockaddr*)&storage[0], sizeof(storage[0])) != 0 ||
+        ipv6_to_sockaddr(&addrs[0], (struct sockaddr*)&storage[0], sizeof(struct sockaddr_in)) != 0) {
+        TEST_FAILED("    zone or short buffer not handled\n");
+    } else {
+        TEST_PASSED();
+    }
+
+    // Batches convert like single calls and skip unknown families
+    ipv6_address_full_t batch_back[LENGTHOF(tests)];
+    uint32_t scope_ids[LENGTHOF(tests)];
+    bool parsed[LENGTHOF(tests)];
+    if (ipv6_to_sockaddr_batch(addrs, LENGTHOF(tests), storage, lengths) != LENGTHOF(tests)) {
+        TEST_FAILED("    ipv6_to_sockaddr_batch failed\n");
+    } else {
+        TEST_PASSED();
+    }
+    storage[1].ss_family = AF_UNSPEC;
+    if (ipv6_from_sockaddr_batch(storage, LENGTHOF(tests), batch_back, scope_ids, parsed) != LENGTHOF(tests) - 1 ||
+        parsed[1] || !parsed[3] || scope_ids[3] != 42 || batch_back[3].port != 8080 ||
+        memcmp(&batch_back[5].address, &addrs[5].address, sizeof(addrs[5].address))) {
+        TEST_FAILED("    ipv6_from_sockaddr_batch results differ\n");
+    } else {
+        TEST_PASSED();
+    }
+}
+
+// Parsing in network order must give the bytes of the host order parse, swapped
+static void test_network_order (test_status_t* status) {
+    ipv6_gen_config_t config;
+    ipv6_gen_t gen;
+
+    ipv6_gen_config_init(&config, 6069);
+    config.port_rate = 0.3;
+    config.mask_rate = 0.3;
+    config.embed_rate = 0.4;
+    ipv6_gen_set_invalid_rate(&config, 0.2);
+
+    if (!ipv6_gen_init(&gen, &config)) {
+        TEST_FAILED("    ipv6_gen_init failed\n");
+        return;
+    }
+
+    uint32_t mismatches = 0;
+    for (uint32_t i = 0; i < 5000; ++i) {
+        char str[IPV6_GEN_STRING_SIZE];
+        char host_str[IPV6_GEN_STRING_SIZE];
+        char network_str[IPV6_GEN_STRING_SIZE];
+        ipv6_address_full_t host;
+        ipv6_address_full_t network;
+        ipv6_diag_result_t host_diag;
+        ipv6_diag_result_t network_diag;
+
+        const size_t len = ipv6_gen_at(&gen, i, str, sizeof(str), NULL);
+        const bool host_ok = ipv6_from_str_compact(str, len, &host, &host_diag);
+        const bool network_ok = ipv6_from_str_network(str, len, &network, &network_diag);
+
+        if (host_ok != network_ok) {
+            mismatches++;
+            continue;
+        }
+        if (!host_ok) {
+            mismatches += host_diag.event != network_diag.event || host_diag.position != network_diag.position;
+            continue;
+        }
+
+        bool same = network.flags == (host.flags | IPV6_FLAG_NETWORK_ORDER) &&
+            network.port == host.port && network.mask == host.mask &&
+            ipv6_compare(&host, &network, 0) == IPV6_COMPARE_OK &&
+            ipv6_to_str(&host, host_str, sizeof(host_str)) &&
+            ipv6_to_str(&network, network_str, sizeof(network_str)) &&
+            !strcmp(host_str, network_str);
+
+        const uint8_t* bytes = (const uint8_t*)network.address.components;
+        for (uint32_t c = 0; c < IPV6_NUM_COMPONENTS && same; ++c) {
+            same = host.address.components[c] == ((bytes[c * 2] << 8) | bytes[c * 2 + 1]);
+        }
+        mismatches += !same;
+    }
+
+    if (mismatches) {
+        TEST_FAILED("    %u addresses differ between byte orders\n", mismatches);
+    } else {
+        TEST_PASSED();
+    }
+
+    // The bytes are an in6_addr, IPv4 compatible addresses keep their octets first
+    const uint8_t expected[16] = { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 192, 0, 2, 33 };
+    const uint8_t expected_v4[4] = { 10, 1, 2, 3 };
+    ipv6_address_full_t addr;
+    struct in6_addr in6;
+    struct sockaddr_in sin;
+    if (!ipv6_from_str_network("2001:db8::192.0.2.33", 20, &addr, NULL) ||
+        memcmp(addr.address.components, expected, sizeof(expected)) ||
+        (ipv6_to_in6_addr(&addr, &in6), memcmp(&in6, expected, sizeof(expected))) ||
+        !ipv6_from_str_network("10.1.2.3:80", 11, &addr, NULL) ||
+        memcmp(addr.address.components, expected_v4, sizeof(expected_v4)) ||
+        ipv6_to_sockaddr(&addr, (struct sockaddr*)&sin, sizeof(sin)) != sizeof(sin) ||
+        memcmp(&sin.sin_addr, expected_v4, sizeof(expected_v4)) || sin.sin_port != htons(80)) {
+        TEST_FAILED("    network order bytes are not in6_addr bytes\n");
+    } else {
+        TEST_PASSED();
+    }
+}
+
+// Reverse DNS names must map to their address or prefix, full names in any case
+static void test_arpa (test_status_t* status) {
+    typedef struct {
+        const char*         name;
+        const char*         expected;   // NULL if parsing fails with event at position
+        uint32_t            mask;       // 0 for an address
+        ipv6_diag_event_t   event;
+        uint32_t            position;
+    } test_arpa_t;
+
+    const test_arpa_t tests[] = {
+        { "1.2.3.4.in-addr.arpa", "4.3.2.1", 0, 0, 0 },
+        { "2.0.192.in-addr.arpa.", "192.0.2.0", 24, 0, 0 },
+        { "10.IN-ADDR.ARPA", "10.0.0.0", 8, 0, 0 },
+        { "8.b.d.0.1.0.0.2.ip6.arpa", "2001:db8::/32", 32, 0, 0 },
+        { "f.ip6.arpa", "f000::/4", 4, 0, 0 },
+        { "1.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.8.b.d.0.1.0.0.2.ip6.arpa", "2001:db8::1", 0, 0, 0 },
+        { "1.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.8.B.D.0.1.0.0.2.IP6.ARPA.", "2001:db8::1", 0, 0, 0 },
+        { "b.a.9.8.7.6.5.4.3.2.1.0.f.e.d.c.b.a.9.8.7.6.5.4.3.2.1.0.f.e.d.c.ip6.arpa", "cdef:123:4567:89ab:cdef:123:4567:89ab", 0, 0, 0 },
+        { "0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.ip6.arpa", NULL, 0, IPV6_DIAG_STRING_SIZE_EXCEEDED, 0 },
+        { "1.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.8.b.d.0.1.0.0.x.ip6.arpa", NULL, 0, IPV6_DIAG_INVALID_INPUT, 62 },
+        { "1.2.3.4.5.in-addr.arpa", NULL, 0, IPV6_DIAG_V4_BAD_COMPONENT_COUNT, 8 },
+        { "256.in-addr.arpa", NULL, 0, IPV6_DIAG_V4_COMPONENT_OUT_OF_RANGE, 0 },
+        { "10.ip6.arpa", NULL, 0, IPV6_DIAG_V6_COMPONENT_OUT_OF_RANGE, 0 },
+        { "g.ip6.arpa", NULL, 0, IPV6_DIAG_INVALID_INPUT, 0 },
+        { "1..ip6.arpa", NULL, 0, IPV6_DIAG_INVALID_INPUT, 2 },
+        { "1.ip6.arpa..", NULL, 0, IPV6_DIAG_INVALID_INPUT, 0 },
+        { "ip6.arpa", NULL, 0, IPV6_DIAG_INVALID_INPUT, 0 },
+        { "example.com", NULL, 0, IPV6_DIAG_INVALID_INPUT, 0 },
+    };
+
+    char str[IPV6_GEN_STRING_SIZE];
+
+    for (uint32_t i = 0; i < LENGTHOF(tests); ++i) {
+        ipv6_address_full_t addr;
+        ipv6_diag_result_t diag = { 0, };
+        const bool ok = ipv6_from_arpa(tests[i].name, strlen(tests[i].name), &addr, &diag);
+
+        if (tests[i].expected) {
+            const uint32_t mask = (addr.flags & IPV6_FLAG_HAS_MASK) ? addr.mask : 0;
+            if (!ok || mask != tests[i].mask || (ipv6_to_str(&addr, str, sizeof(str)), strcmp(str, tests[i].expected))) {
+                TEST_FAILED("    %s parsed as %s, expected %s\n", tests[i].name, ok ? str : "<error>", tests[i].expected);
+            } else {
+                TEST_PASSED();
+            }
+        } else if (ok || diag.event != tests[i].event || diag.position != tests[i].position) {
+            TEST_FAILED("    %s: %s at %u, expected %s at %u\n", tests[i].name,
+                ok ? "<parsed>" : ipv6_diag_event_str(diag.event), diag.position,
+                ipv6_diag_event_str(tests[i].event), tests[i].position);
+        } else {
+            TEST_PASSED();
+        }
+    }
+
+    // Names built from generated addresses come back as the same addresses
+    ipv6_gen_config_t config;
+    ipv6_gen_t gen;
+    ipv6_gen_config_init(&config, 7073);
+    config.embed_rate = 0.3;
+
+    if (!ipv6_gen_init(&gen, &config)) {
+        TEST_FAILED("    ipv6_gen_init failed\n");
+        return;
+    }
+
+    uint32_t mismatches = 0;
+    for (uint32_t i = 0; i < 2000; ++i) {
+        static const char hex[] = "0123456789abcdefABCDEF";
+        char name[128];
+        size_t name_len = 0;
+        ipv6_address_full_t addr;
+        ipv6_address_full_t parsed;
+
+        const size_t len = ipv6_gen_at(&gen, i, str, sizeof(str), NULL);
+        if (!ipv6_from_str(str, len, &addr)) {
+            continue;
+        }
+
+        if (addr.flags & IPV6_FLAG_IPV4_COMPAT) {
+            const uint32_t v4 = ((uint32_t)addr.address.components[0] << 16) | addr.address.components[1];
+            name_len = (size_t)snprintf(name, sizeof(name), "%u.%u.%u.%u.in-addr.arpa",
+                v4 & 0xff, (v4 >> 8) & 0xff, (v4 >> 16) & 0xff, v4 >> 24);
+        } else {
+            for (int32_t nibble = 31; nibble >= 0; --nibble) {
+                const uint32_t value = (addr.address.components[nibble / 4] >> (12 - 4 * (nibble % 4))) & 0xf;
+                name[name_len++] = hex[value >= 10 && (i & 1) ? value + 6 : value];
+                name[name_len++] = '.';
+            }
+            memcpy(name + name_len, (i & 2) ? "IP6.ARPA." : "ip6.arpa", 9);
+            name_len += 8 + ((i & 2) != 0);
+        }
+
+        mismatches += !ipv6_from_arpa(name, name_len, &parsed, NULL) ||
+            (parsed.flags & IPV6_FLAG_HAS_MASK) ||
+            ipv6_compare(&addr, &parsed, IPV6_FLAG_HAS_PORT | IPV6_FLAG_HAS_MASK | IPV6_FLAG_IPV4_EMBED) != IPV6_COMPARE_OK;
+    }
+
+    if (mismatches) {
+        TEST_FAILED("    %u generated names did not map back\n", mismatches);
+    } else {
+        TEST_PASSED();
+    }
+}
+
+// Every registry range must be found, at its edges too, in either byte order
+static void test_classify (test_status_t* status) {
+    typedef struct {
+        const char*         str;
+        uint32_t            classes;
+    } test_classify_t;
+
+    const test_classify_t tests[] = {
+        { "::", IPV6_CLASS_UNSPECIFIED },
+        { "::1", IPV6_CLASS_LOOPBACK },
+        { "::2", 0 },
+        { "[::1]:80", IPV6_CLASS_LOOPBACK },
+        { "fe80::1", IPV6_CLASS_LINK_LOCAL },
+        { "febf:ffff::", IPV6_CLASS_LINK_LOCAL },
+        { "fec0::1", IPV6_CLASS_SITE_LOCAL },
+        { "fc00::1", IPV6_CLASS_UNIQUE_LOCAL },
+        { "fdff:ffff::1", IPV6_CLASS_UNIQUE_LOCAL },
+        { "fbff::1", 0 },
+        { "ff02::1", IPV6_CLASS_MULTICAST | (2u << IPV6_CLASS_SCOPE_SHIFT) },
+        { "ff0e::101", IPV6_CLASS_MULTICAST | (0xeu << IPV6_CLASS_SCOPE_SHIFT) },
+        { "2001:db8::1/64", IPV6_CLASS_DOCUMENTATION },
+        { "3fff:fff::1", IPV6_CLASS_DOCUMENTATION },
+        { "3fff:1000::1", 0 },
+        { "2001:0:4136:e378::", IPV6_CLASS_TEREDO | IPV6_CLASS_IETF_PROTOCOL },
+        { "2001:2::1", IPV6_CLASS_BENCHMARKING | IPV6_CLASS_IETF_PROTOCOL },
+        { "2001:1f::1", IPV6_CLASS_ORCHID | IPV6_CLASS_IETF_PROTOCOL },
+        { "2001:2f::1", IPV6_CLASS_ORCHID | IPV6_CLASS_IETF_PROTOCOL },
+        { "2001:1ff::1", IPV6_CLASS_IETF_PROTOCOL },
+        { "2001:200::1", 0 },
+        { "2002:c000:204::1", IPV6_CLASS_6TO4 },
+        { "2003::1", 0 },
+        { "64:ff9b::192.0.2.33", IPV6_CLASS_NAT64 },
+        { "64:ff9b:1:ffff::1", IPV6_CLASS_NAT64 },
+        { "64:ff9b:2::1", 0 },
+        { "100::abcd", IPV6_CLASS_DISCARD },
+        { "100:0:0:1::", 0 },
+        { "::ffff:10.1.2.3", IPV6_CLASS_IPV4_MAPPED | IPV6_CLASS_IPV4 | IPV6_CLASS_PRIVATE },
+        { "::ffff:8.8.8.8", IPV6_CLASS_IPV4_MAPPED | IPV6_CLASS_IPV4 },
+        { "8.8.8.8", IPV6_CLASS_IPV4 },
+        { "0.1.2.3", IPV6_CLASS_IPV4 | IPV6_CLASS_THIS_NETWORK },
+        { "10.255.255.255", IPV6_CLASS_IPV4 | IPV6_CLASS_PRIVATE },
+        { "100.64.0.1", IPV6_CLASS_IPV4 | IPV6_CLASS_SHARED },
+        { "100.127.255.255:53", IPV6_CLASS_IPV4 | IPV6_CLASS_SHARED },
+        { "100.128.0.0", IPV6_CLASS_IPV4 },
+        { "127.0.0.1", IPV6_CLASS_IPV4 | IPV6_CLASS_LOOPBACK },
+        { "169.254.1.1", IPV6_CLASS_IPV4 | IPV6_CLASS_LINK_LOCAL },
+        { "172.31.0.1", IPV6_CLASS_IPV4 | IPV6_CLASS_PRIVATE },
+        { "172.32.0.1", IPV6_CLASS_IPV4 },
+        { "192.0.0.8", IPV6_CLASS_IPV4 | IPV6_CLASS_IETF_PROTOCOL },
+        { "192.0.2.1", IPV6_CLASS_IPV4 | IPV6_CLASS_DOCUMENTATION },
+        { "192.88.99.1", IPV6_CLASS_IPV4 | IPV6_CLASS_6TO4 },
+        { "192.168.0.1", IPV6_CLASS_IPV4 | IPV6_CLASS_PRIVATE },
+        { "198.19.255.255", IPV6_CLASS_IPV4 | IPV6_CLASS_BENCHMARKING },
+        { "198.51.100.7", IPV6_CLASS_IPV4 | IPV6_CLASS_DOCUMENTATION },
+        { "203.0.113.9", IPV6_CLASS_IPV4 | IPV6_CLASS_DOCUMENTATION },
+        { "239.255.255.250", IPV6_CLASS_IPV4 | IPV6_CLASS_MULTICAST },
+        { "240.0.0.1", IPV6_CLASS_IPV4 | IPV6_CLASS_RESERVED },
+        { "255.255.255.255", IPV6_CLASS_IPV4 | IPV6_CLASS_RESERVED | IPV6_CLASS_BROADCAST },
+    };
+
+    ipv6_address_full_t addrs[LENGTHOF(tests)];
+    uint32_t classes[LENGTHOF(tests)];
+
+    for (uint32_t i = 0; i < LENGTHOF(tests); ++i) {
+        ipv6_address_full_t network;
+        const size_t len = strlen(tests[i].str);
+        if (!ipv6_from_str(tests[i].str, len, &addrs[i]) ||
+            !ipv6_from_str_network(tests[i].str, len, &network, NULL)) {
+            TEST_FAILED("    failed to parse %s\n", tests[i].str);
+            continue;
+        }
+
+        const uint32_t host_classes = ipv6_classify(&addrs[i]);
+        const uint32_t network_classes = ipv6_classify(&network);
+        if (host_classes != tests[i].classes || network_classes != tests[i].classes) {
+            TEST_FAILED("    %s classified %08x / %08x, expected %08x\n",
+                tests[i].str, host_classes, network_classes, tests[i].classes);
+        } else {
+            TEST_PASSED();
+        }
+    }
+
+    ipv6_classify_batch(addrs, LENGTHOF(tests), classes);
+    uint32_t mismatches = 0;
+    for (uint32_t i = 0; i < LENGTHOF(tests); ++i) {
+        mismatches += classes[i] != tests[i].classes;
+    }
+
+    uint32_t named = 0;
+    for (uint32_t bit = 0; bit < IPV6_CLASS_COUNT; ++bit) {
+        named += strcmp(ipv6_class_str((ipv6_class_t)(1u << bit)), "<unknown>") != 0;
+    }
+
+    if (mismatches || named != IPV6_CLASS_COUNT) {
+        TEST_FAILED("    batch: %u mismatches, %u classes named\n", mismatches, named);
+    } else {
+        TEST_PASSED();
+    }
+}
+
+// Ranges, wildcards and netmasks must widen to the addresses they cover
+static void test_range (test_status_t* status) {
+    typedef struct {
+        const char*         input;
+        const char*         first;      // NULL if parsing fails with event at position
+        const char*         last;
+        const char*         prefix;     // NULL if the range is not a single prefix
+        ipv6_diag_event_t   event;
+        uint32_t            position;
+    } test_range_t;
+
+    const test_range_t tests[] = {
+        { "10.0.0.1", "10.0.0.1", "10.0.0.1", "10.0.0.1", 0, 0 },
+        { "10.0.0.0/24", "10.0.0.0", "10.0.0.255", "10.0.0.0", 0, 0 },
+        { "10.0.0.0/255.255.255.0", "10.0.0.0", "10.0.0.255", "10.0.0.0", 0, 0 },
+        { "10.0.0.7/255.255.255.252", "10.0.0.4", "10.0.0.7", "10.0.0.4", 0, 0 },
+        { "10.0.0.0/0.0.0.0", "0.0.0.0", "255.255.255.255", "0.0.0.0", 0, 0 },
+        { "10.1.*.*", "10.1.0.0", "10.1.255.255", "10.1.0.0", 0, 0 },
+        { "*.*.*.*", "0.0.0.0", "255.255.255.255", "0.0.0.0", 0, 0 },
+        { "10.0.0.1-10.0.0.9", "10.0.0.1", "10.0.0.9", NULL, 0, 0 },
+        { "10.0.0.0 - 10.0.0.255", "10.0.0.0", "10.0.0.255", "10.0.0.0", 0, 0 },
+        { "10.0.0.0/24-10.0.1.*", "10.0.0.0", "10.0.1.255", "10.0.0.0", 0, 0 },
+        { "2001:db8::1-2001:db8::ff", "2001:db8::1", "2001:db8::ff", NULL, 0, 0 },
+        { "2001:db8::/127-2001:db8::9", "2001:db8::", "2001:db8::9", NULL, 0, 0 },
+        { "2001:db8::/32", "2001:db8::", "2001:db8:ffff:ffff:ffff:ffff:ffff:ffff", "2001:db8::/32", 0, 0 },
+        { "fe80::1-fe80::2%eth-0", "fe80::1", "fe80::2", NULL, 0, 0 },
+        { "10.0.0.9-10.0.0.1", NULL, NULL, NULL, IPV6_DIAG_INVALID_INPUT, 8 },
+        { "10.0.0.1-::1", NULL, NULL, NULL, IPV6_DIAG_INVALID_INPUT, 8 },
+        { "10.0.0.1-10.0.0.2-10.0.0.3", NULL, NULL, NULL, IPV6_DIAG_INVALID_INPUT_CHAR, 17 },
+        { "10.0.0.1-", NULL, NULL, NULL, IPV6_DIAG_INVALID_INPUT, 9 },
+        { "10.0.0.1-10.0.0.256", NULL, NULL, NULL, IPV6_DIAG_V4_COMPONENT_OUT_OF_RANGE, 19 },
+        { "10.0.0.0/33", NULL, NULL, NULL, IPV6_DIAG_INVALID_CIDR_MASK, 11 },
+        { "10.*.1.*", NULL, NULL, NULL, IPV6_DIAG_INVALID_INPUT, 6 },
+        { "10.*.*", NULL, NULL, NULL, IPV6_DIAG_V4_BAD_COMPONENT_COUNT, 6 },
+        { "10.*.*.*/8", NULL, NULL, NULL, IPV6_DIAG_INVALID_INPUT, 8 },
+        { "::*", NULL, NULL, NULL, IPV6_DIAG_INVALID_INPUT, 2 },
+    };
+
+    char str[IPV6_GEN_STRING_SIZE];
+
+    for (uint32_t i = 0; i < LENGTHOF(tests); ++i) {
+        ipv6_range_t range;
+        ipv6_address_full_t prefix;
+        ipv6_diag_result_t diag = { 0, };
+        const bool ok = ipv6_range_from_str(tests[i].input, strlen(tests[i].input), &range, &diag);
+
+        if (!tests[i].first) {
+            if (ok || diag.event != tests[i].event || diag.position != tests[i].position) {
+                TEST_FAILED("    %s: expected event %u at %u, got %u at %u\n", tests[i].input,
+                    tests[i].event, tests[i].position, diag.event, diag.position);
+            } else {
+                TEST_PASSED();
+            }
+            continue;
+        }
+
+        char last[IPV6_GEN_STRING_SIZE];
+        const bool has_prefix = ok && ipv6_range_to_prefix(&range, &prefix);
+        ipv6_to_str(&range.first, str, sizeof(str));
+        ipv6_to_str(&range.last, last, sizeof(last));
+        bool matches = ok && !strcmp(str, tests[i].first) && !strcmp(last, tests[i].last) &&
+            !(range.first.flags & IPV6_FLAG_HAS_MASK) && has_prefix == (tests[i].prefix != NULL);
+        if (matches && has_prefix) {
+            ipv6_to_str(&prefix, str, sizeof(str));
+            matches = !strcmp(str, tests[i].prefix) && (prefix.flags & IPV6_FLAG_HAS_MASK);
+        }
+        if (!matches) {
+            TEST_FAILED("    %s: read %s to %s, event %u at %u\n", tests[i].input, str, last,
+                diag.event, diag.position);
+        } else {
+            TEST_PASSED();
+        }
+    }
+
+    // Prefix lengths of netmasks and wildcards match their CIDR form
+    const char* equivalent[][2] = {
+        { "10.0.0.0/255.255.254.0", "10.0.0.0/23" },
+        { "10.0.0.0/255.255.255.255", "10.0.0.0/32" },
+        { "172.16.*.*", "172.16.0.0/16" },
+    };
+    for (uint32_t i = 0; i < LENGTHOF(equivalent); ++i) {
+        ipv6_range_t a;
+        ipv6_range_t b;
+        ipv6_address_full_t prefix_a;
+        ipv6_address_full_t prefix_b;
+        if (!ipv6_range_from_str(equivalent[i][0], strlen(equivalent[i][0]), &a, NULL) ||
+            !ipv6_range_from_str(equivalent[i][1], strlen(equivalent[i][1]), &b, NULL) ||
+            !ipv6_range_to_prefix(&a, &prefix_a) || !ipv6_range_to_prefix(&b, &prefix_b) ||
+            ipv6_compare(&prefix_a, &prefix_b, 0) != IPV6_COMPARE_OK) {
+            TEST_FAILED("    %s is not %s\n", equivalent[i][0], equivalent[i][1]);
+        } else {
+            TEST_PASSED();
+        }
+    }
+
+    // Generated IPv4 prefixes read the same as ranges and addresses
+    ipv6_gen_config_t config;
+    ipv6_gen_t gen;
+    ipv6_gen_config_init(&config, 75);
+    memset(config.form_weights, 0, sizeof(config.form_weights));
+    config.form_weights[IPV6_GEN_FORM_IPV4] = 1;
+    config.port_rate = 0.0;
+    config.mask_rate = 1.0;
+    ipv6_gen_init(&gen, &config);
+    for (uint32_t i = 0; i < 1000; ++i) {
+        char input[IPV6_GEN_STRING_SIZE];
+        ipv6_range_t range;
+        ipv6_address_full_t addr;
+        ipv6_address_full_t prefix;
+        const size_t length = ipv6_gen_at(&gen, i, input, sizeof(input), NULL);
+        if (!ipv6_from_str(input, length, &addr) || !ipv6_range_from_str(input, length, &range, NULL)) {
+            TEST_FAILED("    %s did not parse\n", input);
+            continue;
+        }
+
+        const bool has_prefix = ipv6_range_to_prefix(&range, &prefix);
+        const uint32_t mask = (addr.flags & IPV6_FLAG_HAS_MASK) ? addr.mask : 32;
+        if (!(addr.flags & IPV6_FLAG_IPV4_COMPAT) || !has_prefix || prefix.mask != mask) {
+            TEST_FAILED("    %s read as a /%u prefix\n", input, prefix.mask);
+        } else {
+            TEST_PASSED();
+        }
+    }
+}
+
+// NAT64 synthesis and extraction must match the RFC 6052 examples
+static void test_nat64 (test_status_t* status) {
+    typedef struct {
+        const char*         prefix;
+        uint32_t            prefix_len;
+        const char*         synthesized;
+    } test_nat64_t;
+
+    const test_nat64_t tests[] = {
+        { "2001:db8::", 32, "2001:db8:c000:221::" },
+        { "2001:db8:100::", 40, "2001:db8:1c0:2:21::" },
+        { "2001:db8:122::", 48, "2001:db8:122:c000:2:2100::" },
+        { "2001:db8:122:300::", 56, "2001:db8:122:3c0:0:221::" },
+        { "2001:db8:122:344::", 64, "2001:db8:122:344:c0:2:2100:0" },
+        { "2001:db8:122:344::", 96, "2001:db8:122:344::192.0.2.33" },
+        { "64:ff9b::", IPV6_NAT64_WELL_KNOWN_LENGTH, "64:ff9b::192.0.2.33" },
+    };
+
+    ipv6_address_full_t ipv4;
+    ipv6_address_full_t mapped;
+    ipv6_address_full_t synthesized[LENGTHOF(tests)];
+    char str[IPV6_GEN_STRING_SIZE];
+
+    ipv6_from_str("192.0.2.33", strlen("192.0.2.33"), &ipv4);
+    ipv6_from_str_network("::ffff:192.0.2.33", strlen("::ffff:192.0.2.33"), &mapped, NULL);
+
+    for (uint32_t i = 0; i < LENGTHOF(tests); ++i) {
+        ipv6_address_full_t prefix;
+        ipv6_address_full_t out;
+        ipv6_address_full_t extracted;
+        ipv6_from_str(tests[i].prefix, strlen(tests[i].prefix), &prefix);
+
+        // IPv4 compatible and network order IPv4-mapped inputs are the same address
+        const bool ok = ipv6_nat64_synthesize(&prefix, tests[i].prefix_len, &ipv4, &synthesized[i]) &&
+            ipv6_nat64_synthesize(&prefix, tests[i].prefix_len, &mapped, &out) &&
+            ipv6_compare(&synthesized[i], &out, 0) == IPV6_COMPARE_OK;
+        ipv6_to_str(&synthesized[i], str, sizeof(str));
+        if (!ok || strcmp(str, tests[i].synthesized)) {
+            TEST_FAILED("    %s/%u synthesized %s, expected %s\n",
+                tests[i].prefix, tests[i].prefix_len, str, tests[i].synthesized);
+        } else {
+            TEST_PASSED();
+        }
+
+        if (!ipv6_nat64_extract(&synthesized[i], &prefix, tests[i].prefix_len, &extracted) ||
+            !ipv6_nat64_extract(&synthesized[i], NULL, tests[i].prefix_len, &out) ||
+            ipv6_compare(&extracted, &ipv4, 0) != IPV6_COMPARE_OK ||
+            ipv6_compare(&out, &ipv4, 0) != IPV6_COMPARE_OK) {
+            TEST_FAILED("    %s did not extract to 192.0.2.33\n", tests[i].synthesized);
+        } else {
+            TEST_PASSED();
+        }
+    }
+
+    // Ports carry over both ways, /96 results keep their IPv4 suffix format
+    ipv6_address_full_t prefix;
+    ipv6_address_full_t out;
+    ipv6_address_full_t with_port;
+    ipv6_from_str("64:ff9b::", strlen("64:ff9b::"), &prefix);
+    ipv6_from_str("10.0.0.1:53", strlen("10.0.0.1:53"), &with_port);
+    ipv6_nat64_synthesize(&prefix, 96, &with_port, &out);
+    ipv6_to_str(&out, str, sizeof(str));
+    if (strcmp(str, "[64:ff9b::10.0.0.1]:53")) {
+        TEST_FAILED("    synthesized %s, expected [64:ff9b::10.0.0.1]:53\n", str);
+    } else {
+        TEST_PASSED();
+    }
+    ipv6_nat64_extract(&out, &prefix, 96, &out);
+    ipv6_to_str(&out, str, sizeof(str));
+    if (strcmp(str, "10.0.0.1:53")) {
+        TEST_FAILED("    extracted %s, expected 10.0.0.1:53\n", str);
+    } else {
+        TEST_PASSED();
+    }
+
+    // Unsupported lengths, IPv6 inputs, a set u-octet and other prefixes fail
+    ipv6_address_full_t other;
+    ipv6_address_full_t u_octet;
+    ipv6_from_str("2001:db9::", strlen("2001:db9::"), &other);
+    ipv6_from_str("2001:db8:c000:221:100::", strlen("2001:db8:c000:221:100::"), &u_octet);
+    const bool rejected =
+        !ipv6_nat64_synthesize(&prefix, 33, &ipv4, &out) &&
+        !ipv6_nat64_synthesize(&prefix, 96, &prefix, &out) &&
+        !ipv6_nat64_extract(&synthesized[0], NULL, 128, &out) &&
+        !ipv6_nat64_extract(&u_octet, NULL, 32, &out) &&
+        !ipv6_nat64_extract(&synthesized[0], &other, 32, &out) &&
+        ipv6_nat64_extract(&u_octet, NULL, 96, &out);
+    if (!rejected) {
+        TEST_FAILED("    invalid synthesis or extraction accepted\n");
+    } else {
+        TEST_PASSED();
+    }
+
+    // Batches fill every slot and report each extraction
+    ipv6_address_full_t inputs[3] = { ipv4, mapped, prefix };
+    ipv6_address_full_t batch[3];
+    ipv6_address_full_t extracted[3];
+    bool flags[3];
+    ipv6_from_str("2001:db8::", strlen("2001:db8::"), &prefix);
+    const size_t synthesized_count = ipv6_nat64_synthesize_batch(&prefix, 32, inputs, 3, batch);
+    const size_t extracted_count = ipv6_nat64_extract_batch(batch, 3, &prefix, 32, extracted, flags);
+    if (synthesized_count != 2 || extracted_count != 2 || !flags[0] || !flags[1] || flags[2] ||
+        ipv6_compare(&batch[1], &synthesized[0], 0) != IPV6_COMPARE_OK ||
+        ipv6_compare(&extracted[1], &ipv4, 0) != IPV6_COMPARE_OK) {
+        TEST_FAILED("    batch: %zu synthesized, %zu extracted\n", synthesized_count, extracted_count);
+    } else {
+        TEST_PASSED();
+    }
+}
+
+// Zones must be numeric scope ids or interned names, URI hosts escape them (RFC 6874)
+static void test_zone (test_status_t* status) {
+    typedef struct {
+        bool                uri;
+        const char*         input;
+        bool                valid;
+        uint32_t            flags;
+        uint32_t            mask;
+        uint16_t            zone;
+        const char*         iface;
+    } test_zone_t;
+
+    const test_zone_t tests[] = {
+        { false, "fe80::1%eth0", true, 0, 0, 0, "eth0" },
+        { false, "fe80::1%3", true, IPV6_FLAG_ZONE_ID, 0, 3, "3" },
+        { false, "fe80::1%65535", true, IPV6_FLAG_ZONE_ID, 0, 65535, "65535" },
+        { false, "fe80::1%65536", true, 0, 0, 0, "65536" },
+        { false, "[fe80::1%253]", true, IPV6_FLAG_ZONE_ID, 0, 253, "253" },
+        { false, "[fe80::1%250]", true, IPV6_FLAG_ZONE_ID, 0, 250, "250" },
+        { false, "[fe80::1%25foo]:80", true, IPV6_FLAG_HAS_PORT, 0, 0, "25foo" },
+        { false, "[fe80::1%25]", true, IPV6_FLAG_ZONE_ID, 0, 25, "25" },
+        { false, "fe80::1%en0.100", true, 0, 0, 0, "en0.100" },
+        { false, "fe80::1%wlan_0-a~b", true, 0, 0, 0, "wlan_0-a~b" },
+        { false, "fe80::1%", false, 0, 0, 0, NULL },
+        { false, "[fe80::1%]:80", false, 0, 0, 0, NULL },
+        { false, "fe80::1%eth:0", false, 0, 0, 0, NULL },
+        { false, "fe80::1%a%b", false, 0, 0, 0, NULL },
+        { false, "fe80::1%eth/0", true, IPV6_FLAG_HAS_MASK, 0, 0, "eth" },
+        { false, "fe80::1%eth0/64", true, IPV6_FLAG_HAS_MASK, 64, 0, "eth0" },
+        { false, "[fe80::1%3/64]:80", true, IPV6_FLAG_ZONE_ID | IPV6_FLAG_HAS_MASK | IPV6_FLAG_HAS_PORT, 64, 3, "3" },
+        { false, "fe80::1%/64", false, 0, 0, 0, NULL },
+        { false, "fe80::1%eth0/129", false, 0, 0, 0, NULL },
+        { false, "::1g", false, 0, 0, 0, NULL },
+        { true, "[fe80::1%25eth0]:80", true, IPV6_FLAG_HAS_PORT, 0, 0, "eth0" },
+        { true, "[fe80::1%253]", true, IPV6_FLAG_ZONE_ID, 0, 3, "3" },
+        { true, "[fe80::1%250]", true, IPV6_FLAG_ZONE_ID, 0, 0, "0" },
+        { true, "[fe80::1%2525foo]", true, 0, 0, 0, "25foo" },
+        { true, "fe80::1%253", true, IPV6_FLAG_ZONE_ID, 0, 253, "253" },
+        { true, "[fe80::1%25eth0/64]:80", true, IPV6_FLAG_HAS_MASK | IPV6_FLAG_HAS_PORT, 64, 0, "eth0" },
+        { true, "[fe80::1%25]", false, 0, 0, 0, NULL },
+        { true, "[fe80::1%eth0]", false, 0, 0, 0, NULL },
+        { true, "[fe80::1%2]", false, 0, 0, 0, NULL },
+    };
+
+    char str[IPV6_GEN_STRING_SIZE];
+    ipv6_diag_result_t diag;
+
+    for (uint32_t i = 0; i < LENGTHOF(tests); ++i) {
+        ipv6_address_full_t addr;
+        const bool valid = tests[i].uri ?
+            ipv6_from_uri_host(tests[i].input, strlen(tests[i].input), &addr, &diag) :
+            ipv6_from_str_compact(tests[i].input, strlen(tests[i].input), &addr, &diag);
+        bool ok = valid == tests[i].valid;
+        if (ok && valid) {
+            const uint32_t zone_flags = IPV6_FLAG_ZONE_ID | IPV6_FLAG_ZONE_INTERNED | IPV6_FLAG_HAS_PORT |
+                IPV6_FLAG_HAS_MASK;
+            ok = (addr.flags & zone_flags) == tests[i].flags &&
+                addr.mask == tests[i].mask &&
+                addr.zone == tests[i].zone &&
+                addr.iface_len == strlen(tests[i].iface) &&
+                !memcmp(addr.iface, tests[i].iface, addr.iface_len);
+        }
+        if (!ok) {
+            TEST_FAILED("    %s: valid %d, flags %x, zone %u, iface %.*s\n", tests[i].input, valid,
+                addr.flags, addr.zone, (int)addr.iface_len, addr.iface ? addr.iface : "");
+        } else {
+            TEST_PASSED();
+        }
+    }
+
+    // Letters outside a zone are still invalid characters
+    ipv6_address_full_t addr;
+    ipv6_from_str_compact("::1g", strlen("::1g"), &addr, &diag);
+    if (diag.event != IPV6_DIAG_INVALID_INPUT_CHAR) {
+        TEST_FAILED("    ::1g reported event %u\n", diag.event);
+    } else {
+        TEST_PASSED();
+    }
+
+    // Interned zones outlive their input and compare by id
+    ipv6_zone_table_t* table = ipv6_zone_table_create(2);
+    char input[32];
+    ipv6_address_full_t first;
+    ipv6_address_full_t second;
+    strcpy(input, "fe80::1%eth0");
+    ipv6_from_str(input, strlen(input), &first);
+    const bool interned = ipv6_zone_intern_address(table, &first);
+    memset(input, 'x', sizeof(input));
+    strcpy(input, "fe80::1%eth0");
+    ipv6_from_str(input, strlen(input), &second);
+    ipv6_zone_intern_address(table, &second);
+    memset(input, 'x', sizeof(input));
+    if (!interned || first.zone != 1 || !(first.flags & IPV6_FLAG_ZONE_INTERNED) ||
+        first.iface_len != 4 || memcmp(first.iface, "eth0", 4) ||
+        second.zone != 1 || second.iface != first.iface ||
+        strcmp(ipv6_zone_name(table, 1), "eth0") || ipv6_zone_count(table) != 1) {
+        TEST_FAILED("    interning eth0 gave zone %u\n", first.zone);
+    } else {
+        TEST_PASSED();
+    }
+
+    // Full tables, long names and unknown ids fail, numeric zones need no slot
+    char long_name[IPV6_ZONE_NAME_SIZE];
+    memset(long_name, 'a', sizeof(long_name));
+    ipv6_address_full_t numeric;
+    ipv6_address_full_t unnamed;
+    ipv6_from_str("fe80::1%7", strlen("fe80::1%7"), &numeric);
+    ipv6_from_str("fe80::1", strlen("fe80::1"), &unnamed);
+    const uint16_t second_id = ipv6_zone_intern(table, "eth1", 4);
+    strcpy(input, "fe80::1%eth2");
+    ipv6_from_str(input, strlen(input), &first);
+    second = first;
+    const bool rejected =
+        second_id == 2 &&
+        ipv6_zone_intern(table, "eth1", 4) == 2 &&
+        ipv6_zone_find(table, "eth1", 4) == 2 &&
+        ipv6_zone_find(table, "eth2", 4) == 0 &&
+        ipv6_zone_intern(table, "eth2", 4) == 0 &&
+        ipv6_zone_intern(table, long_name, sizeof(long_name)) == 0 &&
+        ipv6_zone_intern(table, "", 0) == 0 &&
+        ipv6_zone_name(table, 0) == NULL &&
+        ipv6_zone_name(table, 3) == NULL &&
+        !ipv6_zone_intern_address(table, &first) &&
+        ipv6_compare(&first, &second, 0) == IPV6_COMPARE_OK && first.iface == second.iface &&
+        ipv6_zone_intern_address(table, &numeric) && numeric.zone == 7 && numeric.iface == NULL &&
+        ipv6_zone_intern_address(table, &unnamed) && unnamed.zone == 0;
+    if (!rejected) {
+        TEST_FAILED("    full table or invalid names accepted\n");
+    } else {
+        TEST_PASSED();
+    }
+    ipv6_zone_table_destroy(table);
+
+    // Batches intern what fits
+    ipv6_address_full_t batch[4];
+    const char* batch_inputs[4] = { "fe80::1%a", "fe80::2%b", "fe80::3%a", "fe80::4%c" };
+    table = ipv6_zone_table_create(2);
+    for (uint32_t i = 0; i < LENGTHOF(batch); ++i) {
+        ipv6_from_str(batch_inputs[i], strlen(batch_inputs[i]), &batch[i]);
+    }
+    const size_t batch_count = ipv6_zone_intern_batch(table, batch, LENGTHOF(batch));
+    if (batch_count != 3 || batch[0].zone != 1 || batch[1].zone != 2 || batch[2].zone != 1 ||
+        (batch[3].flags & IPV6_FLAG_ZONE_INTERNED)) {
+        TEST_FAILED("    batch interned %zu\n", batch_count);
+    } else {
+        TEST_PASSED();
+    }
+    ipv6_zone_table_destroy(table);
+
+    // Numeric zones are scope ids of socket addresses without a name lookup
+    struct sockaddr_in6 sa6;
+    uint32_t scope_id = 0;
+    ipv6_address_full_t from_sockaddr;
+    const size_t sa_len = ipv6_to_sockaddr(&numeric, (struct sockaddr*)&sa6, sizeof(sa6));
+    if (!sa_len || sa6.sin6_scope_id != 7 ||
+        !ipv6_from_sockaddr((struct sockaddr*)&sa6, sa_len, &from_sockaddr, &scope_id) ||
+        scope_id != 7 || from_sockaddr.zone != 7 || !(from_sockaddr.flags & IPV6_FLAG_ZONE_ID)) {
+        TEST_FAILED("    scope id %u did not round trip\n", (uint32_t)sa6.sin6_scope_id);
+    } else {
+        TEST_PASSED();
+    }
+
+    // Zones are not formatted
+    ipv6_to_str(&numeric, str, sizeof(str));
+    if (strcmp(str, "fe80::1")) {
+        TEST_FAILED("    formatted %s\n", str);
+    } else {
+        TEST_PASSED();
+    }
+}
+
+// Bulk validation must report every failure grouped by event, for any thread count
+static void test_validate (test_status_t* status) {
+    const char* pool[] = {
+        "::1",
+        "1:2:3",
+        "10.0.0.1:80",
+        "[::1]:99999",
+        "2001:db8::/32",
+        "::1g",
+        "",
+    };
+
+    static const char* inputs[10000];
+    static ipv6_validate_report_t reports[2];
+    size_t expected_counts[IPV6_DIAG_EVENT_COUNT] = { 0, };
+    size_t expected_first[IPV6_DIAG_EVENT_COUNT];
+    ipv6_address_full_t addr;
+    ipv6_diag_result_t diag;
+
+    for (uint32_t i = 0; i < LENGTHOF(inputs); ++i) {
+        inputs[i] = pool[(i * i + i / 3) % LENGTHOF(pool)];
+        if (!ipv6_from_str_compact(inputs[i], strlen(inputs[i]), &addr, &diag) &&
+            !expected_counts[diag.event]++) {
+            expected_first[diag.event] = i;
+        }
+    }
+
+    for (uint32_t r = 0; r < LENGTHOF(reports); ++r) {
+        ipv6_validate_options_t options = { 0, };
+        options.threads = r ? 4 : 1;
+
+        if (!ipv6_validate_bulk(inputs, NULL, LENGTHOF(inputs), &options, &reports[r])) {
+            TEST_FAILED("    ipv6_validate_bulk failed with %u threads\n", options.threads);
+            return;
+        }
+
+        const ipv6_validate_report_t* report = &reports[r];
+        bool grouped = report->inputs == LENGTHOF(inputs) && report->valid + report->invalid == report->inputs;
+        for (uint32_t e = 0; e < IPV6_DIAG_EVENT_COUNT && grouped; ++e) {
+            grouped = report->event_counts[e] == expected_counts[e];
+            for (size_t i = 0; i < report->event_counts[e] && grouped; ++i) {
+                const size_t index = report->indices[report->event_offsets[e] + i];
+                grouped = !ipv6_from_str_compact(inputs[index], strlen(inputs[index]), &addr, &diag) &&
+                    diag.event == (ipv6_diag_event_t)e &&
+                    (i == 0 || index > report->indices[report->event_offsets[e] + i - 1]);
+            }
+            if (grouped && expected_counts[e]) {
+                grouped = report->examples[e][0].index == expected_first[e] &&
+                    report->example_counts[e] == (expected_counts[e] < IPV6_VALIDATE_MAX_EXAMPLES ?
+                        expected_counts[e] : IPV6_VALIDATE_MAX_EXAMPLES);
+            }
+        }
+
+        if (!grouped) {
+            TEST_FAILED("    unexpected report with %u threads\n", options.threads);
+        } else {
+            TEST_PASSED();
+        }
+    }
+
+    if (memcmp(reports[0].event_counts, reports[1].event_counts, sizeof(reports[0].event_counts)) ||
+        memcmp(reports[0].indices, reports[1].indices, reports[0].invalid * sizeof(size_t)) ||
+        memcmp(reports[0].examples, reports[1].examples, sizeof(reports[0].examples))) {
+        TEST_FAILED("    reports differ between thread counts\n");
+    } else {
+        TEST_PASSED();
+    }
+
+    ipv6_validate_report_free(&reports[1]);
+
+    // Lines split over many chunks report like the array, on threads or an executor
+    static char buffer[LENGTHOF(inputs) * 16];
+    size_t buffer_bytes = 0;
+    for (uint32_t i = 0; i < LENGTHOF(inputs); ++i) {
+        const size_t len = strlen(inputs[i]);
+        memcpy(buffer + buffer_bytes, inputs[i], len);
+        buffer_bytes += len;
+        buffer[buffer_bytes++] = '\n';
+    }
+
+    uint32_t executor_runs = 0;
+    ipv6_executor_t executor = { test_reverse_executor, &executor_runs, 5, 0 };
+    for (uint32_t r = 0; r < 2; ++r) {
+        ipv6_validate_options_t options = { 0, };
+        options.threads = 4;
+        options.executor = r ? &executor : NULL;
+
+        if (!ipv6_validate_lines(buffer, buffer_bytes, &options, &reports[1]) ||
+            reports[1].inputs != reports[0].inputs ||
+            memcmp(reports[0].event_counts, reports[1].event_counts, sizeof(reports[0].event_counts)) ||
+            memcmp(reports[0].indices, reports[1].indices, reports[0].invalid * sizeof(size_t)) ||
+            memcmp(reports[0].examples, reports[1].examples, sizeof(reports[0].examples))) {
+            TEST_FAILED("    line report differs from array report (%s)\n", r ? "executor" : "threads");
+        } else {
+            TEST_PASSED();
+        }
+        ipv6_validate_report_free(&reports[1]);
+    }
+    if (executor_runs != 1) {
+        TEST_FAILED("    executor used %u times\n", executor_runs);
+    } else {
+        TEST_PASSED();
+    }
+
+    ipv6_validate_report_free(&reports[0]);
+
+    // Lines may end in CRLF, empty lines fail and the last line needs no newline
+    const char* lines = "::1\r\n1:2:3\n\n[::1]:99999\n10.0.0.1";
+    if (!ipv6_validate_lines(lines, strlen(lines), NULL, &reports[0]) ||
+        reports[0].inputs != 5 || reports[0].invalid != 3 ||
+        reports[0].event_counts[IPV6_DIAG_INVALID_INPUT] != 1 ||
+        reports[0].examples[IPV6_DIAG_INVALID_INPUT][0].index != 2 ||
+        reports[0].event_counts[IPV6_DIAG_INVALID_PORT] != 1 ||
+        reports[0].examples[IPV6_DIAG_INVALID_PORT][0].index != 3) {
+        TEST_FAILED("    unexpected line report\n");
+    } else {
+        TEST_PASSED();
+    }
+    ipv6_validate_report_free(&reports[0]);
+}
+
 int main (void) {
     test_group_t test_groups[] = {
         { "test_parsing", test_parsing },
         { "test_parsing_diag", test_parsing_diag },
+        { "test_diag_describe", test_diag_describe },
         { "test_comparisons", test_comparisons },
         { "test_api_use_loopback_const", test_api_use_loopback_const },
-        { "test_invalid_to_str", test_invalid_to_str }
+        { "test_invalid_to_str", test_invalid_to_str },
+        { "test_normalize", test_normalize },
+        { "test_generator", test_generator },
+        { "test_stats", test_stats },
+        { "test_profile", test_profile },
+        { "test_batch", test_batch },
+        { "test_counters", test_counters },
+        { "test_cache", test_cache },
+        { "test_pipeline", test_pipeline },
+        { "test_sockaddr", test_sockaddr },
+        { "test_network_order", test_network_order },
+        { "test_arpa", test_arpa },
+        { "test_range", test_range },
+        { "test_classify", test_classify },
+        { "test_nat64", test_nat64 },
+        { "test_zone", test_zone },
+        { "test_validate", test_validate },
+        { "test_header_only", test_header_only },
     };
 
     uint32_t total_failures = 0;
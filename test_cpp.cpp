@@ -0,0 +1,528 @@
+#if defined(IPV6_TEST_FMT)
+#include <fmt/format.h>
+#endif
+
+#include "ipv6.hpp"
+#include "ipv6_format.hpp"
+#include "ipv6_gen.h"
+
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <string>
+#include <unordered_map>
+
+//
+// Tests of the C++ interface, ipv6.hpp
+//
+// Compile-time checks are static_asserts, this file failing to build is a
+// test failure. The runtime groups compare the C++ layer to the C library.
+//
+
+using namespace ipv6::literals;
+
+// Capture high level test run status
+struct test_status_t {
+    uint32_t                total_tests;
+    uint32_t                failed_count;
+};
+
+// Structure to represent function over group of tests
+struct test_group_t {
+    const char*             name;
+    void                    (*func)(test_status_t* status);
+};
+
+#define LENGTHOF(x) ((uint32_t)(sizeof(x)/sizeof(x[0])))
+
+#define TEST_FAILED(...) \
+    printf("  FAILED %s:%d", (const char *)__FILE__, (int32_t)__LINE__); \
+    printf(__VA_ARGS__); \
+    status->failed_count++; \
+    status->total_tests++
+
+#define TEST_PASSED(...) \
+    status->total_tests++;
+
+//
+// Address literals are parsed by the compiler
+//
+constexpr ipv6_address_full_t literal_loopback = "::1"_ipv6;
+static_assert(literal_loopback.address.components[7] == 1, "::1");
+static_assert(literal_loopback.flags == 0, "::1 flags");
+
+constexpr ipv6_address_full_t literal_prefix = "2001:db8::1/64"_ipv6;
+static_assert(literal_prefix.address.components[0] == 0x2001, "2001:db8::1/64");
+static_assert(literal_prefix.address.components[1] == 0x0db8, "2001:db8::1/64");
+static_assert(literal_prefix.address.components[7] == 1, "2001:db8::1/64");
+static_assert(literal_prefix.mask == 64 && literal_prefix.flags == IPV6_FLAG_HAS_MASK, "2001:db8::1/64 mask");
+
+constexpr ipv6_address_full_t literal_port = "[fe80::1:2]:8080"_ipv6;
+static_assert(literal_port.port == 8080 && literal_port.flags == IPV6_FLAG_HAS_PORT, "[fe80::1:2]:8080");
+static_assert(literal_port.address.components[6] == 1 && literal_port.address.components[7] == 2, "[fe80::1:2]:8080");
+
+constexpr ipv6_address_full_t literal_v4 = "10.1.2.3:53"_ipv6;
+static_assert(literal_v4.address.components[0] == 0x0a01 && literal_v4.address.components[1] == 0x0203, "10.1.2.3:53");
+static_assert(literal_v4.flags == (IPV6_FLAG_IPV4_COMPAT | IPV6_FLAG_HAS_PORT), "10.1.2.3:53 flags");
+
+constexpr ipv6_address_full_t literal_embed = "::ffff:192.168.0.1"_ipv6;
+static_assert(literal_embed.address.components[5] == 0xffff && literal_embed.address.components[6] == 0xc0a8, "::ffff:192.168.0.1");
+static_assert(literal_embed.flags == IPV6_FLAG_IPV4_EMBED, "::ffff:192.168.0.1 flags");
+
+// Failures report the event and position of ipv6_from_str_diag
+static_assert(!ipv6::parse("1:2:3"), "1:2:3");
+static_assert(ipv6::parse("1:2:3").event == IPV6_DIAG_V6_BAD_COMPONENT_COUNT, "1:2:3 event");
+static_assert(ipv6::parse("1:2:3").position == 5, "1:2:3 position");
+static_assert(ipv6::parse("::1g").event == IPV6_DIAG_INVALID_INPUT_CHAR, "::1g event");
+static_assert(ipv6::parse("[::1]:70000").event == IPV6_DIAG_INVALID_PORT, "[::1]:70000 event");
+static_assert(ipv6::parse("ffffffff::1").event == IPV6_DIAG_V6_COMPONENT_OUT_OF_RANGE, "ffffffff::1 event");
+static_assert(ipv6::parse("").event == IPV6_DIAG_INVALID_INPUT, "empty event");
+
+// The constexpr string bound must track IPV6_STRING_SIZE
+static void test_string_size (test_status_t* status) {
+    if (ipv6::detail::string_size != IPV6_STRING_SIZE) {
+        TEST_FAILED("    string_size %u != IPV6_STRING_SIZE %u\n",
+            (uint32_t)ipv6::detail::string_size, IPV6_STRING_SIZE);
+    } else {
+        TEST_PASSED();
+    }
+}
+
+// ipv6::parse must agree with the C parser on every generated input
+static void test_constexpr_parse (test_status_t* status) {
+    ipv6_gen_config_t config;
+    ipv6_gen_t gen;
+
+    ipv6_gen_config_init(&config, 6061);
+    config.port_rate = 0.3;
+    config.mask_rate = 0.3;
+    config.zone_rate = 0.1;
+    config.embed_rate = 0.3;
+    ipv6_gen_set_invalid_rate(&config, 0.4);
+
+    if (!ipv6_gen_init(&gen, &config)) {
+        TEST_FAILED("    ipv6_gen_init failed\n");
+        return;
+    }
+
+    for (uint32_t i = 0; i < 20000; ++i) {
+        char str[IPV6_GEN_STRING_SIZE];
+        ipv6_address_full_t addr;
+        ipv6_diag_result_t diag;
+
+        const size_t len = ipv6_gen_at(&gen, i, str, sizeof(str), nullptr);
+        const bool parsed = ipv6_from_str_compact(str, len, &addr, &diag);
+        const ipv6::parse_result result = ipv6::parse(std::string_view(str, len));
+
+        if (parsed != result.ok) {
+            TEST_FAILED("    acceptance differs: %s\n", str);
+        } else if (!parsed && (diag.event != result.event || diag.position != result.position)) {
+            TEST_FAILED("    diagnostic differs: %s: %s@%u != %s@%u\n", str,
+                ipv6_diag_event_str(result.event), result.position,
+                ipv6_diag_event_str(diag.event), diag.position);
+        } else if (parsed && (
+                memcmp(&addr.address, &result.address.address, sizeof(addr.address)) ||
+                addr.port != result.address.port ||
+                addr.mask != result.address.mask ||
+                addr.flags != result.address.flags)) {
+            TEST_FAILED("    address differs: %s\n", str);
+        } else {
+            TEST_PASSED();
+        }
+    }
+}
+
+// Specialized parsers reject the grammar they leave out
+static_assert(ipv6::parse<ipv6::feature::v6_only>("2001:db8::1"), "v6_only");
+static_assert(!ipv6::parse<ipv6::feature::v6_only>("[2001:db8::1]:80"), "v6_only port");
+static_assert(ipv6::parse<ipv6::feature::v6_only>("::1/64").event == IPV6_DIAG_INVALID_INPUT_CHAR, "v6_only mask");
+static_assert(ipv6::parse<ipv6::feature::v6_only>("::1/64").position == 3, "v6_only mask position");
+static_assert(ipv6::parse<ipv6::feature::v4 | ipv6::feature::port>("10.0.0.1:53").address.port == 53, "v4 port");
+static_assert(!ipv6::parse<ipv6::feature::v4 | ipv6::feature::port>("::1"), "v4 port v6");
+static_assert(!ipv6::parse<ipv6::feature::v6 | ipv6::feature::v4>("::ffff:1.2.3.4"), "no embed");
+
+// Grammar used by a parsed address, in ipv6::feature bits
+static uint32_t features_used (const char* str, const ipv6_address_full_t& addr) {
+    uint32_t used = 0;
+    used |= (addr.flags & IPV6_FLAG_IPV4_COMPAT) ? ipv6::feature::v4 : ipv6::feature::v6;
+    used |= (addr.flags & IPV6_FLAG_IPV4_EMBED) ? ipv6::feature::embed : 0;
+    used |= (addr.flags & IPV6_FLAG_HAS_PORT) || strpbrk(str, "[]") ? ipv6::feature::port : 0;
+    used |= (addr.flags & IPV6_FLAG_HAS_MASK) ? ipv6::feature::mask : 0;
+    used |= strchr(str, '%') ? ipv6::feature::zone : 0;
+    return used;
+}
+
+template <uint32_t Features>
+static void check_specialized (test_status_t* status, const char* str, size_t len, const ipv6::parse_result& full) {
+    const ipv6::parse_result result = ipv6::parse<Features>(std::string_view(str, len));
+    const bool expected = full.ok && !(features_used(str, full.address) & ~Features);
+
+    if (result.ok != expected) {
+        TEST_FAILED("    features 0x%02x: %s %s\n", Features, str, expected ? "rejected" : "accepted");
+    } else if (result.ok && memcmp(&result.address, &full.address, sizeof(full.address))) {
+        TEST_FAILED("    features 0x%02x: %s address differs\n", Features, str);
+    } else {
+        TEST_PASSED();
+    }
+}
+
+// A specialized parser accepts exactly the inputs of its shape, with the full parser's result
+static void test_specialized_parse (test_status_t* status) {
+    ipv6_gen_config_t config;
+    ipv6_gen_t gen;
+
+    ipv6_gen_config_init(&config, 6064);
+    config.port_rate = 0.3;
+    config.mask_rate = 0.3;
+    config.zone_rate = 0.1;
+    config.embed_rate = 0.3;
+    ipv6_gen_set_invalid_rate(&config, 0.2);
+
+    if (!ipv6_gen_init(&gen, &config)) {
+        TEST_FAILED("    ipv6_gen_init failed\n");
+        return;
+    }
+
+    namespace f = ipv6::feature;
+    for (uint32_t i = 0; i < 5000; ++i) {
+        char str[IPV6_GEN_STRING_SIZE];
+        const size_t len = ipv6_gen_at(&gen, i, str, sizeof(str), nullptr);
+        const ipv6::parse_result full = ipv6::parse(std::string_view(str, len));
+
+        check_specialized<f::v6_only>(status, str, len, full);
+        check_specialized<f::v6 | f::port | f::mask>(status, str, len, full);
+        check_specialized<f::v6 | f::embed | f::zone>(status, str, len, full);
+        check_specialized<f::v4>(status, str, len, full);
+        check_specialized<f::v4 | f::port>(status, str, len, full);
+        check_specialized<f::all & ~f::zone>(status, str, len, full);
+    }
+}
+
+// Value semantics are usable in constant expressions
+static_assert(ipv6::address(literal_prefix) == ipv6::address("2001:db8::1/64"_ipv6), "equality");
+static_assert(ipv6::address(literal_loopback) != ipv6::address(literal_prefix), "inequality");
+static_assert(ipv6::address::compare(ipv6::address("::1"_ipv6), ipv6::address("::2"_ipv6)) < 0, "ordering");
+static_assert(ipv6::address("::1"_ipv6).hash() != ipv6::address("::2"_ipv6).hash(), "hash");
+static_assert(ipv6::address("[fe80::1%3]"_ipv6).zone() == 3, "scope id");
+static_assert(ipv6::address("[fe80::1%253]"_ipv6).zone() == 253, "zones are not unescaped");
+static_assert(ipv6::address("fe80::1%3"_ipv6) != ipv6::address("fe80::1%4"_ipv6), "scope ids compare");
+static_assert(ipv6::parse("fe80::1%eth0/64").address.mask == 64, "zone then prefix (RFC 4007)");
+static_assert(ipv6::parse("[fe80::1%3/64]:80").address.zone == 3, "zone then prefix (RFC 4007)");
+
+// The value type must round trip, order consistently and key standard containers
+static void test_value_type (test_status_t* status) {
+    const char* inputs[] = {
+        "::1",
+        "::2",
+        "[::1]:80",
+        "[::1]:81",
+        "::1/64",
+        "1.2.3.4",
+        "::ffff:1.2.3.4",
+        "2001:db8::1",
+        "2001:db8:0:0:0:0:0:1",
+        "ff02::1",
+    };
+
+    std::unordered_map<ipv6::address, uint32_t> by_hash;
+    std::map<ipv6::address, uint32_t> by_order;
+
+    for (uint32_t i = 0; i < LENGTHOF(inputs); ++i) {
+        const std::optional<ipv6::address> a = ipv6::address::from(inputs[i]);
+        if (!a) {
+            TEST_FAILED("    from failed: %s\n", inputs[i]);
+            continue;
+        }
+
+        char expected[64];
+        char buffer[64];
+        ipv6_to_str(&a->native(), expected, sizeof(expected));
+        const std::to_chars_result result = a->to_chars(buffer, buffer + sizeof(buffer));
+        const std::optional<ipv6::address> again = ipv6::address::from(
+            std::string_view(buffer, (size_t)(result.ptr - buffer)));
+
+        if (result.ec != std::errc() ||
+            std::string_view(buffer, (size_t)(result.ptr - buffer)) != expected ||
+            !again || *again != *a) {
+            TEST_FAILED("    to_chars round trip failed: %s\n", inputs[i]);
+        } else {
+            TEST_PASSED();
+        }
+
+        // Network order parses are the same value
+        ipv6_address_full_t network;
+        if (!ipv6_from_str_network(inputs[i], strlen(inputs[i]), &network, nullptr) ||
+            ipv6::address(network) != *a || ipv6::address(network).hash() != a->hash() ||
+            ipv6::address::compare(ipv6::address(network), *a) != 0) {
+            TEST_FAILED("    network order differs: %s\n", inputs[i]);
+        } else {
+            TEST_PASSED();
+        }
+
+        by_hash[*a]++;
+        by_order[*a]++;
+        by_hash[ipv6::address(network)]++;
+        by_order[ipv6::address(network)]++;
+    }
+
+    // 2001:db8::1 is written twice, every other input is distinct, network
+    // order parses key the same entries
+    if (by_hash.size() != LENGTHOF(inputs) - 1 || by_order.size() != LENGTHOF(inputs) - 1 ||
+        by_hash[*ipv6::address::from("2001:db8::1")] != 4) {
+        TEST_FAILED("    container keys: %u hashed, %u ordered\n",
+            (uint32_t)by_hash.size(), (uint32_t)by_order.size());
+    } else {
+        TEST_PASSED();
+    }
+
+    // Ordered iteration is strictly ascending
+    const ipv6::address* previous = nullptr;
+    bool ascending = true;
+    for (const auto& entry : by_order) {
+        ascending = ascending && (!previous || ipv6::address::compare(*previous, entry.first) < 0);
+        previous = &entry.first;
+    }
+    if (!ascending) {
+        TEST_FAILED("    std::map iteration not ascending\n");
+    } else {
+        TEST_PASSED();
+    }
+
+    // Failures report the diagnostic, a short buffer is value_too_large
+    ipv6_diag_result_t diag;
+    char small[2];
+    if (ipv6::address::from("1:2:3", &diag) || diag.event != IPV6_DIAG_V6_BAD_COMPONENT_COUNT ||
+        ipv6::address::from("::1").value().to_chars(small, small + sizeof(small)).ec != std::errc::value_too_large ||
+        ipv6::address::from(std::string_view("::1/64", 3)).value() != ipv6::address("::1"_ipv6)) {
+        TEST_FAILED("    failure handling\n");
+    } else {
+        TEST_PASSED();
+    }
+
+    // Zone names are interned or rejected, never merged into one key
+    ipv6_zone_table_t* table = ipv6_zone_table_create(4);
+    ipv6_diag_result_t zone_diag = {};
+    const std::optional<ipv6::address> eth0 = ipv6::address::from("fe80::1%eth0", table);
+    const std::optional<ipv6::address> eth0_again = ipv6::address::from("fe80::1%eth0", table);
+    const std::optional<ipv6::address> eth1 = ipv6::address::from("fe80::1%eth1", table);
+    const std::optional<ipv6::address> unzoned = ipv6::address::from("fe80::1", table);
+    std::unordered_map<ipv6::address, uint32_t> zoned;
+    if (eth0 && eth1 && unzoned) {
+        zoned[*eth0]++;
+        zoned[*eth1]++;
+        zoned[*unzoned]++;
+    }
+    if (!eth0 || !eth0_again || !eth1 || !unzoned || *eth0 != *eth0_again ||
+        *eth0 == *eth1 || *eth0 == *unzoned || *eth1 == *unzoned || zoned.size() != 3 ||
+        ipv6::address::from("fe80::1%eth0", &zone_diag) || zone_diag.event != IPV6_DIAG_INVALID_INPUT ||
+        zone_diag.position != 8 || ipv6::address::from("fe80::1%65536") ||
+        ipv6::address::from("fe80::1%3").value().zone() != 3) {
+        TEST_FAILED("    zone names: %u keys\n", (uint32_t)zoned.size());
+    } else {
+        TEST_PASSED();
+    }
+    ipv6_zone_table_destroy(table);
+
+    // Normalized, both IPv4 spellings are one key
+    std::unordered_map<ipv6::address, uint32_t> normalized;
+    for (uint32_t i = 0; i < LENGTHOF(inputs); ++i) {
+        normalized[ipv6::address::from(inputs[i])->normalized()]++;
+    }
+    if (normalized.size() != LENGTHOF(inputs) - 2 ||
+        normalized[ipv6::address::from("1.2.3.4")->normalized()] != 2) {
+        TEST_FAILED("    normalized keys: %u\n", (uint32_t)normalized.size());
+    } else {
+        TEST_PASSED();
+    }
+}
+
+// The emitter runs in constant expressions
+constexpr bool formats_as (const ipv6_address_full_t& in, std::string_view expected, ipv6::format_spec spec = {}) {
+    char buffer[96] = {};
+    const char* end = ipv6::format_to(buffer, in, spec);
+    return std::string_view(buffer, (size_t)(end - buffer)) == expected;
+}
+static_assert(formats_as("[fe80::1:2]:8080"_ipv6, "[fe80::1:2]:8080"), "format");
+static_assert(formats_as("::ffff:192.168.0.1"_ipv6, "::ffff:192.168.0.1"), "format embed");
+
+// Default output is ipv6_to_str, the specs transform it
+static void test_format (test_status_t* status) {
+    ipv6_gen_config_t config;
+    ipv6_gen_t gen;
+
+    ipv6_gen_config_init(&config, 6063);
+    config.port_rate = 0.3;
+    config.mask_rate = 0.3;
+    config.embed_rate = 0.3;
+
+    if (!ipv6_gen_init(&gen, &config)) {
+        TEST_FAILED("    ipv6_gen_init failed\n");
+        return;
+    }
+
+    ipv6::format_spec upper;
+    upper.uppercase = true;
+    ipv6::format_spec expanded;
+    expanded.expanded = true;
+    expanded.no_port = true;
+    expanded.no_mask = true;
+
+    for (uint32_t i = 0; i < 10000; ++i) {
+        char str[IPV6_GEN_STRING_SIZE];
+        char expected[ipv6::detail::string_size];
+        ipv6_address_full_t addr;
+
+        const size_t len = ipv6_gen_at(&gen, i, str, sizeof(str), nullptr);
+        if (!ipv6_from_str(str, len, &addr)) {
+            TEST_FAILED("    generated input did not parse: %s\n", str);
+            continue;
+        }
+        ipv6_to_str(&addr, expected, sizeof(expected));
+
+        std::string out;
+        ipv6::format_to(std::back_inserter(out), addr);
+        std::string out_upper;
+        ipv6::format_to(std::back_inserter(out_upper), addr, upper);
+        std::string out_expanded;
+        ipv6::format_to(std::back_inserter(out_expanded), addr, expanded);
+
+        std::string expected_upper = expected;
+        for (char& c : expected_upper) {
+            c = (char)toupper((unsigned char)c);
+        }
+
+        ipv6_address_full_t again;
+        const bool reparsed = ipv6_from_str(out_expanded.c_str(), out_expanded.size(), &again);
+        const bool compat = (addr.flags & IPV6_FLAG_IPV4_COMPAT) != 0;
+
+        if (out != expected) {
+            TEST_FAILED("    default %s != %s\n", out.c_str(), expected);
+        } else if (out_upper != expected_upper) {
+            TEST_FAILED("    uppercase %s != %s\n", out_upper.c_str(), expected_upper.c_str());
+        } else if (!reparsed || memcmp(&again.address, &addr.address, sizeof(addr.address)) ||
+                (!compat && out_expanded.size() != 39)) {
+            TEST_FAILED("    expanded %s of %s\n", out_expanded.c_str(), expected);
+        } else {
+            TEST_PASSED();
+        }
+    }
+
+    struct {
+        const char*         input;
+        const char*         spec;
+        const char*         expected;
+    } cases[] = {
+        { "[2001:db8::1/64]:80", "", "[2001:db8::1/64]:80" },
+        { "[2001:db8::1/64]:80", "P", "2001:db8::1/64" },
+        { "[2001:db8::1/64]:80", "M", "[2001:db8::1]:80" },
+        { "[2001:db8::1/64]:80", "PM", "2001:db8::1" },
+        { "[2001:db8::1/64]:80", "eMP", "2001:0db8:0000:0000:0000:0000:0000:0001" },
+        { "2001:db8::abcd", "U", "2001:DB8::ABCD" },
+        { "::ffff:1.2.3.4", "e", "0000:0000:0000:0000:0000:ffff:0102:0304" },
+        { "1.2.3.4:53", "P", "1.2.3.4" },
+        { "1.2.3.4:53", "r", "4.3.2.1.in-addr.arpa" },
+        { "[2001:db8::1]:53", "r", "1.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.8.b.d.0.1.0.0.2.ip6.arpa" },
+        { "::abcd", "rU", "D.C.B.A.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.ip6.arpa" },
+    };
+
+    for (uint32_t i = 0; i < LENGTHOF(cases); ++i) {
+        ipv6_address_full_t addr;
+        ipv6::format_spec spec;
+        bool ok = false;
+        const std::string_view spec_str(cases[i].spec);
+        ipv6::detail::parse_format_spec(spec_str.begin(), spec_str.end(), spec, ok);
+
+        std::string out;
+        if (ok && ipv6_from_str(cases[i].input, strlen(cases[i].input), &addr)) {
+            ipv6::format_to(std::back_inserter(out), addr, spec);
+        }
+
+        // Network order parses format the same
+        std::string out_network;
+        if (ok && ipv6_from_str_network(cases[i].input, strlen(cases[i].input), &addr, nullptr)) {
+            ipv6::format_to(std::back_inserter(out_network), addr, spec);
+        }
+
+        if (out != cases[i].expected || out_network != cases[i].expected) {
+            TEST_FAILED("    {:%s} of %s: %s, network %s != %s\n", cases[i].spec, cases[i].input,
+                out.c_str(), out_network.c_str(), cases[i].expected);
+        } else {
+            TEST_PASSED();
+        }
+    }
+
+    // Unknown spec characters are rejected
+    ipv6::format_spec spec;
+    bool ok = true;
+    const std::string_view bad("ex}");
+    if (*ipv6::detail::parse_format_spec(bad.begin(), bad.end(), spec, ok) != 'x' || ok) {
+        TEST_FAILED("    unknown spec character accepted\n");
+    } else {
+        TEST_PASSED();
+    }
+
+    const ipv6::address a = *ipv6::address::from("[2001:db8::1/64]:80");
+    (void)a;
+
+#if defined(IPV6_TEST_FMT)
+    bool threw = false;
+    try {
+        (void)fmt::format(fmt::runtime("{:q}"), a);
+    } catch (const fmt::format_error&) {
+        threw = true;
+    }
+
+    if (fmt::format("{}", a) != "[2001:db8::1/64]:80" ||
+        fmt::format("<{:PM}>", a) != "<2001:db8::1>" ||
+        fmt::format("{:eUP}", a.native()) != "2001:0DB8:0000:0000:0000:0000:0000:0001/64" ||
+        !threw) {
+        TEST_FAILED("    fmt::formatter\n");
+    } else {
+        TEST_PASSED();
+    }
+#endif
+
+#if defined(__cpp_lib_format)
+    if (std::format("{}", a) != "[2001:db8::1/64]:80" || std::format("{:P}", a.native()) != "2001:db8::1/64") {
+        TEST_FAILED("    std::formatter\n");
+    } else {
+        TEST_PASSED();
+    }
+#endif
+}
+
+int main (void) {
+    test_group_t test_groups[] = {
+        { "test_string_size", test_string_size },
+        { "test_constexpr_parse", test_constexpr_parse },
+        { "test_specialized_parse", test_specialized_parse },
+        { "test_value_type", test_value_type },
+        { "test_format", test_format },
+    };
+
+    uint32_t total_failures = 0;
+    uint32_t total_tests = 0;
+
+    for (uint32_t i = 0; i < LENGTHOF(test_groups); ++i) {
+        test_status_t status = { 0, 0 };
+        printf("%s\n===\n", test_groups[i].name);
+        test_groups[i].func(&status);
+
+        printf("\n%u/%u passed (%u failures).\n\n",
+            (uint32_t)(status.total_tests - status.failed_count),
+            status.total_tests,
+            status.failed_count);
+
+        total_tests += status.total_tests;
+        total_failures += status.failed_count;
+    }
+
+    printf("======\n  total: %u/%u passed (%u failures).\n\n",
+        (uint32_t)(total_tests - total_failures),
+        total_tests,
+        total_failures);
+
+    return 0;
+}
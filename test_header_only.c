@@ -0,0 +1,36 @@
+#define IPV6_PARSE_HEADER_ONLY 1
+
+#include "ipv6.h"
+
+//
+// Entry points into the header-only parser for test.c, which checks them
+// against the library build
+//
+
+//--------------------------------------------------------------------------------
+bool test_header_only_from_str (
+    const char* input,
+    size_t input_bytes,
+    ipv6_address_full_t* out,
+    ipv6_diag_result_t* result)
+{
+    return ipv6_from_str_compact(input, input_bytes, out, result);
+}
+
+//--------------------------------------------------------------------------------
+size_t test_header_only_to_str (
+    const ipv6_address_full_t* in,
+    char* output,
+    size_t output_bytes)
+{
+    return ipv6_to_str(in, output, output_bytes);
+}
+
+//--------------------------------------------------------------------------------
+ipv6_compare_result_t test_header_only_compare (
+    const ipv6_address_full_t* a,
+    const ipv6_address_full_t* b,
+    uint32_t ignore_flags)
+{
+    return ipv6_compare(a, b, ignore_flags);
+}